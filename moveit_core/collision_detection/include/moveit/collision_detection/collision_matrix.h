@@ -39,10 +39,12 @@
 #include <moveit/collision_detection/collision_common.h>
 #include <moveit/macros/class_forward.h>
 #include <moveit_msgs/msg/allowed_collision_matrix.hpp>
+#include <atomic>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <map>
+#include <mutex>
 
 namespace collision_detection
 {
@@ -91,7 +93,12 @@ public:
   AllowedCollisionMatrix(const moveit_msgs::msg::AllowedCollisionMatrix& msg);
 
   /** @brief Copy constructor */
-  AllowedCollisionMatrix(const AllowedCollisionMatrix& acm) = default;
+  AllowedCollisionMatrix(const AllowedCollisionMatrix& acm);
+
+  /** @brief Copy operator */
+  AllowedCollisionMatrix& operator=(const AllowedCollisionMatrix& acm);
+
+  ~AllowedCollisionMatrix();
 
   /** @brief Get the type of the allowed collision between two elements. Return true if the entry is included in the
    * collision matrix.
@@ -265,14 +272,41 @@ public:
   bool getAllowedCollision(const std::string& name1, const std::string& name2,
                            AllowedCollision::Type& allowed_collision) const;
 
+  /** @brief Get the index of an element name, for use with the index based getAllowedCollision(). Indices are
+   *  assigned once per name for the lifetime of the process and are shared by all collision matrices, so callers that
+   *  query the same elements repeatedly (e.g. collision geometries) can resolve and cache them once.
+   *  @param name name of the element */
+  static std::size_t getEntryIndex(const std::string& name);
+
+  /** @brief Same as getAllowedCollision() for names, for elements identified by getEntryIndex(). This avoids hashing
+   *  the names on every query.
+   *  @param index1 index of first element
+   *  @param index2 index of second element
+   *  @param allowed_collision The allowed collision type will be filled here */
+  bool getAllowedCollision(std::size_t index1, std::size_t index2, AllowedCollision::Type& allowed_collision) const;
+
   /** @brief Print the allowed collision matrix */
   void print(std::ostream& out) const;
 
 private:
+  /** @brief Flat view of the allowed collision types, indexed by dense integer ids of the element names */
+  struct CompiledMatrix;
+
+  /** @brief Get the compiled view of the matrix, building it if the matrix changed since it was last built.
+   *  This is safe to call concurrently from multiple threads, as long as the matrix is not modified. */
+  const CompiledMatrix& getCompiledMatrix() const;
+
+  /** @brief Discard the compiled view; needs to be called by every function that modifies the matrix */
+  void invalidateCompiledMatrix();
+
   std::map<std::string, std::map<std::string, AllowedCollision::Type> > entries_;
   std::map<std::string, std::map<std::string, DecideContactFn> > allowed_contacts_;
 
   std::map<std::string, AllowedCollision::Type> default_entries_;
   std::map<std::string, DecideContactFn> default_allowed_contacts_;
+
+  /** @brief The compiled view used to answer getAllowedCollision() queries for types, built lazily */
+  mutable std::atomic<CompiledMatrix*> compiled_;
+  mutable std::mutex compiled_lock_;
 };
 }  // namespace collision_detection
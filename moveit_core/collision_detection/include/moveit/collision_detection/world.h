@@ -40,6 +40,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include <boost/function.hpp>
 #include <Eigen/Geometry>
 #include <eigen_stl_containers/eigen_stl_vector_container.h>
@@ -62,8 +63,9 @@ public:
   World();
 
   /** \brief A copy constructor.
-   * \e other should not be changed while the copy constructor is running
-   * This does copy on write and should be quick. */
+   * \e other should not be changed while the copy constructor is running.
+   * This does copy on write and takes constant time: the object map is shared with \e other until either
+   * world is modified, and individual objects stay shared until they are modified. */
   World(const World& other);
 
   virtual ~World();
@@ -122,22 +124,22 @@ public:
   /** iterator pointing to first change */
   const_iterator begin() const
   {
-    return objects_.begin();
+    return objects_->begin();
   }
   /** iterator pointing to end of changes */
   const_iterator end() const
   {
-    return objects_.end();
+    return objects_->end();
   }
   /** number of changes stored */
   std::size_t size() const
   {
-    return objects_.size();
+    return objects_->size();
   }
   /** find changes for a named object */
   const_iterator find(const std::string& id) const
   {
-    return objects_.find(id);
+    return objects_->find(id);
   }
 
   /** \brief Check if a particular object exists in the collision world*/
@@ -280,12 +282,16 @@ private:
    * clone is made so that it can be safely modified later on. */
   void ensureUnique(ObjectPtr& obj);
 
+  /** \brief Get the object map for modification. If the map is shared with a copy of this World, it is cloned
+   * first (the objects themselves remain shared until ensureUnique() is called on them). */
+  std::map<std::string, ObjectPtr>& getObjectsForWrite();
+
   /* Add a shape with no checking */
   virtual void addToObjectInternal(const ObjectPtr& obj, const shapes::ShapeConstPtr& shape,
                                    const Eigen::Isometry3d& pose);
 
-  /** The objects maintained in the world */
-  std::map<std::string, ObjectPtr> objects_;
+  /** The objects maintained in the world. Shared between copies of the world until one of them is modified. */
+  std::shared_ptr<std::map<std::string, ObjectPtr>> objects_;
 
   /** Wrapper for a callback function to call when something changes in the world */
   class Observer
@@ -37,6 +37,7 @@
 #include <moveit/collision_detection/collision_matrix.h>
 #include <boost/bind.hpp>
 #include <iomanip>
+#include <unordered_map>
 #include "rclcpp/rclcpp.hpp"
 
 namespace collision_detection
@@ -44,11 +45,91 @@ namespace collision_detection
 // Logger
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_collision_detection.collision_matrix");
 
-AllowedCollisionMatrix::AllowedCollisionMatrix()
+struct AllowedCollisionMatrix::CompiledMatrix
 {
+  /** \brief Value stored for pairs (and defaults) that are not specified */
+  static constexpr unsigned char NOT_FOUND = 3;
+
+  CompiledMatrix(std::size_t n) : size(n), defaults(n, NOT_FOUND), types((n * n + 3) / 4, 0xff)
+  {
+  }
+
+  unsigned char get(std::size_t i, std::size_t j) const
+  {
+    const std::size_t k = i * size + j;
+    return (types[k >> 2] >> ((k & 3) << 1)) & 3;
+  }
+
+  void set(std::size_t i, std::size_t j, unsigned char type)
+  {
+    const std::size_t k = i * size + j;
+    const unsigned int shift = (k & 3) << 1;
+    types[k >> 2] = (types[k >> 2] & ~(3 << shift)) | (type << shift);
+  }
+
+  /** \brief Look up the type for a pair of dense ids, where -1 stands for an element that is not in the matrix */
+  bool lookup(int i, int j, AllowedCollision::Type& allowed_collision) const
+  {
+    unsigned char type;
+    if (i >= 0 && j >= 0)
+      type = get(i, j);
+    else if (i >= 0)  // an unknown element can only be decided by the default of the other one
+      type = defaults[i];
+    else if (j >= 0)
+      type = defaults[j];
+    else
+      return false;
+
+    if (type == NOT_FOUND)
+      return false;
+    allowed_collision = static_cast<AllowedCollision::Type>(type);
+    return true;
+  }
+
+  /** \brief Dense id of each element name */
+  std::unordered_map<std::string, std::size_t> ids;
+  /** \brief Dense id for each getEntryIndex() value, or -1 if the element is not in the matrix */
+  std::vector<int> ids_by_index;
+  std::size_t size;
+  /** \brief The default entry of each element, or NOT_FOUND */
+  std::vector<unsigned char> defaults;
+  /** \brief The result of getAllowedCollision() for each pair of ids, packed with 2 bits per pair */
+  std::vector<unsigned char> types;
+};
+
+AllowedCollisionMatrix::AllowedCollisionMatrix() : compiled_(nullptr)
+{
+}
+
+AllowedCollisionMatrix::AllowedCollisionMatrix(const AllowedCollisionMatrix& acm)
+  : entries_(acm.entries_)
+  , allowed_contacts_(acm.allowed_contacts_)
+  , default_entries_(acm.default_entries_)
+  , default_allowed_contacts_(acm.default_allowed_contacts_)
+  , compiled_(nullptr)
+{
+}
+
+AllowedCollisionMatrix& AllowedCollisionMatrix::operator=(const AllowedCollisionMatrix& acm)
+{
+  if (this != &acm)
+  {
+    entries_ = acm.entries_;
+    allowed_contacts_ = acm.allowed_contacts_;
+    default_entries_ = acm.default_entries_;
+    default_allowed_contacts_ = acm.default_allowed_contacts_;
+    invalidateCompiledMatrix();
+  }
+  return *this;
+}
+
+AllowedCollisionMatrix::~AllowedCollisionMatrix()
+{
+  invalidateCompiledMatrix();
 }
 
 AllowedCollisionMatrix::AllowedCollisionMatrix(const std::vector<std::string>& names, bool allowed)
+  : compiled_(nullptr)
 {
   for (std::size_t i = 0; i < names.size(); ++i)
     for (std::size_t j = i; j < names.size(); ++j)
@@ -56,6 +137,7 @@ AllowedCollisionMatrix::AllowedCollisionMatrix(const std::vector<std::string>& n
 }
 
 AllowedCollisionMatrix::AllowedCollisionMatrix(const moveit_msgs::msg::AllowedCollisionMatrix& msg)
+  : compiled_(nullptr)
 {
   if (msg.entry_names.size() != msg.entry_values.size() ||
       msg.default_entry_names.size() != msg.default_entry_values.size())
@@ -128,6 +210,7 @@ void AllowedCollisionMatrix::setEntry(const std::string& name1, const std::strin
 {
   const AllowedCollision::Type v = allowed ? AllowedCollision::ALWAYS : AllowedCollision::NEVER;
   entries_[name1][name2] = entries_[name2][name1] = v;
+  invalidateCompiledMatrix();
 
   // remove boost::function pointers, if any
   auto it = allowed_contacts_.find(name1);
@@ -150,6 +233,7 @@ void AllowedCollisionMatrix::setEntry(const std::string& name1, const std::strin
 {
   entries_[name1][name2] = entries_[name2][name1] = AllowedCollision::CONDITIONAL;
   allowed_contacts_[name1][name2] = allowed_contacts_[name2][name1] = fn;
+  invalidateCompiledMatrix();
 }
 
 void AllowedCollisionMatrix::removeEntry(const std::string& name)
@@ -160,10 +244,12 @@ void AllowedCollisionMatrix::removeEntry(const std::string& name)
     entry.second.erase(name);
   for (auto& allowed_contact : allowed_contacts_)
     allowed_contact.second.erase(name);
+  invalidateCompiledMatrix();
 }
 
 void AllowedCollisionMatrix::removeEntry(const std::string& name1, const std::string& name2)
 {
+  invalidateCompiledMatrix();
   auto jt = entries_.find(name1);
   if (jt != entries_.end())
   {
@@ -226,6 +312,7 @@ void AllowedCollisionMatrix::setEntry(bool allowed)
   for (auto& entry : entries_)
     for (auto& it2 : entry.second)
       it2.second = v;
+  invalidateCompiledMatrix();
 }
 
 void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, bool allowed)
@@ -233,12 +320,14 @@ void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, bool allow
   const AllowedCollision::Type v = allowed ? AllowedCollision::ALWAYS : AllowedCollision::NEVER;
   default_entries_[name] = v;
   default_allowed_contacts_.erase(name);
+  invalidateCompiledMatrix();
 }
 
 void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, DecideContactFn& fn)
 {
   default_entries_[name] = AllowedCollision::CONDITIONAL;
   default_allowed_contacts_[name] = fn;
+  invalidateCompiledMatrix();
 }
 
 bool AllowedCollisionMatrix::getDefaultEntry(const std::string& name, AllowedCollision::Type& allowed_collision) const
@@ -287,34 +376,104 @@ bool AllowedCollisionMatrix::getAllowedCollision(const std::string& name1, const
   }
 }
 
+static AllowedCollision::Type combineDefaultEntries(AllowedCollision::Type t1, AllowedCollision::Type t2)
+{
+  if (t1 == AllowedCollision::NEVER || t2 == AllowedCollision::NEVER)
+    return AllowedCollision::NEVER;
+  else if (t1 == AllowedCollision::CONDITIONAL || t2 == AllowedCollision::CONDITIONAL)
+    return AllowedCollision::CONDITIONAL;
+  else  // ALWAYS is the only remaining case
+    return AllowedCollision::ALWAYS;
+}
+
 bool AllowedCollisionMatrix::getAllowedCollision(const std::string& name1, const std::string& name2,
                                                  AllowedCollision::Type& allowed_collision) const
 {
-  AllowedCollision::Type t1, t2;
-  bool found1 = getDefaultEntry(name1, t1);
-  bool found2 = getDefaultEntry(name2, t2);
+  const CompiledMatrix& compiled = getCompiledMatrix();
+  auto it1 = compiled.ids.find(name1);
+  auto it2 = compiled.ids.find(name2);
+  return compiled.lookup(it1 != compiled.ids.end() ? static_cast<int>(it1->second) : -1,
+                         it2 != compiled.ids.end() ? static_cast<int>(it2->second) : -1, allowed_collision);
+}
 
-  if (!found1 && !found2)
-    return getEntry(name1, name2, allowed_collision);
-  else
+bool AllowedCollisionMatrix::getAllowedCollision(std::size_t index1, std::size_t index2,
+                                                 AllowedCollision::Type& allowed_collision) const
+{
+  const CompiledMatrix& compiled = getCompiledMatrix();
+  const std::size_t count = compiled.ids_by_index.size();
+  return compiled.lookup(index1 < count ? compiled.ids_by_index[index1] : -1,
+                         index2 < count ? compiled.ids_by_index[index2] : -1, allowed_collision);
+}
+
+std::size_t AllowedCollisionMatrix::getEntryIndex(const std::string& name)
+{
+  static std::mutex lock;
+  static std::unordered_map<std::string, std::size_t> indices;
+  std::lock_guard<std::mutex> guard(lock);
+  return indices.emplace(name, indices.size()).first->second;
+}
+
+const AllowedCollisionMatrix::CompiledMatrix& AllowedCollisionMatrix::getCompiledMatrix() const
+{
+  CompiledMatrix* compiled = compiled_.load(std::memory_order_acquire);
+  if (compiled)
+    return *compiled;
+
+  std::lock_guard<std::mutex> lock(compiled_lock_);
+  compiled = compiled_.load(std::memory_order_relaxed);
+  if (compiled)
+    return *compiled;
+
+  // assign dense ids to all element names
+  std::unordered_map<std::string, std::size_t> ids;
+  for (const auto& entry : entries_)
+    ids.emplace(entry.first, ids.size());
+  for (const auto& entry : default_entries_)
+    ids.emplace(entry.first, ids.size());
+
+  compiled = new CompiledMatrix(ids.size());
+  compiled->ids.swap(ids);
+  for (const auto& id : compiled->ids)
   {
-    if (found1 && !found2)
-      allowed_collision = t1;
-    else if (!found1 && found2)
-      allowed_collision = t2;
-    else if (found1 && found2)
+    const std::size_t index = getEntryIndex(id.first);
+    if (index >= compiled->ids_by_index.size())
+      compiled->ids_by_index.resize(index + 1, -1);
+    compiled->ids_by_index[index] = id.second;
+  }
+
+  // explicit entries
+  for (const auto& entry : entries_)
+  {
+    const std::size_t i = compiled->ids[entry.first];
+    for (const auto& other : entry.second)
+      compiled->set(i, compiled->ids[other.first], other.second);
+  }
+
+  // default entries take precedence over explicit entries
+  for (const auto& entry : default_entries_)
+    compiled->defaults[compiled->ids[entry.first]] = entry.second;
+  for (std::size_t i = 0; i < compiled->size; ++i)
+  {
+    if (compiled->defaults[i] == CompiledMatrix::NOT_FOUND)
+      continue;
+    const AllowedCollision::Type t1 = static_cast<AllowedCollision::Type>(compiled->defaults[i]);
+    for (std::size_t j = 0; j < compiled->size; ++j)
     {
-      if (t1 == AllowedCollision::NEVER || t2 == AllowedCollision::NEVER)
-        allowed_collision = AllowedCollision::NEVER;
-      else if (t1 == AllowedCollision::CONDITIONAL || t2 == AllowedCollision::CONDITIONAL)
-        allowed_collision = AllowedCollision::CONDITIONAL;
-      else  // ALWAYS is the only remaining case
-        allowed_collision = AllowedCollision::ALWAYS;
+      const unsigned char t2 = compiled->defaults[j];
+      const AllowedCollision::Type type =
+          t2 == CompiledMatrix::NOT_FOUND ? t1 : combineDefaultEntries(t1, static_cast<AllowedCollision::Type>(t2));
+      compiled->set(i, j, type);
+      compiled->set(j, i, type);
     }
-    else
-      return false;
-    return true;
   }
+
+  compiled_.store(compiled, std::memory_order_release);
+  return *compiled;
+}
+
+void AllowedCollisionMatrix::invalidateCompiledMatrix()
+{
+  delete compiled_.exchange(nullptr);
 }
 
 void AllowedCollisionMatrix::clear()
@@ -323,6 +482,7 @@ void AllowedCollisionMatrix::clear()
   allowed_contacts_.clear();
   default_entries_.clear();
   default_allowed_contacts_.clear();
+  invalidateCompiledMatrix();
 }
 
 void AllowedCollisionMatrix::getAllEntryNames(std::vector<std::string>& names) const
@@ -44,13 +44,12 @@ namespace collision_detection
 // Logger
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_collision_detection.world");
 
-World::World()
+World::World() : objects_(std::make_shared<std::map<std::string, ObjectPtr>>())
 {
 }
 
-World::World(const World& other)
+World::World(const World& other) : objects_(other.objects_)
 {
-  objects_ = other.objects_;
 }
 
 World::~World()
@@ -82,7 +81,7 @@ void World::addToObject(const std::string& id, const std::vector<shapes::ShapeCo
 
   int action = ADD_SHAPE;
 
-  ObjectPtr& obj = objects_[id];
+  ObjectPtr& obj = getObjectsForWrite()[id];
   if (!obj)
   {
     obj.reset(new Object(id));
@@ -101,7 +100,7 @@ void World::addToObject(const std::string& id, const shapes::ShapeConstPtr& shap
 {
   int action = ADD_SHAPE;
 
-  ObjectPtr& obj = objects_[id];
+  ObjectPtr& obj = getObjectsForWrite()[id];
   if (!obj)
   {
     obj.reset(new Object(id));
@@ -117,15 +116,16 @@ void World::addToObject(const std::string& id, const shapes::ShapeConstPtr& shap
 std::vector<std::string> World::getObjectIds() const
 {
   std::vector<std::string> id;
-  for (const auto& object : objects_)
+  id.reserve(objects_->size());
+  for (const auto& object : *objects_)
     id.push_back(object.first);
   return id;
 }
 
 World::ObjectConstPtr World::getObject(const std::string& object_id) const
 {
-  auto it = objects_.find(object_id);
-  if (it == objects_.end())
+  auto it = objects_->find(object_id);
+  if (it == objects_->end())
     return ObjectConstPtr();
   else
     return it->second;
@@ -137,21 +137,29 @@ void World::ensureUnique(ObjectPtr& obj)
     obj.reset(new Object(*obj));
 }
 
+std::map<std::string, World::ObjectPtr>& World::getObjectsForWrite()
+{
+  // copying the map only copies the object pointers, so the objects stay shared until ensureUnique()
+  if (!objects_.unique())
+    objects_ = std::make_shared<std::map<std::string, ObjectPtr>>(*objects_);
+  return *objects_;
+}
+
 bool World::hasObject(const std::string& object_id) const
 {
-  return objects_.find(object_id) != objects_.end();
+  return objects_->find(object_id) != objects_->end();
 }
 
 bool World::knowsTransform(const std::string& name) const
 {
   // Check object names first
-  std::map<std::string, ObjectPtr>::const_iterator it = objects_.find(name);
-  if (it != objects_.end())
+  std::map<std::string, ObjectPtr>::const_iterator it = objects_->find(name);
+  if (it != objects_->end())
     // only accept object name as frame if it is associated to a unique shape
     return !it->second->shape_poses_.empty();
   else  // Then objects' subframes
   {
-    for (const std::pair<const std::string, ObjectPtr>& object : objects_)
+    for (const std::pair<const std::string, ObjectPtr>& object : *objects_)
     {
       // if "object name/" matches start of object_id, we found the matching object
       if (boost::starts_with(name, object.first) && name[object.first.length()] == '/')
@@ -176,15 +184,15 @@ const Eigen::Isometry3d& World::getTransform(const std::string& name, bool& fram
   // assume found
   frame_found = true;
 
-  std::map<std::string, ObjectPtr>::const_iterator it = objects_.find(name);
-  if (it != objects_.end())
+  std::map<std::string, ObjectPtr>::const_iterator it = objects_->find(name);
+  if (it != objects_->end())
   {
     if (!it->second->shape_poses_.empty())
       return it->second->shape_poses_[0];
   }
   else  // Search within subframes
   {
-    for (const std::pair<const std::string, ObjectPtr>& object : objects_)
+    for (const std::pair<const std::string, ObjectPtr>& object : *objects_)
     {
       // if "object name/" matches start of object_id, we found the matching object
       if (boost::starts_with(name, object.first) && name[object.first.length()] == '/')
@@ -205,13 +213,14 @@ const Eigen::Isometry3d& World::getTransform(const std::string& name, bool& fram
 bool World::moveShapeInObject(const std::string& object_id, const shapes::ShapeConstPtr& shape,
                               const Eigen::Isometry3d& pose)
 {
-  auto it = objects_.find(object_id);
-  if (it != objects_.end())
+  auto it = objects_->find(object_id);
+  if (it != objects_->end())
   {
     unsigned int n = it->second->shapes_.size();
     for (unsigned int i = 0; i < n; ++i)
       if (it->second->shapes_[i] == shape)
       {
+        it = getObjectsForWrite().find(object_id);
         ensureUnique(it->second);
         ASSERT_ISOMETRY(pose)  // unsanitized input, could contain a non-isometry
         it->second->shape_poses_[i] = pose;
@@ -225,11 +234,11 @@ bool World::moveShapeInObject(const std::string& object_id, const shapes::ShapeC
 
 bool World::moveObject(const std::string& object_id, const Eigen::Isometry3d& transform)
 {
-  auto it = objects_.find(object_id);
-  if (it == objects_.end())
+  if (objects_->find(object_id) == objects_->end())
     return false;
   if (transform.isApprox(Eigen::Isometry3d::Identity()))
     return true;  // object already at correct location
+  auto it = getObjectsForWrite().find(object_id);
   ensureUnique(it->second);
   for (size_t i = 0, n = it->second->shapes_.size(); i < n; ++i)
   {
@@ -242,13 +251,15 @@ bool World::moveObject(const std::string& object_id, const Eigen::Isometry3d& tr
 
 bool World::removeShapeFromObject(const std::string& object_id, const shapes::ShapeConstPtr& shape)
 {
-  auto it = objects_.find(object_id);
-  if (it != objects_.end())
+  auto it = objects_->find(object_id);
+  if (it != objects_->end())
   {
     unsigned int n = it->second->shapes_.size();
     for (unsigned int i = 0; i < n; ++i)
       if (it->second->shapes_[i] == shape)
       {
+        std::map<std::string, ObjectPtr>& objects = getObjectsForWrite();
+        it = objects.find(object_id);
         ensureUnique(it->second);
         it->second->shapes_.erase(it->second->shapes_.begin() + i);
         it->second->shape_poses_.erase(it->second->shape_poses_.begin() + i);
@@ -256,7 +267,7 @@ bool World::removeShapeFromObject(const std::string& object_id, const shapes::Sh
         if (it->second->shapes_.empty())
         {
           notify(it->second, DESTROY);
-          objects_.erase(it);
+          objects.erase(it);
         }
         else
         {
@@ -270,11 +281,12 @@ bool World::removeShapeFromObject(const std::string& object_id, const shapes::Sh
 
 bool World::removeObject(const std::string& object_id)
 {
-  auto it = objects_.find(object_id);
-  if (it != objects_.end())
+  auto it = objects_->find(object_id);
+  if (it != objects_->end())
   {
     notify(it->second, DESTROY);
-    objects_.erase(it);
+    std::map<std::string, ObjectPtr>& objects = getObjectsForWrite();
+    objects.erase(object_id);
     return true;
   }
   return false;
@@ -283,13 +295,16 @@ bool World::removeObject(const std::string& object_id)
 void World::clearObjects()
 {
   notifyAll(DESTROY);
-  objects_.clear();
+  // do not clone a shared map just to empty it
+  if (objects_.unique())
+    objects_->clear();
+  else
+    objects_ = std::make_shared<std::map<std::string, ObjectPtr>>();
 }
 
 bool World::setSubframesOfObject(const std::string& object_id, const moveit::core::FixedTransformsMap& subframe_poses)
 {
-  auto obj_pair = objects_.find(object_id);
-  if (obj_pair == objects_.end())
+  if (objects_->find(object_id) == objects_->end())
   {
     return false;
   }
@@ -297,6 +312,8 @@ bool World::setSubframesOfObject(const std::string& object_id, const moveit::cor
   {
     ASSERT_ISOMETRY(t.second)  // unsanitized input, could contain a non-isometry
   }
+  auto obj_pair = getObjectsForWrite().find(object_id);
+  ensureUnique(obj_pair->second);
   obj_pair->second->subframe_poses_ = subframe_poses;
   return true;
 }
@@ -323,7 +340,7 @@ void World::removeObserver(ObserverHandle observer_handle)
 
 void World::notifyAll(Action action)
 {
-  for (std::map<std::string, ObjectPtr>::const_iterator it = objects_.begin(); it != objects_.end(); ++it)
+  for (std::map<std::string, ObjectPtr>::const_iterator it = objects_->begin(); it != objects_->end(); ++it)
     notify(it->second, action);
 }
 
@@ -340,7 +357,7 @@ void World::notifyObserverAllObjects(const ObserverHandle observer_handle, Actio
     if (observer == observer_handle.observer_)
     {
       // call the callback for each object
-      for (const auto& object : objects_)
+      for (const auto& object : *objects_)
         observer->callback_(object.second, action);
       break;
     }
@@ -0,0 +1,131 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+#include <moveit/collision_detection/collision_matrix.h>
+
+namespace AllowedCollision = collision_detection::AllowedCollision;
+using collision_detection::AllowedCollisionMatrix;
+using collision_detection::DecideContactFn;
+
+TEST(AllowedCollisionMatrix, QueriesFollowModifications)
+{
+  AllowedCollisionMatrix acm(std::vector<std::string>{ "a", "b", "c" }, false);
+  AllowedCollision::Type type;
+
+  ASSERT_TRUE(acm.getAllowedCollision("a", "b", type));
+  EXPECT_EQ(type, AllowedCollision::NEVER);
+  EXPECT_FALSE(acm.getAllowedCollision("a", "d", type));
+
+  // modifications after a query must be visible to the next query
+  acm.setEntry("a", "b", true);
+  ASSERT_TRUE(acm.getAllowedCollision("b", "a", type));
+  EXPECT_EQ(type, AllowedCollision::ALWAYS);
+
+  acm.setEntry("a", "d", false);
+  ASSERT_TRUE(acm.getAllowedCollision("d", "a", type));
+  EXPECT_EQ(type, AllowedCollision::NEVER);
+
+  acm.removeEntry("a", "b");
+  EXPECT_FALSE(acm.getAllowedCollision("a", "b", type));
+
+  // default entries apply to pairs without an explicit entry
+  acm.setDefaultEntry("e", true);
+  ASSERT_TRUE(acm.getAllowedCollision("e", "a", type));
+  EXPECT_EQ(type, AllowedCollision::ALWAYS);
+  acm.setDefaultEntry("b", false);
+  ASSERT_TRUE(acm.getAllowedCollision("b", "e", type));
+  EXPECT_EQ(type, AllowedCollision::NEVER);
+
+  // default entries take precedence over explicit entries
+  acm.setEntry("e", "c", false);
+  ASSERT_TRUE(acm.getAllowedCollision("c", "e", type));
+  EXPECT_EQ(type, AllowedCollision::ALWAYS);
+  acm.setDefaultEntry("e", false);
+  ASSERT_TRUE(acm.getAllowedCollision("c", "e", type));
+  EXPECT_EQ(type, AllowedCollision::NEVER);
+
+  // copies are independent of the original
+  AllowedCollisionMatrix copy(acm);
+  copy.setDefaultEntry("e", true);
+  ASSERT_TRUE(copy.getAllowedCollision("c", "e", type));
+  EXPECT_EQ(type, AllowedCollision::ALWAYS);
+  ASSERT_TRUE(acm.getAllowedCollision("c", "e", type));
+  EXPECT_EQ(type, AllowedCollision::NEVER);
+
+  acm.clear();
+  EXPECT_FALSE(acm.getAllowedCollision("c", "e", type));
+}
+
+TEST(AllowedCollisionMatrix, IndexQueriesMatchNameQueries)
+{
+  AllowedCollisionMatrix acm(std::vector<std::string>{ "a", "b", "c" }, false);
+  acm.setEntry("a", "b", true);
+  DecideContactFn fn = [](collision_detection::Contact& /*contact*/) { return true; };
+  acm.setEntry("b", "c", fn);
+  acm.setDefaultEntry("d", true);
+
+  // "x" is not part of the matrix; "y" is only assigned an index after the matrix was compiled
+  std::vector<std::string> names = { "a", "b", "c", "d", "x" };
+  AllowedCollision::Type type;
+  acm.getAllowedCollision("a", "b", type);
+  names.push_back("y");
+
+  for (const std::string& name1 : names)
+    for (const std::string& name2 : names)
+    {
+      SCOPED_TRACE(name1 + " - " + name2);
+      AllowedCollision::Type by_name = AllowedCollision::NEVER;
+      AllowedCollision::Type by_index = AllowedCollision::NEVER;
+      const bool found = acm.getAllowedCollision(name1, name2, by_name);
+      ASSERT_EQ(acm.getAllowedCollision(AllowedCollisionMatrix::getEntryIndex(name1),
+                                        AllowedCollisionMatrix::getEntryIndex(name2), by_index),
+                found);
+      EXPECT_EQ(by_index, by_name);
+    }
+
+  // indices are stable and shared between matrices
+  EXPECT_EQ(AllowedCollisionMatrix::getEntryIndex("a"), AllowedCollisionMatrix::getEntryIndex("a"));
+  EXPECT_NE(AllowedCollisionMatrix::getEntryIndex("a"), AllowedCollisionMatrix::getEntryIndex("b"));
+  AllowedCollisionMatrix other(std::vector<std::string>{ "b", "a" }, true);
+  ASSERT_TRUE(other.getAllowedCollision(AllowedCollisionMatrix::getEntryIndex("a"),
+                                        AllowedCollisionMatrix::getEntryIndex("b"), type));
+  EXPECT_EQ(type, AllowedCollision::ALWAYS);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
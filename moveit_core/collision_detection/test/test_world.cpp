@@ -365,6 +365,50 @@ TEST(World, TrackChanges)
   EXPECT_EQ(4, ta3.cnt_);
 }
 
+TEST(World, CopyOnWrite)
+{
+  collision_detection::World world;
+
+  shapes::ShapePtr ball(new shapes::Sphere(1.0));
+  shapes::ShapePtr box(new shapes::Box(1, 2, 3));
+
+  world.addToObject("ball", ball, Eigen::Isometry3d::Identity());
+  world.addToObject("box", box, Eigen::Isometry3d(Eigen::Translation3d(0, 0, 1)));
+
+  // a copy shares all objects with the original
+  collision_detection::World copy(world);
+  EXPECT_EQ(2u, copy.size());
+  EXPECT_EQ(world.getObject("ball"), copy.getObject("ball"));
+  EXPECT_EQ(world.getObject("box"), copy.getObject("box"));
+
+  // modifying an object in the copy only clones that object
+  EXPECT_TRUE(copy.moveShapeInObject("ball", ball, Eigen::Isometry3d(Eigen::Translation3d(0, 0, 2))));
+  EXPECT_NE(world.getObject("ball"), copy.getObject("ball"));
+  EXPECT_EQ(world.getObject("box"), copy.getObject("box"));
+  EXPECT_DOUBLE_EQ(0.0, world.getObject("ball")->shape_poses_[0].translation().z());
+  EXPECT_DOUBLE_EQ(2.0, copy.getObject("ball")->shape_poses_[0].translation().z());
+
+  moveit::core::FixedTransformsMap subframes;
+  subframes["tip"] = Eigen::Isometry3d(Eigen::Translation3d(0, 0, 3));
+  EXPECT_TRUE(copy.setSubframesOfObject("box", subframes));
+  EXPECT_TRUE(copy.knowsTransform("box/tip"));
+  EXPECT_FALSE(world.knowsTransform("box/tip"));
+
+  // adding and removing objects does not affect the original
+  copy.addToObject("cyl", shapes::ShapeConstPtr(new shapes::Cylinder(4, 5)), Eigen::Isometry3d::Identity());
+  EXPECT_TRUE(copy.removeObject("ball"));
+  EXPECT_TRUE(world.hasObject("ball"));
+  EXPECT_FALSE(world.hasObject("cyl"));
+  EXPECT_EQ(2u, world.size());
+
+  // modifying the original does not affect the copy
+  collision_detection::World copy2(world);
+  world.clearObjects();
+  EXPECT_EQ(0u, world.size());
+  EXPECT_EQ(2u, copy2.size());
+  EXPECT_EQ(2u, copy.size());
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
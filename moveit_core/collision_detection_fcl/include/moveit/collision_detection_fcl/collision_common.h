@@ -67,6 +67,7 @@ struct CollisionGeometryData
     : type(BodyTypes::ROBOT_LINK), shape_index(index)
   {
     ptr.link = link;
+    entry_index = AllowedCollisionMatrix::getEntryIndex(getID());
   }
 
   /** \brief Constructor for a new collision geometry object which is attached to the robot. */
@@ -74,12 +75,14 @@ struct CollisionGeometryData
     : type(BodyTypes::ROBOT_ATTACHED), shape_index(index)
   {
     ptr.ab = ab;
+    entry_index = AllowedCollisionMatrix::getEntryIndex(getID());
   }
 
   /** \brief Constructor for a new world collision geometry. */
   CollisionGeometryData(const World::Object* obj, int index) : type(BodyTypes::WORLD_OBJECT), shape_index(index)
   {
     ptr.obj = obj;
+    entry_index = AllowedCollisionMatrix::getEntryIndex(getID());
   }
 
   /** \brief Returns the name which is saved in the member pointed to in \e ptr. */
@@ -127,6 +130,9 @@ struct CollisionGeometryData
    *  geometry data object. */
   int shape_index;
 
+  /** \brief The index of getID() in allowed collision matrices, see AllowedCollisionMatrix::getEntryIndex() */
+  std::size_t entry_index;
+
   /** \brief Points to the type of body which contains the geometry. */
   union
   {
@@ -268,6 +274,19 @@ struct FCLManager
   std::shared_ptr<fcl::BroadPhaseCollisionManagerd> manager_;
 };
 
+/** \brief Decides whether contacts between two collision geometries need to be computed.
+ *
+ *   Pairs are skipped if they belong to the same body, involve no active component or are always allowed by the
+ *   collision matrix or the touch links of attached bodies.
+ *
+ *   \param cdata Collision data providing the request, the active components and the collision matrix
+ *   \param cd1 Geometry data of the first object
+ *   \param cd2 Geometry data of the second object
+ *   \param dcf Set to the contact decider if the collision matrix allows contacts conditionally
+ *   \return True if contacts between the two objects need to be computed */
+bool needsCollisionCheck(const CollisionData& cdata, const CollisionGeometryData* cd1, const CollisionGeometryData* cd2,
+                         DecideContactFn& dcf);
+
 /** \brief Callback function used by the FCLManager used for each pair of collision objects to
  *   calculate object contact information.
  *
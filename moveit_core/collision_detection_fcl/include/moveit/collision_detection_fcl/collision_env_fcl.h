@@ -108,6 +108,18 @@ protected:
   void checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
                                  const moveit::core::RobotState& state, const AllowedCollisionMatrix* acm) const;
 
+  /** \brief Bundles the different continuous checkRobotCollision functions into a single function.
+   *
+   *   Each collision body of the robot is assumed to move from its pose in \e state1 to its pose in \e state2 by
+   *   linear interpolation of its translation and spherical interpolation of its rotation. Candidate world objects are
+   *   found by querying the broadphase with the union of the bounding boxes at both poses, grown by a bound on the
+   *   sweep of the rotation. The first time of contact of each candidate pair is then computed by conservative
+   *   advancement, which is exact for the interpolated motion up to a small contact tolerance. Self collisions are not
+   *   checked. */
+  void checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
+                                 const moveit::core::RobotState& state1, const moveit::core::RobotState& state2,
+                                 const AllowedCollisionMatrix* acm) const;
+
   /** \brief Construct an FCL collision object from MoveIt's World::Object. */
   void constructFCLObjectWorld(const World::Object* obj, FCLObject& fcl_obj) const;
 
@@ -123,8 +135,10 @@ protected:
    *   scratch (which would require call to computeLocalAABB()) but are only transformed according to the joint states.
    *
    *   \param state The current robot state
-   *   \param fcl_obj The newly filled object */
-  void constructFCLObjectRobot(const moveit::core::RobotState& state, FCLObject& fcl_obj) const;
+   *   \param fcl_obj The newly filled object
+   *   \param poses If not null, filled with the global pose of each of the created collision objects */
+  void constructFCLObjectRobot(const moveit::core::RobotState& state, FCLObject& fcl_obj,
+                               EigenSTL::vector_Isometry3d* poses = nullptr) const;
 
   /** \brief Prepares for the collision check through constructing an FCL collision object out of the current robot
    *   state and specifying a broadphase collision manager of FCL where the constructed object is registered to. */
@@ -55,20 +55,15 @@ namespace collision_detection
 // Logger
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_collision_detection_fcl.collision_common");
 
-bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data)
+bool needsCollisionCheck(const CollisionData& cdata, const CollisionGeometryData* cd1, const CollisionGeometryData* cd2,
+                         DecideContactFn& dcf)
 {
-  CollisionData* cdata = reinterpret_cast<CollisionData*>(data);
-  if (cdata->done_)
-    return true;
-  const CollisionGeometryData* cd1 = static_cast<const CollisionGeometryData*>(o1->collisionGeometry()->getUserData());
-  const CollisionGeometryData* cd2 = static_cast<const CollisionGeometryData*>(o2->collisionGeometry()->getUserData());
-
   // do not collision check geoms part of the same object / link / attached body
   if (cd1->sameObject(*cd2))
     return false;
 
   // If active components are specified
-  if (cdata->active_components_only_)
+  if (cdata.active_components_only_)
   {
     const moveit::core::LinkModel* l1 =
         cd1->type == BodyTypes::ROBOT_LINK ?
@@ -80,25 +75,24 @@ bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, voi
             (cd2->type == BodyTypes::ROBOT_ATTACHED ? cd2->ptr.ab->getAttachedLink() : nullptr);
 
     // If neither of the involved components is active
-    if ((!l1 || cdata->active_components_only_->find(l1) == cdata->active_components_only_->end()) &&
-        (!l2 || cdata->active_components_only_->find(l2) == cdata->active_components_only_->end()))
+    if ((!l1 || cdata.active_components_only_->find(l1) == cdata.active_components_only_->end()) &&
+        (!l2 || cdata.active_components_only_->find(l2) == cdata.active_components_only_->end()))
       return false;
   }
 
   // use the collision matrix (if any) to avoid certain collision checks
-  DecideContactFn dcf;
   bool always_allow_collision = false;
-  if (cdata->acm_)
+  if (cdata.acm_)
   {
     AllowedCollision::Type type;
-    bool found = cdata->acm_->getAllowedCollision(cd1->getID(), cd2->getID(), type);
+    bool found = cdata.acm_->getAllowedCollision(cd1->entry_index, cd2->entry_index, type);
     if (found)
     {
       // if we have an entry in the collision matrix, we read it
       if (type == AllowedCollision::ALWAYS)
       {
         always_allow_collision = true;
-        if (cdata->req_->verbose)
+        if (cdata.req_->verbose)
           RCLCPP_DEBUG(LOGGER,
                        "Collision between '%s' (type '%s') and '%s' (type '%s') is always allowed. "
                        "No contacts are computed.",
@@ -107,8 +101,8 @@ bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, voi
       }
       else if (type == AllowedCollision::CONDITIONAL)
       {
-        cdata->acm_->getAllowedCollision(cd1->getID(), cd2->getID(), dcf);
-        if (cdata->req_->verbose)
+        cdata.acm_->getAllowedCollision(cd1->getID(), cd2->getID(), dcf);
+        if (cdata.req_->verbose)
           RCLCPP_DEBUG(LOGGER, "Collision between '%s' and '%s' is conditionally allowed", cd1->getID().c_str(),
                        cd2->getID().c_str());
       }
@@ -122,7 +116,7 @@ bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, voi
     if (tl.find(cd1->getID()) != tl.end())
     {
       always_allow_collision = true;
-      if (cdata->req_->verbose)
+      if (cdata.req_->verbose)
         RCLCPP_DEBUG(LOGGER, "Robot link '%s' is allowed to touch attached object '%s'. No contacts are computed.",
                      cd1->getID().c_str(), cd2->getID().c_str());
     }
@@ -133,7 +127,7 @@ bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, voi
     if (tl.find(cd2->getID()) != tl.end())
     {
       always_allow_collision = true;
-      if (cdata->req_->verbose)
+      if (cdata.req_->verbose)
         RCLCPP_DEBUG(LOGGER, "Robot link '%s' is allowed to touch attached object '%s'. No contacts are computed.",
                      cd2->getID().c_str(), cd1->getID().c_str());
     }
@@ -146,7 +140,19 @@ bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, voi
   }
 
   // if collisions are always allowed, we are done
-  if (always_allow_collision)
+  return !always_allow_collision;
+}
+
+bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data)
+{
+  CollisionData* cdata = reinterpret_cast<CollisionData*>(data);
+  if (cdata->done_)
+    return true;
+  const CollisionGeometryData* cd1 = static_cast<const CollisionGeometryData*>(o1->collisionGeometry()->getUserData());
+  const CollisionGeometryData* cd2 = static_cast<const CollisionGeometryData*>(o2->collisionGeometry()->getUserData());
+
+  DecideContactFn dcf;
+  if (!needsCollisionCheck(*cdata, cd1, cd2, dcf))
     return false;
 
   if (cdata->req_->verbose)
@@ -442,7 +448,7 @@ bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void
   if (cdata->req->acm)
   {
     AllowedCollision::Type type;
-    bool found = cdata->req->acm->getAllowedCollision(cd1->getID(), cd2->getID(), type);
+    bool found = cdata->req->acm->getAllowedCollision(cd1->entry_index, cd2->entry_index, type);
     if (found)
     {
       // if we have an entry in the collision matrix, we read it
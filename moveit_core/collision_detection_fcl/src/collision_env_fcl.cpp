@@ -40,9 +40,13 @@
 
 #include <moveit/collision_detection_fcl/fcl_compat.h>
 #include <boost/bind.hpp>
+#include <limits>
 
 #if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
 #include <fcl/broadphase/broadphase_dynamic_AABB_tree.h>
+#include <fcl/geometry/shape/box.h>
+#else
+#include <fcl/shape/geometric_shapes.h>
 #endif
 
 namespace collision_detection
@@ -71,6 +75,127 @@ void checkFCLCapabilities(const DistanceRequest& req)
   }
 #endif
 }
+
+// Pairs closer than this along the interpolated motion are considered to be in contact
+constexpr double CONTINUOUS_CONTACT_TOLERANCE = 1e-4;
+
+// Maximum number of conservative advancement steps per pair before a contact is assumed
+constexpr std::size_t CONTINUOUS_MAX_ITERATIONS = 256;
+
+// Data for collecting the world objects overlapping the swept bounding box of a robot collision object
+struct SweptVolumeCandidates
+{
+  const fcl::CollisionObjectd* query;
+  std::vector<fcl::CollisionObjectd*> objects;
+};
+
+bool sweptVolumeCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data)
+{
+  SweptVolumeCandidates* candidates = reinterpret_cast<SweptVolumeCandidates*>(data);
+  candidates->objects.push_back(o1 == candidates->query ? o2 : o1);
+  return false;
+}
+
+// Bound on the distance of any point of the geometry from the origin of its frame, about which it is rotated
+double maxDistanceFromOrigin(const fcl::CollisionGeometryd& geometry)
+{
+  return Eigen::Vector3d(geometry.aabb_center[0], geometry.aabb_center[1], geometry.aabb_center[2]).norm() +
+         geometry.aabb_radius;
+}
+
+// Find the first time in [0, 1] at which the moving object comes into contact with the static object by conservative
+// advancement. The moving object is interpolated from pose1 to pose2 and left at the pose of the contact.
+bool computeTimeOfContact(fcl::CollisionObjectd& moving, const Eigen::Isometry3d& pose1,
+                          const Eigen::Isometry3d& pose2, const fcl::CollisionObjectd& object, double& time,
+                          fcl::DistanceResultd& result)
+{
+  const Eigen::Quaterniond q1(pose1.linear());
+  const Eigen::Quaterniond q2(pose2.linear());
+  const Eigen::Vector3d p1 = pose1.translation();
+  const Eigen::Vector3d p2 = pose2.translation();
+
+  // bound on the distance any point of the moving object travels during the motion
+  const double radius = maxDistanceFromOrigin(*moving.collisionGeometry());
+  const double motion_bound = (p2 - p1).norm() + q1.angularDistance(q2) * radius;
+
+  const fcl::DistanceRequestd request(true);
+  time = 0.0;
+  for (std::size_t i = 0; i < CONTINUOUS_MAX_ITERATIONS; ++i)
+  {
+    Eigen::Isometry3d pose(q1.slerp(time, q2));
+    pose.translation() = (1.0 - time) * p1 + time * p2;
+    moving.setTransform(transform2fcl(pose));
+
+    result.clear();
+    const double distance = fcl::distance(&moving, &object, request, result);
+    if (distance <= CONTINUOUS_CONTACT_TOLERANCE)
+      return true;
+
+    // no point of the moving object can reach the static object before this time
+    if (motion_bound <= 0.0)
+      return false;
+    time += distance / motion_bound;
+    if (time >= 1.0)
+      return false;
+  }
+
+  // the objects stay very close for most of the motion; be conservative and report a contact
+  RCLCPP_DEBUG(LOGGER, "Conservative advancement did not converge within %zu steps", CONTINUOUS_MAX_ITERATIONS);
+  return true;
+}
+
+// Fill in position, normal and depth of the contact between the moving object, left at the pose of contact by
+// computeTimeOfContact(), and the static object. The distance query does not report penetration, so overlapping
+// objects (e.g. already at the start of the motion) are resolved with a contact query, like in distanceCallback().
+void computeContactGeometry(const fcl::CollisionObjectd& moving, const fcl::CollisionObjectd& object,
+                            const fcl::DistanceResultd& dist_result, Contact& contact)
+{
+  if (dist_result.min_distance <= 0.0)
+  {
+    fcl::CollisionRequestd coll_req;
+    fcl::CollisionResultd coll_res;
+    coll_req.enable_contact = true;
+    coll_req.num_max_contacts = 200;
+    const std::size_t contacts = fcl::collide(&moving, &object, coll_req, coll_res);
+    if (contacts > 0)
+    {
+      std::size_t max_index = 0;
+      for (std::size_t i = 1; i < contacts; ++i)
+        if (coll_res.getContact(i).penetration_depth > coll_res.getContact(max_index).penetration_depth)
+          max_index = i;
+
+      const fcl::Contactd& fc = coll_res.getContact(max_index);
+#if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
+      contact.pos = fc.pos;
+      contact.normal = fc.normal;
+#else
+      contact.pos = Eigen::Map<const Eigen::Vector3d>(fc.pos.data.vs);
+      contact.normal = Eigen::Map<const Eigen::Vector3d>(fc.normal.data.vs);
+#endif
+      // FCL may swap the objects in the contact; the normal has to point from the moving to the static object
+      if (fc.o1 != moving.collisionGeometry().get())
+        contact.normal = -contact.normal;
+      contact.depth = fc.penetration_depth;
+      contact.nearest_points[0] = contact.pos;
+      contact.nearest_points[1] = contact.pos;
+      return;
+    }
+  }
+
+  // the objects touch within the tolerance: the nearest points are meaningful and the depth is zero
+  for (int k = 0; k < 3; ++k)
+  {
+    contact.nearest_points[0][k] = dist_result.nearest_points[0][k];
+    contact.nearest_points[1][k] = dist_result.nearest_points[1][k];
+  }
+  contact.depth = 0.0;
+  contact.pos = 0.5 * (contact.nearest_points[0] + contact.nearest_points[1]);
+  contact.normal = contact.nearest_points[1] - contact.nearest_points[0];
+  if (contact.normal.norm() > std::numeric_limits<double>::epsilon())
+    contact.normal.normalize();
+  else
+    contact.normal.setZero();
+}
 }  // namespace
 
 CollisionEnvFCL::CollisionEnvFCL(const moveit::core::RobotModelConstPtr& model, double padding, double scale)
@@ -197,7 +322,8 @@ void CollisionEnvFCL::constructFCLObjectWorld(const World::Object* obj, FCLObjec
   }
 }
 
-void CollisionEnvFCL::constructFCLObjectRobot(const moveit::core::RobotState& state, FCLObject& fcl_obj) const
+void CollisionEnvFCL::constructFCLObjectRobot(const moveit::core::RobotState& state, FCLObject& fcl_obj,
+                                              EigenSTL::vector_Isometry3d* poses) const
 {
   fcl_obj.collision_objects_.reserve(robot_geoms_.size());
   fcl::Transform3d fcl_tf;
@@ -205,13 +331,16 @@ void CollisionEnvFCL::constructFCLObjectRobot(const moveit::core::RobotState& st
   for (std::size_t i = 0; i < robot_geoms_.size(); ++i)
     if (robot_geoms_[i] && robot_geoms_[i]->collision_geometry_)
     {
-      transform2fcl(state.getCollisionBodyTransform(robot_geoms_[i]->collision_geometry_data_->ptr.link,
-                                                    robot_geoms_[i]->collision_geometry_data_->shape_index),
-                    fcl_tf);
+      const Eigen::Isometry3d& pose =
+          state.getCollisionBodyTransform(robot_geoms_[i]->collision_geometry_data_->ptr.link,
+                                          robot_geoms_[i]->collision_geometry_data_->shape_index);
+      transform2fcl(pose, fcl_tf);
       auto coll_obj = new fcl::CollisionObjectd(*robot_fcl_objs_[i]);
       coll_obj->setTransform(fcl_tf);
       coll_obj->computeAABB();
       fcl_obj.collision_objects_.push_back(FCLCollisionObjectPtr(coll_obj));
+      if (poses)
+        poses->push_back(pose);
     }
 
   // TODO: Implement a method for caching fcl::CollisionObject's for moveit::core::AttachedBody's
@@ -228,6 +357,8 @@ void CollisionEnvFCL::constructFCLObjectRobot(const moveit::core::RobotState& st
         transform2fcl(ab_t[k], fcl_tf);
         fcl_obj.collision_objects_.push_back(
             FCLCollisionObjectPtr(new fcl::CollisionObjectd(objs[k]->collision_geometry_, fcl_tf)));
+        if (poses)
+          poses->push_back(ab_t[k]);
         // we copy the shared ptr to the CollisionGeometryData, as this is not stored by the class itself,
         // and would be destroyed when objs goes out of scope.
         fcl_obj.collision_geometry_.push_back(objs[k]);
@@ -296,7 +427,7 @@ void CollisionEnvFCL::checkRobotCollision(const CollisionRequest& req, Collision
                                           const moveit::core::RobotState& state1,
                                           const moveit::core::RobotState& state2) const
 {
-  RCLCPP_ERROR(LOGGER, "Continuous collision not implemented");
+  checkRobotCollisionHelper(req, res, state1, state2, nullptr);
 }
 
 void CollisionEnvFCL::checkRobotCollision(const CollisionRequest& req, CollisionResult& res,
@@ -304,7 +435,7 @@ void CollisionEnvFCL::checkRobotCollision(const CollisionRequest& req, Collision
                                           const moveit::core::RobotState& state2,
                                           const AllowedCollisionMatrix& acm) const
 {
-  RCLCPP_ERROR(LOGGER, "Not implemented");
+  checkRobotCollisionHelper(req, res, state1, state2, &acm);
 }
 
 void CollisionEnvFCL::checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
@@ -332,6 +463,102 @@ void CollisionEnvFCL::checkRobotCollisionHelper(const CollisionRequest& req, Col
   }
 }
 
+void CollisionEnvFCL::checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
+                                                const moveit::core::RobotState& state1,
+                                                const moveit::core::RobotState& state2,
+                                                const AllowedCollisionMatrix* acm) const
+{
+  FCLObject fcl_obj1, fcl_obj2;
+  EigenSTL::vector_Isometry3d poses1, poses2;
+  constructFCLObjectRobot(state1, fcl_obj1, &poses1);
+  constructFCLObjectRobot(state2, fcl_obj2, &poses2);
+  if (poses1.size() != poses2.size())
+  {
+    RCLCPP_ERROR(LOGGER, "Continuous collision checking requires the same attached bodies in both states");
+    return;
+  }
+
+  CollisionData cd(&req, &res, acm);
+  cd.enableGroup(getRobotModel());
+  SweptVolumeCandidates candidates;
+  fcl::DistanceResultd dist_result;
+  for (std::size_t i = 0; !cd.done_ && i < fcl_obj1.collision_objects_.size(); ++i)
+  {
+    fcl::CollisionObjectd& moving = *fcl_obj1.collision_objects_[i];
+    const CollisionGeometryData* cd1 =
+        static_cast<const CollisionGeometryData*>(moving.collisionGeometry()->getUserData());
+
+    // broadphase query with a bounding box of the whole interpolated motion. At time t, a point at distance r from
+    // the origin of the object is at most angle * r away from the linear blend of its positions at the start and the
+    // end, which lies inside the union of the bounding boxes at both poses.
+    const auto& aabb1 = moving.getAABB();
+    const auto& aabb2 = fcl_obj2.collision_objects_[i]->getAABB();
+    const double rotation_sweep =
+        Eigen::Quaterniond(poses1[i].linear()).angularDistance(Eigen::Quaterniond(poses2[i].linear())) *
+        maxDistanceFromOrigin(*moving.collisionGeometry());
+    Eigen::Vector3d lower, upper;
+    for (int k = 0; k < 3; ++k)
+    {
+      lower[k] = std::min(aabb1.min_[k], aabb2.min_[k]) - rotation_sweep;
+      upper[k] = std::max(aabb1.max_[k], aabb2.max_[k]) + rotation_sweep;
+    }
+    const Eigen::Vector3d extents = upper - lower;
+    fcl::CollisionObjectd swept(std::make_shared<fcl::Boxd>(extents.x(), extents.y(), extents.z()),
+                                transform2fcl(Eigen::Isometry3d(Eigen::Translation3d(0.5 * (lower + upper)))));
+    candidates.query = &swept;
+    candidates.objects.clear();
+    manager_->collide(&swept, &candidates, &sweptVolumeCallback);
+
+    for (std::size_t j = 0; !cd.done_ && j < candidates.objects.size(); ++j)
+    {
+      const fcl::CollisionObjectd& object = *candidates.objects[j];
+      const CollisionGeometryData* cd2 =
+          static_cast<const CollisionGeometryData*>(object.collisionGeometry()->getUserData());
+      DecideContactFn dcf;
+      if (!needsCollisionCheck(cd, cd1, cd2, dcf))
+        continue;
+
+      double time;
+      if (!computeTimeOfContact(moving, poses1[i], poses2[i], object, time, dist_result))
+        continue;
+
+      Contact contact;
+      contact.body_name_1 = cd1->getID();
+      contact.body_type_1 = cd1->type;
+      contact.body_name_2 = cd2->getID();
+      contact.body_type_2 = cd2->type;
+      contact.percent_interpolation = time;
+      computeContactGeometry(moving, object, dist_result, contact);
+
+      // the decider is only consulted for the first contact of the pair
+      if (dcf && dcf(contact))
+        continue;
+
+      if (req.verbose)
+        RCLCPP_INFO(LOGGER, "Found a contact between '%s' (type '%s') and '%s' (type '%s') at %f of the motion",
+                    cd1->getID().c_str(), cd1->getTypeString().c_str(), cd2->getID().c_str(),
+                    cd2->getTypeString().c_str(), time);
+      res.collision = true;
+      if (req.contacts && res.contact_count < req.max_contacts)
+      {
+        std::vector<Contact>& pair_contacts = cd1->getID() < cd2->getID() ?
+                                                  res.contacts[std::make_pair(cd1->getID(), cd2->getID())] :
+                                                  res.contacts[std::make_pair(cd2->getID(), cd1->getID())];
+        if (pair_contacts.size() < req.max_contacts_per_pair)
+        {
+          pair_contacts.push_back(contact);
+          res.contact_count++;
+        }
+      }
+
+      if (!req.contacts || res.contact_count >= req.max_contacts)
+        cd.done_ = true;
+      else if (req.is_done)
+        cd.done_ = req.is_done(res);
+    }
+  }
+}
+
 void CollisionEnvFCL::distanceSelf(const DistanceRequest& req, DistanceResult& res,
                                    const moveit::core::RobotState& state) const
 {
@@ -35,6 +35,7 @@
 /* Author: Jens Petit */
 
 #include <gtest/gtest.h>
+#include <set>
 
 #include <moveit/collision_detection/collision_common.h>
 
@@ -267,10 +268,8 @@ TEST_F(CollisionDetectionEnvTest, DISABLED_ContinuousCollisionSelf)
   res.clear();
 }
 
-/** \brief Two similar robot poses are used as start and end pose of a continuous collision check.
- *
- *  Functionality not supported yet. */
-TEST_F(CollisionDetectionEnvTest, DISABLED_ContinuousCollisionWorld)
+/** \brief Two similar robot poses are used as start and end pose of a continuous collision check. */
+TEST_F(CollisionDetectionEnvTest, ContinuousCollisionWorld)
 {
   collision_detection::CollisionRequest req;
   req.contacts = true;
@@ -312,9 +311,92 @@ TEST_F(CollisionDetectionEnvTest, DISABLED_ContinuousCollisionWorld)
   ASSERT_FALSE(res.collision);
   res.clear();
 
+  // the links that hit the box at some sampled state along the motion must all be reported by the continuous check
+  std::set<std::string> sampled_links;
+  moveit::core::RobotState sample(robot_model_);
+  for (int i = 0; i <= 100; ++i)
+  {
+    state1.interpolate(state2, 0.01 * i, sample);
+    sample.update();
+    c_env_->checkRobotCollision(req, res, sample, *acm_);
+    for (const auto& pair_contacts : res.contacts)
+      sampled_links.insert(pair_contacts.first.first == "box" ? pair_contacts.first.second :
+                                                                pair_contacts.first.first);
+    res.clear();
+  }
+  ASSERT_FALSE(sampled_links.empty());
+
+  c_env_->checkRobotCollision(req, res, state1, state2, *acm_);
+  ASSERT_TRUE(res.collision);
+  EXPECT_GE(res.contact_count, sampled_links.size());
+  for (const std::string& link : sampled_links)
+    EXPECT_TRUE(res.contacts.count(std::make_pair(std::min(link, std::string("box")),
+                                                  std::max(link, std::string("box")))))
+        << link;
+  for (const auto& pair_contacts : res.contacts)
+    for (const collision_detection::Contact& contact : pair_contacts.second)
+    {
+      EXPECT_TRUE(contact.body_name_1 == "box" || contact.body_name_2 == "box");
+      EXPECT_GT(contact.percent_interpolation, 0.0);
+      EXPECT_LT(contact.percent_interpolation, 1.0);
+      EXPECT_GE(contact.depth, 0.0);
+    }
+  res.clear();
+
+  // the box is ignored when the collision matrix allows all contacts with it
+  acm_->setDefaultEntry("box", true);
   c_env_->checkRobotCollision(req, res, state1, state2, *acm_);
+  ASSERT_FALSE(res.collision);
+  res.clear();
+}
+
+/** \brief A link rotating about its joint sweeps through a box it touches neither at the start nor at the end. The box
+ *  is outside the union of the bounding boxes of the link at both poses. */
+TEST(ContinuousCollisionRotation, RotatingLinkWorld)
+{
+  moveit::core::RobotModelBuilder builder("stick", "base_link");
+  builder.addChain("base_link->stick", "revolute", {}, urdf::Vector3(0.0, 0.0, 1.0));
+  geometry_msgs::msg::Pose origin;
+  origin.position.x = 0.5;
+  origin.orientation.w = 1.0;
+  builder.addCollisionBox("stick", { 1.0, 0.05, 0.05 }, origin);
+  ASSERT_TRUE(builder.isValid());
+  moveit::core::RobotModelPtr robot_model = builder.build();
+
+  collision_detection::CollisionEnvFCL c_env(robot_model);
+  shapes::ShapeConstPtr box = std::make_shared<const shapes::Box>(0.1, 0.1, 0.1);
+  Eigen::Isometry3d pos{ Eigen::Isometry3d::Identity() };
+  pos.translation().x() = 0.9;
+  c_env.getWorld()->addToObject("box", box, pos);
+
+  moveit::core::RobotState state1(robot_model);
+  moveit::core::RobotState state2(robot_model);
+  state1.setToDefaultValues();
+  state2.setToDefaultValues();
+  double angle1{ -1.2 };
+  double angle2{ 1.2 };
+  state1.setJointPositions("base_link-stick-joint", &angle1);
+  state2.setJointPositions("base_link-stick-joint", &angle2);
+  state1.update();
+  state2.update();
+
+  collision_detection::CollisionRequest req;
+  req.contacts = true;
+  collision_detection::CollisionResult res;
+  c_env.checkRobotCollision(req, res, state1);
+  ASSERT_FALSE(res.collision);
+  res.clear();
+
+  c_env.checkRobotCollision(req, res, state2);
+  ASSERT_FALSE(res.collision);
+  res.clear();
+
+  c_env.checkRobotCollision(req, res, state1, state2);
   ASSERT_TRUE(res.collision);
-  ASSERT_EQ(res.contact_count, 4u);
+  ASSERT_EQ(res.contact_count, 1u);
+  const collision_detection::Contact& contact = res.contacts.begin()->second.front();
+  EXPECT_GT(contact.percent_interpolation, 0.0);
+  EXPECT_LT(contact.percent_interpolation, 0.5);
   res.clear();
 }
 
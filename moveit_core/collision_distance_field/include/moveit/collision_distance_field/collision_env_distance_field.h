@@ -42,6 +42,8 @@
 #include <moveit/collision_detection/collision_env.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <boost/thread/mutex.hpp>
+#include <memory>
+#include <unordered_map>
 #include "rclcpp/rclcpp.hpp"
 
 namespace collision_detection
@@ -139,7 +141,11 @@ public:
   MOVEIT_STRUCT_FORWARD(DistanceFieldCacheEntryWorld);
   struct DistanceFieldCacheEntryWorld
   {
-    std::map<std::string, std::vector<PosedBodyPointDecompositionPtr>> posed_body_point_decompositions_;
+    /** \brief Sorted linear indices of the voxels occupied by each world object */
+    std::map<std::string, std::vector<std::size_t>> object_voxels_;
+    /** \brief Number of world objects occupying each voxel, so that voxels shared by several objects stay obstacles
+     *  until the last of them is removed */
+    std::unordered_map<std::size_t, unsigned int> voxel_occupancy_;
     distance_field::DistanceFieldPtr distance_field_;
   };
 
@@ -205,9 +211,15 @@ public:
     return distance_field_cache_entry_->distance_field_;
   }
 
+  /** \brief Get the distance field representing the world objects */
+  distance_field::DistanceFieldConstPtr getWorldDistanceField() const
+  {
+    return distance_field_cache_entry_world_->distance_field_;
+  }
+
   collision_detection::GroupStateRepresentationConstPtr getLastGroupStateRepresentation() const
   {
-    return last_gsr_;
+    return std::atomic_load(&last_gsr_);
   }
 
   void getCollisionGradients(const CollisionRequest& req, CollisionResult& res, const moveit::core::RobotState& state,
@@ -271,6 +283,11 @@ protected:
 
   DistanceFieldCacheEntryWorldPtr generateDistanceFieldCacheEntryWorld();
 
+  /** \brief Update the voxels occupied by world object \e id in \e dfce.
+   *
+   *  Only voxels that become free or occupied through this change are appended to \e subtract_points and
+   *  \e add_points, as the centers of the respective cells, so that they can be applied incrementally to the
+   *  distance field. */
   void updateDistanceObject(const std::string& id, CollisionEnvDistanceField::DistanceFieldCacheEntryWorldPtr& dfce,
                             EigenSTL::vector_Vector3d& add_points, EigenSTL::vector_Vector3d& subtract_points);
 
@@ -305,7 +322,7 @@ protected:
 
   mutable boost::mutex update_cache_lock_world_;
   DistanceFieldCacheEntryWorldPtr distance_field_cache_entry_world_;
-  GroupStateRepresentationPtr last_gsr_;
+  mutable GroupStateRepresentationPtr last_gsr_;  // only accessed through std::atomic_load/atomic_store
   World::ObserverHandle observer_handle_;
 };
 }  // namespace collision_detection
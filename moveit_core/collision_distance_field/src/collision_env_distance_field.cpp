@@ -1396,7 +1396,7 @@ void CollisionEnvDistanceField::checkCollision(const CollisionRequest& req, Coll
     getEnvironmentCollisions(req, res, distance_field_cache_entry_world_->distance_field_, gsr);
   }
 
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  std::atomic_store(&last_gsr_, gsr);
 }
 
 void CollisionEnvDistanceField::checkCollision(const CollisionRequest& req, CollisionResult& res,
@@ -1429,7 +1429,7 @@ void CollisionEnvDistanceField::checkCollision(const CollisionRequest& req, Coll
     getEnvironmentCollisions(req, res, distance_field_cache_entry_world_->distance_field_, gsr);
   }
 
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  std::atomic_store(&last_gsr_, gsr);
 }
 
 void CollisionEnvDistanceField::checkRobotCollision(const CollisionRequest& req, CollisionResult& res,
@@ -1453,7 +1453,7 @@ void CollisionEnvDistanceField::checkRobotCollision(const CollisionRequest& req,
     updateGroupStateRepresentationState(state, gsr);
   }
   getEnvironmentCollisions(req, res, env_distance_field, gsr);
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  std::atomic_store(&last_gsr_, gsr);
 
   // checkRobotCollisionHelper(req, res, robot, state, &acm);
 }
@@ -1482,7 +1482,7 @@ void CollisionEnvDistanceField::checkRobotCollision(const CollisionRequest& req,
     updateGroupStateRepresentationState(state, gsr);
   }
   getEnvironmentCollisions(req, res, env_distance_field, gsr);
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  std::atomic_store(&last_gsr_, gsr);
 
   // checkRobotCollisionHelper(req, res, robot, state, &acm);
 }
@@ -1522,7 +1522,7 @@ void CollisionEnvDistanceField::getCollisionGradients(const CollisionRequest& re
   getIntraGroupProximityGradients(gsr);
   getEnvironmentProximityGradients(env_distance_field, gsr);
 
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  std::atomic_store(&last_gsr_, gsr);
 }
 
 void CollisionEnvDistanceField::getAllCollisions(const CollisionRequest& req, CollisionResult& res,
@@ -1543,7 +1543,7 @@ void CollisionEnvDistanceField::getAllCollisions(const CollisionRequest& req, Co
   distance_field::DistanceFieldConstPtr env_distance_field = distance_field_cache_entry_world_->distance_field_;
   getEnvironmentCollisions(req, res, env_distance_field, gsr);
 
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  std::atomic_store(&last_gsr_, gsr);
 }
 
 bool CollisionEnvDistanceField::getEnvironmentCollisions(const CollisionRequest& req, CollisionResult& res,
@@ -1678,6 +1678,8 @@ void CollisionEnvDistanceField::setWorld(const WorldPtr& world)
 
   // clear out objects from old world
   distance_field_cache_entry_world_->distance_field_->reset();
+  distance_field_cache_entry_world_->object_voxels_.clear();
+  distance_field_cache_entry_world_->voxel_occupancy_.clear();
 
   CollisionEnv::setWorld(world);
 
@@ -1694,76 +1696,107 @@ void CollisionEnvDistanceField::notifyObjectChange(CollisionEnvDistanceField* se
   rclcpp::Clock clock;
   rclcpp::Time start_time = clock.now();
 
+  // only the voxels that changed occupancy are passed on to the distance field
   EigenSTL::vector_Vector3d add_points;
   EigenSTL::vector_Vector3d subtract_points;
   self->updateDistanceObject(obj->id_, self->distance_field_cache_entry_world_, add_points, subtract_points);
 
-  if (action == World::DESTROY)
-  {
-    self->distance_field_cache_entry_world_->distance_field_->removePointsFromField(subtract_points);
-  }
-  else if (action & (World::MOVE_SHAPE | World::REMOVE_SHAPE))
-  {
+  if (!subtract_points.empty())
     self->distance_field_cache_entry_world_->distance_field_->removePointsFromField(subtract_points);
+  if (!add_points.empty())
     self->distance_field_cache_entry_world_->distance_field_->addPointsToField(add_points);
-  }
-  else
-  {
-    self->distance_field_cache_entry_world_->distance_field_->addPointsToField(add_points);
-  }
 
-  RCLCPP_DEBUG(LOGGER, "Modifying object %s took %lf s", obj->id_.c_str(), (clock.now() - start_time).seconds());
+  RCLCPP_DEBUG(LOGGER, "Modifying object %s took %lf s (%zu voxels added, %zu removed)", obj->id_.c_str(),
+               (clock.now() - start_time).seconds(), add_points.size(), subtract_points.size());
 }
 
 void CollisionEnvDistanceField::updateDistanceObject(const std::string& id, DistanceFieldCacheEntryWorldPtr& dfce,
                                                      EigenSTL::vector_Vector3d& add_points,
                                                      EigenSTL::vector_Vector3d& subtract_points)
 {
-  std::map<std::string, std::vector<PosedBodyPointDecompositionPtr>>::iterator cur_it =
-      dfce->posed_body_point_decompositions_.find(id);
-  if (cur_it != dfce->posed_body_point_decompositions_.end())
-  {
-    for (collision_detection::PosedBodyPointDecompositionPtr& posed_body_point_decomposition : cur_it->second)
-    {
-      subtract_points.insert(subtract_points.end(), posed_body_point_decomposition->getCollisionPoints().begin(),
-                             posed_body_point_decomposition->getCollisionPoints().end());
-    }
-  }
+  const distance_field::DistanceField& field = *dfce->distance_field_;
+  const std::size_t num_x = field.getXNumCells();
+  const std::size_t num_xy = num_x * field.getYNumCells();
 
+  std::vector<std::size_t> new_voxels;
   World::ObjectConstPtr object = getWorld()->getObject(id);
   if (object)
   {
     RCLCPP_DEBUG(LOGGER, "Updating/Adding Object '%s' with %lu shapes to CollisionEnvDistanceField",
                  object->id_.c_str(), object->shapes_.size());
-    std::vector<PosedBodyPointDecompositionPtr> shape_points;
     for (unsigned int i = 0; i < object->shapes_.size(); i++)
     {
       shapes::ShapeConstPtr shape = object->shapes_[i];
+      PosedBodyPointDecompositionPtr shape_points;
       if (shape->type == shapes::OCTREE)
       {
         const shapes::OcTree* octree_shape = static_cast<const shapes::OcTree*>(shape.get());
         std::shared_ptr<const octomap::OcTree> octree = octree_shape->octree;
 
-        shape_points.push_back(std::make_shared<PosedBodyPointDecomposition>(octree));
+        shape_points = std::make_shared<PosedBodyPointDecomposition>(octree);
       }
       else
       {
         BodyDecompositionConstPtr bd = getBodyDecompositionCacheEntry(shape, resolution_);
 
-        shape_points.push_back(std::make_shared<PosedBodyPointDecomposition>(bd, object->shape_poses_[i]));
+        shape_points = std::make_shared<PosedBodyPointDecomposition>(bd, object->shape_poses_[i]);
       }
 
-      add_points.insert(add_points.end(), shape_points.back()->getCollisionPoints().begin(),
-                        shape_points.back()->getCollisionPoints().end());
+      for (const Eigen::Vector3d& point : shape_points->getCollisionPoints())
+      {
+        int x, y, z;
+        if (field.worldToGrid(point.x(), point.y(), point.z(), x, y, z))
+          new_voxels.push_back(x + y * num_x + z * num_xy);
+      }
     }
-
-    dfce->posed_body_point_decompositions_[id] = shape_points;
+    std::sort(new_voxels.begin(), new_voxels.end());
+    new_voxels.erase(std::unique(new_voxels.begin(), new_voxels.end()), new_voxels.end());
   }
   else
-  {
     RCLCPP_DEBUG(LOGGER, "Removing Object '%s' from CollisionEnvDistanceField", id.c_str());
-    dfce->posed_body_point_decompositions_.erase(id);
+
+  static const std::vector<std::size_t> NO_VOXELS;
+  auto cur_it = dfce->object_voxels_.find(id);
+  const std::vector<std::size_t>& old_voxels = cur_it != dfce->object_voxels_.end() ? cur_it->second : NO_VOXELS;
+
+  auto appendCellCenter = [&](std::size_t voxel, EigenSTL::vector_Vector3d& points) {
+    Eigen::Vector3d point;
+    field.gridToWorld(voxel % num_x, (voxel / num_x) % field.getYNumCells(), voxel / num_xy, point.x(), point.y(),
+                      point.z());
+    points.push_back(point);
+  };
+
+  // walk both sorted voxel lists, updating the occupancy of voxels that are only in one of them
+  std::size_t i = 0, j = 0;
+  while (i < old_voxels.size() || j < new_voxels.size())
+  {
+    if (j == new_voxels.size() || (i < old_voxels.size() && old_voxels[i] < new_voxels[j]))
+    {
+      auto occupancy = dfce->voxel_occupancy_.find(old_voxels[i]);
+      if (occupancy != dfce->voxel_occupancy_.end() && --occupancy->second == 0)
+      {
+        dfce->voxel_occupancy_.erase(occupancy);
+        appendCellCenter(old_voxels[i], subtract_points);
+      }
+      ++i;
+    }
+    else if (i == old_voxels.size() || new_voxels[j] < old_voxels[i])
+    {
+      if (++dfce->voxel_occupancy_[new_voxels[j]] == 1)
+        appendCellCenter(new_voxels[j], add_points);
+      ++j;
+    }
+    else
+    {
+      ++i;
+      ++j;
+    }
   }
+
+  if (object)
+    dfce->object_voxels_[id].swap(new_voxels);
+  else if (cur_it != dfce->object_voxels_.end())
+    dfce->object_voxels_.erase(cur_it);
 }
 
 CollisionEnvDistanceField::DistanceFieldCacheEntryWorldPtr
@@ -259,6 +259,35 @@ TEST_F(DistanceFieldCollisionDetectionTester, ContactPositions)
   ASSERT_FALSE(res3.collision);
 }
 
+TEST_F(DistanceFieldCollisionDetectionTester, IncrementalWorldUpdates)
+{
+  auto env = std::static_pointer_cast<DefaultCEnvType>(cenv_);
+  collision_detection::WorldPtr world = cenv_->getWorld();
+
+  // two overlapping boxes, one of which is moved and the other one removed afterwards
+  shapes::ShapeConstPtr box(new shapes::Box(0.2, 0.2, 0.2));
+  world->addToObject("box1", box, Eigen::Isometry3d(Eigen::Translation3d(0.5, 0.0, 0.5)));
+  world->addToObject("box2", box, Eigen::Isometry3d(Eigen::Translation3d(0.6, 0.0, 0.5)));
+  world->moveShapeInObject("box2", box, Eigen::Isometry3d(Eigen::Translation3d(0.6, 0.3, 0.5)));
+
+  // voxels formerly shared with box2 still belong to box1
+  distance_field::DistanceFieldConstPtr field = env->getWorldDistanceField();
+  EXPECT_EQ(field->getDistance(0.55, 0.0, 0.5), 0.0);
+  EXPECT_GT(field->getDistance(0.65, 0.0, 0.5), 0.0);
+  EXPECT_EQ(field->getDistance(0.6, 0.3, 0.5), 0.0);
+
+  world->removeObject("box1");
+  EXPECT_GT(field->getDistance(0.5, 0.0, 0.5), 0.0);
+
+  // the incrementally updated field matches one built from scratch
+  DefaultCEnvType fresh(*env, world);
+  distance_field::DistanceFieldConstPtr fresh_field = fresh.getWorldDistanceField();
+  for (int x = 0; x < field->getXNumCells(); ++x)
+    for (int y = 0; y < field->getYNumCells(); ++y)
+      for (int z = 0; z < field->getZNumCells(); ++z)
+        ASSERT_EQ(field->getDistance(x, y, z), fresh_field->getDistance(x, y, z));
+}
+
 TEST_F(DistanceFieldCollisionDetectionTester, AttachedBodyTester)
 {
   collision_detection::CollisionRequest req;
@@ -38,6 +38,7 @@
 
 #include <moveit/distance_field/voxel_grid.h>
 #include <moveit/distance_field/distance_field.h>
+#include <moveit/utils/worker_pool.h>
 #include <vector>
 #include <Eigen/Core>
 #include <set>
@@ -106,6 +107,7 @@ struct PropDistanceFieldVoxel
                                      propagation*/
 
   static const int UNINITIALIZED = -1; /**< \brief Value that represents an unitialized voxel */
+  static const int SELF = -2;          /**< \brief Closest point value that stands for the voxel itself */
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 
@@ -162,10 +164,20 @@ public:
    * \ref PropagationDistanceField description for more information on
    * the implications of this.
    *
+   * @param [in] propagation_thread_count Number of threads used to
+   * expand large propagation buckets, 0 selecting the hardware
+   * concurrency.  The resulting field is identical to the one
+   * computed by a single thread.
+   *
+   * @param [in] blocked_storage Whether to store the voxels in blocks
+   * that are only allocated around obstacles (see \ref VoxelGrid)
+   * instead of densely.  This trades some speed for memory on large,
+   * sparsely occupied volumes.
    */
   PropagationDistanceField(double size_x, double size_y, double size_z, double resolution, double origin_x,
                            double origin_y, double origin_z, double max_distance,
-                           bool propagate_negative_distances = false);
+                           bool propagate_negative_distances = false, unsigned int propagation_thread_count = 1,
+                           bool blocked_storage = false);
 
   /**
    * \brief Constructor based on an OcTree and bounding box
@@ -188,10 +200,21 @@ public:
    * and all obstacle cells will be assigned zero distance.  See the
    * \ref PropagationDistanceField description for more information on
    * the implications of this.
+   *
+   * @param [in] propagation_thread_count Number of threads used to
+   * expand large propagation buckets, 0 selecting the hardware
+   * concurrency.  The resulting field is identical to the one
+   * computed by a single thread.
+   *
+   * @param [in] blocked_storage Whether to store the voxels in blocks
+   * that are only allocated around obstacles (see \ref VoxelGrid)
+   * instead of densely.  This trades some speed for memory on large,
+   * sparsely occupied volumes.
    */
   PropagationDistanceField(const octomap::OcTree& octree, const octomap::point3d& bbx_min,
                            const octomap::point3d& bbx_max, double max_distance,
-                           bool propagate_negative_distances = false);
+                           bool propagate_negative_distances = false, unsigned int propagation_thread_count = 1,
+                           bool blocked_storage = false);
 
   /**
    * \brief Constructor that takes an istream and reads the contents
@@ -212,9 +235,20 @@ public:
    * \ref PropagationDistanceField description for more information on
    * the implications of this.
    *
+   * @param [in] propagation_thread_count Number of threads used to
+   * expand large propagation buckets, 0 selecting the hardware
+   * concurrency.  The resulting field is identical to the one
+   * computed by a single thread.
+   *
+   * @param [in] blocked_storage Whether to store the voxels in blocks
+   * that are only allocated around obstacles (see \ref VoxelGrid)
+   * instead of densely.  This trades some speed for memory on large,
+   * sparsely occupied volumes.
+   *
    * @return
    */
-  PropagationDistanceField(std::istream& stream, double max_distance, bool propagate_negative_distances = false);
+  PropagationDistanceField(std::istream& stream, double max_distance, bool propagate_negative_distances = false,
+                           unsigned int propagation_thread_count = 1, bool blocked_storage = false);
   /**
    * \brief Empty destructor
    *
@@ -384,11 +418,37 @@ public:
    * @param [in] y The integer Y location
    * @param [in] z The integer Z location
    *
+   * Voxels of a blocked grid that were not touched since the last
+   * reset share a single voxel whose closest negative point is
+   * PropDistanceFieldVoxel::SELF; use getResolvedCell() to get the
+   * same data as with dense storage.
+   *
    * @return The data in the indicated cell.
    */
   const PropDistanceFieldVoxel& getCell(int x, int y, int z) const
   {
-    return voxel_grid_->getCell(x, y, z);
+    return getConstVoxelGrid().getCell(x, y, z);
+  }
+
+  /**
+   * \brief Gets a copy of the cell data given an index, with a
+   * PropDistanceFieldVoxel::SELF closest negative point resolved to
+   * (x, y, z).
+   *
+   * x,y,z MUST be valid or data corruption (SEGFAULTS) will occur.
+   *
+   * @param [in] x The integer X location
+   * @param [in] y The integer Y location
+   * @param [in] z The integer Z location
+   *
+   * @return The data in the indicated cell, independent of the storage mode.
+   */
+  PropDistanceFieldVoxel getResolvedCell(int x, int y, int z) const
+  {
+    PropDistanceFieldVoxel cell = getCell(x, y, z);
+    if (cell.closest_negative_point_.x() == PropDistanceFieldVoxel::SELF)
+      cell.closest_negative_point_ = Eigen::Vector3i(x, y, z);
+    return cell;
   }
 
   /**
@@ -411,19 +471,19 @@ public:
    */
   const PropDistanceFieldVoxel* getNearestCell(int x, int y, int z, double& dist, Eigen::Vector3i& pos) const
   {
-    const PropDistanceFieldVoxel* cell = &voxel_grid_->getCell(x, y, z);
+    const PropDistanceFieldVoxel* cell = &getCell(x, y, z);
     if (cell->distance_square_ > 0)
     {
       dist = sqrt_table_[cell->distance_square_];
       pos = cell->closest_point_;
-      const PropDistanceFieldVoxel* ncell = &voxel_grid_->getCell(pos.x(), pos.y(), pos.z());
+      const PropDistanceFieldVoxel* ncell = &getCell(pos.x(), pos.y(), pos.z());
       return ncell == cell ? nullptr : ncell;
     }
     if (cell->negative_distance_square_ > 0)
     {
       dist = -sqrt_table_[cell->negative_distance_square_];
       pos = cell->closest_negative_point_;
-      const PropDistanceFieldVoxel* ncell = &voxel_grid_->getCell(pos.x(), pos.y(), pos.z());
+      const PropDistanceFieldVoxel* ncell = &getCell(pos.x(), pos.y(), pos.z());
       return ncell == cell ? nullptr : ncell;
     }
     dist = 0.0;
@@ -446,6 +506,17 @@ public:
     return max_distance_sq_;
   }
 
+  /**
+   * \brief Gets the number of threads used to expand propagation
+   * buckets, as selected at construction.
+   *
+   * @return The number of propagation threads
+   */
+  unsigned int getPropagationThreadCount() const
+  {
+    return propagation_thread_count_;
+  }
+
 private:
   /** Typedef for set of integer indices */
   typedef std::set<Eigen::Vector3i, CompareEigenVector3i, Eigen::aligned_allocator<Eigen::Vector3i>> VoxelSet;
@@ -457,6 +528,18 @@ private:
    */
   void initialize();
 
+  /**
+   * \brief Read-only access to the voxel grid.  Unlike the non-const
+   * accessors, this never allocates blocks of a blocked grid, so it is
+   * safe to use from concurrent readers.
+   *
+   * @return The voxel grid
+   */
+  const VoxelGrid<PropDistanceFieldVoxel>& getConstVoxelGrid() const
+  {
+    return *voxel_grid_;
+  }
+
   /**
    * \brief Adds a valid set of integer points to the voxel grid
    *
@@ -487,6 +570,37 @@ private:
    */
   void propagateNegative();
 
+  /**
+   * \brief Processes a bucket queue in order of increasing distance,
+   * operating on the positive or negative voxel fields selected by the
+   * member pointers.  Large buckets are expanded by \ref
+   * propagation_thread_count_ threads, the calling thread and the
+   * persistent \ref propagation_workers_, that gather candidate updates
+   * from a read-only view of the grid; the candidates are then applied
+   * in bucket order, so the result matches a serial expansion.
+   *
+   * @param bucket_queue The queue to process and clear
+   * @param distance_square The squared distance field of the voxels
+   * @param closest_point The closest point field of the voxels
+   * @param update_direction The update direction field of the voxels
+   */
+  void propagateBuckets(std::vector<EigenSTL::vector_Vector3i>& bucket_queue,
+                        int PropDistanceFieldVoxel::*distance_square,
+                        Eigen::Vector3i PropDistanceFieldVoxel::*closest_point,
+                        int PropDistanceFieldVoxel::*update_direction);
+
+  /**
+   * \brief Updates the neighbors of a single queued voxel, pushing
+   * every improved neighbor into the bucket queue.
+   *
+   * @param bucket_queue The queue receiving the improved neighbors
+   * @param loc The voxel to expand
+   * @param d Neighborhood selector, 0 for obstacle voxels and 1 otherwise
+   */
+  void expandVoxel(std::vector<EigenSTL::vector_Vector3i>& bucket_queue, const Eigen::Vector3i& loc, int d,
+                   int PropDistanceFieldVoxel::*distance_square, Eigen::Vector3i PropDistanceFieldVoxel::*closest_point,
+                   int PropDistanceFieldVoxel::*update_direction);
+
   /**
    * \brief Determines distance based on actual voxel data
    *
@@ -541,6 +655,14 @@ private:
 
   bool propagate_negative_; /**< \brief Whether or not to propagate negative distances */
 
+  unsigned int propagation_thread_count_; /**< \brief Number of threads expanding large propagation buckets */
+
+  /** \brief Worker threads that expand large propagation buckets together with the calling thread, shared by copies
+      of the field. NULL for a single propagation thread. */
+  std::shared_ptr<moveit::core::WorkerPool> propagation_workers_;
+
+  bool blocked_storage_; /**< \brief Whether the voxel grid allocates its storage in blocks on demand */
+
   VoxelGrid<PropDistanceFieldVoxel>::Ptr voxel_grid_; /**< \brief Actual container for distance data */
 
   /// \brief Structure used to hold propagation frontier
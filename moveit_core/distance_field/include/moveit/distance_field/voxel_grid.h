@@ -38,6 +38,8 @@
 
 #include <algorithm>
 #include <cmath>
+#include <memory>
+#include <vector>
 #include <Eigen/Core>
 #include <moveit/macros/declare_ptr.h>
 
@@ -52,10 +54,17 @@ enum Dimension
 };
 
 /**
- * \brief VoxelGrid holds a dense 3D, axis-aligned set of data at a
- * given resolution, where the data is supplied as a template
- * parameter.
+ * \brief VoxelGrid holds a 3D, axis-aligned set of data at a given
+ * resolution, where the data is supplied as a template parameter.
  *
+ * By default the data is stored densely.  A blocked grid instead
+ * stores cells in cubic blocks of \ref BLOCK_SIZE cells per side that
+ * are allocated the first time one of their cells is accessed through
+ * a non-const accessor; cells of unallocated blocks read as the value
+ * last passed to \ref reset.  Blocked grids only pay for the regions
+ * that are actually written, at the cost of an extra indirection per
+ * access.  Non-const accessors of a blocked grid must not be called
+ * concurrently.
  */
 template <typename T>
 class VoxelGrid
@@ -87,9 +96,12 @@ public:
    *
    * @param [in] default_object An object that will be returned for any
    * future queries that are not valid
+   *
+   * @param [in] blocked Whether to store the cells in blocks allocated
+   * on demand instead of a dense array
    */
   VoxelGrid(double size_x, double size_y, double size_z, double resolution, double origin_x, double origin_y,
-            double origin_z, T default_object);
+            double origin_z, T default_object, bool blocked = false);
   virtual ~VoxelGrid();
 
   /**
@@ -116,9 +128,12 @@ public:
    * @param [in] origin_x Minimum point along the X axis of the volume
    * @param [in] origin_y Minimum point along the Y axis of the volume
    * @param [in] origin_z Minimum point along the Z axis of the volume
+   *
+   * @param [in] blocked Whether to store the cells in blocks allocated
+   * on demand instead of a dense array
    */
   void resize(double size_x, double size_y, double size_z, double resolution, double origin_x, double origin_y,
-              double origin_z, T default_object);
+              double origin_z, T default_object, bool blocked = false);
 
   /**
    * \brief Operator that gets the value of the given location (x, y,
@@ -180,12 +195,31 @@ public:
   void setCell(const Eigen::Vector3i& pos, const T& obj);
 
   /**
-   * \brief Sets every cell in the voxel grid to the supplied data
+   * \brief Sets every cell in the voxel grid to the supplied data.
+   * A blocked grid releases all of its blocks instead.
    *
    * @param [in] initial The template variable to which to set the data
    */
   void reset(const T& initial);
 
+  /** \brief Number of cells along each side of a block of a blocked grid */
+  static constexpr int BLOCK_SIZE = 8;
+
+  /**
+   * \brief Whether the cells are stored in blocks allocated on demand
+   *
+   * @return True for a blocked grid, false for a dense one
+   */
+  bool isBlocked() const;
+
+  /**
+   * \brief Gets the number of blocks of a blocked grid that hold
+   * cell data, which is zero for a dense grid
+   *
+   * @return The number of allocated blocks
+   */
+  std::size_t getAllocatedBlockCount() const;
+
   /**
    * \brief Gets the size in arbitrary units of the indicated dimension
    *
@@ -299,6 +333,11 @@ protected:
   int stride1_;            /**< \brief The step to take when stepping between consecutive X members in the 1D array */
   int stride2_; /**< \brief The step to take when stepping between consecutive Y members given an X in the 1D array */
 
+  bool blocked_;                             /**< \brief Whether cells are stored in blocks instead of data_ */
+  int num_blocks_[3];                        /**< \brief The number of blocks in each dimension */
+  std::vector<std::unique_ptr<T[]>> blocks_; /**< \brief Block storage, null for blocks that were never written */
+  T fill_object_;                            /**< \brief The value of all cells in unallocated blocks */
+
   /**
    * \brief Gets the 1D index into the array, with no validity check.
    *
@@ -310,6 +349,39 @@ protected:
    */
   int ref(int x, int y, int z) const;
 
+  /**
+   * \brief Gets the index of the block holding a cell of a blocked grid
+   *
+   * @param [in] x The integer X location
+   * @param [in] y The integer Y location
+   * @param [in] z The integer Z location
+   *
+   * @return The index into blocks_
+   */
+  int blockRef(int x, int y, int z) const;
+
+  /**
+   * \brief Gets the index of a cell within its block
+   *
+   * @param [in] x The integer X location
+   * @param [in] y The integer Y location
+   * @param [in] z The integer Z location
+   *
+   * @return The index into the block
+   */
+  int cellInBlockRef(int x, int y, int z) const;
+
+  /**
+   * \brief Gets a cell of a blocked grid, allocating its block if needed
+   *
+   * @param [in] x The integer X location
+   * @param [in] y The integer Y location
+   * @param [in] z The integer Z location
+   *
+   * @return The data in the indicated cell
+   */
+  T& getBlockedCell(int x, int y, int z);
+
   /**
    * \brief Gets the cell number from the location
    */
@@ -340,14 +412,14 @@ protected:
 
 template <typename T>
 VoxelGrid<T>::VoxelGrid(double size_x, double size_y, double size_z, double resolution, double origin_x,
-                        double origin_y, double origin_z, T default_object)
+                        double origin_y, double origin_z, T default_object, bool blocked)
   : data_(nullptr)
 {
-  resize(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z, default_object);
+  resize(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z, default_object, blocked);
 }
 
 template <typename T>
-VoxelGrid<T>::VoxelGrid() : data_(NULL)
+VoxelGrid<T>::VoxelGrid() : data_(NULL), blocked_(false)
 {
   for (int i = DIM_X; i <= DIM_Z; ++i)
   {
@@ -355,6 +427,7 @@ VoxelGrid<T>::VoxelGrid() : data_(NULL)
     origin_[i] = 0;
     origin_minus_[i] = 0;
     num_cells_[i] = 0;
+    num_blocks_[i] = 0;
   }
   resolution_ = 1.0;
   oo_resolution_ = 1.0 / resolution_;
@@ -365,10 +438,11 @@ VoxelGrid<T>::VoxelGrid() : data_(NULL)
 
 template <typename T>
 void VoxelGrid<T>::resize(double size_x, double size_y, double size_z, double resolution, double origin_x,
-                          double origin_y, double origin_z, T default_object)
+                          double origin_y, double origin_z, T default_object, bool blocked)
 {
   delete[] data_;
   data_ = nullptr;
+  blocks_.clear();
 
   size_[DIM_X] = size_x;
   size_[DIM_Y] = size_y;
@@ -382,20 +456,30 @@ void VoxelGrid<T>::resize(double size_x, double size_y, double size_z, double re
   num_cells_total_ = 1;
   resolution_ = resolution;
   oo_resolution_ = 1.0 / resolution_;
+  int num_blocks_total = 1;
   for (int i = DIM_X; i <= DIM_Z; ++i)
   {
     num_cells_[i] = size_[i] * oo_resolution_;
     num_cells_total_ *= num_cells_[i];
+    num_blocks_[i] = (num_cells_[i] + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    num_blocks_total *= num_blocks_[i];
   }
 
   default_object_ = default_object;
+  fill_object_ = default_object;
+  blocked_ = blocked;
 
   stride1_ = num_cells_[DIM_Y] * num_cells_[DIM_Z];
   stride2_ = num_cells_[DIM_Z];
 
   // initialize the data:
   if (num_cells_total_ > 0)
-    data_ = new T[num_cells_total_];
+  {
+    if (blocked_)
+      blocks_.resize(num_blocks_total);
+    else
+      data_ = new T[num_cells_total_];
+  }
 }
 
 template <typename T>
@@ -428,6 +512,42 @@ inline int VoxelGrid<T>::ref(int x, int y, int z) const
   return x * stride1_ + y * stride2_ + z;
 }
 
+template <typename T>
+inline int VoxelGrid<T>::blockRef(int x, int y, int z) const
+{
+  return ((x / BLOCK_SIZE) * num_blocks_[DIM_Y] + y / BLOCK_SIZE) * num_blocks_[DIM_Z] + z / BLOCK_SIZE;
+}
+
+template <typename T>
+inline int VoxelGrid<T>::cellInBlockRef(int x, int y, int z) const
+{
+  return ((x % BLOCK_SIZE) * BLOCK_SIZE + y % BLOCK_SIZE) * BLOCK_SIZE + z % BLOCK_SIZE;
+}
+
+template <typename T>
+T& VoxelGrid<T>::getBlockedCell(int x, int y, int z)
+{
+  std::unique_ptr<T[]>& block = blocks_[blockRef(x, y, z)];
+  if (!block)
+  {
+    block.reset(new T[BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE]);
+    std::fill(block.get(), block.get() + BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE, fill_object_);
+  }
+  return block[cellInBlockRef(x, y, z)];
+}
+
+template <typename T>
+inline bool VoxelGrid<T>::isBlocked() const
+{
+  return blocked_;
+}
+
+template <typename T>
+std::size_t VoxelGrid<T>::getAllocatedBlockCount() const
+{
+  return std::count_if(blocks_.begin(), blocks_.end(), [](const std::unique_ptr<T[]>& block) { return bool(block); });
+}
+
 template <typename T>
 inline double VoxelGrid<T>::getSize(Dimension dim) const
 {
@@ -478,37 +598,44 @@ inline const T& VoxelGrid<T>::operator()(const Eigen::Vector3d& pos) const
 template <typename T>
 inline T& VoxelGrid<T>::getCell(int x, int y, int z)
 {
+  if (blocked_)
+    return getBlockedCell(x, y, z);
   return data_[ref(x, y, z)];
 }
 
 template <typename T>
 inline const T& VoxelGrid<T>::getCell(int x, int y, int z) const
 {
+  if (blocked_)
+  {
+    const std::unique_ptr<T[]>& block = blocks_[blockRef(x, y, z)];
+    return block ? block[cellInBlockRef(x, y, z)] : fill_object_;
+  }
   return data_[ref(x, y, z)];
 }
 
 template <typename T>
 inline T& VoxelGrid<T>::getCell(const Eigen::Vector3i& pos)
 {
-  return data_[ref(pos.x(), pos.y(), pos.z())];
+  return getCell(pos.x(), pos.y(), pos.z());
 }
 
 template <typename T>
 inline const T& VoxelGrid<T>::getCell(const Eigen::Vector3i& pos) const
 {
-  return data_[ref(pos.x(), pos.y(), pos.z())];
+  return getCell(pos.x(), pos.y(), pos.z());
 }
 
 template <typename T>
 inline void VoxelGrid<T>::setCell(int x, int y, int z, const T& obj)
 {
-  data_[ref(x, y, z)] = obj;
+  getCell(x, y, z) = obj;
 }
 
 template <typename T>
 inline void VoxelGrid<T>::setCell(const Eigen::Vector3i& pos, const T& obj)
 {
-  data_[ref(pos.x(), pos.y(), pos.z())] = obj;
+  getCell(pos.x(), pos.y(), pos.z()) = obj;
 }
 
 template <typename T>
@@ -540,6 +667,13 @@ inline double VoxelGrid<T>::getLocationFromCell(Dimension dim, int cell) const
 template <typename T>
 inline void VoxelGrid<T>::reset(const T& initial)
 {
+  if (blocked_)
+  {
+    fill_object_ = initial;
+    for (std::unique_ptr<T[]>& block : blocks_)
+      block.reset();
+    return;
+  }
   std::fill(data_, data_ + num_cells_total_, initial);
 }
 
@@ -40,17 +40,53 @@
 #include <boost/iostreams/copy.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
 #include "rclcpp/rclcpp.hpp"
+#include <algorithm>
+#include <thread>
 
 namespace distance_field
 {
 // Logger
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_distance_field.propagation_distance_field");
 
+namespace
+{
+// Buckets smaller than this are expanded on the calling thread only
+constexpr std::size_t MIN_PARALLEL_BUCKET_SIZE = 2048;
+
+// Neighbor update proposed while expanding the bucket entry with index 'entry'
+struct PropagationCandidate
+{
+  std::size_t entry;
+  Eigen::Vector3i location;
+  int distance_square;
+  int update_direction;
+};
+
+unsigned int resolveThreadCount(unsigned int thread_count)
+{
+  if (thread_count == 0)
+    thread_count = std::thread::hardware_concurrency();
+  return std::max(1u, thread_count);
+}
+
+std::shared_ptr<moveit::core::WorkerPool> createWorkers(unsigned int thread_count)
+{
+  // the calling thread expands a share of each bucket as well
+  if (thread_count < 2)
+    return nullptr;
+  return std::make_shared<moveit::core::WorkerPool>(thread_count - 1);
+}
+}  // namespace
+
 PropagationDistanceField::PropagationDistanceField(double size_x, double size_y, double size_z, double resolution,
                                                    double origin_x, double origin_y, double origin_z,
-                                                   double max_distance, bool propagate_negative)
+                                                   double max_distance, bool propagate_negative,
+                                                   unsigned int propagation_thread_count, bool blocked_storage)
   : DistanceField(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z)
   , propagate_negative_(propagate_negative)
+  , propagation_thread_count_(resolveThreadCount(propagation_thread_count))
+  , propagation_workers_(createWorkers(propagation_thread_count_))
+  , blocked_storage_(blocked_storage)
   , max_distance_(max_distance)
 {
   initialize();
@@ -58,10 +94,14 @@ PropagationDistanceField::PropagationDistanceField(double size_x, double size_y,
 
 PropagationDistanceField::PropagationDistanceField(const octomap::OcTree& octree, const octomap::point3d& bbx_min,
                                                    const octomap::point3d& bbx_max, double max_distance,
-                                                   bool propagate_negative_distances)
+                                                   bool propagate_negative_distances,
+                                                   unsigned int propagation_thread_count, bool blocked_storage)
   : DistanceField(bbx_max.x() - bbx_min.x(), bbx_max.y() - bbx_min.y(), bbx_max.z() - bbx_min.z(),
                   octree.getResolution(), bbx_min.x(), bbx_min.y(), bbx_min.z())
   , propagate_negative_(propagate_negative_distances)
+  , propagation_thread_count_(resolveThreadCount(propagation_thread_count))
+  , propagation_workers_(createWorkers(propagation_thread_count_))
+  , blocked_storage_(blocked_storage)
   , max_distance_(max_distance)
   , max_distance_sq_(0)  // avoid gcc warning about uninitialized value
 {
@@ -70,8 +110,14 @@ PropagationDistanceField::PropagationDistanceField(const octomap::OcTree& octree
 }
 
 PropagationDistanceField::PropagationDistanceField(std::istream& is, double max_distance,
-                                                   bool propagate_negative_distances)
-  : DistanceField(0, 0, 0, 0, 0, 0, 0), propagate_negative_(propagate_negative_distances), max_distance_(max_distance)
+                                                   bool propagate_negative_distances,
+                                                   unsigned int propagation_thread_count, bool blocked_storage)
+  : DistanceField(0, 0, 0, 0, 0, 0, 0)
+  , propagate_negative_(propagate_negative_distances)
+  , propagation_thread_count_(resolveThreadCount(propagation_thread_count))
+  , propagation_workers_(createWorkers(propagation_thread_count_))
+  , blocked_storage_(blocked_storage)
+  , max_distance_(max_distance)
 {
   readFromStream(is);
 }
@@ -80,7 +126,8 @@ void PropagationDistanceField::initialize()
 {
   max_distance_sq_ = ceil(max_distance_ / resolution_) * ceil(max_distance_ / resolution_);
   voxel_grid_.reset(new VoxelGrid<PropDistanceFieldVoxel>(size_x_, size_y_, size_z_, resolution_, origin_x_, origin_y_,
-                                                          origin_z_, PropDistanceFieldVoxel(max_distance_sq_, 0)));
+                                                          origin_z_, PropDistanceFieldVoxel(max_distance_sq_, 0),
+                                                          blocked_storage_));
 
   initNeighborhoods();
 
@@ -156,7 +203,7 @@ void PropagationDistanceField::updatePointsInField(const EigenSTL::vector_Vector
   EigenSTL::vector_Vector3i new_not_in_current;
   for (Eigen::Vector3i& voxel_loc : new_not_old)
   {
-    if (voxel_grid_->getCell(voxel_loc.x(), voxel_loc.y(), voxel_loc.z()).distance_square_ != 0)
+    if (getCell(voxel_loc.x(), voxel_loc.y(), voxel_loc.z()).distance_square_ != 0)
     {
       new_not_in_current.push_back(voxel_loc);
     }
@@ -178,7 +225,7 @@ void PropagationDistanceField::addPointsToField(const EigenSTL::vector_Vector3d&
 
     if (valid)
     {
-      if (voxel_grid_->getCell(voxel_loc.x(), voxel_loc.y(), voxel_loc.z()).distance_square_ > 0)
+      if (getCell(voxel_loc.x(), voxel_loc.y(), voxel_loc.z()).distance_square_ > 0)
       {
         voxel_points.push_back(voxel_loc);
       }
@@ -217,7 +264,7 @@ void PropagationDistanceField::addNewObstacleVoxels(const EigenSTL::vector_Vecto
   EigenSTL::vector_Vector3i negative_stack;
   if (propagate_negative_)
   {
-    negative_stack.reserve(getXNumCells() * getYNumCells() * getZNumCells());
+    negative_stack.reserve(voxel_points.size());
     negative_bucket_queue_[0].reserve(voxel_points.size());
   }
 
@@ -299,11 +346,11 @@ void PropagationDistanceField::removeObstacleVoxels(const EigenSTL::vector_Vecto
   EigenSTL::vector_Vector3i negative_stack;
   int initial_update_direction = getDirectionNumber(0, 0, 0);
 
-  stack.reserve(getXNumCells() * getYNumCells() * getZNumCells());
+  stack.reserve(voxel_points.size());
   bucket_queue_[0].reserve(voxel_points.size());
   if (propagate_negative_)
   {
-    negative_stack.reserve(getXNumCells() * getYNumCells() * getZNumCells());
+    negative_stack.reserve(voxel_points.size());
     negative_bucket_queue_[0].reserve(voxel_points.size());
   }
 
@@ -381,122 +428,180 @@ void PropagationDistanceField::removeObstacleVoxels(const EigenSTL::vector_Vecto
 
 void PropagationDistanceField::propagatePositive()
 {
+  propagateBuckets(bucket_queue_, &PropDistanceFieldVoxel::distance_square_, &PropDistanceFieldVoxel::closest_point_,
+                   &PropDistanceFieldVoxel::update_direction_);
+}
+
+void PropagationDistanceField::propagateNegative()
+{
+  propagateBuckets(negative_bucket_queue_, &PropDistanceFieldVoxel::negative_distance_square_,
+                   &PropDistanceFieldVoxel::closest_negative_point_,
+                   &PropDistanceFieldVoxel::negative_update_direction_);
+}
+
+void PropagationDistanceField::propagateBuckets(std::vector<EigenSTL::vector_Vector3i>& bucket_queue,
+                                                int PropDistanceFieldVoxel::*distance_square,
+                                                Eigen::Vector3i PropDistanceFieldVoxel::*closest_point,
+                                                int PropDistanceFieldVoxel::*update_direction)
+{
+  const unsigned int thread_count = propagation_thread_count_;
+  std::vector<std::vector<PropagationCandidate>> candidates(thread_count);
+  EigenSTL::vector_Vector3i source_points;
+  std::vector<int> source_directions;
+
   // now process the queue:
-  for (unsigned int i = 0; i < bucket_queue_.size(); ++i)
+  for (unsigned int i = 0; i < bucket_queue.size(); ++i)
   {
-    EigenSTL::vector_Vector3i::iterator list_it = bucket_queue_[i].begin();
-    EigenSTL::vector_Vector3i::iterator list_end = bucket_queue_[i].end();
-    for (; list_it != list_end; ++list_it)
-    {
-      const Eigen::Vector3i& loc = *list_it;
-      PropDistanceFieldVoxel* vptr = &voxel_grid_->getCell(loc.x(), loc.y(), loc.z());
+    // the end of the bucket is fixed before expanding it, so voxels re-queued at the current distance are dropped
+    const std::size_t bucket_size = bucket_queue[i].size();
+    const int d = std::min(i, 1u);
 
-      // select the neighborhood list based on the update direction:
-      EigenSTL::vector_Vector3i* neighborhood;
-      int d = i;
-      if (d > 1)
-        d = 1;
-
-      // This will never happen.  update_direction_ is always set before voxel is added to bucket queue.
-      if (vptr->update_direction_ < 0 || vptr->update_direction_ > 26)
+    if (thread_count < 2 || bucket_size < MIN_PARALLEL_BUCKET_SIZE)
+    {
+      for (std::size_t k = 0; k < bucket_size; ++k)
       {
-        RCLCPP_ERROR(LOGGER, "PROGRAMMING ERROR: Invalid update direction detected: %d", vptr->update_direction_);
-        continue;
+        const Eigen::Vector3i loc = bucket_queue[i][k];
+        expandVoxel(bucket_queue, loc, d, distance_square, closest_point, update_direction);
       }
+      bucket_queue[i].clear();
+      continue;
+    }
 
-      neighborhood = &neighborhoods_[d][vptr->update_direction_];
-
-      for (const Eigen::Vector3i& diff : *neighborhood)
+    // Gather the updates each voxel would make against the grid as it is before this bucket.  Distances only
+    // decrease while the bucket is applied, so a rejected candidate would also be rejected by a serial expansion.
+    source_points.resize(bucket_size);
+    source_directions.resize(bucket_size);
+    const EigenSTL::vector_Vector3i& bucket = bucket_queue[i];
+    const VoxelGrid<PropDistanceFieldVoxel>& grid = getConstVoxelGrid();
+    auto gather = [&](std::size_t t) {
+      std::vector<PropagationCandidate>& thread_candidates = candidates[t];
+      thread_candidates.clear();
+      const std::size_t end = bucket_size * (t + 1) / thread_count;
+      for (std::size_t k = bucket_size * t / thread_count; k < end; ++k)
       {
-        Eigen::Vector3i nloc(loc.x() + diff.x(), loc.y() + diff.y(), loc.z() + diff.z());
-        if (!isCellValid(nloc.x(), nloc.y(), nloc.z()))
+        const Eigen::Vector3i& loc = bucket[k];
+        const PropDistanceFieldVoxel& voxel = grid.getCell(loc.x(), loc.y(), loc.z());
+        const Eigen::Vector3i& source = source_points[k] = voxel.*closest_point;
+        const int direction = source_directions[k] = voxel.*update_direction;
+        if (direction < 0 || direction > 26)
           continue;
 
-        // the real update code:
-        // calculate the neighbor's new distance based on my closest filled voxel:
-        PropDistanceFieldVoxel* neighbor = &voxel_grid_->getCell(nloc.x(), nloc.y(), nloc.z());
-        int new_distance_sq = (vptr->closest_point_ - nloc).squaredNorm();
-        if (new_distance_sq > max_distance_sq_)
-          continue;
+        for (const Eigen::Vector3i& diff : neighborhoods_[d][direction])
+        {
+          Eigen::Vector3i nloc(loc.x() + diff.x(), loc.y() + diff.y(), loc.z() + diff.z());
+          if (!isCellValid(nloc.x(), nloc.y(), nloc.z()))
+            continue;
+
+          int new_distance_sq = (source - nloc).squaredNorm();
+          if (new_distance_sq > max_distance_sq_ ||
+              new_distance_sq >= grid.getCell(nloc.x(), nloc.y(), nloc.z()).*distance_square)
+            continue;
+          thread_candidates.push_back({ k, nloc, new_distance_sq, getDirectionNumber(diff.x(), diff.y(), diff.z()) });
+        }
+      }
+    };
 
-        if (new_distance_sq < neighbor->distance_square_)
+    propagation_workers_->run(thread_count, gather);
+
+    // Apply the candidates in bucket order.  A voxel whose closest point was changed by an earlier voxel of this
+    // bucket is expanded again from its current state, exactly as the serial expansion would see it.
+    for (unsigned int t = 0; t < thread_count; ++t)
+    {
+      std::vector<PropagationCandidate>::const_iterator candidate = candidates[t].begin();
+      const std::vector<PropagationCandidate>::const_iterator candidates_end = candidates[t].end();
+      const std::size_t end = bucket_size * (t + 1) / thread_count;
+      for (std::size_t k = bucket_size * t / thread_count; k < end; ++k)
+      {
+        const Eigen::Vector3i loc = bucket_queue[i][k];
+        const PropDistanceFieldVoxel& voxel = grid.getCell(loc.x(), loc.y(), loc.z());
+        std::vector<PropagationCandidate>::const_iterator entry_end = candidate;
+        while (entry_end != candidates_end && entry_end->entry == k)
+          ++entry_end;
+
+        if (voxel.*closest_point != source_points[k] || voxel.*update_direction != source_directions[k] ||
+            source_directions[k] < 0 || source_directions[k] > 26)
         {
-          // update the neighboring voxel
-          neighbor->distance_square_ = new_distance_sq;
-          neighbor->closest_point_ = vptr->closest_point_;
-          neighbor->update_direction_ = getDirectionNumber(diff.x(), diff.y(), diff.z());
+          expandVoxel(bucket_queue, loc, d, distance_square, closest_point, update_direction);
+          candidate = entry_end;
+          continue;
+        }
 
-          // and put it in the queue:
-          bucket_queue_[new_distance_sq].push_back(nloc);
+        for (; candidate != entry_end; ++candidate)
+        {
+          PropDistanceFieldVoxel& neighbor = voxel_grid_->getCell(candidate->location);
+          if (candidate->distance_square < neighbor.*distance_square)
+          {
+            neighbor.*distance_square = candidate->distance_square;
+            neighbor.*closest_point = source_points[k];
+            neighbor.*update_direction = candidate->update_direction;
+            bucket_queue[candidate->distance_square].push_back(candidate->location);
+          }
         }
       }
     }
-    bucket_queue_[i].clear();
+    bucket_queue[i].clear();
   }
 }
 
-void PropagationDistanceField::propagateNegative()
+void PropagationDistanceField::expandVoxel(std::vector<EigenSTL::vector_Vector3i>& bucket_queue,
+                                           const Eigen::Vector3i& loc, int d,
+                                           int PropDistanceFieldVoxel::*distance_square,
+                                           Eigen::Vector3i PropDistanceFieldVoxel::*closest_point,
+                                           int PropDistanceFieldVoxel::*update_direction)
 {
-  // now process the queue:
-  for (unsigned int i = 0; i < negative_bucket_queue_.size(); ++i)
-  {
-    EigenSTL::vector_Vector3i::iterator list_it = negative_bucket_queue_[i].begin();
-    EigenSTL::vector_Vector3i::iterator list_end = negative_bucket_queue_[i].end();
-    for (; list_it != list_end; ++list_it)
-    {
-      const Eigen::Vector3i& loc = *list_it;
-      PropDistanceFieldVoxel* vptr = &voxel_grid_->getCell(loc.x(), loc.y(), loc.z());
-
-      // select the neighborhood list based on the update direction:
-      EigenSTL::vector_Vector3i* neighborhood;
-      int d = i;
-      if (d > 1)
-        d = 1;
-
-      // This will never happen.  negative_update_direction_ is always set before voxel is added to
-      // negative_bucket_queue_.
-      if (vptr->negative_update_direction_ < 0 || vptr->negative_update_direction_ > 26)
-      {
-        RCLCPP_ERROR(LOGGER, "PROGRAMMING ERROR: Invalid update direction detected: %d", vptr->update_direction_);
-        continue;
-      }
-
-      neighborhood = &neighborhoods_[d][vptr->negative_update_direction_];
+  const VoxelGrid<PropDistanceFieldVoxel>& grid = getConstVoxelGrid();
+  const PropDistanceFieldVoxel& voxel = grid.getCell(loc.x(), loc.y(), loc.z());
 
-      for (const Eigen::Vector3i& diff : *neighborhood)
-      {
-        Eigen::Vector3i nloc(loc.x() + diff.x(), loc.y() + diff.y(), loc.z() + diff.z());
-        if (!isCellValid(nloc.x(), nloc.y(), nloc.z()))
-          continue;
+  // This will never happen.  The update direction is always set before voxel is added to the bucket queue.
+  const int direction = voxel.*update_direction;
+  if (direction < 0 || direction > 26)
+  {
+    RCLCPP_ERROR(LOGGER, "PROGRAMMING ERROR: Invalid update direction detected: %d", direction);
+    return;
+  }
 
-        // the real update code:
-        // calculate the neighbor's new distance based on my closest filled voxel:
-        PropDistanceFieldVoxel* neighbor = &voxel_grid_->getCell(nloc.x(), nloc.y(), nloc.z());
-        int new_distance_sq = (vptr->closest_negative_point_ - nloc).squaredNorm();
-        if (new_distance_sq > max_distance_sq_)
-          continue;
-        // std::cout << "Looking at " << nloc.x() << " " << nloc.y() << " " << nloc.z() << " " << new_distance_sq << " "
-        // << neighbor->negative_distance_square_ << std::endl;
-        if (new_distance_sq < neighbor->negative_distance_square_)
-        {
-          // std::cout << "Updating " << nloc.x() << " " << nloc.y() << " " << nloc.z() << " " << new_distance_sq <<
-          // std::endl;
-          // update the neighboring voxel
-          neighbor->negative_distance_square_ = new_distance_sq;
-          neighbor->closest_negative_point_ = vptr->closest_negative_point_;
-          neighbor->negative_update_direction_ = getDirectionNumber(diff.x(), diff.y(), diff.z());
-
-          // and put it in the queue:
-          negative_bucket_queue_[new_distance_sq].push_back(nloc);
-        }
-      }
+  // select the neighborhood list based on the update direction:
+  const Eigen::Vector3i source = voxel.*closest_point;
+  for (const Eigen::Vector3i& diff : neighborhoods_[d][direction])
+  {
+    Eigen::Vector3i nloc(loc.x() + diff.x(), loc.y() + diff.y(), loc.z() + diff.z());
+    if (!isCellValid(nloc.x(), nloc.y(), nloc.z()))
+      continue;
+
+    // the real update code:
+    // calculate the neighbor's new distance based on my closest filled voxel:
+    int new_distance_sq = (source - nloc).squaredNorm();
+    if (new_distance_sq > max_distance_sq_)
+      continue;
+
+    // only fetch the neighbor for writing once it improves, so blocked grids stay sparse
+    if (new_distance_sq < grid.getCell(nloc.x(), nloc.y(), nloc.z()).*distance_square)
+    {
+      // update the neighboring voxel
+      PropDistanceFieldVoxel& neighbor = voxel_grid_->getCell(nloc.x(), nloc.y(), nloc.z());
+      neighbor.*distance_square = new_distance_sq;
+      neighbor.*closest_point = source;
+      neighbor.*update_direction = getDirectionNumber(diff.x(), diff.y(), diff.z());
+
+      // and put it in the queue:
+      bucket_queue[new_distance_sq].push_back(nloc);
     }
-    negative_bucket_queue_[i].clear();
   }
 }
 
 void PropagationDistanceField::reset()
 {
+  // Spelling out every voxel's own location would allocate every block of a blocked grid, so its untouched voxels
+  // share the SELF sentinel instead.  getResolvedCell() resolves it and the negative propagation treats it like the voxel
+  // itself, just as any other invalid closest negative point.
+  if (blocked_storage_)
+  {
+    PropDistanceFieldVoxel initial(max_distance_sq_, 0);
+    initial.closest_negative_point_.setConstant(PropDistanceFieldVoxel::SELF);
+    voxel_grid_->reset(initial);
+    return;
+  }
+
   voxel_grid_->reset(PropDistanceFieldVoxel(max_distance_sq_, 0));
   for (int x = 0; x < getXNumCells(); x++)
   {
@@ -590,7 +695,7 @@ double PropagationDistanceField::getDistance(double x, double y, double z) const
 
 double PropagationDistanceField::getDistance(int x, int y, int z) const
 {
-  return getDistance(voxel_grid_->getCell(x, y, z));
+  return getDistance(getCell(x, y, z));
 }
 
 bool PropagationDistanceField::isCellValid(int x, int y, int z) const
@@ -0,0 +1,110 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/distance_field/propagation_distance_field.h>
+#include <geometric_shapes/shapes.h>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+namespace po = boost::program_options;
+
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_distance_field.benchmark_propagation");
+
+namespace
+{
+/** Add and move a table and scattered points in a field and report the time of the propagation */
+void benchmark(unsigned int thread_count, bool blocked_storage, unsigned int repetitions,
+               const EigenSTL::vector_Vector3d& points)
+{
+  distance_field::PropagationDistanceField df(3.0, 3.0, 4.0, 0.02, 0.0, 0.0, 0.0, 0.25, true, thread_count,
+                                              blocked_storage);
+  shapes::Box table(2.0, 2.0, 0.5);
+  const Eigen::Isometry3d pose(Eigen::Translation3d(1.5, 2.0, 1.5));
+  const Eigen::Isometry3d moved_pose(Eigen::Translation3d(1.51, 2.0, 1.5));
+
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < repetitions; ++i)
+  {
+    df.addShapeToField(&table, pose);
+    df.addPointsToField(points);
+    df.moveShapeInField(&table, pose, moved_pose);
+    df.removePointsFromField(points);
+    df.removeShapeFromField(&table, moved_pose);
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  RCLCPP_INFO(LOGGER, "%u threads, %s storage: %g s per update cycle", df.getPropagationThreadCount(),
+              blocked_storage ? "blocked" : "dense", elapsed.count() / repetitions);
+}
+}  // namespace
+
+/** Benchmark of the propagation of PropagationDistanceField with a single and with multiple threads */
+int main(int argc, char* argv[])
+{
+  unsigned int threads;
+  unsigned int repetitions;
+  unsigned int num_points;
+  po::options_description desc("Options");
+  // clang-format off
+  desc.add_options()
+      ("help", "show help message")
+      ("threads", po::value<unsigned int>(&threads)->default_value(0), "propagation threads, 0 for all cores")
+      ("repetitions", po::value<unsigned int>(&repetitions)->default_value(5), "update cycles per configuration")
+      ("points", po::value<unsigned int>(&num_points)->default_value(5000), "number of scattered points");
+  // clang-format on
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help") != 0u)
+  {
+    std::cout << desc << "\n";
+    return 1;
+  }
+
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  EigenSTL::vector_Vector3d points;
+  for (unsigned int i = 0; i < num_points; ++i)
+    points.push_back(Eigen::Vector3d(unit(gen) * 3.0, unit(gen) * 3.0, unit(gen) * 4.0));
+
+  for (bool blocked_storage : { false, true })
+  {
+    benchmark(1, blocked_storage, repetitions, points);
+    benchmark(threads, blocked_storage, repetitions, points);
+  }
+  return 0;
+}
@@ -43,6 +43,8 @@
 #include <tf2_eigen/tf2_eigen.h>
 #include <octomap/octomap.h>
 #include <memory>
+#include <random>
+#include <sstream>
 
 using namespace distance_field;
 
@@ -829,6 +831,140 @@ TEST(TestSignedPropagationDistanceField, TestPerformance)
          wd.count() / (bad_vec.size() * 1.0));
 }
 
+static const unsigned int PERF_THREAD_COUNT = 4;
+
+TEST(TestSignedPropagationDistanceField, TestParallelPropagation)
+{
+  PropagationDistanceField serial_df(PERF_WIDTH, PERF_HEIGHT, PERF_DEPTH, PERF_RESOLUTION, PERF_ORIGIN_X,
+                                     PERF_ORIGIN_Y, PERF_ORIGIN_Z, PERF_MAX_DIST, true);
+  PropagationDistanceField parallel_df(PERF_WIDTH, PERF_HEIGHT, PERF_DEPTH, PERF_RESOLUTION, PERF_ORIGIN_X,
+                                       PERF_ORIGIN_Y, PERF_ORIGIN_Z, PERF_MAX_DIST, true, PERF_THREAD_COUNT);
+  EXPECT_EQ(serial_df.getPropagationThreadCount(), 1u);
+  EXPECT_EQ(parallel_df.getPropagationThreadCount(), PERF_THREAD_COUNT);
+
+  shapes::Box big_table(2.0, 2.0, .5);
+  Eigen::Isometry3d p = Eigen::Translation3d(PERF_WIDTH / 2.0, PERF_DEPTH / 2.0, PERF_HEIGHT / 2.0) *
+                        Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+  Eigen::Isometry3d np = Eigen::Translation3d(PERF_WIDTH / 2.0 + .01, PERF_DEPTH / 2.0, PERF_HEIGHT / 2.0) *
+                         Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+
+  // scattered points exercise buckets with many competing sources
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  EigenSTL::vector_Vector3d scattered_points;
+  for (unsigned int i = 0; i < 5000; ++i)
+    scattered_points.push_back(
+        Eigen::Vector3d(unit(gen) * PERF_WIDTH, unit(gen) * PERF_HEIGHT, unit(gen) * PERF_DEPTH));
+
+  auto run = [&](PropagationDistanceField& df) {
+    df.addShapeToField(&big_table, p);
+    df.addPointsToField(scattered_points);
+    df.moveShapeInField(&big_table, p, np);
+    df.removePointsFromField(scattered_points);
+  };
+  run(serial_df);
+  run(parallel_df);
+
+  ASSERT_TRUE(areDistanceFieldsDistancesEqual(serial_df, parallel_df));
+  for (int z = 0; z < serial_df.getZNumCells(); ++z)
+  {
+    for (int x = 0; x < serial_df.getXNumCells(); ++x)
+    {
+      for (int y = 0; y < serial_df.getYNumCells(); ++y)
+      {
+        const PropDistanceFieldVoxel& serial_cell = serial_df.getCell(x, y, z);
+        const PropDistanceFieldVoxel& parallel_cell = parallel_df.getCell(x, y, z);
+        ASSERT_EQ(serial_cell.closest_point_, parallel_cell.closest_point_);
+        ASSERT_EQ(serial_cell.closest_negative_point_, parallel_cell.closest_negative_point_);
+        ASSERT_EQ(serial_cell.update_direction_, parallel_cell.update_direction_);
+        ASSERT_EQ(serial_cell.negative_update_direction_, parallel_cell.negative_update_direction_);
+      }
+    }
+  }
+}
+
+TEST(TestSignedPropagationDistanceField, TestBlockedStorage)
+{
+  PropagationDistanceField dense_df(PERF_WIDTH, PERF_HEIGHT, PERF_DEPTH, PERF_RESOLUTION, PERF_ORIGIN_X, PERF_ORIGIN_Y,
+                                    PERF_ORIGIN_Z, PERF_MAX_DIST, true);
+  PropagationDistanceField blocked_df(PERF_WIDTH, PERF_HEIGHT, PERF_DEPTH, PERF_RESOLUTION, PERF_ORIGIN_X,
+                                      PERF_ORIGIN_Y, PERF_ORIGIN_Z, PERF_MAX_DIST, true, PERF_THREAD_COUNT, true);
+
+  shapes::Box small_table(.25, .25, .05);
+  Eigen::Isometry3d p = Eigen::Translation3d(PERF_WIDTH / 2.0, PERF_DEPTH / 2.0, PERF_HEIGHT / 2.0) *
+                        Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+  Eigen::Isometry3d np = Eigen::Translation3d(PERF_WIDTH / 2.0 + .1, PERF_DEPTH / 2.0, PERF_HEIGHT / 2.0) *
+                         Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+
+  for (PropagationDistanceField* df : { &dense_df, &blocked_df })
+  {
+    df->addShapeToField(&small_table, p);
+    df->moveShapeInField(&small_table, p, np);
+  }
+  EXPECT_TRUE(areDistanceFieldsDistancesEqual(dense_df, blocked_df));
+
+  std::stringstream dense_stream, blocked_stream;
+  dense_df.writeToStream(dense_stream);
+  blocked_df.writeToStream(blocked_stream);
+  EXPECT_EQ(dense_stream.str(), blocked_stream.str());
+
+  // resetting the blocked field leaves it as empty as a fresh dense one
+  PropagationDistanceField empty_df(PERF_WIDTH, PERF_HEIGHT, PERF_DEPTH, PERF_RESOLUTION, PERF_ORIGIN_X, PERF_ORIGIN_Y,
+                                    PERF_ORIGIN_Z, PERF_MAX_DIST, true);
+  blocked_df.reset();
+  EXPECT_TRUE(areDistanceFieldsDistancesEqual(empty_df, blocked_df));
+}
+
+TEST(TestSignedPropagationDistanceField, TestBlockedStorageCells)
+{
+  PropagationDistanceField dense_df(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, MAX_DIST, true);
+  PropagationDistanceField blocked_df(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, MAX_DIST, true, 1,
+                                      true);
+
+  auto expect_equal_cells = [&](const std::string& stage) {
+    for (int z = 0; z < dense_df.getZNumCells(); ++z)
+    {
+      for (int x = 0; x < dense_df.getXNumCells(); ++x)
+      {
+        for (int y = 0; y < dense_df.getYNumCells(); ++y)
+        {
+          const PropDistanceFieldVoxel dense_cell = dense_df.getResolvedCell(x, y, z);
+          const PropDistanceFieldVoxel blocked_cell = blocked_df.getResolvedCell(x, y, z);
+          ASSERT_EQ(dense_cell.distance_square_, blocked_cell.distance_square_) << stage;
+          ASSERT_EQ(dense_cell.negative_distance_square_, blocked_cell.negative_distance_square_) << stage;
+          ASSERT_EQ(dense_cell.closest_point_, blocked_cell.closest_point_) << stage;
+          ASSERT_EQ(dense_cell.closest_negative_point_, blocked_cell.closest_negative_point_) << stage;
+        }
+      }
+    }
+  };
+
+  expect_equal_cells("constructed");
+
+  // a solid cube, so that its inner voxels get negative distances
+  EigenSTL::vector_Vector3d cube_points;
+  for (double x = 0.2; x < 0.55; x += RESOLUTION)
+    for (double y = 0.2; y < 0.55; y += RESOLUTION)
+      for (double z = 0.2; z < 0.55; z += RESOLUTION)
+        cube_points.push_back(Eigen::Vector3d(x, y, z));
+  EigenSTL::vector_Vector3d corner_points(cube_points.begin(), cube_points.begin() + 8);
+
+  for (PropagationDistanceField* df : { &dense_df, &blocked_df })
+  {
+    df->addPointsToField(cube_points);
+    df->removePointsFromField(corner_points);
+  }
+  expect_equal_cells("propagated");
+
+  dense_df.reset();
+  blocked_df.reset();
+  expect_equal_cells("reset");
+
+  for (PropagationDistanceField* df : { &dense_df, &blocked_df })
+    df->addPointsToField(cube_points);
+  expect_equal_cells("propagated after reset");
+}
+
 TEST(TestSignedPropagationDistanceField, TestOcTree)
 {
   PropagationDistanceField df(PERF_WIDTH, PERF_HEIGHT, PERF_DEPTH, PERF_RESOLUTION, PERF_ORIGIN_X, PERF_ORIGIN_Y,
@@ -95,6 +95,57 @@ TEST(TestVoxelGrid, TestReadWrite)
       }
 }
 
+TEST(TestVoxelGrid, TestBlockedReadWrite)
+{
+  int def = -100;
+  VoxelGrid<int> vg(0.2, 0.2, 0.1, 0.01, 0, 0, 0, def, true);
+  const VoxelGrid<int>& const_vg = vg;
+  ASSERT_TRUE(vg.isBlocked());
+
+  int num_x = vg.getNumCells(DIM_X);
+  int num_y = vg.getNumCells(DIM_Y);
+  int num_z = vg.getNumCells(DIM_Z);
+  EXPECT_EQ(num_x, 20);
+  EXPECT_EQ(num_y, 20);
+  EXPECT_EQ(num_z, 10);
+
+  // untouched cells read as the reset value without allocating storage
+  vg.reset(5);
+  for (int x = 0; x < num_x; x++)
+    for (int y = 0; y < num_y; y++)
+      for (int z = 0; z < num_z; z++)
+        EXPECT_EQ(const_vg.getCell(x, y, z), 5);
+  EXPECT_EQ(vg.getAllocatedBlockCount(), 0u);
+  EXPECT_EQ(const_vg(100.0, 0.0, 0.0), def);
+
+  // writes only allocate the blocks they touch, including partial blocks at the border
+  vg.setCell(0, 0, 0, 1);
+  vg.getCell(num_x - 1, num_y - 1, num_z - 1) = 2;
+  vg.setCell(Eigen::Vector3i(VoxelGrid<int>::BLOCK_SIZE, 0, 0), 3);
+  EXPECT_EQ(vg.getAllocatedBlockCount(), 3u);
+  EXPECT_EQ(const_vg.getCell(0, 0, 0), 1);
+  EXPECT_EQ(const_vg.getCell(num_x - 1, num_y - 1, num_z - 1), 2);
+  EXPECT_EQ(const_vg.getCell(VoxelGrid<int>::BLOCK_SIZE, 0, 0), 3);
+  EXPECT_EQ(const_vg.getCell(1, 0, 0), 5);
+  EXPECT_EQ(const_vg.getCell(num_x - 2, num_y - 1, num_z - 1), 5);
+
+  int i = 0;
+  for (int x = 0; x < num_x; x++)
+    for (int y = 0; y < num_y; y++)
+      for (int z = 0; z < num_z; z++)
+        vg.getCell(x, y, z) = i++;
+
+  i = 0;
+  for (int x = 0; x < num_x; x++)
+    for (int y = 0; y < num_y; y++)
+      for (int z = 0; z < num_z; z++)
+        EXPECT_EQ(const_vg.getCell(x, y, z), i++);
+
+  vg.reset(0);
+  EXPECT_EQ(vg.getAllocatedBlockCount(), 0u);
+  EXPECT_EQ(const_vg.getCell(num_x - 1, 0, 0), 0);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
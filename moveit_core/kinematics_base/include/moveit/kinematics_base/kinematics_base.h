@@ -41,6 +41,7 @@
 #include <moveit/macros/class_forward.h>
 #include "rclcpp/rclcpp.hpp"
 #include <boost/function.hpp>
+#include <functional>
 #include <string>
 
 #include "moveit_kinematics_base_export.h"
@@ -321,6 +322,32 @@ public:
     return false;
   }
 
+  /**
+   * @brief Given a batch of desired poses of the end-effector, search for the joint angles required to reach each of
+   * them. Every pose is an independent query that is solved like searchPositionIK() would solve it.
+   *
+   * The default implementation solves the queries one after another. Solvers that can answer queries concurrently
+   * override it to spread the queries over several threads and to reuse their internal solver objects across the
+   * queries of a thread.
+   * @param ik_poses the desired poses of the link, one per query
+   * @param ik_seed_states initial guesses for the inverse kinematics: either a single seed shared by all queries, or
+   * one seed per query
+   * @param timeout The amount of time (in seconds) available to the solver for each query
+   * @param solutions the solution vectors, one per query. A solution is only valid if its error code is SUCCESS.
+   * @param error_codes the error codes that encode the reason for failure or success, one per query
+   * @param options container for other IK options. See definition of KinematicsQueryOptions for details.
+   * @param num_threads the maximum number of threads used by solvers that support concurrent queries (0 uses one
+   * thread per CPU core)
+   * @return True if a valid solution was found for every query, false otherwise
+   */
+  virtual bool
+  searchPositionIKBatch(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                        const std::vector<std::vector<double> >& ik_seed_states, double timeout,
+                        std::vector<std::vector<double> >& solutions,
+                        std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+                        const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions(),
+                        unsigned int num_threads = 1) const;
+
   /**
    * @brief Given a set of joint angles and a set of links, compute their pose
    * @param link_names A set of links for which FK needs to be computed
@@ -590,6 +617,23 @@ protected:
     return false;
   }
 
+  /**
+   * @brief Check the seeds of a searchPositionIKBatch() query and size its outputs.
+   * @return True if there is a single seed or one seed per pose, false otherwise
+   */
+  bool initBatchQuery(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                      const std::vector<std::vector<double> >& ik_seed_states,
+                      std::vector<std::vector<double> >& solutions,
+                      std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes) const;
+
+  /**
+   * @brief Solve the queries 0 .. num_queries - 1 of a batch on up to num_threads threads of the shared
+   * moveit::core::WorkerPool (0 uses one thread per CPU core). Each thread calls make_worker once, so that it can set
+   * up its solver objects, and passes its queries to the returned function.
+   */
+  static void forEachBatchQuery(std::size_t num_queries, unsigned int num_threads,
+                                const std::function<std::function<void(std::size_t)>()>& make_worker);
+
   /** Store some core variables passed via initialize().
    *
    * @param robot_model RobotModel, this kinematics solver should act on.
@@ -36,6 +36,10 @@
 
 #include <moveit/kinematics_base/kinematics_base.h>
 #include <moveit/robot_model/joint_model_group.h>
+#include <moveit/utils/worker_pool.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 namespace kinematics
 {
@@ -193,4 +197,67 @@ bool KinematicsBase::getPositionIK(const std::vector<geometry_msgs::msg::Pose>&
 
   return true;
 }
+
+bool KinematicsBase::searchPositionIKBatch(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                           const std::vector<std::vector<double> >& ik_seed_states, double timeout,
+                                           std::vector<std::vector<double> >& solutions,
+                                           std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+                                           const KinematicsQueryOptions& options, unsigned int /*num_threads*/) const
+{
+  if (!initBatchQuery(ik_poses, ik_seed_states, solutions, error_codes))
+    return false;
+
+  // solvers are not required to support concurrent queries, so solve them on the calling thread
+  bool solved_all = true;
+  for (std::size_t i = 0; i < ik_poses.size(); ++i)
+    solved_all &= searchPositionIK(ik_poses[i], ik_seed_states.size() == 1 ? ik_seed_states[0] : ik_seed_states[i],
+                                   timeout, solutions[i], error_codes[i], options);
+  return solved_all;
+}
+
+bool KinematicsBase::initBatchQuery(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                    const std::vector<std::vector<double> >& ik_seed_states,
+                                    std::vector<std::vector<double> >& solutions,
+                                    std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes) const
+{
+  solutions.resize(ik_poses.size());
+  error_codes.resize(ik_poses.size());
+  if (ik_seed_states.size() != 1 && ik_seed_states.size() != ik_poses.size())
+  {
+    RCLCPP_ERROR(LOGGER, "Expected a single seed state or one per pose for %lu poses, but got %lu seed states",
+                 ik_poses.size(), ik_seed_states.size());
+    for (auto& error_code : error_codes)
+      error_code.val = moveit_msgs::msg::MoveItErrorCodes::INVALID_ROBOT_STATE;
+    return false;
+  }
+  return true;
+}
+
+void KinematicsBase::forEachBatchQuery(std::size_t num_queries, unsigned int num_threads,
+                                       const std::function<std::function<void(std::size_t)>()>& make_worker)
+{
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  num_threads = std::min<std::size_t>(num_threads, num_queries);
+
+  // queries may take very different times to solve, so threads take the next query as soon as they are done
+  std::atomic<std::size_t> next_query(0);
+  auto run = [&] {
+    std::function<void(std::size_t)> worker = make_worker();
+    for (std::size_t i = next_query++; i < num_queries; i = next_query++)
+      worker(i);
+  };
+  if (num_threads <= 1)
+  {
+    if (num_queries > 0)
+      run();
+    return;
+  }
+
+  moveit::core::WorkerPool::getShared().run(num_threads, [&](std::size_t /*index*/) {
+    // skip setting up a worker if the others already took all queries, e.g. when the pool runs this section serially
+    if (next_query < num_queries)
+      run();
+  });
+}
 }  // end of namespace kinematics
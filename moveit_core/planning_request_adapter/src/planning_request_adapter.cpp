@@ -35,8 +35,10 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/profiler/tracer.h>
 #include <boost/bind.hpp>
 #include <algorithm>
+#include <optional>
 #include "rclcpp/rclcpp.hpp"
 
 // we could really use some c++11 lambda functions here :)
@@ -52,9 +54,16 @@ bool callPlannerInterfaceSolve(const planning_interface::PlannerManager* planner
                                const planning_interface::MotionPlanRequest& req,
                                planning_interface::MotionPlanResponse& res)
 {
-  planning_interface::PlanningContextPtr context = planner->getPlanningContext(planning_scene, req, res.error_code_);
+  planning_interface::PlanningContextPtr context;
+  {
+    MOVEIT_TRACE_SCOPE("PlannerManager::getPlanningContext");
+    context = planner->getPlanningContext(planning_scene, req, res.error_code_);
+  }
   if (context)
+  {
+    MOVEIT_TRACE_SCOPE("PlanningContext::solve");
     return context->solve(res);
+  }
   else
     return false;
 }
@@ -88,6 +97,10 @@ bool callAdapter1(const PlanningRequestAdapter* adapter, const planning_interfac
                   const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
                   std::vector<std::size_t>& added_path_index)
 {
+  // only build the span name while tracing is enabled
+  std::optional<moveit::tools::Tracer::ScopedSpan> span;
+  if (moveit::tools::Tracer::isEnabled())
+    span.emplace("PlanningRequestAdapter: " + adapter->getDescription());
   try
   {
     return adapter->adaptAndPlan(planner, planning_scene, req, res, added_path_index);
@@ -106,6 +119,9 @@ bool callAdapter2(const PlanningRequestAdapter* adapter, const PlanningRequestAd
                   const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
                   std::vector<std::size_t>& added_path_index)
 {
+  std::optional<moveit::tools::Tracer::ScopedSpan> span;
+  if (moveit::tools::Tracer::isEnabled())
+    span.emplace("PlanningRequestAdapter: " + adapter->getDescription());
   try
   {
     return adapter->adaptAndPlan(planner, planning_scene, req, res, added_path_index);
@@ -46,6 +46,7 @@
 #include <moveit/kinematics_base/kinematics_base.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
 #include <moveit/macros/class_forward.h>
+#include <moveit/utils/worker_pool.h>
 #include <moveit_msgs/msg/planning_scene.hpp>
 #include <moveit_msgs/msg/robot_trajectory.hpp>
 #include <moveit_msgs/msg/constraints.hpp>
@@ -823,6 +824,24 @@ public:
   bool isStateValid(const moveit::core::RobotState& state, const kinematic_constraints::KinematicConstraintSet& constr,
                     const std::string& group = "", bool verbose = false) const;
 
+  /** \brief Set the number of threads used to check the waypoints of a path in isPathValid().
+   *
+   *  With more than one thread, waypoints are distributed across worker threads, each checking them with its own
+   *  RobotState. Results, including the reported invalid indices, are the same as for sequential checking, but the
+   *  state feasibility predicate is then called concurrently and must be thread-safe. A value of 0 selects the number
+   *  of hardware threads. The default is 1, i.e. sequential checking.
+   *
+   *  The worker threads are started here and reused by every call to isPathValid(); diff scenes share them with
+   *  their parent. While the workers are busy with the path of another call, a path is checked on the calling
+   *  thread only. */
+  void setPathValidationThreadCount(unsigned int thread_count);
+
+  /** \brief Get the number of threads used to check the waypoints of a path in isPathValid() */
+  unsigned int getPathValidationThreadCount() const
+  {
+    return path_validation_thread_count_;
+  }
+
   /** \brief Check if a given path is valid. Each state is checked for validity (collision avoidance and feasibility) */
   bool isPathValid(const moveit_msgs::msg::RobotState& start_state, const moveit_msgs::msg::RobotTrajectory& trajectory,
                    const std::string& group = "", bool verbose = false,
@@ -957,6 +976,18 @@ private:
 
   MOVEIT_STRUCT_FORWARD(CollisionDetector);
 
+  /* Check a single waypoint of a path for collisions, feasibility and the path constraints */
+  bool isPathWayPointValid(const moveit::core::RobotState& state,
+                           const kinematic_constraints::KinematicConstraintSet& path_constraints,
+                           const std::string& group, bool verbose) const;
+
+  /* Check all waypoints of a path on multiple threads, marking invalid ones in valid. If stop_at_invalid is set,
+   * checking is cancelled as soon as an invalid waypoint is found. */
+  void checkPathWayPointsParallel(const robot_trajectory::RobotTrajectory& trajectory,
+                                  const kinematic_constraints::KinematicConstraintSet& path_constraints,
+                                  const std::string& group, bool verbose, bool stop_at_invalid,
+                                  std::vector<char>& valid) const;
+
   /* Construct a new CollisionDector from allocator, copy-construct environments from parent_detector if not null */
   void allocateCollisionDetector(const collision_detection::CollisionDetectorAllocatorPtr& allocator,
                                  const CollisionDetectorPtr& parent_detector);
@@ -1011,6 +1042,9 @@ private:
   StateFeasibilityFn state_feasibility_;
   MotionFeasibilityFn motion_feasibility_;
 
+  unsigned int path_validation_thread_count_ = 1;
+  std::shared_ptr<moveit::core::WorkerPool> path_validation_workers_;  // NULL if the count is 1
+
   std::unique_ptr<ObjectColorMap> object_colors_;
 
   // a map of object types
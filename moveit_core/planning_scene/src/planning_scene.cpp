@@ -44,10 +44,13 @@
 #include <moveit/exceptions/exceptions.h>
 #include <moveit/robot_state/attached_body.h>
 #include <moveit/utils/message_checks.h>
+#include <moveit/profiler/tracer.h>
 #include <octomap_msgs/conversions.h>
 #include <tf2_eigen/tf2_eigen.h>
+#include <atomic>
 #include <memory>
 #include <set>
+#include <thread>
 
 namespace planning_scene
 {
@@ -195,6 +198,9 @@ PlanningScene::PlanningScene(const PlanningSceneConstPtr& parent) : parent_(pare
 
   allocateCollisionDetector(parent_->collision_detector_->alloc_, parent_->collision_detector_);
   collision_detector_->copyPadding(*parent_->collision_detector_);
+
+  path_validation_thread_count_ = parent_->path_validation_thread_count_;
+  path_validation_workers_ = parent_->path_validation_workers_;
 }
 
 PlanningScenePtr PlanningScene::clone(const PlanningSceneConstPtr& scene)
@@ -375,6 +381,7 @@ void PlanningScene::checkCollision(const collision_detection::CollisionRequest&
                                    collision_detection::CollisionResult& res,
                                    const moveit::core::RobotState& robot_state) const
 {
+  MOVEIT_TRACE_SCOPE("PlanningScene::checkCollision");
   // check collision with the world using the padded version
   getCollisionEnv()->checkRobotCollision(req, res, robot_state, getAllowedCollisionMatrix());
 
@@ -399,6 +406,7 @@ void PlanningScene::checkCollision(const collision_detection::CollisionRequest&
                                    const moveit::core::RobotState& robot_state,
                                    const collision_detection::AllowedCollisionMatrix& acm) const
 {
+  MOVEIT_TRACE_SCOPE("PlanningScene::checkCollision");
   // check collision with the world using the padded version
   getCollisionEnv()->checkRobotCollision(req, res, robot_state, acm);
 
@@ -421,6 +429,7 @@ void PlanningScene::checkCollisionUnpadded(const collision_detection::CollisionR
                                            const moveit::core::RobotState& robot_state,
                                            const collision_detection::AllowedCollisionMatrix& acm) const
 {
+  MOVEIT_TRACE_SCOPE("PlanningScene::checkCollisionUnpadded");
   // check collision with the world using the unpadded version
   getCollisionEnvUnpadded()->checkRobotCollision(req, res, robot_state, acm);
 
@@ -2060,18 +2069,17 @@ bool PlanningScene::isPathValid(const robot_trajectory::RobotTrajectory& traject
   kinematic_constraints::KinematicConstraintSet ks_p(getRobotModel());
   ks_p.add(path_constraints, getTransforms());
   std::size_t n_wp = trajectory.getWayPointCount();
+
+  // with multiple threads, all waypoints are checked upfront and the results are collected below in order
+  std::vector<char> valid;
+  if (path_validation_thread_count_ > 1 && n_wp > 1)
+    checkPathWayPointsParallel(trajectory, ks_p, group, verbose, invalid_index == nullptr, valid);
+
   for (std::size_t i = 0; i < n_wp; ++i)
   {
     const moveit::core::RobotState& st = trajectory.getWayPoint(i);
 
-    bool this_state_valid = true;
-    if (isStateColliding(st, group, verbose))
-      this_state_valid = false;
-    if (!isStateFeasible(st, verbose))
-      this_state_valid = false;
-    if (!ks_p.empty() && !ks_p.decide(st, verbose).satisfied)
-      this_state_valid = false;
-
+    bool this_state_valid = valid.empty() ? isPathWayPointValid(st, ks_p, group, verbose) : valid[i];
     if (!this_state_valid)
     {
       if (invalid_index)
@@ -2106,6 +2114,70 @@ bool PlanningScene::isPathValid(const robot_trajectory::RobotTrajectory& traject
   return result;
 }
 
+void PlanningScene::setPathValidationThreadCount(unsigned int thread_count)
+{
+  path_validation_thread_count_ = thread_count > 0 ? thread_count : std::max(1u, std::thread::hardware_concurrency());
+  // the calling thread checks waypoints as well
+  if (path_validation_thread_count_ > 1)
+    path_validation_workers_ = std::make_shared<moveit::core::WorkerPool>(path_validation_thread_count_ - 1);
+  else
+    path_validation_workers_.reset();
+}
+
+bool PlanningScene::isPathWayPointValid(const moveit::core::RobotState& state,
+                                        const kinematic_constraints::KinematicConstraintSet& path_constraints,
+                                        const std::string& group, bool verbose) const
+{
+  bool valid = true;
+  if (isStateColliding(state, group, verbose))
+    valid = false;
+  if (!isStateFeasible(state, verbose))
+    valid = false;
+  if (!path_constraints.empty() && !path_constraints.decide(state, verbose).satisfied)
+    valid = false;
+  return valid;
+}
+
+void PlanningScene::checkPathWayPointsParallel(const robot_trajectory::RobotTrajectory& trajectory,
+                                               const kinematic_constraints::KinematicConstraintSet& path_constraints,
+                                               const std::string& group, bool verbose, bool stop_at_invalid,
+                                               std::vector<char>& valid) const
+{
+  const std::size_t n_wp = trajectory.getWayPointCount();
+  valid.assign(n_wp, true);
+
+  std::atomic<std::size_t> next_index(0);
+  std::atomic<bool> cancelled(false);
+  auto worker = [&]() {
+    // waypoints without up-to-date transforms are checked on a copy, as they are shared with the other threads
+    std::unique_ptr<moveit::core::RobotState> copy;
+    for (std::size_t i = next_index++; i < n_wp && !cancelled; i = next_index++)
+    {
+      const moveit::core::RobotState* st = &trajectory.getWayPoint(i);
+      if (st->dirtyCollisionBodyTransforms())
+      {
+        if (!copy)
+          copy = std::make_unique<moveit::core::RobotState>(*st);
+        else
+          copy->assignFrom(*st);
+        copy->updateCollisionBodyTransforms();
+        st = copy.get();
+      }
+
+      if (!isPathWayPointValid(*st, path_constraints, group, verbose))
+      {
+        valid[i] = false;
+        if (stop_at_invalid)
+          cancelled = true;
+      }
+    }
+  };
+
+  // every participating thread takes waypoints until none are left
+  path_validation_workers_->run(std::min<std::size_t>(path_validation_thread_count_, n_wp),
+                                [&worker](std::size_t /*thread*/) { worker(); });
+}
+
 bool PlanningScene::isPathValid(const robot_trajectory::RobotTrajectory& trajectory,
                                 const moveit_msgs::msg::Constraints& path_constraints,
                                 const moveit_msgs::msg::Constraints& goal_constraints, const std::string& group,
@@ -40,6 +40,8 @@
 #include <moveit/utils/message_checks.h>
 #include <moveit/utils/robot_model_test_utils.h>
 #include <urdf_parser/urdf_parser.h>
+#include <geometric_shapes/shapes.h>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -212,6 +214,48 @@ TEST(PlanningScene, loadBadSceneGeometry)
   EXPECT_FALSE(ps->loadGeometryFromStream(malformed_scene_geometry));
 }
 
+TEST(PlanningScene, isPathValidParallel)
+{
+  moveit::core::RobotModelPtr robot_model = moveit::core::loadTestingRobotModel("pr2");
+  auto ps = std::make_shared<planning_scene::PlanningScene>(robot_model->getURDF(), robot_model->getSRDF());
+  const moveit::core::JointModelGroup* group = robot_model->getJointModelGroup("right_arm");
+
+  // random waypoints; every tenth one collides with a box placed at its wrist
+  robot_trajectory::RobotTrajectory trajectory(robot_model, group);
+  moveit::core::RobotState state = ps->getCurrentState();
+  random_numbers::RandomNumberGenerator rng(42);
+  shapes::ShapeConstPtr box = std::make_shared<const shapes::Box>(0.15, 0.15, 0.15);
+  std::vector<std::size_t> colliding;
+  for (std::size_t i = 0; i < 200; ++i)
+  {
+    state.setToRandomPositions(group, rng);
+    state.update();
+    trajectory.addSuffixWayPoint(state, 0.1);
+    if (i % 10 == 3)
+    {
+      ps->getWorldNonConst()->addToObject("box_" + std::to_string(i), box,
+                                          state.getGlobalLinkTransform("r_wrist_roll_link"));
+      colliding.push_back(i);
+    }
+  }
+
+  std::vector<std::size_t> sequential_invalid, parallel_invalid;
+  bool sequential_valid = ps->isPathValid(trajectory, "right_arm", false, &sequential_invalid);
+  ASSERT_FALSE(sequential_valid);
+  for (std::size_t i : colliding)
+    EXPECT_TRUE(std::find(sequential_invalid.begin(), sequential_invalid.end(), i) != sequential_invalid.end()) << i;
+  EXPECT_EQ(sequential_valid, ps->isPathValid(trajectory, "right_arm"));
+
+  ps->setPathValidationThreadCount(4);
+  EXPECT_EQ(ps->getPathValidationThreadCount(), 4u);
+  EXPECT_EQ(sequential_valid, ps->isPathValid(trajectory, "right_arm", false, &parallel_invalid));
+  EXPECT_EQ(sequential_invalid, parallel_invalid);
+  EXPECT_EQ(sequential_valid, ps->isPathValid(trajectory, "right_arm"));
+
+  // diff scenes inherit the setting
+  EXPECT_EQ(ps->diff()->getPathValidationThreadCount(), 4u);
+}
+
 // Test the setting of a new collision detector type. For now, only FCL is available in MoveIt2.
 // TODO(andyz): switch to a different type when one becomes available.
 TEST(PlanningScene, switchCollisionDetectorType)
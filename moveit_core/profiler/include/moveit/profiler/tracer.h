@@ -0,0 +1,144 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace moveit
+{
+namespace tools
+{
+/** \brief Low-overhead tracing of timed code spans across threads.
+
+    Unlike the Profiler, which aggregates statistics in a mutex-guarded map, the Tracer records individual spans
+    (a name id plus start and end time) into a fixed-size ring buffer owned by the recording thread, without taking
+    any lock. Span names are registered once per call site (see MOVEIT_TRACE_SCOPE) and referred to by id afterwards.
+    Tracing is disabled by default, in which case a span costs a single atomic load.
+
+    The spans of all threads can be exported in the Chrome trace event format, which chrome://tracing and Perfetto
+    display as a timeline. Setting the environment variable MOVEIT_TRACE_FILE to a file name enables tracing at
+    startup and writes the trace to that file when the process exits. */
+class Tracer
+{
+public:
+  /** \brief Records the lifetime of this object as a span, if tracing is enabled when it is constructed */
+  class ScopedSpan
+  {
+  public:
+    /** \brief Start a span with an id returned by Tracer::registerSpan() */
+    explicit ScopedSpan(std::uint32_t id) : id_(id), active_(Tracer::isEnabled()), start_(active_ ? Tracer::now() : 0)
+    {
+    }
+
+    /** \brief Start a span with a name that is only known at runtime. The name is registered on first use while
+        tracing is enabled, which takes a lock, so prefer cached ids in frequently called code. */
+    explicit ScopedSpan(const std::string& name)
+      : id_(0), active_(Tracer::isEnabled()), start_(active_ ? Tracer::now() : 0)
+    {
+      if (active_)
+        id_ = Tracer::registerSpan(name);
+    }
+
+    ~ScopedSpan()
+    {
+      if (active_)
+        Tracer::record(id_, start_, Tracer::now());
+    }
+
+    ScopedSpan(const ScopedSpan&) = delete;
+    ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+  private:
+    std::uint32_t id_;
+    bool active_;
+    std::uint64_t start_;
+  };
+
+  /** \brief Number of spans each thread keeps before overwriting its oldest ones */
+  static constexpr std::size_t BUFFER_CAPACITY = 1 << 16;
+
+  /** \brief Get the id of the spans called \e name, registering the name on first use. This takes a lock. */
+  static std::uint32_t registerSpan(const std::string& name);
+
+  /** \brief Enable or disable the recording of spans */
+  static void setEnabled(bool enabled);
+
+  /** \brief Check whether spans are being recorded */
+  static bool isEnabled()
+  {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  /** \brief Discard all spans recorded so far */
+  static void clear();
+
+  /** \brief Record a span that was timed externally, using times returned by now() */
+  static void record(std::uint32_t id, std::uint64_t start, std::uint64_t end);
+
+  /** \brief The current time in nanoseconds of a monotonic clock */
+  static std::uint64_t now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  /** \brief Write the recorded spans of all threads as a Chrome trace JSON document. Spans still being recorded
+      concurrently are either written completely or skipped. */
+  static void writeChromeTrace(std::ostream& out);
+
+  /** \brief Write the recorded spans of all threads as a Chrome trace JSON document to the file \e filename */
+  static bool writeChromeTrace(const std::string& filename);
+
+private:
+  static std::atomic<bool> enabled_;
+};
+}  // namespace tools
+}  // namespace moveit
+
+#define MOVEIT_TRACE_CONCAT_IMPL(a, b) a##b
+#define MOVEIT_TRACE_CONCAT(a, b) MOVEIT_TRACE_CONCAT_IMPL(a, b)
+
+/** \brief Trace the enclosing scope as a span called \e name. The name is registered once per call site, so it has
+    to be the same on every pass; use Tracer::ScopedSpan directly for names computed at runtime. */
+#define MOVEIT_TRACE_SCOPE(name)                                                                                      \
+  static const std::uint32_t MOVEIT_TRACE_CONCAT(moveit_trace_id_, __LINE__) =                                        \
+      moveit::tools::Tracer::registerSpan(name);                                                                      \
+  moveit::tools::Tracer::ScopedSpan MOVEIT_TRACE_CONCAT(moveit_trace_span_, __LINE__)(                                \
+      MOVEIT_TRACE_CONCAT(moveit_trace_id_, __LINE__))
@@ -0,0 +1,267 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/profiler/tracer.h>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <rclcpp/rclcpp.hpp>
+
+namespace moveit
+{
+namespace tools
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_profiler.tracer");
+
+std::atomic<bool> Tracer::enabled_(false);
+
+namespace
+{
+// A single span, guarded by a per-record sequence number so that readers can detect records that are overwritten
+// while they are being read. The sequence is odd while the record is written and 2 * (index + 1) once it holds the
+// span with the given index in the buffer.
+struct SpanRecord
+{
+  std::atomic<std::uint64_t> sequence{ 0 };
+  std::atomic<std::uint64_t> start{ 0 };
+  std::atomic<std::uint64_t> end{ 0 };
+  std::atomic<std::uint32_t> id{ 0 };
+};
+
+// Ring buffer written only by the thread currently owning it
+struct ThreadBuffer
+{
+  explicit ThreadBuffer(unsigned int lane) : lane(lane), records(new SpanRecord[Tracer::BUFFER_CAPACITY])
+  {
+  }
+
+  const unsigned int lane;
+  std::unique_ptr<SpanRecord[]> records;
+  std::atomic<std::uint64_t> count{ 0 };  // number of spans ever written
+};
+
+struct TracerState
+{
+  std::mutex lock;
+  std::vector<std::string> names;
+  std::unordered_map<std::string, std::uint32_t> ids;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  std::vector<ThreadBuffer*> free_buffers;  // buffers of threads that exited, reused by new threads
+  std::atomic<std::uint64_t> cleared_before{ 0 };
+  std::string trace_file;
+};
+
+void writeTraceFileAtExit();
+
+// The state is intentionally never destroyed, so that threads outliving static destruction can still record
+TracerState& state()
+{
+  static TracerState* tracer_state = [] {
+    auto* s = new TracerState();
+    const char* trace_file = std::getenv("MOVEIT_TRACE_FILE");
+    if (trace_file && *trace_file)
+    {
+      s->trace_file = trace_file;
+      Tracer::setEnabled(true);
+      std::atexit(&writeTraceFileAtExit);
+    }
+    return s;
+  }();
+  return *tracer_state;
+}
+
+void writeTraceFileAtExit()
+{
+  Tracer::writeChromeTrace(state().trace_file);
+}
+
+// make sure MOVEIT_TRACE_FILE is handled when the library is loaded
+const bool STATE_INITIALIZED = (state(), true);
+
+// Hands a buffer to the calling thread for its lifetime and returns it to the pool when the thread exits
+class ThreadBufferHandle
+{
+public:
+  ThreadBufferHandle()
+  {
+    TracerState& s = state();
+    std::lock_guard<std::mutex> slock(s.lock);
+    if (s.free_buffers.empty())
+    {
+      s.buffers.push_back(std::make_unique<ThreadBuffer>(s.buffers.size()));
+      buffer_ = s.buffers.back().get();
+    }
+    else
+    {
+      buffer_ = s.free_buffers.back();
+      s.free_buffers.pop_back();
+    }
+  }
+
+  ~ThreadBufferHandle()
+  {
+    TracerState& s = state();
+    std::lock_guard<std::mutex> slock(s.lock);
+    s.free_buffers.push_back(buffer_);
+  }
+
+  ThreadBuffer& buffer()
+  {
+    return *buffer_;
+  }
+
+private:
+  ThreadBuffer* buffer_;
+};
+
+void writeJSONString(std::ostream& out, const std::string& value)
+{
+  out << '"';
+  for (char c : value)
+  {
+    if (c == '"' || c == '\\')
+      out << '\\' << c;
+    else if (static_cast<unsigned char>(c) < 0x20)
+      out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+    else
+      out << c;
+  }
+  out << '"';
+}
+}  // namespace
+
+std::uint32_t Tracer::registerSpan(const std::string& name)
+{
+  TracerState& s = state();
+  std::lock_guard<std::mutex> slock(s.lock);
+  auto it = s.ids.find(name);
+  if (it != s.ids.end())
+    return it->second;
+  const std::uint32_t id = s.names.size();
+  s.names.push_back(name);
+  s.ids[name] = id;
+  return id;
+}
+
+void Tracer::setEnabled(bool enabled)
+{
+  enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void Tracer::clear()
+{
+  state().cleared_before.store(now(), std::memory_order_relaxed);
+}
+
+void Tracer::record(std::uint32_t id, std::uint64_t start, std::uint64_t end)
+{
+  static thread_local ThreadBufferHandle handle;
+  ThreadBuffer& buffer = handle.buffer();
+  const std::uint64_t index = buffer.count.load(std::memory_order_relaxed);
+  SpanRecord& record = buffer.records[index % BUFFER_CAPACITY];
+
+  record.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  record.id.store(id, std::memory_order_relaxed);
+  record.start.store(start, std::memory_order_relaxed);
+  record.end.store(end, std::memory_order_relaxed);
+  record.sequence.store(2 * index + 2, std::memory_order_release);
+  buffer.count.store(index + 1, std::memory_order_release);
+}
+
+void Tracer::writeChromeTrace(std::ostream& out)
+{
+  TracerState& s = state();
+  std::vector<std::string> names;
+  std::vector<ThreadBuffer*> buffers;
+  {
+    std::lock_guard<std::mutex> slock(s.lock);
+    names = s.names;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : s.buffers)
+      buffers.push_back(buffer.get());
+  }
+  const std::uint64_t cleared_before = s.cleared_before.load(std::memory_order_relaxed);
+
+  const std::ios::fmtflags flags = out.flags();
+  const std::streamsize precision = out.precision();
+  out << std::fixed << std::setprecision(3);
+  out << "{\"traceEvents\":[";
+  bool first = true;
+  for (const ThreadBuffer* buffer : buffers)
+  {
+    const std::uint64_t count = buffer->count.load(std::memory_order_acquire);
+    for (std::uint64_t index = count > BUFFER_CAPACITY ? count - BUFFER_CAPACITY : 0; index < count; ++index)
+    {
+      const SpanRecord& record = buffer->records[index % BUFFER_CAPACITY];
+      const std::uint64_t sequence = record.sequence.load(std::memory_order_acquire);
+      const std::uint32_t id = record.id.load(std::memory_order_relaxed);
+      const std::uint64_t start = record.start.load(std::memory_order_relaxed);
+      const std::uint64_t end = record.end.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // skip records that were overwritten in the meantime
+      if (sequence != 2 * index + 2 || record.sequence.load(std::memory_order_relaxed) != sequence)
+        continue;
+      if (start < cleared_before || id >= names.size())
+        continue;
+
+      out << (first ? "\n" : ",\n") << "{\"name\":";
+      writeJSONString(out, names[id]);
+      out << ",\"cat\":\"moveit\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->lane << ",\"ts\":" << start * 1e-3
+          << ",\"dur\":" << (end - start) * 1e-3 << '}';
+      first = false;
+    }
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  out.flags(flags);
+  out.precision(precision);
+}
+
+bool Tracer::writeChromeTrace(const std::string& filename)
+{
+  std::ofstream out(filename);
+  if (!out)
+  {
+    RCLCPP_ERROR(LOGGER, "Unable to open '%s' for writing the trace", filename.c_str());
+    return false;
+  }
+  writeChromeTrace(out);
+  RCLCPP_INFO(LOGGER, "Wrote trace to '%s'", filename.c_str());
+  return out.good();
+}
+}  // namespace tools
+}  // namespace moveit
@@ -0,0 +1,130 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+#include <moveit/profiler/tracer.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using moveit::tools::Tracer;
+
+namespace
+{
+std::size_t countOccurrences(const std::string& text, const std::string& pattern)
+{
+  std::size_t count = 0;
+  for (std::size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1))
+    ++count;
+  return count;
+}
+
+std::string exportTrace()
+{
+  std::stringstream out;
+  Tracer::writeChromeTrace(out);
+  return out.str();
+}
+
+void tracedFunction()
+{
+  MOVEIT_TRACE_SCOPE("tracedFunction");
+}
+}  // namespace
+
+TEST(Tracer, RegisterSpan)
+{
+  const std::uint32_t id = Tracer::registerSpan("RegisterSpan");
+  EXPECT_EQ(Tracer::registerSpan("RegisterSpan"), id);
+  EXPECT_NE(Tracer::registerSpan("RegisterSpanOther"), id);
+}
+
+TEST(Tracer, DisabledRecordsNothing)
+{
+  Tracer::setEnabled(false);
+  Tracer::clear();
+  tracedFunction();
+  EXPECT_EQ(countOccurrences(exportTrace(), "\"tracedFunction\""), 0u);
+}
+
+TEST(Tracer, RecordsSpansOfAllThreads)
+{
+  Tracer::setEnabled(true);
+  Tracer::clear();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i)
+    threads.emplace_back([] {
+      for (int j = 0; j < 10; ++j)
+        tracedFunction();
+    });
+  for (std::thread& thread : threads)
+    thread.join();
+  {
+    Tracer::ScopedSpan span(std::string("runtime \"name\""));
+  }
+  Tracer::setEnabled(false);
+
+  const std::string trace = exportTrace();
+  EXPECT_EQ(trace.rfind("{\"traceEvents\":[", 0), 0u);
+  EXPECT_EQ(countOccurrences(trace, "\"name\":\"tracedFunction\""), 40u);
+  EXPECT_EQ(countOccurrences(trace, "\"name\":\"runtime \\\"name\\\"\""), 1u);
+  EXPECT_EQ(countOccurrences(trace, "\"ph\":\"X\""), 41u);
+
+  Tracer::clear();
+  EXPECT_EQ(countOccurrences(exportTrace(), "\"ph\":\"X\""), 0u);
+}
+
+TEST(Tracer, RingBufferKeepsNewestSpans)
+{
+  const std::uint32_t old_id = Tracer::registerSpan("old");
+  const std::uint32_t new_id = Tracer::registerSpan("new");
+  Tracer::clear();
+  std::thread([&] {
+    const std::uint64_t start = Tracer::now();
+    Tracer::record(old_id, start, start + 1);
+    for (std::size_t i = 0; i < Tracer::BUFFER_CAPACITY; ++i)
+      Tracer::record(new_id, start, start + 1);
+  }).join();
+
+  const std::string trace = exportTrace();
+  EXPECT_EQ(countOccurrences(trace, "\"name\":\"old\""), 0u);
+  EXPECT_EQ(countOccurrences(trace, "\"name\":\"new\""), Tracer::BUFFER_CAPACITY);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
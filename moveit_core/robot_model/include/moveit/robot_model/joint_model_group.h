@@ -104,6 +104,40 @@ public:
   /// Map from group instances to allocator functions & bijections
   using KinematicsSolverMap = std::map<const JointModelGroup*, KinematicsSolver>;
 
+  /** \brief Flat description of the kinematic tree formed by the updated links of a group (see
+      getUpdatedLinkModels()). It is computed once when the group is constructed and allows forward kinematics
+      and Jacobian computations to iterate over contiguous arrays instead of following pointers between links
+      and joints and looking up joints by name. All arrays, except link_slots, are indexed by the position of a
+      link in getUpdatedLinkModels() (its slot). */
+  struct CompiledKinematics
+  {
+    /// The RobotModel index of each link
+    std::vector<int> link_indices;
+
+    /// The slot of the parent of each link, or -1 if the parent link is not updated by the group
+    std::vector<int> parent_slots;
+
+    /// The type of the parent joint of each link
+    std::vector<JointModel::JointType> joint_types;
+
+    /// The index of the first variable of the parent joint within the group state, or -1 if the joint is not
+    /// part of the group or has no variables
+    std::vector<int> group_variable_indices;
+
+    /// The axis of the parent joint of each link (only meaningful for revolute and prismatic joints)
+    EigenSTL::vector_Vector3d joint_axes;
+
+    /// Map from a RobotModel link index to its slot, or -1 if the link is not updated by the group
+    std::vector<int> link_slots;
+
+    /// Get the slot of \e link, or -1 if the link is not updated by the group
+    int getSlot(const LinkModel* link) const
+    {
+      const std::size_t index = link->getLinkIndex();
+      return index < link_slots.size() ? link_slots[index] : -1;
+    }
+  };
+
   JointModelGroup(const std::string& name, const srdf::Model::Group& config,
                   const std::vector<const JointModel*>& joint_vector, const RobotModel* parent_model);
 
@@ -235,6 +269,12 @@ public:
     return updated_link_model_vector_;
   }
 
+  /** \brief Get the flat, index-based description of the links returned by getUpdatedLinkModels() */
+  const CompiledKinematics& getCompiledKinematics() const
+  {
+    return compiled_kinematics_;
+  }
+
   /** \brief Return the same data as getUpdatedLinkModels() but as a set */
   const std::set<const LinkModel*>& getUpdatedLinkModelsSet() const
   {
@@ -698,6 +738,9 @@ protected:
    * this group) */
   std::set<std::string> updated_link_model_with_geometry_name_set_;
 
+  /** \brief Flat description of the updated links, used in tight FK and Jacobian loops */
+  CompiledKinematics compiled_kinematics_;
+
   /** \brief The number of variables necessary to describe this group of joints */
   unsigned int variable_count_;
 
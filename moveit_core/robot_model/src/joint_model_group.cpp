@@ -38,6 +38,7 @@
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_model/joint_model_group.h>
 #include <moveit/robot_model/revolute_joint_model.h>
+#include <moveit/robot_model/prismatic_joint_model.h>
 #include <moveit/exceptions/exceptions.h>
 #include <boost/lexical_cast.hpp>
 #include <algorithm>
@@ -247,6 +248,30 @@ JointModelGroup::JointModelGroup(const std::string& group_name, const srdf::Mode
   for (const LinkModel* updated_link_model_with_geometry : updated_link_model_with_geometry_vector_)
     updated_link_model_with_geometry_name_vector_.push_back(updated_link_model_with_geometry->getName());
 
+  // flatten the updated links into index arrays; since links are sorted by index, parents precede their children
+  if (!updated_link_model_vector_.empty())
+    compiled_kinematics_.link_slots.assign(updated_link_model_vector_.back()->getLinkIndex() + 1, -1);
+  for (const LinkModel* updated_link_model : updated_link_model_vector_)
+  {
+    const JointModel* joint_model = updated_link_model->getParentJointModel();
+    const LinkModel* parent_link_model = updated_link_model->getParentLinkModel();
+    compiled_kinematics_.link_slots[updated_link_model->getLinkIndex()] = compiled_kinematics_.link_indices.size();
+    compiled_kinematics_.link_indices.push_back(updated_link_model->getLinkIndex());
+    compiled_kinematics_.parent_slots.push_back(parent_link_model ? compiled_kinematics_.getSlot(parent_link_model) :
+                                                                    -1);
+    compiled_kinematics_.joint_types.push_back(joint_model->getType());
+    compiled_kinematics_.group_variable_indices.push_back(
+        joint_model->getVariableCount() > 0 && hasJointModel(joint_model->getName()) ?
+            joint_variables_index_map_[joint_model->getName()] :
+            -1);
+    if (joint_model->getType() == JointModel::REVOLUTE)
+      compiled_kinematics_.joint_axes.push_back(static_cast<const RevoluteJointModel*>(joint_model)->getAxis());
+    else if (joint_model->getType() == JointModel::PRISMATIC)
+      compiled_kinematics_.joint_axes.push_back(static_cast<const PrismaticJointModel*>(joint_model)->getAxis());
+    else
+      compiled_kinematics_.joint_axes.push_back(Eigen::Vector3d::Zero());
+  }
+
   // check if this group should actually be a chain
   if (joint_roots_.size() == 1 && !active_joint_model_vector_.empty())
   {
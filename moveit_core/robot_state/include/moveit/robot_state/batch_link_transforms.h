@@ -0,0 +1,125 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/robot_model/robot_model.h>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+namespace moveit
+{
+namespace core
+{
+/** \brief Global link transforms of a joint model group, computed for a batch of group states.
+
+    The transforms are stored in a structure-of-arrays layout: for every link, each of the 12 non-constant
+    components of the 3x4 affine matrix (the column-major 3x3 rotation followed by the translation) is a
+    contiguous array holding that component for all states of the batch. This allows the per-joint computations
+    to be vectorized across states. Instances are filled by RobotState::computeBatchLinkTransforms() and can be
+    reused between calls to avoid reallocation. */
+class BatchLinkTransforms
+{
+public:
+  /** \brief Number of components stored per link and state */
+  static constexpr std::size_t COMPONENT_COUNT = 12;
+
+  BatchLinkTransforms();
+
+  /** \brief The group these transforms were last computed for */
+  const JointModelGroup* getJointModelGroup() const
+  {
+    return group_;
+  }
+
+  /** \brief The number of states in the batch */
+  std::size_t getStateCount() const
+  {
+    return state_count_;
+  }
+
+  /** \brief The links for which transforms are available (the updated links of the group) */
+  const std::vector<const LinkModel*>& getLinkModels() const;
+
+  /** \brief Check whether the transform of \e link is part of the batch */
+  bool hasLinkModel(const LinkModel* link) const
+  {
+    return getSlot(link) >= 0;
+  }
+
+  /** \brief Get the transform of \e link (w.r.t. the model frame) for state number \e state of the batch.
+      The link must be one of getLinkModels(). */
+  Eigen::Isometry3d getGlobalLinkTransform(const LinkModel* link, std::size_t state) const;
+
+  /** \brief Direct access to the array of \e component values of \e link over all states of the batch.
+      Components 0-8 are the rotation matrix in column-major order, 9-11 are the translation.
+      Returns nullptr if \e link is not part of the batch or \e component is out of range. */
+  const double* getComponentData(const LinkModel* link, std::size_t component) const
+  {
+    const int slot = getSlot(link);
+    if (slot < 0 || component >= COMPONENT_COUNT)
+      return nullptr;
+    return data_.data() + (slot * COMPONENT_COUNT + component) * state_count_;
+  }
+
+private:
+  friend class RobotState;
+
+  /** \brief Prepare the storage for \e state_count states of \e group */
+  void configure(const JointModelGroup* group, std::size_t state_count);
+
+  int getSlot(const LinkModel* link) const
+  {
+    return group_ ? group_->getCompiledKinematics().getSlot(link) : -1;
+  }
+
+  double* getLinkData(std::size_t slot)
+  {
+    return data_.data() + slot * COMPONENT_COUNT * state_count_;
+  }
+
+  const JointModelGroup* group_;
+  std::size_t state_count_;
+
+  /** \brief The link transforms; COMPONENT_COUNT arrays of state_count_ values per link */
+  Eigen::ArrayXd data_;
+
+  /** \brief Scratch space: the group variables, one contiguous row per variable */
+  Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> positions_;
+  /** \brief Scratch space for the local joint and link transforms of a single link */
+  Eigen::ArrayXd joint_transforms_;
+  Eigen::ArrayXd local_transforms_;
+};
+}  // namespace core
+}  // namespace moveit
@@ -126,14 +126,23 @@ public:
 
      For absolute jump thresholds, if any individual joint-space motion delta is larger then \e revolute_jump_threshold
      for revolute joints or \e prismatic_jump_threshold for prismatic joints then this step is considered a failure and
-     the returned path is truncated up to just before the jump.*/
+     the returned path is truncated up to just before the jump.
+
+     By default (\e validation_thread_count is 1), the \e validCallback is evaluated by the IK solver for every
+     waypoint before the next one is solved. With any other value, the path is computed in a pipelined fashion on the
+     shared WorkerPool: IK is solved for the waypoints in order (each seeded by the previous solution) on one thread,
+     while up to \e validation_thread_count other threads (0 selects the number of hardware threads) run
+     \e validCallback on the waypoints that were already solved. The computation stops at the first waypoint for which IK fails or which is
+     invalid, and the returned fraction and path are truncated just before it, as in sequential mode. The IK solver
+     then cannot reject an invalid solution in favor of another one, and \e validCallback must be thread-safe.*/
   static double
   computeCartesianPath(RobotState* start_state, const JointModelGroup* group,
                        std::vector<std::shared_ptr<RobotState>>& traj, const LinkModel* link,
                        const Eigen::Vector3d& direction, bool global_reference_frame, double distance,
                        const MaxEEFStep& max_step, const JumpThreshold& jump_threshold,
                        const GroupStateValidityCallbackFn& validCallback = GroupStateValidityCallbackFn(),
-                       const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions());
+                       const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions(),
+                       unsigned int validation_thread_count = 1);
 
   /** \brief Compute the sequence of joint values that correspond to a straight Cartesian path, for a particular group.
 
@@ -147,7 +156,8 @@ public:
                        const Eigen::Isometry3d& target, bool global_reference_frame, const MaxEEFStep& max_step,
                        const JumpThreshold& jump_threshold,
                        const GroupStateValidityCallbackFn& validCallback = GroupStateValidityCallbackFn(),
-                       const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions());
+                       const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions(),
+                       unsigned int validation_thread_count = 1);
 
   /** \brief Compute the sequence of joint values that perform a general Cartesian path.
 
@@ -161,7 +171,8 @@ public:
                        const EigenSTL::vector_Isometry3d& waypoints, bool global_reference_frame,
                        const MaxEEFStep& max_step, const JumpThreshold& jump_threshold,
                        const GroupStateValidityCallbackFn& validCallback = GroupStateValidityCallbackFn(),
-                       const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions());
+                       const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions(),
+                       unsigned int validation_thread_count = 1);
 
   /** \brief Tests joint space jumps of a trajectory.
 
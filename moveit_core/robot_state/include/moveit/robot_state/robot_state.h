@@ -39,6 +39,7 @@
 
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/attached_body.h>
+#include <moveit/robot_state/batch_link_transforms.h>
 #include <moveit/transforms/transforms.h>
 #include <sensor_msgs/msg/joint_state.hpp>
 #include <visualization_msgs/msg/marker_array.hpp>
@@ -100,6 +101,11 @@ public:
   /** \brief Copy operator */
   RobotState& operator=(const RobotState& other);
 
+  /** \brief Copy the contents of \e other, which must be a state of the same robot model, into this state.
+      The memory of this state is reused, so no allocation takes place unless attached bodies need to be copied.
+      An exception is thrown if the robot models differ. */
+  void assignFrom(const RobotState& other);
+
   /** \brief Get the robot model this state is constructed for. */
   const RobotModelConstPtr& getRobotModel() const
   {
@@ -1285,6 +1291,23 @@ public:
   /** \brief Update the state after setting a particular link to the input global transform pose.*/
   void updateStateWithLinkAt(const LinkModel* link, const Eigen::Isometry3d& transform, bool backward = false);
 
+  /** \brief Compute the global transforms of the updated links of \e group for a batch of group states at once.
+
+      Each column of \e group_values holds the variable values of \e group for one state (in the order of
+      JointModelGroup::getVariableNames()). Joints outside the group keep the values of this state, which is not
+      modified. Mimic joints within the group are updated as in setJointGroupPositions(). Attached bodies are not
+      considered. This is equivalent to (but considerably faster than) calling setJointGroupPositions() and
+      getGlobalLinkTransform() for every state. */
+  void computeBatchLinkTransforms(const JointModelGroup* group, const Eigen::Ref<const Eigen::MatrixXd>& group_values,
+                                  BatchLinkTransforms& transforms) const;
+
+  void computeBatchLinkTransforms(const JointModelGroup* group, const Eigen::Ref<const Eigen::MatrixXd>& group_values,
+                                  BatchLinkTransforms& transforms)
+  {
+    updateLinkTransforms();
+    static_cast<const RobotState*>(this)->computeBatchLinkTransforms(group, group_values, transforms);
+  }
+
   /** \brief Get the link transform w.r.t. the root link (model frame) of the RobotModel.
    *   This is typically the root link of the URDF unless a virtual joint is present.
    *   Checks the cache and if there are any dirty (non-updated) transforms, first updates them as needed.
@@ -0,0 +1,113 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/robot_state/robot_state.h>
+#include <memory>
+#include <mutex>
+
+namespace moveit
+{
+namespace core
+{
+MOVEIT_CLASS_FORWARD(RobotStatePool);  // Defines RobotStatePoolPtr, ConstPtr, WeakPtr... etc
+
+/** \brief A pool of preallocated RobotState instances for a single RobotModel.
+
+    Creating and destroying RobotState objects in hot loops allocates and frees memory for every state, which
+    causes contention on the allocator when many planning threads do this in parallel. The pool keeps released
+    states in a set of free lists, each protected by its own mutex. Every thread is mapped to one of the free lists,
+    so concurrent threads rarely compete for the same lock, and acquiring a state that was previously released
+    does not allocate. States are returned to the pool automatically when the pointer returned by acquire()
+    goes out of scope. The pool must outlive all states acquired from it. */
+class RobotStatePool
+{
+public:
+  /** \brief Deleter that returns a state to the pool it was acquired from */
+  struct Releaser
+  {
+    RobotStatePool* pool;
+    void operator()(RobotState* state) const
+    {
+      pool->release(state);
+    }
+  };
+
+  /** \brief Pointer to a pooled state. The state is returned to the pool on destruction. */
+  using PooledRobotStatePtr = std::unique_ptr<RobotState, Releaser>;
+
+  /** \brief Construct a pool for states of \e robot_model. At most \e max_free_states released states are kept
+      for reuse, split evenly over the free lists; released states that do not fit into the free list of the
+      releasing thread are freed. */
+  RobotStatePool(const RobotModelConstPtr& robot_model, std::size_t max_free_states = 256);
+  ~RobotStatePool();
+
+  RobotStatePool(const RobotStatePool&) = delete;
+  RobotStatePool& operator=(const RobotStatePool&) = delete;
+
+  const RobotModelConstPtr& getRobotModel() const
+  {
+    return robot_model_;
+  }
+
+  /** \brief Get a state from the pool. Its content is undefined (it may hold the values of a previous use). */
+  PooledRobotStatePtr acquire();
+
+  /** \brief Get a state from the pool and set it to a copy of \e other (see RobotState::assignFrom()) */
+  PooledRobotStatePtr acquire(const RobotState& other);
+
+  /** \brief Preallocate \e count states for the free list of the calling thread */
+  void reserve(std::size_t count);
+
+  /** \brief The number of states currently available for reuse */
+  std::size_t getFreeStateCount() const;
+
+private:
+  struct FreeList
+  {
+    mutable std::mutex lock;
+    std::vector<RobotState*> states;
+  };
+
+  FreeList& getFreeList();
+  void release(RobotState* state);
+
+  RobotModelConstPtr robot_model_;
+  std::size_t free_list_count_;
+  std::size_t max_states_per_free_list_;
+  std::unique_ptr<FreeList[]> free_lists_;
+};
+}  // namespace core
+}  // namespace moveit
@@ -0,0 +1,291 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/robot_state/batch_link_transforms.h>
+#include <moveit/robot_state/robot_state.h>
+
+namespace moveit
+{
+namespace core
+{
+namespace
+{
+// Index of the rotation element (row, col) and of the translation element (row) within the 12 stored components
+constexpr std::size_t R(std::size_t row, std::size_t col)
+{
+  return col * 3 + row;
+}
+constexpr std::size_t T(std::size_t row)
+{
+  return 9 + row;
+}
+
+using Row = Eigen::Map<Eigen::ArrayXd>;
+using ConstRow = Eigen::Map<const Eigen::ArrayXd>;
+
+// out = a * b, where a is the same for all states
+void multiply(const Eigen::Isometry3d& a, const double* b, double* out, Eigen::Index n)
+{
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    for (std::size_t j = 0; j < 3; ++j)
+      Row(out + R(i, j) * n, n) = a(i, 0) * ConstRow(b + R(0, j) * n, n) + a(i, 1) * ConstRow(b + R(1, j) * n, n) +
+                                  a(i, 2) * ConstRow(b + R(2, j) * n, n);
+    Row(out + T(i) * n, n) = a(i, 0) * ConstRow(b + T(0) * n, n) + a(i, 1) * ConstRow(b + T(1) * n, n) +
+                             a(i, 2) * ConstRow(b + T(2) * n, n) + a(i, 3);
+  }
+}
+
+// out = a * b, where b is the same for all states
+void multiply(const double* a, const Eigen::Isometry3d& b, double* out, Eigen::Index n)
+{
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    for (std::size_t j = 0; j < 3; ++j)
+      Row(out + R(i, j) * n, n) = ConstRow(a + R(i, 0) * n, n) * b(0, j) + ConstRow(a + R(i, 1) * n, n) * b(1, j) +
+                                  ConstRow(a + R(i, 2) * n, n) * b(2, j);
+    Row(out + T(i) * n, n) = ConstRow(a + R(i, 0) * n, n) * b(0, 3) + ConstRow(a + R(i, 1) * n, n) * b(1, 3) +
+                             ConstRow(a + R(i, 2) * n, n) * b(2, 3) + ConstRow(a + T(i) * n, n);
+  }
+}
+
+// out = a * b
+void multiply(const double* a, const double* b, double* out, Eigen::Index n)
+{
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    for (std::size_t j = 0; j < 3; ++j)
+      Row(out + R(i, j) * n, n) = ConstRow(a + R(i, 0) * n, n) * ConstRow(b + R(0, j) * n, n) +
+                                  ConstRow(a + R(i, 1) * n, n) * ConstRow(b + R(1, j) * n, n) +
+                                  ConstRow(a + R(i, 2) * n, n) * ConstRow(b + R(2, j) * n, n);
+    Row(out + T(i) * n, n) = ConstRow(a + R(i, 0) * n, n) * ConstRow(b + T(0) * n, n) +
+                             ConstRow(a + R(i, 1) * n, n) * ConstRow(b + T(1) * n, n) +
+                             ConstRow(a + R(i, 2) * n, n) * ConstRow(b + T(2) * n, n) + ConstRow(a + T(i) * n, n);
+  }
+}
+
+// out = a for all states
+void assign(const Eigen::Isometry3d& a, double* out, Eigen::Index n)
+{
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    for (std::size_t j = 0; j < 3; ++j)
+      Row(out + R(i, j) * n, n).setConstant(a(i, j));
+    Row(out + T(i) * n, n).setConstant(a(i, 3));
+  }
+}
+
+// Compute the transforms of \e joint (of type \e type with \e axis) for all states; \e values holds one row of
+// n values per joint variable
+void computeJointTransforms(const JointModel* joint, JointModel::JointType type, const Eigen::Vector3d& axis,
+                            const double* values, double* out, Eigen::Index n)
+{
+  switch (type)
+  {
+    case JointModel::REVOLUTE:
+    {
+      // same as RevoluteJointModel::computeTransform(), evaluated for all states at once
+      const ConstRow angle(values, n);
+      const Eigen::ArrayXd c = angle.cos();
+      const Eigen::ArrayXd s = angle.sin();
+      const Eigen::ArrayXd t = 1.0 - c;
+
+      Row(out + R(0, 0) * n, n) = t * (axis.x() * axis.x()) + c;
+      Row(out + R(1, 0) * n, n) = t * (axis.x() * axis.y()) + s * axis.z();
+      Row(out + R(2, 0) * n, n) = t * (axis.x() * axis.z()) - s * axis.y();
+      Row(out + R(0, 1) * n, n) = t * (axis.x() * axis.y()) - s * axis.z();
+      Row(out + R(1, 1) * n, n) = t * (axis.y() * axis.y()) + c;
+      Row(out + R(2, 1) * n, n) = t * (axis.y() * axis.z()) + s * axis.x();
+      Row(out + R(0, 2) * n, n) = t * (axis.x() * axis.z()) + s * axis.y();
+      Row(out + R(1, 2) * n, n) = t * (axis.y() * axis.z()) - s * axis.x();
+      Row(out + R(2, 2) * n, n) = t * (axis.z() * axis.z()) + c;
+      for (std::size_t i = 0; i < 3; ++i)
+        Row(out + T(i) * n, n).setZero();
+      break;
+    }
+    case JointModel::PRISMATIC:
+    {
+      const ConstRow offset(values, n);
+      for (std::size_t i = 0; i < 3; ++i)
+      {
+        for (std::size_t j = 0; j < 3; ++j)
+          Row(out + R(i, j) * n, n).setConstant(i == j ? 1.0 : 0.0);
+        Row(out + T(i) * n, n) = offset * axis[i];
+      }
+      break;
+    }
+    default:
+    {
+      // multi-dof joints are rare within groups; fall back to the per-state computation
+      const std::size_t variable_count = joint->getVariableCount();
+      std::vector<double> state_values(variable_count);
+      Eigen::Isometry3d transform;
+      for (Eigen::Index k = 0; k < n; ++k)
+      {
+        for (std::size_t v = 0; v < variable_count; ++v)
+          state_values[v] = values[v * n + k];
+        joint->computeTransform(state_values.data(), transform);
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+          for (std::size_t j = 0; j < 3; ++j)
+            out[R(i, j) * n + k] = transform(i, j);
+          out[T(i) * n + k] = transform(i, 3);
+        }
+      }
+      break;
+    }
+  }
+}
+}  // namespace
+
+BatchLinkTransforms::BatchLinkTransforms() : group_(nullptr), state_count_(0)
+{
+}
+
+void BatchLinkTransforms::configure(const JointModelGroup* group, std::size_t state_count)
+{
+  const std::size_t size = group->getUpdatedLinkModels().size() * COMPONENT_COUNT * state_count;
+  if (group != group_ || state_count != state_count_ || static_cast<std::size_t>(data_.size()) != size)
+  {
+    group_ = group;
+    state_count_ = state_count;
+    data_.resize(size);
+    positions_.resize(group->getVariableCount(), state_count);
+    joint_transforms_.resize(COMPONENT_COUNT * state_count);
+    local_transforms_.resize(COMPONENT_COUNT * state_count);
+  }
+}
+
+const std::vector<const LinkModel*>& BatchLinkTransforms::getLinkModels() const
+{
+  static const std::vector<const LinkModel*> EMPTY;
+  return group_ ? group_->getUpdatedLinkModels() : EMPTY;
+}
+
+Eigen::Isometry3d BatchLinkTransforms::getGlobalLinkTransform(const LinkModel* link, std::size_t state) const
+{
+  const int slot = getSlot(link);
+  if (slot < 0 || state >= state_count_)
+    throw Exception("Link '" + link->getName() + "' or state " + std::to_string(state) +
+                    " is not part of the batch of link transforms");
+
+  const double* d = data_.data() + slot * COMPONENT_COUNT * state_count_ + state;
+  Eigen::Isometry3d result;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    for (std::size_t j = 0; j < 3; ++j)
+      result(i, j) = d[R(i, j) * state_count_];
+    result(i, 3) = d[T(i) * state_count_];
+  }
+  result.makeAffine();
+  return result;
+}
+
+void RobotState::computeBatchLinkTransforms(const JointModelGroup* group,
+                                            const Eigen::Ref<const Eigen::MatrixXd>& group_values,
+                                            BatchLinkTransforms& transforms) const
+{
+  BOOST_VERIFY(checkLinkTransforms());
+
+  if (group_values.rows() != static_cast<Eigen::Index>(group->getVariableCount()))
+    throw Exception("Batch of states for group '" + group->getName() + "' has " +
+                    std::to_string(group_values.rows()) + " variables instead of " +
+                    std::to_string(group->getVariableCount()));
+
+  const Eigen::Index n = group_values.cols();
+  transforms.configure(group, n);
+  if (n == 0)
+    return;
+
+  // store the group variables state-contiguous, so each joint variable forms a single array
+  transforms.positions_ = group_values.array();
+
+  // mimic joints within the group follow their master, as in setJointGroupPositions()
+  for (const JointModel* jm : group->getMimicJointModels())
+  {
+    const JointModel* master = jm->getMimic();
+    const int dest = group->getVariableGroupIndex(jm->getName());
+    if (group->hasJointModel(master->getName()))
+      transforms.positions_.row(dest) =
+          jm->getMimicFactor() * transforms.positions_.row(group->getVariableGroupIndex(master->getName())) +
+          jm->getMimicOffset();
+    else
+      transforms.positions_.row(dest).setConstant(jm->getMimicFactor() * position_[master->getFirstVariableIndex()] +
+                                                  jm->getMimicOffset());
+  }
+
+  const JointModelGroup::CompiledKinematics& kinematics = group->getCompiledKinematics();
+  const std::vector<const LinkModel*>& links = group->getUpdatedLinkModels();
+  double* joint_transforms = transforms.joint_transforms_.data();
+  double* local_transforms = transforms.local_transforms_.data();
+  Eigen::Isometry3d joint_transform;
+  for (std::size_t slot = 0; slot < links.size(); ++slot)
+  {
+    const LinkModel* link = links[slot];
+    const LinkModel* parent = link->getParentLinkModel();
+    const int parent_slot = kinematics.parent_slots[slot];
+    const int variable_index = kinematics.group_variable_indices[slot];
+    double* out = transforms.getLinkData(slot);
+    const double* parent_data = parent_slot >= 0 ? transforms.getLinkData(parent_slot) : nullptr;
+
+    if (variable_index < 0)
+    {
+      // the joint does not depend on the group variables: its local transform is the same for all states
+      const JointModel* joint = link->getParentJointModel();
+      joint->computeTransform(position_ + joint->getFirstVariableIndex(), joint_transform);
+      joint_transform = link->getJointOriginTransform() * joint_transform;
+      if (parent_data)
+        multiply(parent_data, joint_transform, out, n);
+      else
+        assign(parent ? global_link_transforms_[parent->getLinkIndex()] * joint_transform : joint_transform, out, n);
+    }
+    else
+    {
+      computeJointTransforms(link->getParentJointModel(), kinematics.joint_types[slot], kinematics.joint_axes[slot],
+                             transforms.positions_.row(variable_index).data(), joint_transforms, n);
+      if (parent_data)
+      {
+        multiply(link->getJointOriginTransform(), joint_transforms, local_transforms, n);
+        multiply(parent_data, local_transforms, out, n);
+      }
+      else if (parent)
+        multiply(global_link_transforms_[parent->getLinkIndex()] * link->getJointOriginTransform(), joint_transforms,
+                 out, n);
+      else
+        multiply(link->getJointOriginTransform(), joint_transforms, out, n);
+    }
+  }
+}
+}  // namespace core
+}  // namespace moveit
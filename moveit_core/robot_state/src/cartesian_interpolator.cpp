@@ -37,7 +37,13 @@
 /* Author: Ioan Sucan, Sachin Chitta, Acorn Pooley, Mario Prats, Dave Coleman */
 
 #include <moveit/robot_state/cartesian_interpolator.h>
+#include <moveit/utils/worker_pool.h>
 #include <geometric_shapes/check_isometry.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 namespace moveit
 {
@@ -51,13 +57,120 @@ static const std::size_t MIN_STEPS_FOR_JUMP_THRESH = 10;
 
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_robot_state.cartesian_interpolator");
 
+namespace
+{
+/** \brief Solve IK for \e poses in order on one thread of the shared WorkerPool while up to \e thread_count others
+ * check the already solved waypoints with \e validCallback. Stops at the first waypoint for which IK fails or which is
+ * invalid, appends the states of the waypoints before it to \e traj and returns their number. */
+std::size_t solveAndValidatePipelined(RobotState* start_state, const JointModelGroup* group, const LinkModel* link,
+                                      const EigenSTL::vector_Isometry3d& poses,
+                                      const std::vector<double>& consistency_limits,
+                                      const GroupStateValidityCallbackFn& validCallback,
+                                      const kinematics::KinematicsQueryOptions& options, unsigned int thread_count,
+                                      std::vector<RobotStatePtr>& traj)
+{
+  std::mutex mutex;
+  std::condition_variable pending_condition;
+  std::vector<RobotStatePtr> solved;  // states of the waypoints solved so far, in order
+  std::deque<std::size_t> pending;    // indices into solved that still need to be validated
+  std::size_t first_invalid = poses.size();
+  bool solving_done = false;
+  solved.reserve(poses.size());
+
+  auto validate = [&]() {
+    std::vector<double> values;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+      pending_condition.wait(lock, [&] { return !pending.empty() || solving_done; });
+      if (pending.empty())
+        return;
+      const std::size_t index = pending.front();
+      pending.pop_front();
+      if (index > first_invalid)
+        continue;  // the path is truncated before this waypoint anyway
+      RobotStatePtr state = solved[index];
+      lock.unlock();
+
+      state->copyJointGroupPositions(group, values);
+      const bool valid = validCallback(state.get(), group, values.data());
+
+      lock.lock();
+      if (!valid)
+        first_invalid = std::min(first_invalid, index);
+    }
+  };
+
+  auto finish_solving = [&]() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      solving_done = true;
+    }
+    pending_condition.notify_all();
+  };
+
+  auto solve = [&]() {
+    for (std::size_t i = 0; i < poses.size(); ++i)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (first_invalid < poses.size())
+          break;
+      }
+
+      // Explicitly use a single IK attempt only: We want a smooth trajectory.
+      // Random seeding (of additional attempts) would probably create IK jumps.
+      if (!start_state->setFromIK(group, poses[i], link->getName(), consistency_limits, 0.0,
+                                  GroupStateValidityCallbackFn(), options))
+        break;
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        solved.push_back(RobotStatePtr(new moveit::core::RobotState(*start_state)));
+        pending.push_back(i);
+      }
+      pending_condition.notify_one();
+    }
+  };
+
+  // The pool hands out the indices in order, so the solver (index 0) always starts before any validator waits for it,
+  // also when the pool is busy and runs all indices on this thread.
+  WorkerPool::getShared().run(thread_count + 1, [&](std::size_t index) {
+    if (index > 0)
+    {
+      validate();
+      return;
+    }
+    try
+    {
+      solve();
+    }
+    catch (...)
+    {
+      finish_solving();
+      throw;
+    }
+    finish_solving();
+  });
+
+  // as in sequential mode, leave the state at the last attempted waypoint
+  if (first_invalid < solved.size())
+    *start_state = *solved[first_invalid];
+
+  const std::size_t num_valid = std::min(solved.size(), first_invalid);
+  traj.insert(traj.end(), solved.begin(), solved.begin() + num_valid);
+  return num_valid;
+}
+}  // namespace
+
 double CartesianInterpolator::computeCartesianPath(RobotState* start_state, const JointModelGroup* group,
                                                    std::vector<RobotStatePtr>& traj, const LinkModel* link,
                                                    const Eigen::Vector3d& direction, bool global_reference_frame,
                                                    double distance, const MaxEEFStep& max_step,
                                                    const JumpThreshold& jump_threshold,
                                                    const GroupStateValidityCallbackFn& validCallback,
-                                                   const kinematics::KinematicsQueryOptions& options)
+                                                   const kinematics::KinematicsQueryOptions& options,
+                                                   unsigned int validation_thread_count)
 {
   // this is the Cartesian pose we start from, and have to move in the direction indicated
   // getGlobalLinkTransform() returns a valid isometry by contract
@@ -72,7 +185,7 @@ double CartesianInterpolator::computeCartesianPath(RobotState* start_state, cons
 
   // call computeCartesianPath for the computed target pose in the global reference frame
   return (distance * computeCartesianPath(start_state, group, traj, link, target_pose, true, max_step, jump_threshold,
-                                          validCallback, options));
+                                          validCallback, options, validation_thread_count));
 }
 
 double CartesianInterpolator::computeCartesianPath(RobotState* start_state, const JointModelGroup* group,
@@ -80,7 +193,8 @@ double CartesianInterpolator::computeCartesianPath(RobotState* start_state, cons
                                                    const Eigen::Isometry3d& target, bool global_reference_frame,
                                                    const MaxEEFStep& max_step, const JumpThreshold& jump_threshold,
                                                    const GroupStateValidityCallbackFn& validCallback,
-                                                   const kinematics::KinematicsQueryOptions& options)
+                                                   const kinematics::KinematicsQueryOptions& options,
+                                                   unsigned int validation_thread_count)
 {
   const std::vector<const JointModel*>& cjnt = group->getContinuousJointModels();
   // make sure that continuous joints wrap
@@ -149,22 +263,44 @@ double CartesianInterpolator::computeCartesianPath(RobotState* start_state, cons
   traj.clear();
   traj.push_back(RobotStatePtr(new moveit::core::RobotState(*start_state)));
 
-  double last_valid_percentage = 0.0;
-  for (std::size_t i = 1; i <= steps; ++i)
-  {
-    double percentage = (double)i / (double)steps;
-
+  auto interpolate = [&](double percentage) {
     Eigen::Isometry3d pose(start_quaternion.slerp(percentage, target_quaternion));
     pose.translation() = percentage * rotated_target.translation() + (1 - percentage) * start_pose.translation();
+    return pose;
+  };
 
-    // Explicitly use a single IK attempt only: We want a smooth trajectory.
-    // Random seeding (of additional attempts) would probably create IK jumps.
-    if (start_state->setFromIK(group, pose, link->getName(), consistency_limits, 0.0, validCallback, options))
-      traj.push_back(RobotStatePtr(new moveit::core::RobotState(*start_state)));
-    else
-      break;
+  double last_valid_percentage = 0.0;
+  if (validCallback && validation_thread_count != 1)
+  {
+    // interpolate all poses up front, so IK can run ahead of validation
+    EigenSTL::vector_Isometry3d poses;
+    poses.reserve(steps);
+    for (std::size_t i = 1; i <= steps; ++i)
+      poses.push_back(interpolate((double)i / (double)steps));
+
+    const unsigned int thread_count = validation_thread_count > 0 ?
+                                          validation_thread_count :
+                                          std::max(1u, std::thread::hardware_concurrency());
+    std::size_t num_valid = solveAndValidatePipelined(start_state, group, link, poses, consistency_limits,
+                                                      validCallback, options, thread_count, traj);
+    last_valid_percentage = (double)num_valid / (double)steps;
+  }
+  else
+  {
+    for (std::size_t i = 1; i <= steps; ++i)
+    {
+      double percentage = (double)i / (double)steps;
+      Eigen::Isometry3d pose = interpolate(percentage);
 
-    last_valid_percentage = percentage;
+      // Explicitly use a single IK attempt only: We want a smooth trajectory.
+      // Random seeding (of additional attempts) would probably create IK jumps.
+      if (start_state->setFromIK(group, pose, link->getName(), consistency_limits, 0.0, validCallback, options))
+        traj.push_back(RobotStatePtr(new moveit::core::RobotState(*start_state)));
+      else
+        break;
+
+      last_valid_percentage = percentage;
+    }
   }
 
   last_valid_percentage *= checkJointSpaceJump(group, traj, jump_threshold);
@@ -178,7 +314,8 @@ double CartesianInterpolator::computeCartesianPath(RobotState* start_state, cons
                                                    bool global_reference_frame, const MaxEEFStep& max_step,
                                                    const JumpThreshold& jump_threshold,
                                                    const GroupStateValidityCallbackFn& validCallback,
-                                                   const kinematics::KinematicsQueryOptions& options)
+                                                   const kinematics::KinematicsQueryOptions& options,
+                                                   unsigned int validation_thread_count)
 {
   double percentage_solved = 0.0;
   for (std::size_t i = 0; i < waypoints.size(); ++i)
@@ -188,7 +325,7 @@ double CartesianInterpolator::computeCartesianPath(RobotState* start_state, cons
     std::vector<RobotStatePtr> waypoint_traj;
     double wp_percentage_solved =
         computeCartesianPath(start_state, group, waypoint_traj, link, waypoints[i], global_reference_frame, max_step,
-                             NO_JOINT_SPACE_JUMP_TEST, validCallback, options);
+                             NO_JOINT_SPACE_JUMP_TEST, validCallback, options, validation_thread_count);
     if (fabs(wp_percentage_solved - 1.0) < std::numeric_limits<double>::epsilon())
     {
       percentage_solved = (double)(i + 1) / (double)waypoints.size();
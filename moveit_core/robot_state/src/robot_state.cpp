@@ -140,6 +140,15 @@ RobotState& RobotState::operator=(const RobotState& other)
   return *this;
 }
 
+void RobotState::assignFrom(const RobotState& other)
+{
+  if (robot_model_ != other.robot_model_)
+    throw Exception("Cannot assign a RobotState of robot model '" + other.robot_model_->getName() +
+                    "' to a RobotState of robot model '" + robot_model_->getName() + "'");
+  if (this != &other)
+    copyFrom(other);
+}
+
 void RobotState::copyFrom(const RobotState& other)
 {
   has_velocity_ = other.has_velocity_;
@@ -1266,7 +1275,8 @@ bool RobotState::getJacobian(const JointModelGroup* group, const LinkModel* link
     return false;
   }
 
-  if (!group->isLinkUpdated(link->getName()))
+  const JointModelGroup::CompiledKinematics& kinematics = group->getCompiledKinematics();
+  if (kinematics.getSlot(link) < 0)
   {
     RCLCPP_ERROR(LOGGER, "Link name '%s' does not exist in the chain '%s' or is not a child for this chain",
                  link->getName().c_str(), group->getName().c_str());
@@ -1296,55 +1306,39 @@ bool RobotState::getJacobian(const JointModelGroup* group, const LinkModel* link
   Eigen::Vector3d joint_axis;
   Eigen::Isometry3d joint_transform;
 
-  while (link)
-  {
-    /*
-    RCLCPP_DEBUG(LOGGER, "Link: %s, %f %f %f",link_state->getName().c_str(),
-             link_state->getGlobalLinkTransform().translation().x(),
-             link_state->getGlobalLinkTransform().translation().y(),
-             link_state->getGlobalLinkTransform().translation().z());
-    RCLCPP_DEBUG(LOGGER, "Joint: %s",link_state->getParentJointState()->getName().c_str());
-    */
-    const JointModel* pjm = link->getParentJointModel();
-    if (pjm->getVariableCount() > 0)
+  // walk from the link towards the root of the group, using the flattened description of the group's links
+  for (int slot = kinematics.getSlot(link); slot >= 0; slot = kinematics.parent_slots[slot])
+  {
+    const int joint_index = kinematics.group_variable_indices[slot];
+    if (joint_index < 0)
+      continue;
+
+    // global link transforms are valid isometries by contract
+    joint_transform = reference_transform * global_link_transforms_[kinematics.link_indices[slot]];
+    switch (kinematics.joint_types[slot])
     {
-      if (!group->hasJointModel(pjm->getName()))
-      {
-        link = pjm->getParentLinkModel();
-        continue;
-      }
-      unsigned int joint_index = group->getVariableGroupIndex(pjm->getName());
-      // getGlobalLinkTransform() returns a valid isometry by contract
-      joint_transform = reference_transform * getGlobalLinkTransform(link);  // valid isometry
-      if (pjm->getType() == moveit::core::JointModel::REVOLUTE)
-      {
-        joint_axis = joint_transform.linear() * static_cast<const moveit::core::RevoluteJointModel*>(pjm)->getAxis();
-        jacobian.block<3, 1>(0, joint_index) =
-            jacobian.block<3, 1>(0, joint_index) + joint_axis.cross(point_transform - joint_transform.translation());
-        jacobian.block<3, 1>(3, joint_index) = jacobian.block<3, 1>(3, joint_index) + joint_axis;
-      }
-      else if (pjm->getType() == moveit::core::JointModel::PRISMATIC)
-      {
-        joint_axis = joint_transform.linear() * static_cast<const moveit::core::PrismaticJointModel*>(pjm)->getAxis();
-        jacobian.block<3, 1>(0, joint_index) = jacobian.block<3, 1>(0, joint_index) + joint_axis;
-      }
-      else if (pjm->getType() == moveit::core::JointModel::PLANAR)
-      {
+      case JointModel::REVOLUTE:
+        joint_axis = joint_transform.linear() * kinematics.joint_axes[slot];
+        jacobian.block<3, 1>(0, joint_index) += joint_axis.cross(point_transform - joint_transform.translation());
+        jacobian.block<3, 1>(3, joint_index) += joint_axis;
+        break;
+      case JointModel::PRISMATIC:
+        joint_axis = joint_transform.linear() * kinematics.joint_axes[slot];
+        jacobian.block<3, 1>(0, joint_index) += joint_axis;
+        break;
+      case JointModel::PLANAR:
         joint_axis = joint_transform * Eigen::Vector3d(1.0, 0.0, 0.0);
-        jacobian.block<3, 1>(0, joint_index) = jacobian.block<3, 1>(0, joint_index) + joint_axis;
+        jacobian.block<3, 1>(0, joint_index) += joint_axis;
         joint_axis = joint_transform * Eigen::Vector3d(0.0, 1.0, 0.0);
-        jacobian.block<3, 1>(0, joint_index + 1) = jacobian.block<3, 1>(0, joint_index + 1) + joint_axis;
+        jacobian.block<3, 1>(0, joint_index + 1) += joint_axis;
         joint_axis = joint_transform * Eigen::Vector3d(0.0, 0.0, 1.0);
-        jacobian.block<3, 1>(0, joint_index + 2) = jacobian.block<3, 1>(0, joint_index + 2) +
-                                                   joint_axis.cross(point_transform - joint_transform.translation());
-        jacobian.block<3, 1>(3, joint_index + 2) = jacobian.block<3, 1>(3, joint_index + 2) + joint_axis;
-      }
-      else
+        jacobian.block<3, 1>(0, joint_index + 2) += joint_axis.cross(point_transform - joint_transform.translation());
+        jacobian.block<3, 1>(3, joint_index + 2) += joint_axis;
+        break;
+      default:
         RCLCPP_ERROR(LOGGER, "Unknown type of joint in Jacobian computation");
+        break;
     }
-    if (pjm == root_joint_model)
-      break;
-    link = pjm->getParentLinkModel();
   }
   if (use_quaternion_representation)
   {  // Quaternion representation
@@ -0,0 +1,142 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/robot_state/robot_state_pool.h>
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+namespace moveit
+{
+namespace core
+{
+namespace
+{
+std::size_t getThreadHash()
+{
+  static thread_local const std::size_t THREAD_HASH = std::hash<std::thread::id>()(std::this_thread::get_id());
+  return THREAD_HASH;
+}
+}  // namespace
+
+RobotStatePool::RobotStatePool(const RobotModelConstPtr& robot_model, std::size_t max_free_states)
+  : robot_model_(robot_model)
+  // never more free lists than states to keep, so the per-list capacities add up to at most max_free_states
+  , free_list_count_(std::max<std::size_t>(
+        1, std::min<std::size_t>(2 * std::thread::hardware_concurrency(), max_free_states)))
+  , max_states_per_free_list_(max_free_states / free_list_count_)
+  , free_lists_(new FreeList[free_list_count_])
+{
+  if (robot_model == nullptr)
+    throw std::invalid_argument("RobotStatePool cannot be constructed with nullptr RobotModelConstPtr");
+
+  // reserve the free lists up front, so returning a state to the pool never allocates
+  for (std::size_t i = 0; i < free_list_count_; ++i)
+    free_lists_[i].states.reserve(max_states_per_free_list_);
+}
+
+RobotStatePool::~RobotStatePool()
+{
+  for (std::size_t i = 0; i < free_list_count_; ++i)
+    for (RobotState* state : free_lists_[i].states)
+      delete state;
+}
+
+RobotStatePool::FreeList& RobotStatePool::getFreeList()
+{
+  return free_lists_[getThreadHash() % free_list_count_];
+}
+
+RobotStatePool::PooledRobotStatePtr RobotStatePool::acquire()
+{
+  RobotState* state = nullptr;
+  FreeList& free_list = getFreeList();
+  {
+    std::lock_guard<std::mutex> lock(free_list.lock);
+    if (!free_list.states.empty())
+    {
+      state = free_list.states.back();
+      free_list.states.pop_back();
+    }
+  }
+  if (!state)
+    state = new RobotState(robot_model_);
+  return PooledRobotStatePtr(state, Releaser{ this });
+}
+
+RobotStatePool::PooledRobotStatePtr RobotStatePool::acquire(const RobotState& other)
+{
+  PooledRobotStatePtr state = acquire();
+  state->assignFrom(other);
+  return state;
+}
+
+void RobotStatePool::reserve(std::size_t count)
+{
+  FreeList& free_list = getFreeList();
+  std::lock_guard<std::mutex> lock(free_list.lock);
+  while (free_list.states.size() < std::min(count, max_states_per_free_list_))
+    free_list.states.push_back(new RobotState(robot_model_));
+}
+
+std::size_t RobotStatePool::getFreeStateCount() const
+{
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < free_list_count_; ++i)
+  {
+    std::lock_guard<std::mutex> lock(free_lists_[i].lock);
+    count += free_lists_[i].states.size();
+  }
+  return count;
+}
+
+void RobotStatePool::release(RobotState* state)
+{
+  // attached bodies hold their own memory and may not be wanted by the next user
+  state->clearAttachedBodies();
+  state->setAttachedBodyUpdateCallback(AttachedBodyCallback());
+
+  FreeList& free_list = getFreeList();
+  {
+    std::lock_guard<std::mutex> lock(free_list.lock);
+    if (free_list.states.size() < max_states_per_free_list_)
+    {
+      free_list.states.push_back(state);
+      return;
+    }
+  }
+  delete state;
+}
+}  // namespace core
+}  // namespace moveit
@@ -106,6 +106,50 @@ TEST_F(Timing, stateUpdate)
   }
 }
 
+TEST_F(Timing, batchLinkTransforms)
+{
+  moveit::core::RobotModelPtr model = moveit::core::loadTestingRobotModel("pr2");
+  ASSERT_TRUE(bool(model));
+  const moveit::core::JointModelGroup* group = model->getJointModelGroup("right_arm");
+  ASSERT_TRUE(group);
+
+  moveit::core::RobotState state(model);
+  state.setToDefaultValues();
+  state.update();
+
+  const size_t batch_size = 1000;
+  const size_t runs = 100;
+  Eigen::MatrixXd values(group->getVariableCount(), batch_size);
+  {
+    moveit::core::RobotState sample(state);
+    Eigen::VectorXd group_values;
+    for (size_t k = 0; k < batch_size; ++k)
+    {
+      sample.setToRandomPositions(group);
+      sample.copyJointGroupPositions(group, group_values);
+      values.col(k) = group_values;
+    }
+  }
+
+  double gold_standard = 0;
+  {
+    moveit::core::RobotState sample(state);
+    ScopedTimer t("Sequential link transform updates: ", &gold_standard);
+    for (size_t i = 0; i < runs; ++i)
+      for (size_t k = 0; k < batch_size; ++k)
+      {
+        sample.setJointGroupPositions(group, values.col(k));
+        sample.updateLinkTransforms();
+      }
+  }
+  {
+    moveit::core::BatchLinkTransforms batch;
+    ScopedTimer t("Batched link transform updates: ", &gold_standard);
+    for (size_t i = 0; i < runs; ++i)
+      state.computeBatchLinkTransforms(group, values, batch);
+  }
+}
+
 TEST_F(Timing, multiply)
 {
   size_t runs = 1e7;
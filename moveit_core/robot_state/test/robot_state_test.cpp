@@ -35,6 +35,7 @@
 /* Author: Ioan Sucan */
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_state/robot_state_pool.h>
 #include <moveit/utils/robot_model_test_utils.h>
 #include <urdf_parser/urdf_parser.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
@@ -42,6 +43,8 @@
 #include <sstream>
 #include <algorithm>
 #include <ctype.h>
+#include <thread>
+#include <vector>
 
 static bool sameStringIgnoringWS(const std::string& s1, const std::string& s2)
 {
@@ -84,6 +87,62 @@ static void expect_near(const Eigen::MatrixXd& x, const Eigen::MatrixXd& y,
 }
 // clang-format on
 
+// Global transform of a link, computed by following the parent links and joints of the model
+static Eigen::Isometry3d referenceLinkTransform(const moveit::core::RobotState& state,
+                                                const moveit::core::LinkModel* link)
+{
+  const moveit::core::JointModel* joint = link->getParentJointModel();
+  Eigen::Isometry3d joint_transform = Eigen::Isometry3d::Identity();
+  if (joint->getVariableCount() > 0)
+    joint->computeTransform(state.getJointPositions(joint), joint_transform);
+  const Eigen::Isometry3d parent_transform = link->getParentLinkModel() ?
+                                                 referenceLinkTransform(state, link->getParentLinkModel()) :
+                                                 Eigen::Isometry3d::Identity();
+  return parent_transform * link->getJointOriginTransform() * joint_transform;
+}
+
+// Jacobian at the origin of a link, computed by following the parent links and joints of the model and looking up
+// the group variables by joint name
+static Eigen::MatrixXd referenceJacobian(const moveit::core::RobotState& state,
+                                         const moveit::core::JointModelGroup* group,
+                                         const moveit::core::LinkModel* link)
+{
+  const moveit::core::JointModel* root_joint_model = group->getJointModels()[0];
+  const moveit::core::LinkModel* root_link_model = root_joint_model->getParentLinkModel();
+  const Eigen::Isometry3d reference_transform = root_link_model ?
+                                                    referenceLinkTransform(state, root_link_model).inverse() :
+                                                    Eigen::Isometry3d::Identity();
+  const Eigen::Vector3d point = (reference_transform * referenceLinkTransform(state, link)).translation();
+
+  Eigen::MatrixXd jacobian = Eigen::MatrixXd::Zero(6, group->getVariableCount());
+  while (link)
+  {
+    const moveit::core::JointModel* joint = link->getParentJointModel();
+    if (joint->getVariableCount() > 0 && group->hasJointModel(joint->getName()))
+    {
+      const int index = group->getVariableGroupIndex(joint->getName());
+      const Eigen::Isometry3d joint_transform = reference_transform * referenceLinkTransform(state, link);
+      if (joint->getType() == moveit::core::JointModel::REVOLUTE)
+      {
+        const Eigen::Vector3d axis =
+            joint_transform.linear() * static_cast<const moveit::core::RevoluteJointModel*>(joint)->getAxis();
+        jacobian.block<3, 1>(0, index) += axis.cross(point - joint_transform.translation());
+        jacobian.block<3, 1>(3, index) += axis;
+      }
+      else if (joint->getType() == moveit::core::JointModel::PRISMATIC)
+      {
+        const Eigen::Vector3d axis =
+            joint_transform.linear() * static_cast<const moveit::core::PrismaticJointModel*>(joint)->getAxis();
+        jacobian.block<3, 1>(0, index) += axis;
+      }
+    }
+    if (joint == root_joint_model)
+      break;
+    link = joint->getParentLinkModel();
+  }
+  return jacobian;
+}
+
 TEST(Loading, SimpleRobot)
 {
   moveit::core::RobotModelBuilder builder("myrobot", "base_link");
@@ -539,6 +598,168 @@ TEST_F(OneRobot, FK)
   EXPECT_NEAR_TRACED(state.getGlobalLinkTransform("link_e").translation(), Eigen::Vector3d(2.8, 0.6, 0));
 }
 
+TEST_F(OneRobot, batchLinkTransforms)
+{
+  moveit::core::RobotState state(robot_model_);
+  state.setToRandomPositions();
+  state.update();
+
+  moveit::core::BatchLinkTransforms batch;
+  for (const char* group_name : { "base_from_joints", "mim_joints", "base_from_base_to_e" })
+  {
+    SCOPED_TRACE(group_name);
+    const moveit::core::JointModelGroup* group = robot_model_->getJointModelGroup(group_name);
+    ASSERT_TRUE(group);
+
+    const std::size_t n = 17;
+    Eigen::MatrixXd values(group->getVariableCount(), n);
+    moveit::core::RobotState sample(state);
+    for (std::size_t k = 0; k < n; ++k)
+    {
+      sample.setToRandomPositions(group);
+      Eigen::VectorXd group_values;
+      sample.copyJointGroupPositions(group, group_values);
+      values.col(k) = group_values;
+    }
+
+    state.computeBatchLinkTransforms(group, values, batch);
+    ASSERT_EQ(batch.getStateCount(), n);
+    ASSERT_EQ(batch.getLinkModels().size(), group->getUpdatedLinkModels().size());
+
+    for (std::size_t k = 0; k < n; ++k)
+    {
+      sample = state;
+      sample.setJointGroupPositions(group, values.col(k));
+      sample.update();
+      for (const moveit::core::LinkModel* link : batch.getLinkModels())
+      {
+        const Eigen::Isometry3d& expected = sample.getGlobalLinkTransform(link);
+        EXPECT_LT((batch.getGlobalLinkTransform(link, k).matrix() - expected.matrix()).norm(), 1e-10)
+            << link->getName() << " in state " << k;
+        EXPECT_NEAR(batch.getComponentData(link, 9)[k], expected.translation().x(), 1e-10);
+      }
+    }
+
+    // links that are not updated by the group have no data
+    for (const moveit::core::LinkModel* link : robot_model_->getLinkModels())
+    {
+      if (batch.hasLinkModel(link))
+        EXPECT_TRUE(batch.getComponentData(link, 0) != nullptr) << link->getName();
+      else
+        EXPECT_TRUE(batch.getComponentData(link, 0) == nullptr) << link->getName();
+    }
+  }
+}
+
+TEST(CompiledKinematics, MixedChain)
+{
+  moveit::core::RobotModelBuilder builder("mixed_chain", "base_link");
+  geometry_msgs::msg::Pose origin;
+  tf2::Quaternion q;
+  auto set_origin = [&](double x, double y, double z, double roll, double pitch, double yaw) {
+    origin.position.x = x;
+    origin.position.y = y;
+    origin.position.z = z;
+    q.setRPY(roll, pitch, yaw);
+    origin.orientation = tf2::toMsg(q);
+  };
+  set_origin(0.1, 0.0, 0.3, 0.0, 0.0, 0.2);
+  builder.addChain("base_link->link_a", "revolute", { origin }, urdf::Vector3(0.0, 0.0, 1.0));
+  set_origin(0.0, 0.2, 0.1, 0.3, 0.0, 0.0);
+  builder.addChain("link_a->link_b", "prismatic", { origin }, urdf::Vector3(1.0, 0.0, 0.0));
+  set_origin(0.4, 0.0, 0.0, 0.0, 0.5, 0.0);
+  builder.addChain("link_b->link_c", "fixed", { origin });
+  set_origin(0.0, 0.0, 0.5, 0.1, 0.2, 0.3);
+  builder.addChain("link_c->link_d", "continuous", { origin }, urdf::Vector3(0.0, 1.0, 0.0));
+  set_origin(0.3, -0.1, 0.0, 0.0, 0.0, -0.4);
+  builder.addChain("link_d->link_e", "prismatic", { origin }, urdf::Vector3(0.0, 0.0, 1.0));
+  set_origin(0.0, 0.0, 0.2, 0.0, 0.0, 0.0);
+  builder.addChain("link_e->tip", "fixed", { origin });
+  builder.addGroupChain("base_link", "tip", "arm");
+  ASSERT_TRUE(builder.isValid());
+  moveit::core::RobotModelPtr model = builder.build();
+
+  const moveit::core::JointModelGroup* group = model->getJointModelGroup("arm");
+  ASSERT_TRUE(group);
+  ASSERT_TRUE(group->isChain());
+  ASSERT_EQ(group->getVariableCount(), 4u);
+
+  moveit::core::RobotState state(model);
+  const std::size_t n = 9;
+  Eigen::MatrixXd values(group->getVariableCount(), n);
+  for (std::size_t k = 0; k < n; ++k)
+  {
+    state.setToRandomPositions(group);
+    Eigen::VectorXd group_values;
+    state.copyJointGroupPositions(group, group_values);
+    values.col(k) = group_values;
+  }
+
+  moveit::core::BatchLinkTransforms batch;
+  state.computeBatchLinkTransforms(group, values, batch);
+  ASSERT_EQ(batch.getStateCount(), n);
+
+  for (std::size_t k = 0; k < n; ++k)
+  {
+    state.setJointGroupPositions(group, values.col(k));
+    state.update();
+    for (const moveit::core::LinkModel* link : group->getUpdatedLinkModels())
+    {
+      SCOPED_TRACE(link->getName() + " in state " + std::to_string(k));
+      const Eigen::Isometry3d expected = referenceLinkTransform(state, link);
+      EXPECT_NEAR_TRACED(state.getGlobalLinkTransform(link).matrix(), expected.matrix(), 1e-10);
+      EXPECT_NEAR_TRACED(batch.getGlobalLinkTransform(link, k).matrix(), expected.matrix(), 1e-10);
+
+      Eigen::MatrixXd jacobian;
+      ASSERT_TRUE(state.getJacobian(group, link, Eigen::Vector3d::Zero(), jacobian));
+      EXPECT_NEAR_TRACED(jacobian, referenceJacobian(state, group, link), 1e-10);
+    }
+  }
+}
+
+TEST_F(OneRobot, robotStatePool)
+{
+  moveit::core::RobotState state(robot_model_);
+  state.setToRandomPositions();
+
+  moveit::core::RobotStatePool pool(robot_model_, 1);
+  pool.reserve(1);
+  EXPECT_EQ(pool.getFreeStateCount(), 1u);
+
+  const moveit::core::RobotState* reused;
+  {
+    moveit::core::RobotStatePool::PooledRobotStatePtr pooled = pool.acquire(state);
+    EXPECT_EQ(pool.getFreeStateCount(), 0u);
+    reused = pooled.get();
+    for (std::size_t i = 0; i < robot_model_->getVariableCount(); ++i)
+      EXPECT_EQ(pooled->getVariablePosition(i), state.getVariablePosition(i));
+  }
+  // the released state is handed out again instead of allocating a new one
+  EXPECT_EQ(pool.getFreeStateCount(), 1u);
+  moveit::core::RobotStatePool::PooledRobotStatePtr pooled = pool.acquire();
+  EXPECT_EQ(pooled.get(), reused);
+
+  // states beyond the capacity of the pool are freed on release
+  pool.acquire().reset();
+  EXPECT_EQ(pool.getFreeStateCount(), 1u);
+  pooled.reset();
+  EXPECT_EQ(pool.getFreeStateCount(), 1u);
+
+  // states released by many threads never exceed the capacity of the pool
+  moveit::core::RobotStatePool small_pool(robot_model_, 3);
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < 8; ++i)
+    threads.emplace_back([&small_pool] {
+      std::vector<moveit::core::RobotStatePool::PooledRobotStatePtr> states;
+      for (std::size_t j = 0; j < 4; ++j)
+        states.push_back(small_pool.acquire());
+    });
+  for (std::thread& thread : threads)
+    thread.join();
+  EXPECT_GT(small_pool.getFreeStateCount(), 0u);
+  EXPECT_LE(small_pool.getFreeStateCount(), 3u);
+}
+
 TEST_F(OneRobot, testPrintCurrentPositionWithJointLimits)
 {
   moveit::core::RobotState state(robot_model_);
@@ -37,6 +37,7 @@
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/robot_state/cartesian_interpolator.h>
+#include <moveit/kinematics_base/kinematics_base.h>
 #include <moveit/utils/robot_model_test_utils.h>
 
 #include <urdf_parser/urdf_parser.h>
@@ -384,6 +385,143 @@ TEST_F(OneRobot, checkRelativeJointSpaceJump)
   EXPECT_NEAR(1.0, fraction, 0.01);
 }
 
+/** \brief IK solver for a chain of x/y/z prismatic joints: the solution is the position of the target */
+class PrismaticXYZKinematics : public kinematics::KinematicsBase
+{
+public:
+  PrismaticXYZKinematics(const moveit::core::RobotModel& robot_model, const std::string& group)
+  {
+    storeValues(robot_model, group, "base_link", { "tip" }, 0.0);
+  }
+
+  bool getPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& /*ik_seed_state*/,
+                     std::vector<double>& solution, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                     const kinematics::KinematicsQueryOptions& /*options*/) const override
+  {
+    solution = { ik_pose.position.x, ik_pose.position.y, ik_pose.position.z };
+    error_code.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+    return true;
+  }
+
+  bool searchPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                        double /*timeout*/, std::vector<double>& solution,
+                        moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options) const override
+  {
+    return getPositionIK(ik_pose, ik_seed_state, solution, error_code, options);
+  }
+
+  bool searchPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                        double timeout, const std::vector<double>& /*consistency_limits*/,
+                        std::vector<double>& solution, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options) const override
+  {
+    return searchPositionIK(ik_pose, ik_seed_state, timeout, solution, error_code, options);
+  }
+
+  bool searchPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                        double /*timeout*/, std::vector<double>& solution, const IKCallbackFn& solution_callback,
+                        moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options) const override
+  {
+    getPositionIK(ik_pose, ik_seed_state, solution, error_code, options);
+    if (solution_callback)
+      solution_callback(ik_pose, solution, error_code);
+    return error_code.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+  }
+
+  bool searchPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                        double timeout, const std::vector<double>& /*consistency_limits*/,
+                        std::vector<double>& solution, const IKCallbackFn& solution_callback,
+                        moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options) const override
+  {
+    return searchPositionIK(ik_pose, ik_seed_state, timeout, solution, solution_callback, error_code, options);
+  }
+
+  bool getPositionFK(const std::vector<std::string>& /*link_names*/, const std::vector<double>& joint_angles,
+                     std::vector<geometry_msgs::msg::Pose>& poses) const override
+  {
+    poses.resize(1);
+    poses[0].position.x = joint_angles[0];
+    poses[0].position.y = joint_angles[1];
+    poses[0].position.z = joint_angles[2];
+    poses[0].orientation.w = 1.0;
+    return true;
+  }
+
+  const std::vector<std::string>& getJointNames() const override
+  {
+    return joint_names_;
+  }
+
+  const std::vector<std::string>& getLinkNames() const override
+  {
+    return tip_frames_;
+  }
+
+private:
+  std::vector<std::string> joint_names_{ "base_link-link_x-joint", "link_x-link_y-joint", "link_y-tip-joint" };
+};
+
+TEST(CartesianInterpolator, pipelinedValidationMatchesSequential)
+{
+  moveit::core::RobotModelBuilder builder("xyz_robot", "base_link");
+  builder.addChain("base_link->link_x", "prismatic", {}, urdf::Vector3(1.0, 0.0, 0.0));
+  builder.addChain("link_x->link_y", "prismatic", {}, urdf::Vector3(0.0, 1.0, 0.0));
+  builder.addChain("link_y->tip", "prismatic", {}, urdf::Vector3(0.0, 0.0, 1.0));
+  builder.addGroupChain("base_link", "tip", "group");
+  ASSERT_TRUE(builder.isValid());
+  moveit::core::RobotModelPtr robot_model = builder.build();
+
+  const std::map<std::string, moveit::core::SolverAllocatorFn> allocators = {
+    { "group", [&robot_model](const moveit::core::JointModelGroup* /*jmg*/) {
+        return std::make_shared<PrismaticXYZKinematics>(*robot_model, "group");
+      } }
+  };
+  robot_model->setKinematicsAllocators(allocators);
+  const moveit::core::JointModelGroup* group = robot_model->getJointModelGroup("group");
+  const moveit::core::LinkModel* tip = robot_model->getLinkModel("tip");
+  ASSERT_TRUE(group->getSolverInstance());
+
+  // states beyond x = 0.5 are invalid
+  const moveit::core::GroupStateValidityCallbackFn valid = [](moveit::core::RobotState* state,
+                                                              const moveit::core::JointModelGroup* /*jmg*/,
+                                                              const double* joint_group_variable_values) {
+    state->setJointGroupPositions("group", joint_group_variable_values);
+    return joint_group_variable_values[0] <= 0.5;
+  };
+
+  for (double distance : { 0.4, 1.0 })
+  {
+    std::vector<std::vector<moveit::core::RobotStatePtr>> trajs(2);
+    std::vector<double> distances;
+    std::vector<moveit::core::RobotState> end_states;
+    for (unsigned int threads : { 1u, 4u })
+    {
+      moveit::core::RobotState state(robot_model);
+      state.setToDefaultValues();
+      state.update();
+      distances.push_back(moveit::core::CartesianInterpolator::computeCartesianPath(
+          &state, group, trajs[distances.size()], tip, Eigen::Vector3d(1.0, 0.0, 0.0), true, distance,
+          moveit::core::MaxEEFStep(0.01), moveit::core::JumpThreshold(), valid, kinematics::KinematicsQueryOptions(),
+          threads));
+      end_states.push_back(state);
+    }
+
+    // the direction overload returns the distance travelled
+    EXPECT_NEAR(distances[0], std::min(distance, 0.5), 0.02);
+    EXPECT_DOUBLE_EQ(distances[0], distances[1]);
+    ASSERT_EQ(trajs[0].size(), trajs[1].size());
+    for (std::size_t i = 0; i < trajs[0].size(); ++i)
+    {
+      EXPECT_LE(trajs[1][i]->getVariablePosition(0), 0.5);
+      EXPECT_NEAR(trajs[0][i]->getVariablePosition(0), trajs[1][i]->getVariablePosition(0), 1e-9);
+    }
+    EXPECT_NEAR(end_states[0].getVariablePosition(0), end_states[1].getVariablePosition(0), 1e-9);
+  }
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
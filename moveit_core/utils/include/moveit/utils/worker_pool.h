@@ -0,0 +1,104 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+/** \brief A fixed set of worker threads that is kept alive to run parallel sections without creating threads each time.
+
+    run() executes a task once for each index of a section, on the calling thread and the idle workers. Only one
+    section runs on the workers at a time; a section started while the workers are busy, e.g. from another thread,
+    runs all its indices on its calling thread, so run() never waits for another section to finish. */
+class WorkerPool
+{
+public:
+  /** \brief Start \e worker_count threads. Together with the calling thread, sections of up to worker_count + 1
+      indices run fully in parallel. */
+  explicit WorkerPool(std::size_t worker_count);
+
+  /** \brief Stop and join the workers */
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  /** \brief A pool with one worker less than the number of hardware threads, created on first use. It is meant for
+      parallel sections of code that has no natural owner for a pool of its own, e.g. static functions. */
+  static WorkerPool& getShared();
+
+  std::size_t getWorkerCount() const
+  {
+    return workers_.size();
+  }
+
+  /** \brief Call task(i) exactly once for every i in [0, count) and return when all calls are done. The first
+      exception thrown by a call is rethrown after the remaining calls have finished. */
+  void run(std::size_t count, const std::function<void(std::size_t)>& task);
+
+private:
+  void workerLoop();
+
+  /** \brief Take and run indices of the current section until none are left */
+  void work();
+
+  std::vector<std::thread> workers_;
+
+  /** \brief Held by the thread whose section runs on the workers */
+  std::mutex run_lock_;
+
+  /** \brief Protects the section state below */
+  std::mutex lock_;
+  std::condition_variable start_condition_;
+  std::condition_variable done_condition_;
+  bool stop_ = false;
+  std::size_t generation_ = 0;
+  const std::function<void(std::size_t)>* task_ = nullptr;
+  std::size_t count_ = 0;
+  std::size_t next_index_ = 0;
+  std::size_t active_workers_ = 0;
+  std::exception_ptr exception_;
+};
+}  // namespace core
+}  // namespace moveit
@@ -0,0 +1,144 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/utils/worker_pool.h>
+#include <algorithm>
+
+namespace moveit
+{
+namespace core
+{
+WorkerPool::WorkerPool(std::size_t worker_count)
+{
+  workers_.reserve(worker_count);
+  for (std::size_t i = 0; i < worker_count; ++i)
+    workers_.emplace_back(&WorkerPool::workerLoop, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    stop_ = true;
+  }
+  start_condition_.notify_all();
+  for (std::thread& worker : workers_)
+    worker.join();
+}
+
+WorkerPool& WorkerPool::getShared()
+{
+  static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+  return pool;
+}
+
+void WorkerPool::run(std::size_t count, const std::function<void(std::size_t)>& task)
+{
+  std::unique_lock<std::mutex> run_lock(run_lock_, std::try_to_lock);
+  if (!run_lock.owns_lock() || workers_.empty() || count < 2)
+  {
+    // the workers are busy with another section or not needed
+    for (std::size_t i = 0; i < count; ++i)
+      task(i);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    task_ = &task;
+    count_ = count;
+    next_index_ = 0;
+    exception_ = nullptr;
+    ++generation_;
+  }
+  start_condition_.notify_all();
+
+  work();
+
+  std::unique_lock<std::mutex> lock(lock_);
+  done_condition_.wait(lock, [this] { return active_workers_ == 0 && next_index_ >= count_; });
+  task_ = nullptr;
+  if (exception_)
+  {
+    std::exception_ptr exception = exception_;
+    exception_ = nullptr;
+    std::rethrow_exception(exception);
+  }
+}
+
+void WorkerPool::work()
+{
+  std::unique_lock<std::mutex> lock(lock_);
+  while (next_index_ < count_)
+  {
+    const std::size_t index = next_index_++;
+    lock.unlock();
+    try
+    {
+      (*task_)(index);
+    }
+    catch (...)
+    {
+      lock.lock();
+      if (!exception_)
+        exception_ = std::current_exception();
+      continue;
+    }
+    lock.lock();
+  }
+}
+
+void WorkerPool::workerLoop()
+{
+  std::size_t generation = 0;
+  std::unique_lock<std::mutex> lock(lock_);
+  while (true)
+  {
+    start_condition_.wait(lock, [&] { return stop_ || generation_ != generation; });
+    if (stop_)
+      return;
+    generation = generation_;
+    if (!task_)
+      continue;
+
+    ++active_workers_;
+    lock.unlock();
+    work();
+    lock.lock();
+    --active_workers_;
+    done_condition_.notify_one();
+  }
+}
+}  // namespace core
+}  // namespace moveit
@@ -43,6 +43,7 @@
 #include <tf2/LinearMath/Quaternion.h>
 #include <tf2/LinearMath/Vector3.h>
 #include <boost/filesystem.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <mutex>
 #include <unordered_map>
 #include <utility>
@@ -52,7 +53,13 @@ namespace cached_ik_kinematics_plugin
 static const rclcpp::Logger LOGGER =
     rclcpp::get_logger("moveit_cached_ik_kinematics_plugin.cached_ik_kinematics_plugin");
 
-/** \brief A cache of inverse kinematic solutions */
+/** \brief A cache of inverse kinematic solutions
+
+    The cache is persisted in a file that is shared by all processes using the same robot, group and cache
+    parameters. The file starts with a nearest-neighbor index (a vantage-point tree laid out in the order of the
+    entries) that is memory-mapped read-only and searched in place, so it is neither copied nor rebuilt at startup.
+    New entries are kept in memory and appended to the end of the file; the appended entries are merged into the
+    index when the cache is initialized and they outnumber the indexed ones. */
 class IKCache
 {
 public:
@@ -96,9 +103,9 @@ public:
   IKCache(const IKCache&) = delete;
 
   /** get the entry from the IK cache that best matches a given pose */
-  const IKEntry& getBestApproximateIKSolution(const Pose& pose) const;
+  IKEntry getBestApproximateIKSolution(const Pose& pose) const;
   /** get the entry from the IK cache that best matches a given vector of poses */
-  const IKEntry& getBestApproximateIKSolution(const std::vector<Pose>& poses) const;
+  IKEntry getBestApproximateIKSolution(const std::vector<Pose>& poses) const;
   /** initialize cache, read from disk if found */
   void initializeCache(const std::string& robot_id, const std::string& group_name, const std::string& cache_name,
                        const unsigned int num_joints, const Options& opts = Options());
@@ -114,12 +121,30 @@ public:
   void updateCache(const IKEntry& nearest, const std::vector<Pose>& poses, const std::vector<double>& config) const;
   /** verify with forward kinematics that the cache entries are correct */
   void verifyCache(kdl_kinematics_plugin::KDLKinematicsPlugin& fk) const;
+  /** number of entries in the cache */
+  std::size_t size() const
+  {
+    return num_indexed_ + ik_cache_.size();
+  }
 
 protected:
   /** compute the distance between two joint configurations */
   double configDistance2(const std::vector<double>& config1, const std::vector<double>& config2) const;
-  /** save current state of cache to disk */
+  /** append the entries that were not saved yet to the cache file, without growing it beyond max_cache_size_ */
   void saveCache() const;
+  /** map the cache file, set up the index and read the appended entries; compact or convert the file if needed */
+  void loadCache();
+  /** map the cache file read-only; return the number of appended entries, or -1 if the file can't be mapped */
+  long mapCache();
+  /** read all entries from a cache file in the format used before the file was indexed */
+  bool readLegacyCache(std::vector<IKEntry>& entries) const;
+  /** replace the cache file by one holding \e entries, indexed for nearest-neighbor queries */
+  void writeCache(std::vector<IKEntry> entries) const;
+  /** get entry \e i of the mapped cache file */
+  IKEntry getMappedEntry(std::size_t i) const;
+  /** search the indexed entries [begin, end) of the mapped cache file for the nearest neighbor of \e poses */
+  void nearestIndexed(const std::vector<Pose>& poses, std::size_t begin, std::size_t end, std::size_t& nearest,
+                      double& nearest_distance) const;
 
   /** number of joints in the system */
   unsigned int num_joints_;
@@ -132,17 +157,23 @@ protected:
   unsigned int max_cache_size_;
   /** file name for loading / saving cache */
   boost::filesystem::path cache_file_name_;
+  /** read-only mapping of the cache file */
+  boost::interprocess::mapped_region mapped_cache_;
+  /** number of entries in the index at the start of the mapped cache file */
+  std::size_t num_indexed_{ 0 };
+  /** number of end effectors of each entry, 0 if not known yet */
+  mutable unsigned int num_tips_{ 0 };
 
   /**
     the IK methods are declared const in the base class, but the
     wrapped methods need to modify the cache, so the next four members
     are mutable
-    cache of IK solutions
+    cache of IK solutions that are not in the index of the mapped cache file
   */
   mutable std::vector<IKEntry> ik_cache_;
   /** nearest neighbor data structure over IK cache entries */
   mutable NearestNeighborsGNAT<IKEntry*> ik_nn_;
-  /** size of the cache when it was last saved */
+  /** number of entries in ik_cache_ that are stored in the cache file */
   mutable unsigned int last_saved_cache_size_{ 0 };
   /** mutex for changing IK cache */
   mutable std::mutex lock_;
@@ -161,9 +192,8 @@ public:
     get the entry from the IK cache that best matches a given vector of
     poses, with a specified set of fixed and active tip links
   */
-  const IKEntry& getBestApproximateIKSolution(const std::vector<std::string>& fixed,
-                                              const std::vector<std::string>& active,
-                                              const std::vector<Pose>& poses) const;
+  IKEntry getBestApproximateIKSolution(const std::vector<std::string>& fixed, const std::vector<std::string>& active,
+                                       const std::vector<Pose>& poses) const;
   /**
     insert (pose,config) as an entry if it's different enough from the
     most similar cache entry
@@ -35,26 +35,118 @@
 /* Author: Mark Moll */
 
 #include <boost/filesystem/fstream.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/sync/file_lock.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <numeric>
 
 #include <moveit/cached_ik_kinematics_plugin/cached_ik_kinematics_plugin.h>
 
 namespace cached_ik_kinematics_plugin
 {
+namespace
+{
+/* The cache file consists of a header followed by fixed-size records of doubles. Each record holds the threshold
+   distance of its vantage-point tree node, then position and orientation (x, y, z, w) of every tip, then the
+   joint values. The first num_indexed records form a vantage-point tree in pre-order: the node at position begin
+   of a range [begin, end) splits the remaining entries into those within the threshold distance of it,
+   [begin + 1, mid), and those outside of it, [mid, end), where mid = begin + 1 + (end - begin - 1) / 2. Records
+   appended later are not indexed. */
+struct CacheFileHeader
+{
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t num_dofs;
+  std::uint32_t num_tips;
+  std::uint64_t num_indexed;
+};
+
+const char CACHE_FILE_MAGIC[4] = { 'I', 'K', 'C', 'M' };
+const std::uint32_t CACHE_FILE_VERSION = 1;
+const std::size_t POSE_SIZE = 7;
+/** merge appended entries into the index when there are more of them than this and than indexed entries */
+const std::size_t MIN_ENTRIES_TO_COMPACT = 500;
+
+std::size_t recordSize(unsigned int num_tips, unsigned int num_dofs)
+{
+  return 1 + POSE_SIZE * num_tips + num_dofs;
+}
+
+double posesDistance(const std::vector<IKCache::Pose>& poses1, const std::vector<IKCache::Pose>& poses2)
+{
+  double dist = 0.;
+  for (unsigned int i = 0; i < poses1.size(); ++i)
+    dist += poses1[i].distance(poses2[i]);
+  return dist;
+}
+
+IKCache::Pose readPose(const double* data)
+{
+  IKCache::Pose pose;
+  pose.position = tf2::Vector3(data[0], data[1], data[2]);
+  pose.orientation = tf2::Quaternion(data[3], data[4], data[5], data[6]);
+  return pose;
+}
+
+void writeRecord(std::ostream& out, const IKCache::IKEntry& entry, double threshold)
+{
+  std::vector<double> record;
+  record.reserve(recordSize(entry.first.size(), entry.second.size()));
+  record.push_back(threshold);
+  for (const auto& pose : entry.first)
+  {
+    record.insert(record.end(), { pose.position.x(), pose.position.y(), pose.position.z(), pose.orientation.x(),
+                                  pose.orientation.y(), pose.orientation.z(), pose.orientation.w() });
+  }
+  record.insert(record.end(), entry.second.begin(), entry.second.end());
+  out.write((const char*)record.data(), record.size() * sizeof(double));
+}
+
+/** reorder entries [begin, end) of \e order into a vantage-point tree, see the file format above */
+void buildIndex(const std::vector<IKCache::IKEntry>& entries, std::vector<std::size_t>& order,
+                std::vector<double>& thresholds, std::size_t begin, std::size_t end)
+{
+  if (end - begin < 2)
+    return;
+  const IKCache::IKEntry& vantage_point = entries[order[begin]];
+  std::vector<std::pair<double, std::size_t>> distances;
+  distances.reserve(end - begin - 1);
+  for (std::size_t i = begin + 1; i < end; ++i)
+    distances.emplace_back(posesDistance(vantage_point.first, entries[order[i]].first), order[i]);
+  std::size_t inside = distances.size() / 2;
+  std::nth_element(distances.begin(), distances.begin() + inside, distances.end());
+  thresholds[order[begin]] = distances[inside].first;
+  for (std::size_t i = 0; i < distances.size(); ++i)
+    order[begin + 1 + i] = distances[i].second;
+  buildIndex(entries, order, thresholds, begin + 1, begin + 1 + inside);
+  buildIndex(entries, order, thresholds, begin + 1 + inside, end);
+}
+
+boost::filesystem::path lockFileName(const boost::filesystem::path& cache_file_name)
+{
+  boost::filesystem::path lock_file_name(cache_file_name);
+  lock_file_name += ".lock";
+  // file_lock requires an existing file
+  if (!boost::filesystem::exists(lock_file_name))
+    boost::filesystem::ofstream(lock_file_name, std::ios_base::app);
+  return lock_file_name;
+}
+}  // namespace
+
 IKCache::IKCache()
 {
   // set distance function for nearest-neighbor queries
-  ik_nn_.setDistanceFunction([](const IKEntry* entry1, const IKEntry* entry2) {
-    double dist = 0.;
-    for (unsigned int i = 0; i < entry1->first.size(); ++i)
-      dist += entry1->first[i].distance(entry2->first[i]);
-    return dist;
-  });
+  ik_nn_.setDistanceFunction(
+      [](const IKEntry* entry1, const IKEntry* entry2) { return posesDistance(entry1->first, entry2->first); });
 }
 
 IKCache::~IKCache()
 {
-  if (!ik_cache_.empty())
+  if (ik_cache_.size() > last_saved_cache_size_)
     saveCache();
 }
 
@@ -83,56 +175,199 @@ void IKCache::initializeCache(const std::string& robot_id, const std::string& gr
   ik_cache_.clear();
   ik_nn_.clear();
   last_saved_cache_size_ = 0;
+  mapped_cache_ = boost::interprocess::mapped_region();
+  num_indexed_ = 0;
+  num_tips_ = 0;
+  num_joints_ = num_joints;
   if (boost::filesystem::exists(cache_file_name_))
+    loadCache();
+
+  RCLCPP_INFO(LOGGER, "cache file %s initialized!", cache_file_name_.string().c_str());
+}
+
+void IKCache::loadCache()
+{
+  boost::interprocess::file_lock file_lock(lockFileName(cache_file_name_).c_str());
+  boost::interprocess::scoped_lock<boost::interprocess::file_lock> file_guard(file_lock);
+
+  long num_appended = mapCache();
+  if (num_appended < 0)
+  {
+    // convert a cache file in the old format, discard an incompatible one
+    std::vector<IKEntry> entries;
+    if (!readLegacyCache(entries))
+      RCLCPP_WARN(LOGGER, "Discarding incompatible cache file %s", cache_file_name_.string().c_str());
+    writeCache(entries);
+    num_appended = mapCache();
+  }
+  else if (static_cast<std::size_t>(num_appended) > std::max(num_indexed_, MIN_ENTRIES_TO_COMPACT))
+  {
+    // merge the entries appended since the index was built into the index
+    std::vector<IKEntry> entries;
+    entries.reserve(num_indexed_ + num_appended);
+    for (std::size_t i = 0; i < num_indexed_ + num_appended; ++i)
+      entries.push_back(getMappedEntry(i));
+    mapped_cache_ = boost::interprocess::mapped_region();
+    writeCache(entries);
+    num_appended = mapCache();
+  }
+  if (num_appended < 0)
+    return;
+
+  RCLCPP_INFO(LOGGER, "Found %lu IK solutions for a %d-dof system with %d end effectors in %s",
+              num_indexed_ + num_appended, num_joints_, num_tips_, cache_file_name_.string().c_str());
+
+  // the appended entries are searched with the in-memory nearest-neighbor data structure
+  for (std::size_t i = num_indexed_; i < num_indexed_ + num_appended; ++i)
+    ik_cache_.push_back(getMappedEntry(i));
+  last_saved_cache_size_ = ik_cache_.size();
+  std::vector<IKEntry*> ik_entry_ptrs(ik_cache_.size());
+  for (std::size_t i = 0; i < ik_cache_.size(); ++i)
+    ik_entry_ptrs[i] = &ik_cache_[i];
+  ik_nn_.add(ik_entry_ptrs);
+}
+
+long IKCache::mapCache()
+{
+  mapped_cache_ = boost::interprocess::mapped_region();
+  num_indexed_ = 0;
+  if (!boost::filesystem::exists(cache_file_name_) ||
+      boost::filesystem::file_size(cache_file_name_) < sizeof(CacheFileHeader))
+    return -1;
+
+  boost::interprocess::file_mapping mapping(cache_file_name_.c_str(), boost::interprocess::read_only);
+  boost::interprocess::mapped_region region(mapping, boost::interprocess::read_only);
+  CacheFileHeader header;
+  memcpy(&header, region.get_address(), sizeof(CacheFileHeader));
+  if (memcmp(header.magic, CACHE_FILE_MAGIC, sizeof(CACHE_FILE_MAGIC)) != 0 || header.version != CACHE_FILE_VERSION ||
+      header.num_dofs != num_joints_ || header.num_tips == 0)
+    return -1;
+
+  std::size_t num_records =
+      (region.get_size() - sizeof(CacheFileHeader)) / (recordSize(header.num_tips, num_joints_) * sizeof(double));
+  if (header.num_indexed > num_records)
+    return -1;
+
+  mapped_cache_.swap(region);
+  num_indexed_ = header.num_indexed;
+  num_tips_ = header.num_tips;
+  return num_records - num_indexed_;
+}
+
+bool IKCache::readLegacyCache(std::vector<IKEntry>& entries) const
+{
+  boost::filesystem::ifstream cache_file(cache_file_name_, std::ios_base::binary | std::ios_base::in);
+  unsigned int num_entries, num_dofs, num_tips;
+  cache_file.read((char*)&num_entries, sizeof(unsigned int));
+  cache_file.read((char*)&num_dofs, sizeof(unsigned int));
+  cache_file.read((char*)&num_tips, sizeof(unsigned int));
+  if (!cache_file || num_dofs != num_joints_ || num_tips == 0)
+    return false;
+
+  unsigned int position_size = 3 * sizeof(tf2Scalar);
+  unsigned int orientation_size = 4 * sizeof(tf2Scalar);
+  unsigned int pose_size = position_size + orientation_size;
+  unsigned int config_size = num_dofs * sizeof(double);
+  unsigned int offset_conf = pose_size * num_tips;
+  std::vector<char> buffer(offset_conf + config_size);
+  IKEntry entry;
+  entry.first.resize(num_tips);
+  entry.second.resize(num_dofs);
+
+  for (unsigned i = 0; i < num_entries && cache_file.read(buffer.data(), buffer.size()); ++i)
   {
-    // read cache
-    boost::filesystem::ifstream cache_file(cache_file_name_, std::ios_base::binary | std::ios_base::in);
-    cache_file.read((char*)&last_saved_cache_size_, sizeof(unsigned int));
-    unsigned int num_dofs;
-    cache_file.read((char*)&num_dofs, sizeof(unsigned int));
-    unsigned int num_tips;
-    cache_file.read((char*)&num_tips, sizeof(unsigned int));
-
-    RCLCPP_INFO(LOGGER, "Found %d IK solutions for a %d-dof system with %d end effectors in %s", last_saved_cache_size_,
-                num_dofs, num_tips, cache_file_name_.string().c_str());
-
-    unsigned int position_size = 3 * sizeof(tf2Scalar);
-    unsigned int orientation_size = 4 * sizeof(tf2Scalar);
-    unsigned int pose_size = position_size + orientation_size;
-    unsigned int config_size = num_dofs * sizeof(double);
-    unsigned int offset_conf = pose_size * num_tips;
-    unsigned int bufsize = offset_conf + config_size;
-    char* buffer = new char[bufsize];
-    IKEntry entry;
-    entry.first.resize(num_tips);
-    entry.second.resize(num_dofs);
-    ik_cache_.reserve(last_saved_cache_size_);
-
-    for (unsigned i = 0; i < last_saved_cache_size_; ++i)
+    unsigned int j = 0;
+    for (auto& pose : entry.first)
     {
-      unsigned int j = 0;
-      cache_file.read(buffer, bufsize);
-      for (auto& pose : entry.first)
-      {
-        memcpy(&pose.position[0], buffer + j * pose_size, position_size);
-        memcpy(&pose.orientation[0], buffer + j * pose_size + position_size, orientation_size);
-        ++j;
-      }
-      memcpy(&entry.second[0], buffer + offset_conf, config_size);
-      ik_cache_.push_back(entry);
+      memcpy(&pose.position[0], buffer.data() + j * pose_size, position_size);
+      memcpy(&pose.orientation[0], buffer.data() + j * pose_size + position_size, orientation_size);
+      ++j;
     }
-    RCLCPP_INFO(LOGGER, "freeing buffer");
-    delete[] buffer;
-    RCLCPP_INFO(LOGGER, "freed buffer");
-    std::vector<IKEntry*> ik_entry_ptrs(last_saved_cache_size_);
-    for (unsigned int i = 0; i < last_saved_cache_size_; ++i)
-      ik_entry_ptrs[i] = &ik_cache_[i];
-    ik_nn_.add(ik_entry_ptrs);
+    memcpy(&entry.second[0], buffer.data() + offset_conf, config_size);
+    entries.push_back(entry);
+  }
+  RCLCPP_INFO(LOGGER, "Converting %lu IK solutions in %s to the indexed format", entries.size(),
+              cache_file_name_.string().c_str());
+  return true;
+}
+
+void IKCache::writeCache(std::vector<IKEntry> entries) const
+{
+  if (entries.empty())
+  {
+    boost::filesystem::remove(cache_file_name_);
+    return;
   }
 
-  num_joints_ = num_joints;
+  std::vector<std::size_t> order(entries.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::vector<double> thresholds(entries.size(), 0.);
+  buildIndex(entries, order, thresholds, 0, entries.size());
 
-  RCLCPP_INFO(LOGGER, "cache file %s initialized!", cache_file_name_.string().c_str());
+  // write to a temporary file and rename it, so that processes that mapped the old file can keep using it
+  boost::filesystem::path tmp_file_name(cache_file_name_);
+  tmp_file_name += ".tmp";
+  {
+    boost::filesystem::ofstream cache_file(tmp_file_name, std::ios_base::binary | std::ios_base::out);
+    CacheFileHeader header;
+    memcpy(header.magic, CACHE_FILE_MAGIC, sizeof(CACHE_FILE_MAGIC));
+    header.version = CACHE_FILE_VERSION;
+    header.num_dofs = num_joints_;
+    header.num_tips = entries[0].first.size();
+    header.num_indexed = entries.size();
+    cache_file.write((const char*)&header, sizeof(CacheFileHeader));
+    for (std::size_t i : order)
+      writeRecord(cache_file, entries[i], thresholds[i]);
+  }
+  boost::filesystem::rename(tmp_file_name, cache_file_name_);
+}
+
+IKCache::IKEntry IKCache::getMappedEntry(std::size_t i) const
+{
+  const double* record = reinterpret_cast<const double*>(static_cast<const char*>(mapped_cache_.get_address()) +
+                                                         sizeof(CacheFileHeader)) +
+                         i * recordSize(num_tips_, num_joints_);
+  IKEntry entry;
+  entry.first.reserve(num_tips_);
+  for (unsigned int j = 0; j < num_tips_; ++j)
+    entry.first.push_back(readPose(record + 1 + j * POSE_SIZE));
+  const double* config = record + 1 + num_tips_ * POSE_SIZE;
+  entry.second.assign(config, config + num_joints_);
+  return entry;
+}
+
+void IKCache::nearestIndexed(const std::vector<Pose>& poses, std::size_t begin, std::size_t end, std::size_t& nearest,
+                             double& nearest_distance) const
+{
+  if (begin >= end)
+    return;
+  const double* record = reinterpret_cast<const double*>(static_cast<const char*>(mapped_cache_.get_address()) +
+                                                         sizeof(CacheFileHeader)) +
+                         begin * recordSize(num_tips_, num_joints_);
+  double dist = 0.;
+  for (unsigned int j = 0; j < num_tips_; ++j)
+    dist += readPose(record + 1 + j * POSE_SIZE).distance(poses[j]);
+  if (dist < nearest_distance)
+  {
+    nearest = begin;
+    nearest_distance = dist;
+  }
+
+  // by the triangle inequality, a subtree can only contain a closer entry if the query is near its boundary
+  double threshold = record[0];
+  std::size_t mid = begin + 1 + (end - begin - 1) / 2;
+  if (dist < threshold)
+  {
+    nearestIndexed(poses, begin + 1, mid, nearest, nearest_distance);
+    if (dist + nearest_distance > threshold)
+      nearestIndexed(poses, mid, end, nearest, nearest_distance);
+  }
+  else
+  {
+    nearestIndexed(poses, mid, end, nearest, nearest_distance);
+    if (dist - nearest_distance < threshold)
+      nearestIndexed(poses, begin + 1, mid, nearest, nearest_distance);
+  }
 }
 
 double IKCache::configDistance2(const std::vector<double>& config1, const std::vector<double>& config2) const
@@ -146,37 +381,40 @@ double IKCache::configDistance2(const std::vector<double>& config1, const std::v
   return dist;
 }
 
-const IKCache::IKEntry& IKCache::getBestApproximateIKSolution(const Pose& pose) const
+IKCache::IKEntry IKCache::getBestApproximateIKSolution(const Pose& pose) const
 {
-  if (ik_cache_.empty())
-  {
-    static IKEntry dummy = std::make_pair(std::vector<Pose>(1, pose), std::vector<double>(num_joints_, 0.));
-    return dummy;
-  }
-  IKEntry query = std::make_pair(std::vector<Pose>(1, pose), std::vector<double>());
-  return *ik_nn_.nearest(&query);
+  return getBestApproximateIKSolution(std::vector<Pose>(1, pose));
 }
 
-const IKCache::IKEntry& IKCache::getBestApproximateIKSolution(const std::vector<Pose>& poses) const
+IKCache::IKEntry IKCache::getBestApproximateIKSolution(const std::vector<Pose>& poses) const
 {
-  if (ik_cache_.empty())
+  std::size_t nearest_indexed = num_indexed_;
+  double nearest_distance = std::numeric_limits<double>::infinity();
+  if (num_indexed_ > 0 && poses.size() == num_tips_)
+    nearestIndexed(poses, 0, num_indexed_, nearest_indexed, nearest_distance);
+
+  if (!ik_cache_.empty())
   {
-    static IKEntry dummy = std::make_pair(poses, std::vector<double>(num_joints_, 0.));
-    return dummy;
+    IKEntry query = std::make_pair(poses, std::vector<double>());
+    const IKEntry* nearest = ik_nn_.nearest(&query);
+    if (nearest_indexed == num_indexed_ || posesDistance(nearest->first, poses) < nearest_distance)
+      return *nearest;
   }
-  IKEntry query = std::make_pair(poses, std::vector<double>());
-  return *ik_nn_.nearest(&query);
+  if (nearest_indexed < num_indexed_)
+    return getMappedEntry(nearest_indexed);
+  return std::make_pair(poses, std::vector<double>(num_joints_, 0.));
 }
 
 void IKCache::updateCache(const IKEntry& nearest, const Pose& pose, const std::vector<double>& config) const
 {
-  if (ik_cache_.size() < ik_cache_.capacity() && (nearest.first[0].distance(pose) > min_pose_distance_ ||
-                                                  configDistance2(nearest.second, config) > min_config_distance2_))
+  if (num_indexed_ + ik_cache_.size() < max_cache_size_ && ik_cache_.size() < ik_cache_.capacity() &&
+      (nearest.first[0].distance(pose) > min_pose_distance_ ||
+       configDistance2(nearest.second, config) > min_config_distance2_))
   {
     std::lock_guard<std::mutex> slock(lock_);
     ik_cache_.emplace_back(std::vector<Pose>(1u, pose), config);
     ik_nn_.add(&ik_cache_.back());
-    if (ik_cache_.size() >= last_saved_cache_size_ + 500u || ik_cache_.size() == max_cache_size_)
+    if (ik_cache_.size() >= last_saved_cache_size_ + 500u || num_indexed_ + ik_cache_.size() == max_cache_size_)
       saveCache();
   }
 }
@@ -184,7 +422,7 @@ void IKCache::updateCache(const IKEntry& nearest, const Pose& pose, const std::v
 void IKCache::updateCache(const IKEntry& nearest, const std::vector<Pose>& poses,
                           const std::vector<double>& config) const
 {
-  if (ik_cache_.size() < ik_cache_.capacity())
+  if (num_indexed_ + ik_cache_.size() < max_cache_size_ && ik_cache_.size() < ik_cache_.capacity())
   {
     bool add_to_cache = configDistance2(nearest.second, config) > min_config_distance2_;
     if (!add_to_cache)
@@ -205,7 +443,7 @@ void IKCache::updateCache(const IKEntry& nearest, const std::vector<Pose>& poses
       std::lock_guard<std::mutex> slock(lock_);
       ik_cache_.emplace_back(poses, config);
       ik_nn_.add(&ik_cache_.back());
-      if (ik_cache_.size() >= last_saved_cache_size_ + 500u || ik_cache_.size() == max_cache_size_)
+      if (ik_cache_.size() >= last_saved_cache_size_ + 500u || num_indexed_ + ik_cache_.size() == max_cache_size_)
         saveCache();
     }
   }
@@ -214,37 +452,45 @@ void IKCache::updateCache(const IKEntry& nearest, const std::vector<Pose>& poses
 void IKCache::saveCache() const
 {
   if (cache_file_name_.empty())
+  {
     RCLCPP_ERROR(LOGGER, "can't save cache before initialization");
+    return;
+  }
 
-  RCLCPP_INFO(LOGGER, "writing %ld IK solutions to %s", ik_cache_.size(), cache_file_name_.string().c_str());
-
-  boost::filesystem::ofstream cache_file(cache_file_name_, std::ios_base::binary | std::ios_base::out);
-  unsigned int position_size = 3 * sizeof(tf2Scalar);
-  unsigned int orientation_size = 4 * sizeof(tf2Scalar);
-  unsigned int pose_size = position_size + orientation_size;
-  unsigned int num_tips = ik_cache_[0].first.size();
-  unsigned int config_size = ik_cache_[0].second.size() * sizeof(double);
-  unsigned int offset_conf = num_tips * pose_size;
-  unsigned int bufsize = offset_conf + config_size;
-  char* buffer = new char[bufsize];
+  // other processes may append to or rewrite the file concurrently
+  boost::interprocess::file_lock file_lock(lockFileName(cache_file_name_).c_str());
+  boost::interprocess::scoped_lock<boost::interprocess::file_lock> file_guard(file_lock);
 
-  // write number of IK entries and size of each configuration first
-  last_saved_cache_size_ = ik_cache_.size();
-  cache_file.write((char*)&last_saved_cache_size_, sizeof(unsigned int));
-  unsigned int sz = ik_cache_[0].second.size();
-  cache_file.write((char*)&sz, sizeof(unsigned int));
-  cache_file.write((char*)&num_tips, sizeof(unsigned int));
-  for (const auto& entry : ik_cache_)
+  if (num_tips_ == 0)
+    num_tips_ = ik_cache_[0].first.size();
+  if (!boost::filesystem::exists(cache_file_name_))
   {
-    for (unsigned int i = 0; i < num_tips; ++i)
-    {
-      memcpy(buffer + i * pose_size, &entry.first[i].position[0], position_size);
-      memcpy(buffer + i * pose_size + position_size, &entry.first[i].orientation[0], orientation_size);
-    }
-    memcpy(buffer + offset_conf, &entry.second[0], config_size);
-    cache_file.write(buffer, bufsize);
+    RCLCPP_INFO(LOGGER, "writing %lu IK solutions to %s", ik_cache_.size(), cache_file_name_.string().c_str());
+    writeCache(std::vector<IKEntry>(ik_cache_.begin(), ik_cache_.end()));
+    last_saved_cache_size_ = ik_cache_.size();
+    return;
   }
-  delete[] buffer;
+
+  // drop a partially written record, e.g., from a process that crashed while appending
+  std::size_t record_size = recordSize(num_tips_, num_joints_) * sizeof(double);
+  std::size_t file_size = boost::filesystem::file_size(cache_file_name_);
+  if ((file_size - sizeof(CacheFileHeader)) % record_size != 0)
+    boost::filesystem::resize_file(cache_file_name_,
+                                   file_size - (file_size - sizeof(CacheFileHeader)) % record_size);
+
+  // other processes may have filled the file since it was mapped; the entries that don't fit stay in memory only
+  std::size_t num_records = (file_size - sizeof(CacheFileHeader)) / record_size;
+  std::size_t num_free = num_records < max_cache_size_ ? max_cache_size_ - num_records : 0;
+  std::size_t end = last_saved_cache_size_ + std::min<std::size_t>(ik_cache_.size() - last_saved_cache_size_, num_free);
+  RCLCPP_INFO(LOGGER, "writing %lu IK solutions to %s", end - last_saved_cache_size_,
+              cache_file_name_.string().c_str());
+  if (end < ik_cache_.size())
+    RCLCPP_INFO(LOGGER, "cache file is full, not writing %lu IK solutions", ik_cache_.size() - end);
+
+  boost::filesystem::ofstream cache_file(cache_file_name_, std::ios_base::binary | std::ios_base::app);
+  for (std::size_t i = last_saved_cache_size_; i < end; ++i)
+    writeRecord(cache_file, ik_cache_[i], 0.);
+  last_saved_cache_size_ = ik_cache_.size();
 }
 
 void IKCache::verifyCache(kdl_kinematics_plugin::KDLKinematicsPlugin& fk) const
@@ -253,7 +499,12 @@ void IKCache::verifyCache(kdl_kinematics_plugin::KDLKinematicsPlugin& fk) const
   std::vector<geometry_msgs::msg::Pose> poses(tip_names.size());
   double error, max_error = 0.;
 
-  for (const auto& entry : ik_cache_)
+  std::vector<IKEntry> entries;
+  entries.reserve(num_indexed_ + ik_cache_.size());
+  for (std::size_t i = 0; i < num_indexed_; ++i)
+    entries.push_back(getMappedEntry(i));
+  entries.insert(entries.end(), ik_cache_.begin(), ik_cache_.end());
+  for (const auto& entry : entries)
   {
     fk.getPositionFK(tip_names, entry.second, poses);
     error = 0.;
@@ -293,19 +544,16 @@ IKCacheMap::~IKCacheMap()
     delete cache.second;
 }
 
-const IKCache::IKEntry& IKCacheMap::getBestApproximateIKSolution(const std::vector<std::string>& fixed,
-                                                                 const std::vector<std::string>& active,
-                                                                 const std::vector<Pose>& poses) const
+IKCache::IKEntry IKCacheMap::getBestApproximateIKSolution(const std::vector<std::string>& fixed,
+                                                          const std::vector<std::string>& active,
+                                                          const std::vector<Pose>& poses) const
 {
   auto key(getKey(fixed, active));
   auto it = find(key);
   if (it != end())
     return it->second->getBestApproximateIKSolution(poses);
   else
-  {
-    static IKEntry dummy = std::make_pair(poses, std::vector<double>(num_joints_, 0.));
-    return dummy;
-  }
+    return std::make_pair(poses, std::vector<double>(num_joints_, 0.));
 }
 
 void IKCacheMap::updateCache(const IKEntry& nearest, const std::vector<std::string>& fixed,
@@ -0,0 +1,289 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/cached_ik_kinematics_plugin/cached_ik_kinematics_plugin.h>
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit/robot_state/robot_state.h>
+#include <pluginlib/class_loader.hpp>
+#include <random_numbers/random_numbers.h>
+#include <rclcpp/rclcpp.hpp>
+#include <tf2_eigen/tf2_eigen.h>
+#include <boost/program_options.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace po = boost::program_options;
+
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("cached_ik.precompute_ik_cache");
+
+namespace
+{
+struct IKResult
+{
+  std::vector<double> solution;
+  bool found;
+  double time;
+};
+
+/** Solve IK for a batch of poses, spreading the poses over one thread per solver */
+std::vector<IKResult> solveIK(const std::vector<kinematics::KinematicsBasePtr>& solvers,
+                              const std::vector<geometry_msgs::msg::Pose>& poses,
+                              const std::vector<std::vector<double>>& seeds, double timeout)
+{
+  std::vector<IKResult> results(poses.size());
+  std::atomic<std::size_t> next(0);
+  std::vector<std::thread> threads;
+  for (const auto& solver : solvers)
+    threads.emplace_back([&, solver] {
+      moveit_msgs::msg::MoveItErrorCodes error_code;
+      for (std::size_t i = next++; i < poses.size(); i = next++)
+      {
+        auto start = std::chrono::steady_clock::now();
+        results[i].found = solver->searchPositionIK(poses[i], seeds[i], timeout, results[i].solution, error_code);
+        results[i].time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      }
+    });
+  for (auto& thread : threads)
+    thread.join();
+  return results;
+}
+
+/** Sample random configurations of the group and compute the pose of the tip in the base frame of the solver.
+    The configurations are returned in the joint order of the solver. */
+void samplePoses(moveit::core::RobotState& state, const moveit::core::JointModelGroup* jmg,
+                 const kinematics::KinematicsBase& solver, random_numbers::RandomNumberGenerator& rng, std::size_t num,
+                 std::vector<geometry_msgs::msg::Pose>& poses, std::vector<std::vector<double>>& configs)
+{
+  const std::vector<std::string>& joint_names = solver.getJointNames();
+  poses.resize(num);
+  configs.assign(num, std::vector<double>(joint_names.size()));
+  for (std::size_t i = 0; i < num; ++i)
+  {
+    state.setToRandomPositions(jmg, rng);
+    state.update();
+    poses[i] = tf2::toMsg(state.getFrameTransform(solver.getBaseFrame()).inverse() *
+                          state.getGlobalLinkTransform(solver.getTipFrame()));
+    for (std::size_t j = 0; j < joint_names.size(); ++j)
+      configs[i][j] = state.getVariablePosition(joint_names[j]);
+  }
+}
+}  // namespace
+
+/** Fill the IK cache of a planning group offline and report how well the cache covers the group's workspace */
+int main(int argc, char* argv[])
+{
+  std::string group;
+  std::string solver_name;
+  unsigned int num_threads;
+  unsigned int batch_size;
+  unsigned int max_samples;
+  unsigned int num_evaluations;
+  double target_coverage;
+  double timeout;
+  cached_ik_kinematics_plugin::IKCache::Options opts;
+  po::options_description desc("Options");
+  // clang-format off
+  desc.add_options()
+      ("help", "show help message")
+      ("group", po::value<std::string>(&group)->required(), "name of planning group")
+      ("solver", po::value<std::string>(&solver_name)->default_value("kdl_kinematics_plugin/KDLKinematicsPlugin"),
+       "IK solver wrapped by the cache")
+      ("threads", po::value<unsigned int>(&num_threads)->default_value(0),
+       "number of threads solving IK (0 uses all hardware threads)")
+      ("batch_size", po::value<unsigned int>(&batch_size)->default_value(1000),
+       "number of samples per batch; coverage is measured per batch")
+      ("max_samples", po::value<unsigned int>(&max_samples)->default_value(1000000),
+       "maximum number of samples used to fill the cache")
+      ("target_coverage", po::value<double>(&target_coverage)->default_value(0.99),
+       "stop when this fraction of the samples of a batch is already covered by the cache")
+      ("num_evaluations", po::value<unsigned int>(&num_evaluations)->default_value(1000),
+       "number of random poses used to evaluate the cache")
+      ("timeout", po::value<double>(&timeout)->default_value(0.1), "IK solver timeout in seconds")
+      ("max_cache_size", po::value<unsigned int>(&opts.max_cache_size)->default_value(opts.max_cache_size),
+       "maximum number of cache entries")
+      ("min_pose_distance", po::value<double>(&opts.min_pose_distance)->default_value(opts.min_pose_distance),
+       "minimum pose distance between cache entries")
+      ("min_joint_config_distance",
+       po::value<double>(&opts.min_joint_config_distance)->default_value(opts.min_joint_config_distance),
+       "minimum joint configuration distance between cache entries")
+      ("cached_ik_path", po::value<std::string>(&opts.cached_ik_path)->default_value(""),
+       "directory of the cache file (defaults to the current directory)");
+  // clang-format on
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  if (vm.count("help") != 0u)
+  {
+    std::cout << desc << "\n";
+    return 1;
+  }
+  po::notify(vm);
+
+  rclcpp::init(argc, argv);
+  rclcpp::Node::SharedPtr node = rclcpp::Node::make_shared("precompute_ik_cache");
+
+  robot_model_loader::RobotModelLoader robot_model_loader(node);
+  const moveit::core::RobotModelPtr& robot_model = robot_model_loader.getModel();
+  const moveit::core::JointModelGroup* jmg = robot_model ? robot_model->getJointModelGroup(group) : nullptr;
+  if (!jmg)
+  {
+    RCLCPP_ERROR(LOGGER, "Unable to find planning group '%s'", group.c_str());
+    return 1;
+  }
+
+  // use the same frames as the configured (cached) solver, so that the plugin finds the cache file
+  std::string base_frame;
+  std::vector<std::string> tip_frames;
+  if (const kinematics::KinematicsBaseConstPtr& configured_solver = jmg->getSolverInstance())
+  {
+    base_frame = configured_solver->getBaseFrame();
+    tip_frames = configured_solver->getTipFrames();
+  }
+  else
+  {
+    const moveit::core::LinkModel* base_link = jmg->getLinkModels().front()->getParentJointModel()->getParentLinkModel();
+    base_frame = base_link ? base_link->getName() : robot_model->getModelFrame();
+    tip_frames.push_back(jmg->getLinkModels().back()->getName());
+  }
+  if (tip_frames.size() != 1)
+  {
+    RCLCPP_ERROR(LOGGER, "The IK cache only supports groups with a single tip frame");
+    return 1;
+  }
+
+  // each thread uses its own solver instance
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  pluginlib::ClassLoader<kinematics::KinematicsBase> kinematics_loader("moveit_core", "kinematics::KinematicsBase");
+  std::vector<kinematics::KinematicsBasePtr> solvers;
+  for (unsigned int i = 0; i < num_threads; ++i)
+  {
+    try
+    {
+      solvers.push_back(kinematics_loader.createUniqueInstance(solver_name));
+    }
+    catch (pluginlib::PluginlibException& e)
+    {
+      RCLCPP_ERROR(LOGGER, "Unable to load IK solver '%s': %s", solver_name.c_str(), e.what());
+      return 1;
+    }
+    if (!solvers.back()->initialize(node, *robot_model, group, base_frame, tip_frames,
+                                    kinematics::KinematicsBase::DEFAULT_SEARCH_DISCRETIZATION))
+    {
+      RCLCPP_ERROR(LOGGER, "Unable to initialize IK solver '%s' for group '%s'", solver_name.c_str(), group.c_str());
+      return 1;
+    }
+  }
+  const kinematics::KinematicsBase& solver = *solvers.front();
+  const std::size_t num_joints = solver.getJointNames().size();
+  const std::string cache_name = base_frame + tip_frames[0];
+
+  moveit::core::RobotState state(robot_model);
+  state.setToDefaultValues();
+  std::vector<double> default_seed(num_joints);
+  for (std::size_t j = 0; j < num_joints; ++j)
+    default_seed[j] = state.getVariablePosition(solver.getJointNames()[j]);
+  random_numbers::RandomNumberGenerator rng;
+  std::vector<geometry_msgs::msg::Pose> poses;
+  std::vector<std::vector<double>> configs;
+
+  {
+    cached_ik_kinematics_plugin::IKCache cache;
+    cache.initializeCache(robot_model->getName(), group, cache_name, num_joints, opts);
+
+    // fill the cache until the samples are (almost) all covered by existing entries or the cache is full
+    std::size_t num_samples = 0, num_failed = 0;
+    double coverage = 0.;
+    while (num_samples < max_samples && coverage < target_coverage && cache.size() < opts.max_cache_size)
+    {
+      samplePoses(state, jmg, solver, rng, batch_size, poses, configs);
+      std::vector<IKResult> results =
+          solveIK(solvers, poses, std::vector<std::vector<double>>(poses.size(), default_seed), timeout);
+
+      std::size_t num_added = 0;
+      for (std::size_t i = 0; i < poses.size(); ++i)
+      {
+        // the sampled configuration is a valid solution where the solver fails
+        if (!results[i].found)
+          ++num_failed;
+        const std::vector<double>& solution = results[i].found ? results[i].solution : configs[i];
+        cached_ik_kinematics_plugin::IKCache::Pose pose(poses[i]);
+        std::size_t cache_size = cache.size();
+        cache.updateCache(cache.getBestApproximateIKSolution(pose), pose, solution);
+        if (cache.size() > cache_size)
+          ++num_added;
+      }
+      num_samples += poses.size();
+      coverage = 1. - static_cast<double>(num_added) / poses.size();
+      RCLCPP_INFO(LOGGER, "%lu samples: %lu cache entries, %g%% of the last batch covered, %g%% of IK calls failed",
+                  num_samples, cache.size(), 100. * coverage, 100. * num_failed / num_samples);
+    }
+  }
+
+  // reopen the cache as the plugin would and measure how much it helps the solver
+  cached_ik_kinematics_plugin::IKCache cache;
+  cache.initializeCache(robot_model->getName(), group, cache_name, num_joints, opts);
+  samplePoses(state, jmg, solver, rng, num_evaluations, poses, configs);
+  std::vector<std::vector<double>> cache_seeds(poses.size());
+  std::size_t num_covered = 0;
+  for (std::size_t i = 0; i < poses.size(); ++i)
+  {
+    cached_ik_kinematics_plugin::IKCache::Pose pose(poses[i]);
+    cached_ik_kinematics_plugin::IKCache::IKEntry nearest = cache.getBestApproximateIKSolution(pose);
+    if (nearest.first[0].distance(pose) <= opts.min_pose_distance)
+      ++num_covered;
+    cache_seeds[i] = nearest.second;
+  }
+
+  auto summarize = [&poses](const std::vector<IKResult>& results, const char* seed) {
+    std::size_t num_found = 0;
+    double time = 0.;
+    for (const IKResult& result : results)
+    {
+      num_found += result.found;
+      time += result.time;
+    }
+    RCLCPP_INFO(LOGGER, "Seeded with the %s: %g%% of IK calls succeeded, avg. time per IK call is %g s", seed,
+                100. * num_found / poses.size(), time / poses.size());
+  };
+  RCLCPP_INFO(LOGGER, "Cache with %lu entries covers %g%% of %lu random poses within a distance of %g", cache.size(),
+              100. * num_covered / poses.size(), poses.size(), opts.min_pose_distance);
+  summarize(solveIK(solvers, poses, std::vector<std::vector<double>>(poses.size(), default_seed), timeout),
+            "default state");
+  summarize(solveIK(solvers, poses, cache_seeds, timeout), "nearest cache entry");
+
+  rclcpp::shutdown();
+  return 0;
+}
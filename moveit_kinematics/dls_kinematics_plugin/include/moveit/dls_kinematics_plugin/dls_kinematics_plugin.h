@@ -0,0 +1,211 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+// ROS2
+#include <rclcpp/rclcpp.hpp>
+
+// ROS msgs
+#include <geometry_msgs/msg/pose.hpp>
+#include <moveit_msgs/msg/move_it_error_codes.hpp>
+
+// MoveIt
+#include <moveit/kinematics_base/kinematics_base.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+
+#include <memory>
+#include <mutex>
+
+namespace dls_kinematics_plugin
+{
+/**
+ * @brief Implementation of kinematics using a damped least-squares (Levenberg-Marquardt) solver that operates directly
+ * on moveit::core::RobotState. Forward kinematics and Jacobians are computed from the link transforms of the state,
+ * so no KDL model is built. Besides chains, groups shaped like a tree are supported, with one tip frame per branch.
+ * All joints of the group must be revolute or prismatic; mimic joints are supported. The base frame must not be moved
+ * by the joints of the group.
+ */
+class DLSKinematicsPlugin : public kinematics::KinematicsBase
+{
+public:
+  /**
+   *  @brief Default constructor
+   */
+  DLSKinematicsPlugin();
+
+  ~DLSKinematicsPlugin() override;
+
+  bool
+  getPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                std::vector<double>& solution, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const override;
+
+  bool searchPositionIK(
+      const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state, double timeout,
+      std::vector<double>& solution, moveit_msgs::msg::MoveItErrorCodes& error_code,
+      const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const override;
+
+  bool searchPositionIK(
+      const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state, double timeout,
+      const std::vector<double>& consistency_limits, std::vector<double>& solution,
+      moveit_msgs::msg::MoveItErrorCodes& error_code,
+      const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const override;
+
+  bool searchPositionIK(
+      const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state, double timeout,
+      std::vector<double>& solution, const IKCallbackFn& solution_callback,
+      moveit_msgs::msg::MoveItErrorCodes& error_code,
+      const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const override;
+
+  bool searchPositionIK(
+      const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state, double timeout,
+      const std::vector<double>& consistency_limits, std::vector<double>& solution,
+      const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code,
+      const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const override;
+
+  /**
+   * @brief Solve for the poses of all tip frames at once. The solution callback receives the first pose.
+   * If given, context_state provides the values of the joints outside of the group.
+   */
+  bool searchPositionIK(const std::vector<geometry_msgs::msg::Pose>& ik_poses, const std::vector<double>& ik_seed_state,
+                        double timeout, const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                        const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions(),
+                        const moveit::core::RobotState* context_state = nullptr) const override;
+
+  /**
+   * @brief Solve a batch of IK queries on up to num_threads threads. Each thread reuses a single workspace for all
+   * of its queries.
+   */
+  bool searchPositionIKBatch(
+      const std::vector<geometry_msgs::msg::Pose>& ik_poses, const std::vector<std::vector<double> >& ik_seed_states,
+      double timeout, std::vector<std::vector<double> >& solutions,
+      std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+      const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions(),
+      unsigned int num_threads = 1) const override;
+
+  bool getPositionFK(const std::vector<std::string>& link_names, const std::vector<double>& joint_angles,
+                     std::vector<geometry_msgs::msg::Pose>& poses) const override;
+
+  bool initialize(const rclcpp::Node::SharedPtr& node, const moveit::core::RobotModel& robot_model,
+                  const std::string& group_name, const std::string& base_frame,
+                  const std::vector<std::string>& tip_frames, double search_discretization) override;
+
+  /**
+   * @brief  Return all the joint names in the order they are used internally
+   */
+  const std::vector<std::string>& getJointNames() const override;
+
+  /**
+   * @brief  Return all the link names in the order they are represented internally
+   */
+  const std::vector<std::string>& getLinkNames() const override;
+
+  /**
+   * @brief Groups are supported if all of their joints are revolute, prismatic or fixed. They do not need to be chains.
+   */
+  bool supportsGroup(const moveit::core::JointModelGroup* jmg, std::string* error_text_out = nullptr) const override;
+
+private:
+  /** State and buffers of a single IK query, allocated once and reused across queries */
+  struct IKWorkspace;
+
+  std::unique_ptr<IKWorkspace> acquireWorkspace() const;
+  void releaseWorkspace(std::unique_ptr<IKWorkspace> workspace) const;
+
+  /** @brief Implementation of searchPositionIK() using the given workspace, which must not be used by other threads at
+   *  the same time */
+  bool searchPositionIK(const std::vector<geometry_msgs::msg::Pose>& ik_poses, const std::vector<double>& ik_seed_state,
+                        double timeout, const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                        const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options,
+                        const moveit::core::RobotState* context_state, IKWorkspace& workspace) const;
+
+  /** @brief Run damped least-squares iterations starting from workspace.q until the weighted pose error of all tips
+   *  drops below epsilon_
+   *  @return true if the solver converged */
+  bool solve(IKWorkspace& workspace) const;
+
+  /** Set the active joints of the group to q and update the link transforms */
+  void setActivePositions(IKWorkspace& workspace, const Eigen::VectorXd& q) const;
+
+  /** Compute the weighted pose error of all tips of the current state of the workspace
+   *  @return the squared norm of the error */
+  double computeError(const IKWorkspace& workspace, Eigen::VectorXd& error) const;
+
+  /** Compute the weighted Jacobian of all tips w.r.t. the active joints for the current state of the workspace */
+  void computeJacobian(IKWorkspace& workspace) const;
+
+  /** Get the transform of the base frame within the model frame */
+  Eigen::Isometry3d getBaseTransform(const moveit::core::RobotState& state) const;
+
+  bool timedOut(const rclcpp::Time& start_time, double duration) const;
+
+  /** @brief Check whether the solution lies within the consistency limits of the seed state */
+  bool checkConsistency(const std::vector<double>& seed_state, const std::vector<double>& consistency_limits,
+                        const std::vector<double>& solution) const;
+
+  bool initialized_;  ///< Internal variable that indicates whether solver is configured and ready
+
+  unsigned int dimension_;  ///< Number of variables of the group, including mimic joints
+  std::vector<std::string> joint_names_;
+
+  const moveit::core::JointModelGroup* joint_model_group_;
+  moveit::core::RobotStatePtr state_;
+  const moveit::core::LinkModel* base_link_;  ///< nullptr if the base frame is the model frame
+
+  std::vector<const moveit::core::JointModel*> active_joints_;
+  std::vector<int> active_group_indices_;  ///< index of each active joint within the group variables
+  std::vector<int> active_columns_;        ///< Jacobian column of each group variable, -1 if it has none
+  std::vector<double> column_factors_;     ///< mimic factor of each group variable, 1 for active joints
+
+  std::vector<const moveit::core::LinkModel*> tip_links_;
+  std::vector<int> tip_slots_;  ///< slots of the tip links in the compiled kinematics of the group
+
+  int max_solver_iterations_;
+  double epsilon_;
+  double damping_;  ///< initial damping of the least-squares steps
+  /** weight of orientation error vs position error
+   *
+   * < 1.0: orientation has less importance than position
+   * > 1.0: orientation has more importance than position
+   * = 0.0: perform position-only IK */
+  double orientation_vs_position_weight_;
+
+  mutable std::mutex workspace_mutex_;
+  mutable std::vector<std::unique_ptr<IKWorkspace>> workspace_pool_;
+};
+}  // namespace dls_kinematics_plugin
@@ -0,0 +1,646 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/dls_kinematics_plugin/dls_kinematics_plugin.h>
+
+#include <tf2_eigen/tf2_eigen.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+// register as a KinematicsBase implementation
+#include <class_loader/class_loader.hpp>
+CLASS_LOADER_REGISTER_CLASS(dls_kinematics_plugin::DLSKinematicsPlugin, kinematics::KinematicsBase)
+
+namespace dls_kinematics_plugin
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_dls_kinematics_plugin.dls_kinematics_plugin");
+
+/// The damping is never decreased below this value
+static const double MIN_DAMPING = 1e-12;
+/// If the damping grows beyond this value, no step reduces the error anymore and the solver gives up
+static const double MAX_DAMPING = 1e8;
+
+struct DLSKinematicsPlugin::IKWorkspace
+{
+  explicit IKWorkspace(const DLSKinematicsPlugin& plugin)
+    : state(*plugin.state_)
+    , targets(plugin.tip_links_.size())
+    , q(plugin.active_joints_.size())
+    , q_seed(q.size())
+    , q_trial(q.size())
+    , dq(q.size())
+    , error(6 * plugin.tip_links_.size())
+    , trial_error(error.size())
+    , jte(q.size())
+    , jacobian(error.size(), q.size())
+    , jtj(q.size(), q.size())
+    , normal(q.size(), q.size())
+    , llt(q.size())
+    , positions(plugin.dimension_)
+  {
+    consistency_limits_active.reserve(q.size());
+  }
+
+  moveit::core::RobotState state;  ///< state the solver works on, also provides the random number generator
+  bool has_context = false;        ///< whether state holds the joint values of a context state
+
+  EigenSTL::vector_Isometry3d targets;  ///< target poses of the tips in the model frame
+  Eigen::VectorXd q, q_seed, q_trial, dq;
+  Eigen::VectorXd error, trial_error, jte;
+  Eigen::MatrixXd jacobian, jtj, normal;
+  Eigen::LLT<Eigen::MatrixXd> llt;
+  std::vector<double> positions;  ///< values of all group variables
+  std::vector<double> consistency_limits_active;
+};
+
+DLSKinematicsPlugin::DLSKinematicsPlugin() : initialized_(false)
+{
+}
+
+DLSKinematicsPlugin::~DLSKinematicsPlugin() = default;
+
+std::unique_ptr<DLSKinematicsPlugin::IKWorkspace> DLSKinematicsPlugin::acquireWorkspace() const
+{
+  {
+    std::lock_guard<std::mutex> lock(workspace_mutex_);
+    if (!workspace_pool_.empty())
+    {
+      std::unique_ptr<IKWorkspace> workspace = std::move(workspace_pool_.back());
+      workspace_pool_.pop_back();
+      return workspace;
+    }
+  }
+  return std::make_unique<IKWorkspace>(*this);
+}
+
+void DLSKinematicsPlugin::releaseWorkspace(std::unique_ptr<IKWorkspace> workspace) const
+{
+  std::lock_guard<std::mutex> lock(workspace_mutex_);
+  workspace_pool_.push_back(std::move(workspace));
+}
+
+bool DLSKinematicsPlugin::supportsGroup(const moveit::core::JointModelGroup* jmg, std::string* error_text_out) const
+{
+  for (const moveit::core::JointModel* jm : jmg->getJointModels())
+  {
+    if (jm->getType() != moveit::core::JointModel::REVOLUTE && jm->getType() != moveit::core::JointModel::PRISMATIC &&
+        jm->getType() != moveit::core::JointModel::FIXED)
+    {
+      if (error_text_out)
+        *error_text_out = "Joint '" + jm->getName() + "' of group '" + jmg->getName() +
+                          "' is neither revolute nor prismatic, which this plugin does not support";
+      return false;
+    }
+  }
+  return true;
+}
+
+bool DLSKinematicsPlugin::initialize(const rclcpp::Node::SharedPtr& node, const moveit::core::RobotModel& robot_model,
+                                     const std::string& group_name, const std::string& base_frame,
+                                     const std::vector<std::string>& tip_frames, double search_discretization)
+{
+  node_ = node;
+  storeValues(robot_model, group_name, base_frame, tip_frames, search_discretization);
+  joint_model_group_ = robot_model_->getJointModelGroup(group_name);
+  if (!joint_model_group_)
+    return false;
+
+  std::string error_text;
+  if (!supportsGroup(joint_model_group_, &error_text))
+  {
+    RCLCPP_ERROR(LOGGER, "%s", error_text.c_str());
+    return false;
+  }
+
+  if (robot_model_->hasLinkModel(base_frame_))
+    base_link_ = robot_model_->getLinkModel(base_frame_);
+  else if (base_frame_ == robot_model_->getModelFrame())
+    base_link_ = nullptr;
+  else
+  {
+    RCLCPP_ERROR(LOGGER, "Unknown base frame '%s'", base_frame_.c_str());
+    return false;
+  }
+  // the target poses are transformed into the model frame once per query, so the base must not move with the group
+  if (base_link_ && joint_model_group_->getUpdatedLinkModelsSet().count(base_link_))
+  {
+    RCLCPP_ERROR(LOGGER, "Base frame '%s' is moved by the joints of group '%s', which this plugin does not support",
+                 base_frame_.c_str(), group_name.c_str());
+    return false;
+  }
+
+  // the tips must be updated by the group, so that their Jacobians can be computed from its compiled kinematics
+  const moveit::core::JointModelGroup::CompiledKinematics& kinematics = joint_model_group_->getCompiledKinematics();
+  tip_links_.clear();
+  tip_slots_.clear();
+  for (const std::string& tip_frame : tip_frames_)
+  {
+    const moveit::core::LinkModel* link =
+        robot_model_->hasLinkModel(tip_frame) ? robot_model_->getLinkModel(tip_frame) : nullptr;
+    const int slot = link ? kinematics.getSlot(link) : -1;
+    if (slot < 0)
+    {
+      RCLCPP_ERROR(LOGGER, "Tip frame '%s' is not a link that is moved by group '%s'", tip_frame.c_str(),
+                   group_name.c_str());
+      return false;
+    }
+    tip_links_.push_back(link);
+    tip_slots_.push_back(slot);
+  }
+
+  // the solver works on the active joints; mimic joints add their motion to the Jacobian column of their master
+  dimension_ = joint_model_group_->getVariableCount();
+  joint_names_ = joint_model_group_->getVariableNames();
+  active_joints_ = joint_model_group_->getActiveJointModels();
+  active_group_indices_.clear();
+  active_columns_.assign(dimension_, -1);
+  column_factors_.assign(dimension_, 1.0);
+  for (std::size_t i = 0; i < active_joints_.size(); ++i)
+  {
+    const int index = joint_model_group_->getVariableGroupIndex(active_joints_[i]->getName());
+    active_group_indices_.push_back(index);
+    active_columns_[index] = i;
+  }
+  for (const moveit::core::JointModel* jm : joint_model_group_->getMimicJointModels())
+  {
+    const moveit::core::JointModel* master = jm->getMimic();
+    if (!joint_model_group_->hasJointModel(master->getName()))
+      continue;
+    const int index = joint_model_group_->getVariableGroupIndex(jm->getName());
+    active_columns_[index] = active_columns_[joint_model_group_->getVariableGroupIndex(master->getName())];
+    column_factors_[index] = jm->getMimicFactor();
+  }
+
+  // Get Solver Parameters
+  lookupParam(node_, "max_solver_iterations", max_solver_iterations_, 500);
+  lookupParam(node_, "epsilon", epsilon_, 1e-5);
+  lookupParam(node_, "damping", damping_, 1e-3);
+  lookupParam(node_, "orientation_vs_position", orientation_vs_position_weight_, 1.0);
+
+  bool position_ik;
+  lookupParam(node_, "position_only_ik", position_ik, false);
+  if (position_ik)  // position_only_ik overrules orientation_vs_position
+    orientation_vs_position_weight_ = 0.0;
+  if (orientation_vs_position_weight_ == 0.0)
+    RCLCPP_INFO(LOGGER, "Using position only ik");
+
+  // Setup the joint state groups that we need
+  state_.reset(new moveit::core::RobotState(robot_model_));
+  state_->setToDefaultValues();
+  state_->updateLinkTransforms();
+
+  // workspaces of a previous initialization do not fit the new group
+  workspace_pool_.clear();
+
+  initialized_ = true;
+  RCLCPP_DEBUG(LOGGER, "DLS solver initialized");
+  return true;
+}
+
+bool DLSKinematicsPlugin::timedOut(const rclcpp::Time& start_time, double duration) const
+{
+  return ((node_->now() - start_time).seconds() >= duration);
+}
+
+bool DLSKinematicsPlugin::checkConsistency(const std::vector<double>& seed_state,
+                                           const std::vector<double>& consistency_limits,
+                                           const std::vector<double>& solution) const
+{
+  for (int index : active_group_indices_)
+    if (fabs(seed_state[index] - solution[index]) > consistency_limits[index])
+      return false;
+  return true;
+}
+
+Eigen::Isometry3d DLSKinematicsPlugin::getBaseTransform(const moveit::core::RobotState& state) const
+{
+  return base_link_ ? state.getGlobalLinkTransform(base_link_) : Eigen::Isometry3d::Identity();
+}
+
+void DLSKinematicsPlugin::setActivePositions(IKWorkspace& workspace, const Eigen::VectorXd& q) const
+{
+  workspace.state.setJointGroupActivePositions(joint_model_group_, q);
+  workspace.state.updateLinkTransforms();
+}
+
+double DLSKinematicsPlugin::computeError(const IKWorkspace& workspace, Eigen::VectorXd& error) const
+{
+  for (std::size_t i = 0; i < tip_links_.size(); ++i)
+  {
+    const Eigen::Isometry3d& tip = workspace.state.getGlobalLinkTransform(tip_links_[i]);
+    const Eigen::Isometry3d& target = workspace.targets[i];
+    error.segment<3>(6 * i) = target.translation() - tip.translation();
+    const Eigen::AngleAxisd rotation_error(Eigen::Matrix3d(target.linear() * tip.linear().transpose()));
+    error.segment<3>(6 * i + 3) = (orientation_vs_position_weight_ * rotation_error.angle()) * rotation_error.axis();
+  }
+  return error.squaredNorm();
+}
+
+void DLSKinematicsPlugin::computeJacobian(IKWorkspace& workspace) const
+{
+  const moveit::core::JointModelGroup::CompiledKinematics& kinematics = joint_model_group_->getCompiledKinematics();
+  const std::vector<const moveit::core::LinkModel*>& links = joint_model_group_->getUpdatedLinkModels();
+  Eigen::MatrixXd& jacobian = workspace.jacobian;
+  jacobian.setZero();
+
+  for (std::size_t i = 0; i < tip_links_.size(); ++i)
+  {
+    const Eigen::Vector3d& tip_position = workspace.state.getGlobalLinkTransform(tip_links_[i]).translation();
+
+    // walk from the tip towards the root of the group, like RobotState::getJacobian()
+    for (int slot = tip_slots_[i]; slot >= 0; slot = kinematics.parent_slots[slot])
+    {
+      const int variable = kinematics.group_variable_indices[slot];
+      if (variable < 0 || active_columns_[variable] < 0)
+        continue;
+
+      const int column = active_columns_[variable];
+      const Eigen::Isometry3d& joint_transform = workspace.state.getGlobalLinkTransform(links[slot]);
+      const Eigen::Vector3d joint_axis =
+          column_factors_[variable] * (joint_transform.linear() * kinematics.joint_axes[slot]);
+      if (kinematics.joint_types[slot] == moveit::core::JointModel::REVOLUTE)
+      {
+        jacobian.block<3, 1>(6 * i, column) += joint_axis.cross(tip_position - joint_transform.translation());
+        jacobian.block<3, 1>(6 * i + 3, column) += orientation_vs_position_weight_ * joint_axis;
+      }
+      else if (kinematics.joint_types[slot] == moveit::core::JointModel::PRISMATIC)
+        jacobian.block<3, 1>(6 * i, column) += joint_axis;
+    }
+  }
+}
+
+bool DLSKinematicsPlugin::solve(IKWorkspace& workspace) const
+{
+  setActivePositions(workspace, workspace.q);
+  double cost = computeError(workspace, workspace.error);
+  double damping = damping_;
+  bool update_jacobian = true;
+
+  for (int iteration = 0; iteration < max_solver_iterations_; ++iteration)
+  {
+    if (workspace.error.lpNorm<Eigen::Infinity>() < epsilon_)
+      return true;
+
+    // the Jacobian only changes when a step is accepted; rejected steps are retried with more damping
+    if (update_jacobian)
+    {
+      computeJacobian(workspace);
+      workspace.jtj.noalias() = workspace.jacobian.transpose() * workspace.jacobian;
+      workspace.jte.noalias() = workspace.jacobian.transpose() * workspace.error;
+      update_jacobian = false;
+    }
+
+    // damped least-squares step: (J^T J + lambda I) dq = J^T e
+    workspace.normal = workspace.jtj;
+    workspace.normal.diagonal().array() += damping;
+    workspace.llt.compute(workspace.normal);
+    workspace.dq = workspace.llt.solve(workspace.jte);
+
+    workspace.q_trial = workspace.q + workspace.dq;
+    for (std::size_t i = 0; i < active_joints_.size(); ++i)
+      active_joints_[i]->enforcePositionBounds(&workspace.q_trial[i]);
+
+    setActivePositions(workspace, workspace.q_trial);
+    const double trial_cost = computeError(workspace, workspace.trial_error);
+    if (trial_cost < cost)
+    {
+      workspace.q.swap(workspace.q_trial);
+      workspace.error.swap(workspace.trial_error);
+      cost = trial_cost;
+      damping = std::max(damping * 0.1, MIN_DAMPING);
+      update_jacobian = true;
+    }
+    else
+    {
+      damping *= 10.0;
+      if (damping > MAX_DAMPING)  // stuck in a local minimum
+        break;
+    }
+  }
+  return workspace.error.lpNorm<Eigen::Infinity>() < epsilon_;
+}
+
+bool DLSKinematicsPlugin::getPositionIK(const geometry_msgs::msg::Pose& ik_pose,
+                                        const std::vector<double>& ik_seed_state, std::vector<double>& solution,
+                                        moveit_msgs::msg::MoveItErrorCodes& error_code,
+                                        const kinematics::KinematicsQueryOptions& options) const
+{
+  std::vector<double> consistency_limits;
+
+  // limit search to a single attempt by setting a timeout of zero
+  return searchPositionIK(ik_pose, ik_seed_state, 0.0, consistency_limits, solution, IKCallbackFn(), error_code,
+                          options);
+}
+
+bool DLSKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_pose,
+                                           const std::vector<double>& ik_seed_state, double timeout,
+                                           std::vector<double>& solution,
+                                           moveit_msgs::msg::MoveItErrorCodes& error_code,
+                                           const kinematics::KinematicsQueryOptions& options) const
+{
+  std::vector<double> consistency_limits;
+
+  return searchPositionIK(ik_pose, ik_seed_state, timeout, consistency_limits, solution, IKCallbackFn(), error_code,
+                          options);
+}
+
+bool DLSKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_pose,
+                                           const std::vector<double>& ik_seed_state, double timeout,
+                                           const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                                           moveit_msgs::msg::MoveItErrorCodes& error_code,
+                                           const kinematics::KinematicsQueryOptions& options) const
+{
+  return searchPositionIK(ik_pose, ik_seed_state, timeout, consistency_limits, solution, IKCallbackFn(), error_code,
+                          options);
+}
+
+bool DLSKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_pose,
+                                           const std::vector<double>& ik_seed_state, double timeout,
+                                           std::vector<double>& solution, const IKCallbackFn& solution_callback,
+                                           moveit_msgs::msg::MoveItErrorCodes& error_code,
+                                           const kinematics::KinematicsQueryOptions& options) const
+{
+  std::vector<double> consistency_limits;
+  return searchPositionIK(ik_pose, ik_seed_state, timeout, consistency_limits, solution, solution_callback, error_code,
+                          options);
+}
+
+bool DLSKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_pose,
+                                           const std::vector<double>& ik_seed_state, double timeout,
+                                           const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                                           const IKCallbackFn& solution_callback,
+                                           moveit_msgs::msg::MoveItErrorCodes& error_code,
+                                           const kinematics::KinematicsQueryOptions& options) const
+{
+  const std::vector<geometry_msgs::msg::Pose> ik_poses(1, ik_pose);
+  return searchPositionIK(ik_poses, ik_seed_state, timeout, consistency_limits, solution, solution_callback,
+                          error_code, options);
+}
+
+bool DLSKinematicsPlugin::searchPositionIK(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                           const std::vector<double>& ik_seed_state, double timeout,
+                                           const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                                           const IKCallbackFn& solution_callback,
+                                           moveit_msgs::msg::MoveItErrorCodes& error_code,
+                                           const kinematics::KinematicsQueryOptions& options,
+                                           const moveit::core::RobotState* context_state) const
+{
+  if (!initialized_)
+  {
+    RCLCPP_ERROR(LOGGER, "kinematics solver not initialized");
+    error_code.val = error_code.NO_IK_SOLUTION;
+    return false;
+  }
+
+  std::unique_ptr<IKWorkspace> workspace = acquireWorkspace();
+  const bool found = searchPositionIK(ik_poses, ik_seed_state, timeout, consistency_limits, solution,
+                                      solution_callback, error_code, options, context_state, *workspace);
+  releaseWorkspace(std::move(workspace));
+  return found;
+}
+
+bool DLSKinematicsPlugin::searchPositionIKBatch(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                                const std::vector<std::vector<double> >& ik_seed_states,
+                                                double timeout, std::vector<std::vector<double> >& solutions,
+                                                std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+                                                const kinematics::KinematicsQueryOptions& options,
+                                                unsigned int num_threads) const
+{
+  if (!initBatchQuery(ik_poses, ik_seed_states, solutions, error_codes))
+    return false;
+  if (!initialized_)
+  {
+    RCLCPP_ERROR(LOGGER, "kinematics solver not initialized");
+    for (auto& error_code : error_codes)
+      error_code.val = error_code.NO_IK_SOLUTION;
+    return false;
+  }
+
+  // each thread solves its queries with its own workspace, which is returned to the pool when the thread is done
+  std::atomic<bool> solved_all(true);
+  const std::vector<double> consistency_limits;
+  forEachBatchQuery(ik_poses.size(), num_threads, [&]() -> std::function<void(std::size_t)> {
+    std::shared_ptr<IKWorkspace> workspace(acquireWorkspace().release(), [this](IKWorkspace* workspace) {
+      releaseWorkspace(std::unique_ptr<IKWorkspace>(workspace));
+    });
+    auto pose = std::make_shared<std::vector<geometry_msgs::msg::Pose> >(1);
+    return [&, workspace, pose](std::size_t i) {
+      (*pose)[0] = ik_poses[i];
+      if (!searchPositionIK(*pose, ik_seed_states.size() == 1 ? ik_seed_states[0] : ik_seed_states[i], timeout,
+                            consistency_limits, solutions[i], IKCallbackFn(), error_codes[i], options, nullptr,
+                            *workspace))
+        solved_all = false;
+    };
+  });
+  return solved_all;
+}
+
+bool DLSKinematicsPlugin::searchPositionIK(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                           const std::vector<double>& ik_seed_state, double timeout,
+                                           const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                                           const IKCallbackFn& solution_callback,
+                                           moveit_msgs::msg::MoveItErrorCodes& error_code,
+                                           const kinematics::KinematicsQueryOptions& options,
+                                           const moveit::core::RobotState* context_state, IKWorkspace& workspace) const
+{
+  rclcpp::Time start_time = node_->now();
+  if (ik_poses.size() != tip_links_.size())
+  {
+    RCLCPP_ERROR(LOGGER, "Expected one pose per tip frame (%zu) instead of %zu poses", tip_links_.size(),
+                 ik_poses.size());
+    error_code.val = error_code.NO_IK_SOLUTION;
+    return false;
+  }
+
+  if (ik_seed_state.size() != dimension_)
+  {
+    RCLCPP_ERROR(LOGGER, "Seed state must have size %d instead of size %zu", dimension_, ik_seed_state.size());
+    error_code.val = error_code.NO_IK_SOLUTION;
+    return false;
+  }
+
+  // random re-seeding samples the active joints only
+  std::vector<double>& consistency_limits_active = workspace.consistency_limits_active;
+  consistency_limits_active.clear();
+  if (!consistency_limits.empty())
+  {
+    if (consistency_limits.size() != dimension_)
+    {
+      RCLCPP_ERROR(LOGGER, "Consistency limits must be empty or have size %d instead of size %zu", dimension_,
+                   consistency_limits.size());
+      error_code.val = error_code.NO_IK_SOLUTION;
+      return false;
+    }
+    for (int index : active_group_indices_)
+      consistency_limits_active.push_back(consistency_limits[index]);
+  }
+
+  // the joints outside of the group keep the values of the context state, or the default values otherwise
+  moveit::core::RobotState& state = workspace.state;
+  if (context_state)
+  {
+    state.assignFrom(*context_state);
+    workspace.has_context = true;
+  }
+  else if (workspace.has_context)
+  {
+    state.assignFrom(*state_);
+    workspace.has_context = false;
+  }
+
+  state.setJointGroupPositions(joint_model_group_, ik_seed_state);
+  state.updateLinkTransforms();
+  const Eigen::Isometry3d base_transform = getBaseTransform(state);
+  for (std::size_t i = 0; i < ik_poses.size(); ++i)
+  {
+    tf2::fromMsg(ik_poses[i], workspace.targets[i]);
+    workspace.targets[i] = base_transform * workspace.targets[i];
+  }
+  for (std::size_t i = 0; i < active_group_indices_.size(); ++i)
+    workspace.q_seed[i] = ik_seed_state[active_group_indices_[i]];
+
+  solution.resize(dimension_);
+
+  RCLCPP_DEBUG_STREAM(LOGGER, "searchPositionIK: Position request pose is "
+                                  << ik_poses[0].position.x << " " << ik_poses[0].position.y << " "
+                                  << ik_poses[0].position.z << " " << ik_poses[0].orientation.x << " "
+                                  << ik_poses[0].orientation.y << " " << ik_poses[0].orientation.z << " "
+                                  << ik_poses[0].orientation.w);
+
+  unsigned int attempt = 0;
+  do
+  {
+    ++attempt;
+    if (attempt > 1)  // randomly re-seed after first attempt
+    {
+      if (!consistency_limits_active.empty())
+        joint_model_group_->getVariableRandomPositionsNearBy(state.getRandomNumberGenerator(),
+                                                             workspace.positions.data(), ik_seed_state.data(),
+                                                             consistency_limits_active);
+      else
+        joint_model_group_->getVariableRandomPositions(state.getRandomNumberGenerator(), workspace.positions.data());
+      for (std::size_t i = 0; i < active_group_indices_.size(); ++i)
+        workspace.q[i] = workspace.positions[active_group_indices_[i]];
+      RCLCPP_DEBUG_STREAM(LOGGER, "New random configuration (" << attempt << "): " << workspace.q.transpose());
+    }
+    else  // warm start from the seed
+      workspace.q = workspace.q_seed;
+
+    if (solve(workspace) || options.return_approximate_solution)  // found acceptable solution
+    {
+      for (std::size_t i = 0; i < active_joints_.size(); ++i)
+        active_joints_[i]->harmonizePosition(&workspace.q[i]);
+      state.setJointGroupActivePositions(joint_model_group_, workspace.q);
+      state.copyJointGroupPositions(joint_model_group_, solution.data());
+
+      if (!consistency_limits_active.empty() && !checkConsistency(ik_seed_state, consistency_limits, solution))
+        continue;
+      if (!solution_callback.empty())
+      {
+        solution_callback(ik_poses[0], solution, error_code);
+        if (error_code.val != error_code.SUCCESS)
+          continue;
+      }
+
+      // solution passed consistency check and solution callback
+      error_code.val = error_code.SUCCESS;
+      RCLCPP_DEBUG_STREAM(LOGGER, "Solved after " << (node_->now() - start_time).seconds() << " < " << timeout
+                                                  << "s and " << attempt << " attempts");
+      return true;
+    }
+  } while (!timedOut(start_time, timeout));
+
+  RCLCPP_DEBUG_STREAM(LOGGER, "IK timed out after " << (node_->now() - start_time).seconds() << " > " << timeout
+                                                    << "s and " << attempt << " attempts");
+  error_code.val = error_code.TIMED_OUT;
+  return false;
+}
+
+bool DLSKinematicsPlugin::getPositionFK(const std::vector<std::string>& link_names,
+                                        const std::vector<double>& joint_angles,
+                                        std::vector<geometry_msgs::msg::Pose>& poses) const
+{
+  if (!initialized_)
+  {
+    RCLCPP_ERROR(LOGGER, "kinematics solver not initialized");
+    return false;
+  }
+  poses.resize(link_names.size());
+  if (joint_angles.size() != dimension_)
+  {
+    RCLCPP_ERROR(LOGGER, "Joint angles vector must have size: %d", dimension_);
+    return false;
+  }
+
+  std::unique_ptr<IKWorkspace> workspace = acquireWorkspace();
+  moveit::core::RobotState& state = workspace->state;
+  if (workspace->has_context)
+  {
+    state.assignFrom(*state_);
+    workspace->has_context = false;
+  }
+  state.setJointGroupPositions(joint_model_group_, joint_angles);
+  state.updateLinkTransforms();
+  const Eigen::Isometry3d base_inverse = getBaseTransform(state).inverse();
+
+  bool valid = true;
+  for (unsigned int i = 0; i < poses.size(); i++)
+  {
+    if (robot_model_->hasLinkModel(link_names[i]))
+    {
+      poses[i] = tf2::toMsg(base_inverse * state.getGlobalLinkTransform(link_names[i]));
+    }
+    else
+    {
+      RCLCPP_ERROR(LOGGER, "Could not compute FK for %s", link_names[i].c_str());
+      valid = false;
+    }
+  }
+  releaseWorkspace(std::move(workspace));
+  return valid;
+}
+
+const std::vector<std::string>& DLSKinematicsPlugin::getJointNames() const
+{
+  return joint_names_;
+}
+
+const std::vector<std::string>& DLSKinematicsPlugin::getLinkNames() const
+{
+  return getTipFrames();
+}
+
+}  // namespace dls_kinematics_plugin
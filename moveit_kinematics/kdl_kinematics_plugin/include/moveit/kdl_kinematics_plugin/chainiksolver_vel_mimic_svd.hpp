@@ -68,7 +68,7 @@ public:
 
   int CartToJnt(const JntArray& q_in, const Twist& v_in, JntArray& qdot_out) override
   {
-    return CartToJnt(q_in, v_in, qdot_out, Eigen::VectorXd::Constant(svd_.cols(), 1.0),
+    return CartToJnt(q_in, v_in, qdot_out, Eigen::VectorXd::Constant(jac_reduced_.columns(), 1.0),
                      Eigen::Matrix<double, 6, 1>::Constant(1.0));
   }
 
@@ -89,12 +89,20 @@ public:
   /// Return true iff we ignore orientation but only consider position for inverse kinematics
   bool isPositionOnly() const
   {
-    return svd_.rows() == 3;
+    return rows_ == 3;
   }
 
+  /// Chains with up to this many active joints are solved with fixed-size storage, without heap allocations
+  static constexpr int MAX_FIXED_SIZE_JOINTS = 7;
+
 private:
   bool jacToJacReduced(const Jacobian& jac, Jacobian& jac_reduced);
 
+  /// Solve the weighted Jacobian for v_in with the given SVD, decomposing a copy of the used rows in jac_rows
+  template <typename SVD>
+  void solve(SVD& svd, typename SVD::MatrixType& jac_rows, const Eigen::Matrix<double, 6, 1>& v_in,
+             Eigen::VectorXd& qdot_out);
+
   // Mimic joint specific
   const std::vector<kdl_kinematics_plugin::JointMimic>& mimic_joints_;
   int num_mimic_joints_;
@@ -102,7 +110,14 @@ private:
   const Chain& chain_;
   ChainJntToJacSolver jnt2jac_;
 
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor, 6, MAX_FIXED_SIZE_JOINTS>
+      FixedSizeMatrix;
+
+  Eigen::Index rows_;  // 3 for position-only IK, 6 otherwise
+  bool use_fixed_size_;
   Eigen::JacobiSVD<Eigen::MatrixXd> svd_;
+  Eigen::JacobiSVD<FixedSizeMatrix> fixed_size_svd_;
+  Eigen::MatrixXd jac_rows_;  // used rows of the weighted Jacobian, decomposed by svd_
   Eigen::VectorXd qdot_out_reduced_;
 
   Jacobian jac_;          // full Jacobian
@@ -59,6 +59,8 @@
 #include <moveit/robot_state/robot_state.h>
 
 #include <cfloat>
+#include <memory>
+#include <mutex>
 
 namespace KDL
 {
@@ -79,6 +81,8 @@ public:
    */
   KDLKinematicsPlugin();
 
+  ~KDLKinematicsPlugin() override;
+
   bool
   getPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
                 std::vector<double>& solution, moveit_msgs::msg::MoveItErrorCodes& error_code,
@@ -107,6 +111,17 @@ public:
       const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code,
       const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const override;
 
+  /**
+   * @brief Solve a batch of IK queries on up to num_threads threads. Each thread allocates its solver objects once
+   * and reuses them for all of its queries.
+   */
+  bool searchPositionIKBatch(
+      const std::vector<geometry_msgs::msg::Pose>& ik_poses, const std::vector<std::vector<double> >& ik_seed_states,
+      double timeout, std::vector<std::vector<double> >& solutions,
+      std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+      const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions(),
+      unsigned int num_threads = 1) const override;
+
   bool getPositionFK(const std::vector<std::string>& link_names, const std::vector<double>& joint_angles,
                      std::vector<geometry_msgs::msg::Pose>& poses) const override;
 
@@ -127,13 +142,43 @@ public:
 protected:
   typedef Eigen::Matrix<double, 6, 1> Twist;
 
+  /** Preallocated solvers and buffers for one IK query at a time */
+  struct IKWorkspace;
+
   /// Solve position IK given initial joint values
   // NOLINTNEXTLINE(readability-identifier-naming)
   int CartToJnt(KDL::ChainIkSolverVelMimicSVD& ik_solver, const KDL::JntArray& q_init, const KDL::Frame& p_in,
                 KDL::JntArray& q_out, const unsigned int max_iter, const Eigen::VectorXd& joint_weights,
                 const Twist& cartesian_weights) const;
 
+  /// Solve position IK given initial joint values, using the solvers and buffers of the given workspace
+  // NOLINTNEXTLINE(readability-identifier-naming)
+  int CartToJnt(IKWorkspace& workspace, const KDL::JntArray& q_init, const KDL::Frame& p_in, KDL::JntArray& q_out,
+                const unsigned int max_iter, const Eigen::VectorXd& joint_weights,
+                const Twist& cartesian_weights) const;
+
+  /** @brief Take a workspace from the pool, or create a new one if all are in use.
+   *  Hand it back with releaseWorkspace() to avoid allocations in later queries. */
+  std::unique_ptr<IKWorkspace> acquireWorkspace() const;
+
+  /** @brief Return a workspace obtained from acquireWorkspace() to the pool */
+  void releaseWorkspace(std::unique_ptr<IKWorkspace> workspace) const;
+
 private:
+  /** @brief Implementation of searchPositionIK() using the given workspace, which must not be used by other threads
+   *  at the same time */
+  bool searchPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                        double timeout, const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                        const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options, IKWorkspace& workspace) const;
+
+  /// Iterate the position IK using the given solvers and the preallocated buffers, which are overwritten
+  // NOLINTNEXTLINE(readability-identifier-naming)
+  int CartToJnt(KDL::ChainFkSolverPos& fk_solver, KDL::ChainIkSolverVelMimicSVD& ik_solver,
+                const KDL::JntArray& q_init, const KDL::Frame& p_in, KDL::JntArray& q_out, const unsigned int max_iter,
+                const Eigen::VectorXd& joint_weights, const Twist& cartesian_weights, KDL::JntArray& delta_q,
+                KDL::JntArray& q_backup, Eigen::ArrayXd& extra_joint_weights, Eigen::VectorXd& weights) const;
+
   void getJointWeights();
   bool timedOut(const rclcpp::Time& start_time, double duration) const;
 
@@ -146,15 +191,16 @@ private:
   bool checkConsistency(const Eigen::VectorXd& seed_state, const std::vector<double>& consistency_limits,
                         const Eigen::VectorXd& solution) const;
 
-  void getRandomConfiguration(Eigen::VectorXd& jnt_array) const;
+  void getRandomConfiguration(moveit::core::RobotState& state, Eigen::VectorXd& jnt_array) const;
 
   /** @brief Get a random configuration within consistency limits close to the seed state
+   *  @param state State providing the random number generator
    *  @param seed_state Seed state
    *  @param consistency_limits
    *  @param jnt_array Returned random configuration
    */
-  void getRandomConfiguration(const Eigen::VectorXd& seed_state, const std::vector<double>& consistency_limits,
-                              Eigen::VectorXd& jnt_array) const;
+  void getRandomConfiguration(moveit::core::RobotState& state, const Eigen::VectorXd& seed_state,
+                              const std::vector<double>& consistency_limits, Eigen::VectorXd& jnt_array) const;
 
   /// clip q_delta such that joint limits will not be violated
   void clipToJointLimits(const KDL::JntArray& q, KDL::JntArray& q_delta, Eigen::ArrayXd& weighting) const;
@@ -180,5 +226,9 @@ private:
    * > 1.0: orientation has more importance than position
    * = 0.0: perform position-only IK */
   double orientation_vs_position_weight_;
+
+  /// workspaces of finished queries, reused by subsequent ones
+  mutable std::mutex workspace_mutex_;
+  mutable std::vector<std::unique_ptr<IKWorkspace>> workspace_pool_;
 };
 }  // namespace kdl_kinematics_plugin
@@ -49,10 +49,18 @@ ChainIkSolverVelMimicSVD::ChainIkSolverVelMimicSVD(const Chain& chain,
   , chain_(chain)
   , jnt2jac_(chain)
   // Performing a position-only IK, we just need to consider the first 3 rows of the Jacobian for SVD
+  , rows_(position_ik ? 3 : 6)
   // SVD doesn't consider mimic joints, but only their driving joints
-  , svd_(position_ik ? 3 : 6, chain_.getNrOfJoints() - num_mimic_joints_, Eigen::ComputeThinU | Eigen::ComputeThinV)
+  , use_fixed_size_(chain_.getNrOfJoints() - num_mimic_joints_ <= MAX_FIXED_SIZE_JOINTS)
+  // only size the decomposition that is actually used
+  , svd_(use_fixed_size_ ? 0 : rows_, use_fixed_size_ ? 0 : chain_.getNrOfJoints() - num_mimic_joints_,
+         Eigen::ComputeThinU | Eigen::ComputeThinV)
+  , fixed_size_svd_(use_fixed_size_ ? rows_ : 0, use_fixed_size_ ? chain_.getNrOfJoints() - num_mimic_joints_ : 0,
+                    Eigen::ComputeThinU | Eigen::ComputeThinV)
+  , jac_rows_(use_fixed_size_ ? 0 : rows_, use_fixed_size_ ? 0 : chain_.getNrOfJoints() - num_mimic_joints_)
+  , qdot_out_reduced_(chain_.getNrOfJoints() - num_mimic_joints_)
   , jac_(chain_.getNrOfJoints())
-  , jac_reduced_(svd_.cols())
+  , jac_reduced_(chain_.getNrOfJoints() - num_mimic_joints_)
 {
   assert(mimic_joints_.size() == chain.getNrOfJoints());
 #ifndef NDEBUG
@@ -60,6 +68,7 @@ ChainIkSolverVelMimicSVD::ChainIkSolverVelMimicSVD(const Chain& chain,
     assert(item.map_index < chain_.getNrOfJoints());
 #endif
   svd_.setThreshold(threshold);
+  fixed_size_svd_.setThreshold(threshold);
 }
 
 void ChainIkSolverVelMimicSVD::updateInternalDataStructures()
@@ -83,6 +92,22 @@ bool ChainIkSolverVelMimicSVD::jacToJacReduced(const Jacobian& jac, Jacobian& ja
   return true;
 }
 
+template <typename SVD>
+void ChainIkSolverVelMimicSVD::solve(SVD& svd, typename SVD::MatrixType& jac_rows,
+                                     const Eigen::Matrix<double, 6, 1>& v_in, Eigen::VectorXd& qdot_out)
+{
+  // Do a singular value decomposition: J = U*S*V^t
+  jac_rows = jac_reduced_.data.topRows(rows_);
+  svd.compute(jac_rows);
+
+  // Same as svd.solve(v_in), but as the rank is at most 6, the intermediate vector can live on the stack
+  const Eigen::Index rank = svd.rank();
+  Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor, 6, 1> tmp;
+  tmp.noalias() = svd.matrixU().leftCols(rank).adjoint() * v_in.topRows(rows_);
+  tmp = svd.singularValues().head(rank).asDiagonal().inverse() * tmp;
+  qdot_out.noalias() = svd.matrixV().leftCols(rank) * tmp;
+}
+
 // NOLINTNEXTLINE(readability-identifier-naming)
 int ChainIkSolverVelMimicSVD::CartToJnt(const JntArray& q_in, const Twist& v_in, JntArray& qdot_out,
                                         const Eigen::VectorXd& joint_weights,
@@ -100,7 +125,7 @@ int ChainIkSolverVelMimicSVD::CartToJnt(const JntArray& q_in, const Twist& v_in,
 
   // weight Jacobian
   auto& jac = jac_reduced_.data;
-  const Eigen::Index rows = svd_.rows();  // only operate on position rows?
+  const Eigen::Index rows = rows_;  // only operate on position rows?
   jac.topRows(rows) *= joint_weights.asDiagonal();
   jac.topRows(rows).transpose() *= cartesian_weights.topRows(rows).asDiagonal();
 
@@ -109,21 +134,24 @@ int ChainIkSolverVelMimicSVD::CartToJnt(const JntArray& q_in, const Twist& v_in,
   vin.topRows<3>() = Eigen::Map<const Eigen::Array3d>(v_in.vel.data, 3) * cartesian_weights.topRows<3>().array();
   vin.bottomRows<3>() = Eigen::Map<const Eigen::Array3d>(v_in.rot.data, 3) * cartesian_weights.bottomRows<3>().array();
 
-  // Do a singular value decomposition: J = U*S*V^t
-  svd_.compute(jac.topRows(rows));
+  // Solve into qdot_out directly if there are no mimic joints to map
+  Eigen::VectorXd& qdot = num_mimic_joints_ > 0 ? qdot_out_reduced_ : qdot_out.data;
+  if (use_fixed_size_)
+  {
+    FixedSizeMatrix jac_rows;
+    solve(fixed_size_svd_, jac_rows, vin, qdot);
+  }
+  else
+    solve(svd_, jac_rows_, vin, qdot);
 
   if (num_mimic_joints_ > 0)
   {
-    qdot_out_reduced_.noalias() = svd_.solve(vin.topRows(rows));
     qdot_out_reduced_.array() *= joint_weights.array();
     for (unsigned int i = 0; i < chain_.getNrOfJoints(); ++i)
       qdot_out(i) = qdot_out_reduced_[mimic_joints_[i].map_index] * mimic_joints_[i].multiplier;
   }
   else
-  {
-    qdot_out.data.noalias() = svd_.solve(vin.topRows(rows));
     qdot_out.data.array() *= joint_weights.array();
-  }
 
   return 0;
 }
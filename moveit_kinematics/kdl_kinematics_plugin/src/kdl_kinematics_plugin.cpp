@@ -45,26 +45,82 @@
 #include <kdl/frames_io.hpp>
 #include <kdl/kinfam_io.hpp>
 
+#include <atomic>
+#include <memory>
+
 namespace kdl_kinematics_plugin
 {
 static rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_kdl_kinematics_plugin.kdl_kinematics_plugin");
 
+/** Solvers and buffers of a single IK query, allocated once and reused across queries */
+struct KDLKinematicsPlugin::IKWorkspace
+{
+  explicit IKWorkspace(const KDLKinematicsPlugin& plugin)
+    : fk_solver(plugin.kdl_chain_)
+    , ik_solver_vel(plugin.kdl_chain_, plugin.mimic_joints_, plugin.orientation_vs_position_weight_ == 0.0)
+    , state(*plugin.state_)
+    , jnt_seed_state(plugin.dimension_)
+    , jnt_pos_in(plugin.dimension_)
+    , jnt_pos_out(plugin.dimension_)
+    , delta_q(plugin.dimension_)
+    , q_backup(plugin.dimension_)
+    , joint_weights(Eigen::Map<const Eigen::VectorXd>(plugin.joint_weights_.data(), plugin.joint_weights_.size()))
+    , extra_joint_weights(joint_weights.size())
+    , weights(joint_weights.size())
+  {
+    consistency_limits_mimic.reserve(plugin.dimension_);
+  }
+
+  KDL::ChainFkSolverPos_recursive fk_solver;
+  KDL::ChainIkSolverVelMimicSVD ik_solver_vel;
+  moveit::core::RobotState state;  ///< provides the random number generator for re-seeding
+
+  KDL::JntArray jnt_seed_state, jnt_pos_in, jnt_pos_out;
+  KDL::JntArray delta_q, q_backup;
+  Eigen::VectorXd joint_weights;
+  Eigen::ArrayXd extra_joint_weights;
+  Eigen::VectorXd weights;  ///< joint_weights * extra_joint_weights
+  std::vector<double> consistency_limits_mimic;
+};
+
 KDLKinematicsPlugin::KDLKinematicsPlugin() : initialized_(false)
 {
 }
 
-void KDLKinematicsPlugin::getRandomConfiguration(Eigen::VectorXd& jnt_array) const
+KDLKinematicsPlugin::~KDLKinematicsPlugin() = default;
+
+std::unique_ptr<KDLKinematicsPlugin::IKWorkspace> KDLKinematicsPlugin::acquireWorkspace() const
+{
+  {
+    std::lock_guard<std::mutex> lock(workspace_mutex_);
+    if (!workspace_pool_.empty())
+    {
+      std::unique_ptr<IKWorkspace> workspace = std::move(workspace_pool_.back());
+      workspace_pool_.pop_back();
+      return workspace;
+    }
+  }
+  return std::make_unique<IKWorkspace>(*this);
+}
+
+void KDLKinematicsPlugin::releaseWorkspace(std::unique_ptr<IKWorkspace> workspace) const
+{
+  std::lock_guard<std::mutex> lock(workspace_mutex_);
+  workspace_pool_.push_back(std::move(workspace));
+}
+
+void KDLKinematicsPlugin::getRandomConfiguration(moveit::core::RobotState& state, Eigen::VectorXd& jnt_array) const
 {
-  state_->setToRandomPositions(joint_model_group_);
-  state_->copyJointGroupPositions(joint_model_group_, &jnt_array[0]);
+  state.setToRandomPositions(joint_model_group_);
+  state.copyJointGroupPositions(joint_model_group_, &jnt_array[0]);
 }
 
-void KDLKinematicsPlugin::getRandomConfiguration(const Eigen::VectorXd& seed_state,
+void KDLKinematicsPlugin::getRandomConfiguration(moveit::core::RobotState& state, const Eigen::VectorXd& seed_state,
                                                  const std::vector<double>& consistency_limits,
                                                  Eigen::VectorXd& jnt_array) const
 {
-  joint_model_group_->getVariableRandomPositionsNearBy(state_->getRandomNumberGenerator(), &jnt_array[0],
-                                                       &seed_state[0], consistency_limits);
+  joint_model_group_->getVariableRandomPositionsNearBy(state.getRandomNumberGenerator(), &jnt_array[0], &seed_state[0],
+                                                       consistency_limits);
 }
 
 bool KDLKinematicsPlugin::checkConsistency(const Eigen::VectorXd& seed_state,
@@ -261,6 +317,9 @@ bool KDLKinematicsPlugin::initialize(const rclcpp::Node::SharedPtr& node, const
 
   fk_solver_.reset(new KDL::ChainFkSolverPos_recursive(kdl_chain_));
 
+  // drop workspaces referring to a previous configuration
+  workspace_pool_.clear();
+
   initialized_ = true;
   RCLCPP_DEBUG(LOGGER, "KDL solver initialized");
   return true;
@@ -323,7 +382,6 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
                                            moveit_msgs::msg::MoveItErrorCodes& error_code,
                                            const kinematics::KinematicsQueryOptions& options) const
 {
-  rclcpp::Time start_time = node_->now();
   if (!initialized_)
   {
     RCLCPP_ERROR(LOGGER, "kinematics solver not initialized");
@@ -331,6 +389,55 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
     return false;
   }
 
+  std::unique_ptr<IKWorkspace> workspace = acquireWorkspace();
+  const bool found = searchPositionIK(ik_pose, ik_seed_state, timeout, consistency_limits, solution, solution_callback,
+                                      error_code, options, *workspace);
+  releaseWorkspace(std::move(workspace));
+  return found;
+}
+
+bool KDLKinematicsPlugin::searchPositionIKBatch(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                                const std::vector<std::vector<double> >& ik_seed_states,
+                                                double timeout, std::vector<std::vector<double> >& solutions,
+                                                std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+                                                const kinematics::KinematicsQueryOptions& options,
+                                                unsigned int num_threads) const
+{
+  if (!initBatchQuery(ik_poses, ik_seed_states, solutions, error_codes))
+    return false;
+  if (!initialized_)
+  {
+    RCLCPP_ERROR(LOGGER, "kinematics solver not initialized");
+    for (auto& error_code : error_codes)
+      error_code.val = error_code.NO_IK_SOLUTION;
+    return false;
+  }
+
+  // each thread solves its queries with its own workspace, which is returned to the pool when the thread is done
+  std::atomic<bool> solved_all(true);
+  const std::vector<double> consistency_limits;
+  forEachBatchQuery(ik_poses.size(), num_threads, [&]() -> std::function<void(std::size_t)> {
+    std::shared_ptr<IKWorkspace> workspace(acquireWorkspace().release(), [this](IKWorkspace* workspace) {
+      releaseWorkspace(std::unique_ptr<IKWorkspace>(workspace));
+    });
+    return [&, workspace](std::size_t i) {
+      if (!searchPositionIK(ik_poses[i], ik_seed_states.size() == 1 ? ik_seed_states[0] : ik_seed_states[i], timeout,
+                            consistency_limits, solutions[i], IKCallbackFn(), error_codes[i], options, *workspace))
+        solved_all = false;
+    };
+  });
+  return solved_all;
+}
+
+bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_pose,
+                                           const std::vector<double>& ik_seed_state, double timeout,
+                                           const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                                           const IKCallbackFn& solution_callback,
+                                           moveit_msgs::msg::MoveItErrorCodes& error_code,
+                                           const kinematics::KinematicsQueryOptions& options,
+                                           IKWorkspace& workspace) const
+{
+  rclcpp::Time start_time = node_->now();
   if (ik_seed_state.size() != dimension_)
   {
     RCLCPP_ERROR(LOGGER, "Seed state must have size %d instead of size %d\n", dimension_, ik_seed_state.size());
@@ -339,7 +446,8 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
   }
 
   // Resize consistency limits to remove mimic joints
-  std::vector<double> consistency_limits_mimic;
+  std::vector<double>& consistency_limits_mimic = workspace.consistency_limits_mimic;
+  consistency_limits_mimic.clear();
   if (!consistency_limits.empty())
   {
     if (consistency_limits.size() != dimension_)
@@ -360,13 +468,12 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
   cartesian_weights.topRows<3>().setConstant(1.0);
   cartesian_weights.bottomRows<3>().setConstant(orientation_vs_position_weight_);
 
-  KDL::JntArray jnt_seed_state(dimension_);
-  KDL::JntArray jnt_pos_in(dimension_);
-  KDL::JntArray jnt_pos_out(dimension_);
+  KDL::JntArray& jnt_seed_state = workspace.jnt_seed_state;
+  KDL::JntArray& jnt_pos_in = workspace.jnt_pos_in;
+  KDL::JntArray& jnt_pos_out = workspace.jnt_pos_out;
   jnt_seed_state.data = Eigen::Map<const Eigen::VectorXd>(ik_seed_state.data(), ik_seed_state.size());
   jnt_pos_in = jnt_seed_state;
 
-  KDL::ChainIkSolverVelMimicSVD ik_solver_vel(kdl_chain_, mimic_joints_, orientation_vs_position_weight_ == 0.0);
   solution.resize(dimension_);
 
   KDL::Frame pose_desired;
@@ -384,15 +491,14 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
     if (attempt > 1)  // randomly re-seed after first attempt
     {
       if (!consistency_limits_mimic.empty())
-        getRandomConfiguration(jnt_seed_state.data, consistency_limits_mimic, jnt_pos_in.data);
+        getRandomConfiguration(workspace.state, jnt_seed_state.data, consistency_limits_mimic, jnt_pos_in.data);
       else
-        getRandomConfiguration(jnt_pos_in.data);
+        getRandomConfiguration(workspace.state, jnt_pos_in.data);
       RCLCPP_DEBUG_STREAM(LOGGER, "New random configuration (" << attempt << "): " << jnt_pos_in);
     }
 
-    int ik_valid =
-        CartToJnt(ik_solver_vel, jnt_pos_in, pose_desired, jnt_pos_out, max_solver_iterations_,
-                  Eigen::Map<const Eigen::VectorXd>(joint_weights_.data(), joint_weights_.size()), cartesian_weights);
+    int ik_valid = CartToJnt(workspace, jnt_pos_in, pose_desired, jnt_pos_out, max_solver_iterations_,
+                             workspace.joint_weights, cartesian_weights);
     if (ik_valid == 0 || options.return_approximate_solution)  // found acceptable solution
     {
       if (!consistency_limits_mimic.empty() &&
@@ -425,13 +531,36 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
 int KDLKinematicsPlugin::CartToJnt(KDL::ChainIkSolverVelMimicSVD& ik_solver, const KDL::JntArray& q_init,
                                    const KDL::Frame& p_in, KDL::JntArray& q_out, const unsigned int max_iter,
                                    const Eigen::VectorXd& joint_weights, const Twist& cartesian_weights) const
+{
+  KDL::JntArray delta_q(q_out.rows()), q_backup(q_out.rows());
+  Eigen::ArrayXd extra_joint_weights(joint_weights.rows());
+  Eigen::VectorXd weights(joint_weights.rows());
+  return CartToJnt(*fk_solver_, ik_solver, q_init, p_in, q_out, max_iter, joint_weights, cartesian_weights, delta_q,
+                   q_backup, extra_joint_weights, weights);
+}
+
+// NOLINTNEXTLINE(readability-identifier-naming)
+int KDLKinematicsPlugin::CartToJnt(IKWorkspace& workspace, const KDL::JntArray& q_init, const KDL::Frame& p_in,
+                                   KDL::JntArray& q_out, const unsigned int max_iter,
+                                   const Eigen::VectorXd& joint_weights, const Twist& cartesian_weights) const
+{
+  return CartToJnt(workspace.fk_solver, workspace.ik_solver_vel, q_init, p_in, q_out, max_iter, joint_weights,
+                   cartesian_weights, workspace.delta_q, workspace.q_backup, workspace.extra_joint_weights,
+                   workspace.weights);
+}
+
+// NOLINTNEXTLINE(readability-identifier-naming)
+int KDLKinematicsPlugin::CartToJnt(KDL::ChainFkSolverPos& fk_solver, KDL::ChainIkSolverVelMimicSVD& ik_solver,
+                                   const KDL::JntArray& q_init, const KDL::Frame& p_in, KDL::JntArray& q_out,
+                                   const unsigned int max_iter, const Eigen::VectorXd& joint_weights,
+                                   const Twist& cartesian_weights, KDL::JntArray& delta_q, KDL::JntArray& q_backup,
+                                   Eigen::ArrayXd& extra_joint_weights, Eigen::VectorXd& weights) const
 {
   double last_delta_twist_norm = DBL_MAX;
   double step_size = 1.0;
   KDL::Frame f;
   KDL::Twist delta_twist;
-  KDL::JntArray delta_q(q_out.rows()), q_backup(q_out.rows());
-  Eigen::ArrayXd extra_joint_weights(joint_weights.rows());
+  delta_q.data.setZero();
   extra_joint_weights.setOnes();
 
   q_out = q_init;
@@ -441,7 +570,7 @@ int KDLKinematicsPlugin::CartToJnt(KDL::ChainIkSolverVelMimicSVD& ik_solver, con
   bool success = false;
   for (i = 0; i < max_iter; ++i)
   {
-    fk_solver_->JntToCart(q_out, f);
+    fk_solver.JntToCart(q_out, f);
     delta_twist = diff(f, p_in);
     RCLCPP_DEBUG_STREAM(LOGGER, "[" << std::setw(3) << i << "] delta_twist: " << delta_twist);
 
@@ -471,7 +600,8 @@ int KDLKinematicsPlugin::CartToJnt(KDL::ChainIkSolverVelMimicSVD& ik_solver, con
       step_size = 1.0;   // reset step size
       last_delta_twist_norm = delta_twist_norm;
 
-      ik_solver.CartToJnt(q_out, delta_twist, delta_q, extra_joint_weights * joint_weights.array(), cartesian_weights);
+      weights.array() = extra_joint_weights * joint_weights.array();
+      ik_solver.CartToJnt(q_out, delta_twist, delta_q, weights, cartesian_weights);
     }
 
     clipToJointLimits(q_out, delta_q, extra_joint_weights);
@@ -43,6 +43,8 @@
 #include <kdl/frames_io.hpp>
 #include <kdl/kinfam_io.hpp>
 
+#include <atomic>
+
 // register as a KinematicsBase implementation
 #include <class_loader/class_loader.hpp>
 CLASS_LOADER_REGISTER_CLASS(lma_kinematics_plugin::LMAKinematicsPlugin, kinematics::KinematicsBase)
@@ -55,18 +57,18 @@ LMAKinematicsPlugin::LMAKinematicsPlugin() : initialized_(false)
 {
 }
 
-void LMAKinematicsPlugin::getRandomConfiguration(Eigen::VectorXd& jnt_array) const
+void LMAKinematicsPlugin::getRandomConfiguration(moveit::core::RobotState& state, Eigen::VectorXd& jnt_array) const
 {
-  state_->setToRandomPositions(joint_model_group_);
-  state_->copyJointGroupPositions(joint_model_group_, &jnt_array[0]);
+  state.setToRandomPositions(joint_model_group_);
+  state.copyJointGroupPositions(joint_model_group_, &jnt_array[0]);
 }
 
-void LMAKinematicsPlugin::getRandomConfiguration(const Eigen::VectorXd& seed_state,
+void LMAKinematicsPlugin::getRandomConfiguration(moveit::core::RobotState& state, const Eigen::VectorXd& seed_state,
                                                  const std::vector<double>& consistency_limits,
                                                  Eigen::VectorXd& jnt_array) const
 {
-  joint_model_group_->getVariableRandomPositionsNearBy(state_->getRandomNumberGenerator(), &jnt_array[0],
-                                                       &seed_state[0], consistency_limits);
+  joint_model_group_->getVariableRandomPositionsNearBy(state.getRandomNumberGenerator(), &jnt_array[0], &seed_state[0],
+                                                       consistency_limits);
 }
 
 bool LMAKinematicsPlugin::checkConsistency(const Eigen::VectorXd& seed_state,
@@ -218,7 +220,6 @@ bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
                                            moveit_msgs::msg::MoveItErrorCodes& error_code,
                                            const kinematics::KinematicsQueryOptions& options) const
 {
-  rclcpp::Time start_time = node_->now();
   if (!initialized_)
   {
     RCLCPP_ERROR(LOGGER, "kinematics solver not initialized");
@@ -226,6 +227,65 @@ bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
     return false;
   }
 
+  KDL::ChainIkSolverPos_LMA ik_solver_pos(kdl_chain_, getCartesianWeights(), epsilon_, max_solver_iterations_);
+  return searchPositionIK(ik_pose, ik_seed_state, timeout, consistency_limits, solution, solution_callback, error_code,
+                          options, ik_solver_pos, *state_);
+}
+
+bool LMAKinematicsPlugin::searchPositionIKBatch(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                                const std::vector<std::vector<double> >& ik_seed_states,
+                                                double timeout, std::vector<std::vector<double> >& solutions,
+                                                std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+                                                const kinematics::KinematicsQueryOptions& options,
+                                                unsigned int num_threads) const
+{
+  if (!initBatchQuery(ik_poses, ik_seed_states, solutions, error_codes))
+    return false;
+  if (!initialized_)
+  {
+    RCLCPP_ERROR(LOGGER, "kinematics solver not initialized");
+    for (auto& error_code : error_codes)
+      error_code.val = error_code.NO_IK_SOLUTION;
+    return false;
+  }
+
+  // each thread solves its queries with its own solver and random number generator
+  std::atomic<bool> solved_all(true);
+  forEachBatchQuery(ik_poses.size(), num_threads, [&]() -> std::function<void(std::size_t)> {
+    auto ik_solver_pos = std::make_shared<KDL::ChainIkSolverPos_LMA>(kdl_chain_, getCartesianWeights(), epsilon_,
+                                                                     max_solver_iterations_);
+    auto state = std::make_shared<moveit::core::RobotState>(*state_);
+    return [&, ik_solver_pos, state](std::size_t i) {
+      if (!searchPositionIK(ik_poses[i], ik_seed_states.size() == 1 ? ik_seed_states[0] : ik_seed_states[i], timeout,
+                            std::vector<double>(), solutions[i], IKCallbackFn(), error_codes[i], options,
+                            *ik_solver_pos, *state))
+        solved_all = false;
+    };
+  });
+  return solved_all;
+}
+
+Eigen::Matrix<double, 6, 1> LMAKinematicsPlugin::getCartesianWeights() const
+{
+  Eigen::Matrix<double, 6, 1> cartesian_weights;
+  cartesian_weights(0) = 1;
+  cartesian_weights(1) = 1;
+  cartesian_weights(2) = 1;
+  cartesian_weights(3) = orientation_vs_position_weight_;
+  cartesian_weights(4) = orientation_vs_position_weight_;
+  cartesian_weights(5) = orientation_vs_position_weight_;
+  return cartesian_weights;
+}
+
+bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_pose,
+                                           const std::vector<double>& ik_seed_state, double timeout,
+                                           const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                                           const IKCallbackFn& solution_callback,
+                                           moveit_msgs::msg::MoveItErrorCodes& error_code,
+                                           const kinematics::KinematicsQueryOptions& options,
+                                           KDL::ChainIkSolverPos& ik_solver_pos, moveit::core::RobotState& state) const
+{
+  rclcpp::Time start_time = node_->now();
   if (ik_seed_state.size() != dimension_)
   {
     RCLCPP_ERROR(LOGGER, "Seed state must have size %d instead of size %d", dimension_, ik_seed_state.size());
@@ -241,21 +301,12 @@ bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
     return false;
   }
 
-  Eigen::Matrix<double, 6, 1> cartesian_weights;
-  cartesian_weights(0) = 1;
-  cartesian_weights(1) = 1;
-  cartesian_weights(2) = 1;
-  cartesian_weights(3) = orientation_vs_position_weight_;
-  cartesian_weights(4) = orientation_vs_position_weight_;
-  cartesian_weights(5) = orientation_vs_position_weight_;
-
   KDL::JntArray jnt_seed_state(dimension_);
   KDL::JntArray jnt_pos_in(dimension_);
   KDL::JntArray jnt_pos_out(dimension_);
   jnt_seed_state.data = Eigen::Map<const Eigen::VectorXd>(ik_seed_state.data(), ik_seed_state.size());
   jnt_pos_in = jnt_seed_state;
 
-  KDL::ChainIkSolverPos_LMA ik_solver_pos(kdl_chain_, cartesian_weights, epsilon_, max_solver_iterations_);
   solution.resize(dimension_);
 
   KDL::Frame pose_desired;
@@ -272,9 +323,9 @@ bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
     if (attempt > 1)  // randomly re-seed after first attempt
     {
       if (!consistency_limits.empty())
-        getRandomConfiguration(jnt_seed_state.data, consistency_limits, jnt_pos_in.data);
+        getRandomConfiguration(state, jnt_seed_state.data, consistency_limits, jnt_pos_in.data);
       else
-        getRandomConfiguration(jnt_pos_in.data);
+        getRandomConfiguration(state, jnt_pos_in.data);
       RCLCPP_DEBUG_STREAM(LOGGER, "New random configuration (" << attempt << "): " << jnt_pos_in);
     }
 
@@ -0,0 +1,146 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <chrono>
+#include <boost/program_options.hpp>
+#include <rclcpp/rclcpp.hpp>
+#include <tf2_eigen/tf2_eigen.h>
+#include <moveit/kdl_kinematics_plugin/kdl_kinematics_plugin.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/utils/robot_model_test_utils.h>
+
+namespace po = boost::program_options;
+
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("kdl_kinematics_plugin.benchmark_kdl_ik");
+
+namespace
+{
+/** Solve the poses one after another and report the achieved rate of IK calls.
+ *  If track is true, each call is seeded with the previous solution, as during servoing. */
+void benchmark(const char* name, const kdl_kinematics_plugin::KDLKinematicsPlugin& solver,
+               const std::vector<geometry_msgs::msg::Pose>& poses, std::vector<double> seed, bool track, double timeout)
+{
+  std::vector<double> solution;
+  moveit_msgs::msg::MoveItErrorCodes error_code;
+  unsigned int num_failed_calls = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (const geometry_msgs::msg::Pose& pose : poses)
+  {
+    if (!solver.searchPositionIK(pose, seed, timeout, solution, error_code))
+      ++num_failed_calls;
+    else if (track)
+      seed.swap(solution);
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  RCLCPP_INFO(LOGGER, "%s: %.0f calls/s, %g%% of calls failed", name, poses.size() / elapsed.count(),
+              100. * num_failed_calls / poses.size());
+}
+}  // namespace
+
+/** Microbenchmark measuring the rate of KDL IK calls for pose tracking and for random poses */
+int main(int argc, char* argv[])
+{
+  std::string robot;
+  std::string group_name;
+  unsigned int num;
+  double step;
+  double timeout;
+  po::options_description desc("Options");
+  // clang-format off
+  desc.add_options()
+      ("help", "show help message")
+      ("robot", po::value<std::string>(&robot)->default_value("panda"), "name of the testing robot model")
+      ("group", po::value<std::string>(&group_name)->default_value("panda_arm"), "name of the chain group")
+      ("num", po::value<unsigned int>(&num)->default_value(100000), "number of IK calls per workload")
+      ("step", po::value<double>(&step)->default_value(0.01), "joint space distance between tracked poses")
+      ("timeout", po::value<double>(&timeout)->default_value(0.005), "timeout of a single IK call");
+  // clang-format on
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help") != 0u)
+  {
+    std::cout << desc << "\n";
+    return 1;
+  }
+
+  rclcpp::init(argc, argv);
+  rclcpp::Node::SharedPtr node = rclcpp::Node::make_shared("benchmark_kdl_ik");
+
+  const moveit::core::RobotModelPtr robot_model = moveit::core::loadTestingRobotModel(robot);
+  const moveit::core::JointModelGroup* group = robot_model->getJointModelGroup(group_name);
+  if (!group)
+  {
+    RCLCPP_ERROR(LOGGER, "Unknown group '%s'", group_name.c_str());
+    return 1;
+  }
+  const std::string& tip = group->getLinkModelNames().back();
+
+  kdl_kinematics_plugin::KDLKinematicsPlugin solver;
+  if (!solver.initialize(node, *robot_model, group_name, robot_model->getModelFrame(), { tip }, 0.1))
+  {
+    RCLCPP_ERROR(LOGGER, "Failed to initialize the KDL solver for group '%s'", group_name.c_str());
+    return 1;
+  }
+
+  // a random walk of nearby poses, as tracked by servoing, and independent random poses
+  moveit::core::RobotState state(robot_model);
+  state.setToDefaultValues();
+  std::vector<double> default_seed;
+  state.copyJointGroupPositions(group, default_seed);
+
+  std::vector<geometry_msgs::msg::Pose> tracked_poses(num), random_poses(num);
+  moveit::core::RobotState previous(state);
+  for (geometry_msgs::msg::Pose& pose : tracked_poses)
+  {
+    state.setToRandomPositionsNearBy(group, previous, step);
+    state.update();
+    pose = tf2::toMsg(state.getGlobalLinkTransform(tip));
+    previous = state;
+  }
+  for (geometry_msgs::msg::Pose& pose : random_poses)
+  {
+    state.setToRandomPositions(group);
+    state.update();
+    pose = tf2::toMsg(state.getGlobalLinkTransform(tip));
+  }
+
+  benchmark("Tracking", solver, tracked_poses, default_seed, true, timeout);
+  benchmark("Random poses", solver, random_poses, default_seed, false, timeout);
+
+  rclcpp::shutdown();
+  return 0;
+}
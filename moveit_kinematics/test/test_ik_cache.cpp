@@ -0,0 +1,251 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+#include <moveit/cached_ik_kinematics_plugin/cached_ik_kinematics_plugin.h>
+#include <boost/filesystem.hpp>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <limits>
+#include <random>
+
+using namespace cached_ik_kinematics_plugin;
+
+namespace
+{
+const unsigned int NUM_JOINTS = 3;
+
+/** exposes how the entries of an IKCache are split between the mapped index and memory */
+class TestIKCache : public IKCache
+{
+public:
+  std::size_t getNumIndexed() const
+  {
+    return num_indexed_;
+  }
+};
+
+class IKCacheTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    options_.max_cache_size = 5000;
+    // accept every solution, so that the tests control the cache contents
+    options_.min_pose_distance = 0.;
+    options_.min_joint_config_distance = 0.;
+    options_.cached_ik_path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+  }
+
+  void TearDown() override
+  {
+    boost::filesystem::remove_all(options_.cached_ik_path);
+  }
+
+  void initialize(IKCache& cache) const
+  {
+    cache.initializeCache("robot", "group", "test", NUM_JOINTS, options_);
+  }
+
+  static IKCache::Pose randomPose(std::mt19937& gen)
+  {
+    std::uniform_real_distribution<double> unit(-1., 1.);
+    IKCache::Pose pose;
+    pose.position = tf2::Vector3(unit(gen), unit(gen), unit(gen));
+    pose.orientation = tf2::Quaternion(unit(gen), unit(gen), unit(gen), unit(gen)).normalized();
+    return pose;
+  }
+
+  /** add \e count random entries, whose configurations are (tag, i, 1) */
+  static std::vector<IKCache::IKEntry> addEntries(IKCache& cache, std::size_t count, double tag, unsigned int seed)
+  {
+    std::mt19937 gen(seed);
+    std::vector<IKCache::IKEntry> entries;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      IKCache::Pose pose = randomPose(gen);
+      std::vector<double> config = { tag, double(i), 1. };
+      cache.updateCache(cache.getBestApproximateIKSolution(pose), pose, config);
+      entries.emplace_back(std::vector<IKCache::Pose>(1, pose), config);
+    }
+    return entries;
+  }
+
+  static void expectContains(const IKCache& cache, const std::vector<IKCache::IKEntry>& entries)
+  {
+    for (const IKCache::IKEntry& entry : entries)
+    {
+      IKCache::IKEntry nearest = cache.getBestApproximateIKSolution(entry.first);
+      EXPECT_EQ(nearest.first[0].distance(entry.first[0]), 0.);
+      EXPECT_EQ(nearest.second, entry.second);
+    }
+  }
+
+  IKCache::Options options_;
+};
+}  // namespace
+
+TEST_F(IKCacheTest, SaveLoadRoundTrip)
+{
+  // the first save creates an indexed file with 500 entries, the second one appends the remaining 200
+  std::vector<IKCache::IKEntry> entries;
+  {
+    TestIKCache cache;
+    initialize(cache);
+    EXPECT_EQ(cache.size(), 0u);
+    entries = addEntries(cache, 700, 0., 1);
+    EXPECT_EQ(cache.size(), entries.size());
+  }
+  {
+    TestIKCache cache;
+    initialize(cache);
+    ASSERT_EQ(cache.size(), entries.size());
+    EXPECT_EQ(cache.getNumIndexed(), 500u);
+    expectContains(cache, entries);
+
+    std::vector<IKCache::IKEntry> appended = addEntries(cache, 400, 1., 2);
+    entries.insert(entries.end(), appended.begin(), appended.end());
+  }
+
+  // the 600 appended entries outnumber the indexed ones, so the file is rebuilt with all of them indexed
+  TestIKCache cache;
+  initialize(cache);
+  ASSERT_EQ(cache.size(), entries.size());
+  EXPECT_EQ(cache.getNumIndexed(), entries.size());
+  expectContains(cache, entries);
+}
+
+TEST_F(IKCacheTest, NearestNeighborMatchesBruteForce)
+{
+  std::vector<IKCache::IKEntry> entries;
+  {
+    IKCache cache;
+    initialize(cache);
+    entries = addEntries(cache, 1000, 0., 3);
+  }
+  // search the mapped index, the entries appended to the file and the ones only held in memory
+  TestIKCache cache;
+  initialize(cache);
+  ASSERT_EQ(cache.getNumIndexed(), 500u);
+  std::vector<IKCache::IKEntry> appended = addEntries(cache, 300, 1., 4);
+  entries.insert(entries.end(), appended.begin(), appended.end());
+
+  std::mt19937 gen(5);
+  for (unsigned int i = 0; i < 500; ++i)
+  {
+    IKCache::Pose query = randomPose(gen);
+    double min_distance = std::numeric_limits<double>::infinity();
+    for (const IKCache::IKEntry& entry : entries)
+      min_distance = std::min(min_distance, entry.first[0].distance(query));
+    EXPECT_DOUBLE_EQ(cache.getBestApproximateIKSolution(query).first[0].distance(query), min_distance);
+  }
+}
+
+TEST_F(IKCacheTest, TwoProcessAppend)
+{
+  // both processes start from the same file and append to it concurrently
+  std::vector<IKCache::IKEntry> indexed;
+  {
+    IKCache cache;
+    initialize(cache);
+    indexed = addEntries(cache, 200, 0., 6);
+  }
+
+  pid_t child = fork();
+  ASSERT_NE(child, -1);
+  if (child == 0)
+  {
+    {
+      IKCache cache;
+      initialize(cache);
+      addEntries(cache, 400, 1., 7);
+    }
+    _exit(0);
+  }
+  std::vector<IKCache::IKEntry> parent_entries;
+  {
+    IKCache cache;
+    initialize(cache);
+    parent_entries = addEntries(cache, 400, 2., 8);
+  }
+  int status;
+  ASSERT_EQ(waitpid(child, &status, 0), child);
+  ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  std::mt19937 gen(7);
+  std::vector<IKCache::IKEntry> child_entries;
+  for (std::size_t i = 0; i < 400; ++i)
+  {
+    IKCache::Pose pose = randomPose(gen);
+    child_entries.emplace_back(std::vector<IKCache::Pose>(1, pose), std::vector<double>{ 1., double(i), 1. });
+  }
+
+  IKCache cache;
+  initialize(cache);
+  ASSERT_EQ(cache.size(), 1000u);
+  expectContains(cache, indexed);
+  expectContains(cache, child_entries);
+  expectContains(cache, parent_entries);
+}
+
+TEST_F(IKCacheTest, AppendRespectsMaxCacheSize)
+{
+  options_.max_cache_size = 500;
+  {
+    IKCache cache;
+    initialize(cache);
+    addEntries(cache, 300, 0., 9);
+  }
+
+  // two caches opened on the same file each hold fewer than max_cache_size entries, but not together
+  {
+    IKCache cache1, cache2;
+    initialize(cache1);
+    initialize(cache2);
+    addEntries(cache1, 150, 1., 10);
+    addEntries(cache2, 150, 2., 11);
+    EXPECT_EQ(cache1.size(), 450u);
+    EXPECT_EQ(cache2.size(), 450u);
+  }
+
+  IKCache cache;
+  initialize(cache);
+  EXPECT_EQ(cache.size(), 500u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -562,6 +562,51 @@ TEST_F(KinematicsTest, searchIK)
   EXPECT_GE(success, EXPECTED_SUCCESS_RATE * num_ik_tests_);
 }
 
+TEST_F(KinematicsTest, searchIKBatch)
+{
+  const std::vector<std::string>& fk_names = kinematics_solver_->getTipFrames();
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+
+  std::vector<geometry_msgs::msg::Pose> ik_poses;
+  std::vector<double> fk_values;
+  for (unsigned int i = 0; i < num_ik_tests_; ++i)
+  {
+    robot_state.setToRandomPositions(jmg_, this->rng_);
+    robot_state.copyJointGroupPositions(jmg_, fk_values);
+    std::vector<geometry_msgs::msg::Pose> poses;
+    ASSERT_TRUE(kinematics_solver_->getPositionFK(fk_names, fk_values, poses));
+    ik_poses.push_back(poses[0]);
+  }
+
+  // a single seed is shared by all queries, 0 threads uses all cores
+  std::vector<std::vector<double> > seeds(1, std::vector<double>(kinematics_solver_->getJointNames().size(), 0.0));
+  std::vector<std::vector<double> > solutions;
+  std::vector<moveit_msgs::msg::MoveItErrorCodes> error_codes;
+  kinematics_solver_->searchPositionIKBatch(ik_poses, seeds, timeout_, solutions, error_codes,
+                                            kinematics::KinematicsQueryOptions(), 0);
+  ASSERT_EQ(solutions.size(), ik_poses.size());
+  ASSERT_EQ(error_codes.size(), ik_poses.size());
+
+  unsigned int success = 0;
+  for (std::size_t i = 0; i < ik_poses.size(); ++i)
+  {
+    if (error_codes[i].val != moveit_msgs::msg::MoveItErrorCodes::SUCCESS)
+      continue;
+    success++;
+
+    std::vector<geometry_msgs::msg::Pose> poses(1, ik_poses[i]), reached_poses;
+    kinematics_solver_->getPositionFK(fk_names, solutions[i], reached_poses);
+    EXPECT_NEAR_POSES(poses, reached_poses, tolerance_);
+  }
+  EXPECT_GE(success, EXPECTED_SUCCESS_RATE * num_ik_tests_);
+
+  // the number of seeds has to match the number of poses unless a single seed is given
+  seeds.resize(2, seeds[0]);
+  if (ik_poses.size() > 2)
+    EXPECT_FALSE(kinematics_solver_->searchPositionIKBatch(ik_poses, seeds, timeout_, solutions, error_codes));
+}
+
 TEST_F(KinematicsTest, searchIKWithCallback)
 {
   std::vector<double> seed, fk_values, solution;
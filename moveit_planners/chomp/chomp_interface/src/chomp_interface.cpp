@@ -81,5 +81,6 @@ void CHOMPInterface::loadParams()
   }
   nh_.param("enable_failure_recovery", params_.enable_failure_recovery_, false);
   nh_.param("max_recovery_attempts", params_.max_recovery_attempts_, 5);
+  nh_.param("num_threads", params_.num_threads_, 1);
 }
 }  // namespace chomp_interface
@@ -44,6 +44,10 @@ namespace chomp
 {
 /**
  * \brief Represents the smoothness cost for CHOMP, for a single joint
+ *
+ * The quadratic cost is a sum of squared finite differencing matrices and therefore banded. It is stored in banded
+ * form together with the banded Cholesky factorization of its free variable block, so memory and the cost of every
+ * product or solve grow linearly with the number of trajectory points.
  */
 class ChompCost
 {
@@ -55,9 +59,12 @@ public:
   template <typename Derived>
   void getDerivative(const Eigen::MatrixXd::ColXpr& joint_trajectory, Eigen::MatrixBase<Derived>& derivative) const;
 
-  const Eigen::MatrixXd& getQuadraticCostInverse() const;
+  /** \brief Multiply \e vector (defined on the free variables) by the inverse of the quadratic cost of the free
+   * variables, by solving with the banded Cholesky factorization */
+  Eigen::VectorXd multiplyByQuadraticCostInverse(const Eigen::VectorXd& vector) const;
 
-  const Eigen::MatrixXd& getQuadraticCost() const;
+  /** \brief Get column \e index of the inverse of the quadratic cost of the free variables */
+  Eigen::VectorXd getQuadraticCostInverseColumn(int index) const;
 
   double getCost(const Eigen::MatrixXd::ColXpr& joint_trajectory) const;
 
@@ -66,34 +73,34 @@ public:
   void scale(double scale);
 
 private:
-  Eigen::MatrixXd quad_cost_full_;
-  Eigen::MatrixXd quad_cost_;
-  // Eigen::VectorXd linear_cost_;
-  Eigen::MatrixXd quad_cost_inv_;
+  /** \brief Multiply \e vector (defined on all variables) by the quadratic cost of all variables */
+  Eigen::VectorXd multiplyByQuadraticCostFull(const Eigen::VectorXd& vector) const;
+
+  int num_vars_free_;
+  int bandwidth_;  // number of sub-diagonals of the quadratic cost
 
-  Eigen::MatrixXd getDiffMatrix(int size, const double* diff_rule) const;
+  // banded storage: entry (d, i) holds element (i + d, i) of the symmetric (resp. lower triangular) matrix
+  Eigen::MatrixXd quad_cost_full_band_;
+  Eigen::MatrixXd quad_cost_cholesky_band_;  // Cholesky factor of the quadratic cost of the free variables
+
+  double max_quad_cost_inv_value_;
 };
 
 template <typename Derived>
 void ChompCost::getDerivative(const Eigen::MatrixXd::ColXpr& joint_trajectory,
                               Eigen::MatrixBase<Derived>& derivative) const
 {
-  derivative = (quad_cost_full_ * (2.0 * joint_trajectory));
-}
-
-inline const Eigen::MatrixXd& ChompCost::getQuadraticCostInverse() const
-{
-  return quad_cost_inv_;
+  derivative = 2.0 * multiplyByQuadraticCostFull(joint_trajectory);
 }
 
-inline const Eigen::MatrixXd& ChompCost::getQuadraticCost() const
+inline double ChompCost::getCost(const Eigen::MatrixXd::ColXpr& joint_trajectory) const
 {
-  return quad_cost_;
+  return joint_trajectory.dot(multiplyByQuadraticCostFull(joint_trajectory));
 }
 
-inline double ChompCost::getCost(const Eigen::MatrixXd::ColXpr& joint_trajectory) const
+inline double ChompCost::getMaxQuadCostInvValue() const
 {
-  return joint_trajectory.dot(quad_cost_full_ * joint_trajectory);
+  return max_quad_cost_inv_value_;
 }
 
 }  // namespace chomp
@@ -43,9 +43,12 @@
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/collision_distance_field/collision_env_hybrid.h>
+#include <moveit/utils/worker_pool.h>
 
 #include <Eigen/Core>
 #include <Eigen/StdVector>
+#include <functional>
+#include <memory>
 #include <vector>
 
 namespace chomp
@@ -108,7 +111,25 @@ private:
   //                     const std::string& group_name,
   //                     Eigen::VectorXd& state_vec);
 
-  void setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i);
+  void setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i, moveit::core::RobotState& state);
+
+  /** \brief Scratch data owned by one worker thread while evaluating trajectory points */
+  struct ThreadData
+  {
+    ThreadData(const moveit::core::RobotState& state) : state_(state)
+    {
+    }
+
+    moveit::core::RobotState state_;
+    collision_detection::GroupStateRepresentationPtr gsr_;
+    Eigen::MatrixXd jacobian_;
+    Eigen::MatrixXd jacobian_pseudo_inverse_;
+    Eigen::MatrixXd jacobian_jacobian_tranpose_;
+  };
+
+  /** \brief Call \e fn on contiguous chunks of the trajectory points [start, end], one chunk per entry of
+   * thread_data_. Every point is handled by exactly one call, so results do not depend on thread scheduling. */
+  void forEachTrajectoryChunk(int start, int end, const std::function<void(int, int, ThreadData&)>& fn);
 
   // collision_proximity::CollisionProximitySpace::TrajectorySafety checkCurrentIterValidity();
 
@@ -134,6 +155,8 @@ private:
 
   std::vector<ChompCost> joint_costs_;
   collision_detection::GroupStateRepresentationPtr gsr_;
+  std::vector<ThreadData> thread_data_;  // never empty once initialized, one entry per trajectory chunk
+  std::unique_ptr<moveit::core::WorkerPool> workers_;  // NULL if there is only one chunk
   bool initialized_;
 
   std::vector<std::vector<std::string> > collision_point_joint_names_;
@@ -170,9 +193,6 @@ private:
 
   // temporary variables for all functions:
   Eigen::VectorXd smoothness_derivative_;
-  Eigen::MatrixXd jacobian_;
-  Eigen::MatrixXd jacobian_pseudo_inverse_;
-  Eigen::MatrixXd jacobian_jacobian_tranpose_;
   Eigen::VectorXd random_state_;
   Eigen::VectorXd joint_state_velocities_;
 
@@ -212,8 +232,8 @@ private:
   void getRandomMomentum();
   void updateMomentum();
   void updatePositionFromMomentum();
-  void calculatePseudoInverse();
-  void computeJointProperties(int trajectoryPoint);
+  void calculatePseudoInverse(ThreadData& thread_data);
+  void computeJointProperties(int trajectoryPoint, const moveit::core::RobotState& state);
   bool isCurrentTrajectoryMeshToMeshCollisionFree() const;
 };
 }  // namespace chomp
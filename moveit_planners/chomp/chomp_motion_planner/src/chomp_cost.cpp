@@ -36,7 +36,8 @@
 
 #include <chomp_motion_planner/chomp_cost.h>
 #include <chomp_motion_planner/chomp_utils.h>
-#include <eigen3/Eigen/LU>
+#include <algorithm>
+#include <cmath>
 
 using namespace Eigen;
 using namespace std;
@@ -46,59 +47,125 @@ namespace chomp
 ChompCost::ChompCost(const ChompTrajectory& trajectory, int /* joint_number */,
                      const std::vector<double>& derivative_costs, double ridge_factor)
 {
-  int num_vars_all = trajectory.getNumPoints();
-  int num_vars_free = num_vars_all - 2 * (DIFF_RULE_LENGTH - 1);
-  MatrixXd diff_matrix = MatrixXd::Zero(num_vars_all, num_vars_all);
-  quad_cost_full_ = MatrixXd::Zero(num_vars_all, num_vars_all);
+  const int num_vars_all = trajectory.getNumPoints();
+  const int half_rule_length = DIFF_RULE_LENGTH / 2;
+  num_vars_free_ = num_vars_all - 2 * (DIFF_RULE_LENGTH - 1);
+  bandwidth_ = 2 * half_rule_length;
 
-  // construct the quad cost for all variables, as a sum of squared differentiation matrices
+  // construct the quad cost for all variables, as a sum of squared differentiation matrices.
+  // Row r of a differentiation matrix D only has entries in columns r - half_rule_length .. r + half_rule_length,
+  // so D^T * D is accumulated row by row without forming D.
+  quad_cost_full_band_ = MatrixXd::Zero(bandwidth_ + 1, num_vars_all);
   double multiplier = 1.0;
   for (unsigned int i = 0; i < derivative_costs.size(); i++)
   {
     multiplier *= trajectory.getDiscretization();
-    diff_matrix = getDiffMatrix(num_vars_all, &DIFF_RULES[i][0]);
-    quad_cost_full_ += (derivative_costs[i] * multiplier) * (diff_matrix.transpose() * diff_matrix);
+    const double weight = derivative_costs[i] * multiplier;
+    for (int r = 0; r < num_vars_all; r++)
+    {
+      for (int j1 = -half_rule_length; j1 <= half_rule_length; j1++)
+      {
+        const int p = r + j1;
+        if (p < 0 || p >= num_vars_all)
+          continue;
+        for (int j2 = -half_rule_length; j2 <= j1; j2++)
+        {
+          const int q = r + j2;
+          if (q < 0)
+            continue;
+          quad_cost_full_band_(p - q, q) +=
+              weight * DIFF_RULES[i][j1 + half_rule_length] * DIFF_RULES[i][j2 + half_rule_length];
+        }
+      }
+    }
   }
-  quad_cost_full_ += MatrixXd::Identity(num_vars_all, num_vars_all) * ridge_factor;
+  quad_cost_full_band_.row(0).array() += ridge_factor;
 
-  // extract the quad cost just for the free variables:
-  quad_cost_ = quad_cost_full_.block(DIFF_RULE_LENGTH - 1, DIFF_RULE_LENGTH - 1, num_vars_free, num_vars_free);
+  // banded Cholesky factorization of the quad cost of the free variables
+  const int free_offset = DIFF_RULE_LENGTH - 1;
+  quad_cost_cholesky_band_ = MatrixXd::Zero(bandwidth_ + 1, num_vars_free_);
+  for (int j = 0; j < num_vars_free_; j++)
+  {
+    double diagonal = quad_cost_full_band_(0, j + free_offset);
+    for (int k = std::max(0, j - bandwidth_); k < j; k++)
+      diagonal -= quad_cost_cholesky_band_(j - k, k) * quad_cost_cholesky_band_(j - k, k);
+    const double l_jj = std::sqrt(diagonal);
+    quad_cost_cholesky_band_(0, j) = l_jj;
 
-  // invert the matrix:
-  quad_cost_inv_ = quad_cost_.inverse();
+    for (int i = j + 1; i <= std::min(num_vars_free_ - 1, j + bandwidth_); i++)
+    {
+      double value = quad_cost_full_band_(i - j, j + free_offset);
+      for (int k = std::max(0, i - bandwidth_); k < j; k++)
+        value -= quad_cost_cholesky_band_(i - k, k) * quad_cost_cholesky_band_(j - k, k);
+      quad_cost_cholesky_band_(i - j, j) = value / l_jj;
+    }
+  }
 
-  // cout << quad_cost_inv_ << endl;
+  // The inverse is symmetric positive definite, so its largest entry lies on the diagonal. The band of the inverse
+  // (which contains the diagonal) is computed from the Cholesky factor with the backward recurrence
+  // Z(i, j) = (delta_ij / L(i, i) - sum_{k > i} L(k, i) * Z(k, j)) / L(i, i), without forming the dense inverse.
+  MatrixXd inverse_band = MatrixXd::Zero(bandwidth_ + 1, num_vars_free_);
+  auto inverse = [&inverse_band](int a, int b) { return a >= b ? inverse_band(a - b, b) : inverse_band(b - a, a); };
+  max_quad_cost_inv_value_ = 0.0;
+  for (int i = num_vars_free_ - 1; i >= 0; i--)
+  {
+    const int last = std::min(num_vars_free_ - 1, i + bandwidth_);
+    const double l_ii = quad_cost_cholesky_band_(0, i);
+    for (int j = last; j >= i; j--)
+    {
+      double value = (i == j) ? 1.0 / l_ii : 0.0;
+      for (int k = i + 1; k <= last; k++)
+        value -= quad_cost_cholesky_band_(k - i, i) * inverse(k, j);
+      inverse_band(j - i, i) = value / l_ii;
+    }
+    max_quad_cost_inv_value_ = std::max(max_quad_cost_inv_value_, inverse_band(0, i));
+  }
 }
 
-Eigen::MatrixXd ChompCost::getDiffMatrix(int size, const double* diff_rule) const
+VectorXd ChompCost::multiplyByQuadraticCostFull(const VectorXd& vector) const
 {
-  MatrixXd matrix = MatrixXd::Zero(size, size);
-  for (int i = 0; i < size; i++)
+  const int size = vector.size();
+  VectorXd result = quad_cost_full_band_.row(0).transpose().cwiseProduct(vector);
+  for (int d = 1; d <= bandwidth_; d++)
   {
-    for (int j = -DIFF_RULE_LENGTH / 2; j <= DIFF_RULE_LENGTH / 2; j++)
+    for (int i = 0; i + d < size; i++)
     {
-      int index = i + j;
-      if (index < 0)
-        continue;
-      if (index >= size)
-        continue;
-      matrix(i, index) = diff_rule[j + DIFF_RULE_LENGTH / 2];
+      result(i + d) += quad_cost_full_band_(d, i) * vector(i);
+      result(i) += quad_cost_full_band_(d, i) * vector(i + d);
     }
   }
-  return matrix;
+  return result;
+}
+
+VectorXd ChompCost::multiplyByQuadraticCostInverse(const VectorXd& vector) const
+{
+  // forward substitution with L, then backward substitution with L^T
+  VectorXd result = vector;
+  for (int i = 0; i < num_vars_free_; i++)
+  {
+    for (int k = std::max(0, i - bandwidth_); k < i; k++)
+      result(i) -= quad_cost_cholesky_band_(i - k, k) * result(k);
+    result(i) /= quad_cost_cholesky_band_(0, i);
+  }
+  for (int i = num_vars_free_ - 1; i >= 0; i--)
+  {
+    for (int k = i + 1; k <= std::min(num_vars_free_ - 1, i + bandwidth_); k++)
+      result(i) -= quad_cost_cholesky_band_(k - i, i) * result(k);
+    result(i) /= quad_cost_cholesky_band_(0, i);
+  }
+  return result;
 }
 
-double ChompCost::getMaxQuadCostInvValue() const
+VectorXd ChompCost::getQuadraticCostInverseColumn(int index) const
 {
-  return quad_cost_inv_.maxCoeff();
+  return multiplyByQuadraticCostInverse(VectorXd::Unit(num_vars_free_, index));
 }
 
 void ChompCost::scale(double scale)
 {
-  double inv_scale = 1.0 / scale;
-  quad_cost_inv_ *= inv_scale;
-  quad_cost_ *= scale;
-  quad_cost_full_ *= scale;
+  quad_cost_full_band_ *= scale;
+  quad_cost_cholesky_band_ *= std::sqrt(scale);
+  max_quad_cost_inv_value_ /= scale;
 }
 
 ChompCost::~ChompCost() = default;
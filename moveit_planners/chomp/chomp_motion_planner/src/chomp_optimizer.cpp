@@ -43,7 +43,9 @@
 #include <moveit/planning_scene/planning_scene.h>
 #include <eigen3/Eigen/LU>
 #include <eigen3/Eigen/Core>
+#include <algorithm>
 #include <random>
+#include <thread>
 
 namespace chomp
 {
@@ -111,6 +113,35 @@ void ChompOptimizer::initialize()
     num_collision_points_ += gradient.gradients.size();
   }
 
+  // set up the scratch data of the worker threads. Each one needs its own collision checking structures, generated
+  // with the same ACM as gsr_ so that all threads report the same collision points.
+  unsigned int num_threads =
+      parameters_->num_threads_ > 0 ? parameters_->num_threads_ : std::thread::hardware_concurrency();
+  num_threads = std::max(1u, std::min<unsigned int>(num_threads, num_vars_all_));
+  thread_data_.clear();
+  thread_data_.reserve(num_threads);
+  for (unsigned int t = 0; t < num_threads; ++t)
+  {
+    thread_data_.emplace_back(state_);
+    ThreadData& thread_data = thread_data_.back();
+    if (t == 0)
+      thread_data.gsr_ = gsr_;
+    else
+    {
+      collision_detection::CollisionResult thread_res;
+      hy_env_->getCollisionGradients(req, thread_res, thread_data.state_, &planning_scene_->getAllowedCollisionMatrix(),
+                                     thread_data.gsr_);
+    }
+    thread_data.jacobian_ = Eigen::MatrixXd::Zero(3, num_joints_);
+    thread_data.jacobian_pseudo_inverse_ = Eigen::MatrixXd::Zero(num_joints_, 3);
+    thread_data.jacobian_jacobian_tranpose_ = Eigen::MatrixXd::Zero(3, 3);
+  }
+  // the calling thread processes chunks as well, so one worker less than chunks is enough
+  if (num_threads > 1)
+    workers_ = std::make_unique<moveit::core::WorkerPool>(num_threads - 1);
+  else
+    workers_.reset();
+
   // set up the joint costs:
   joint_costs_.reserve(num_joints_);
 
@@ -144,9 +175,6 @@ void ChompOptimizer::initialize()
   collision_increments_ = Eigen::MatrixXd::Zero(num_vars_free_, num_joints_);
   final_increments_ = Eigen::MatrixXd::Zero(num_vars_free_, num_joints_);
   smoothness_derivative_ = Eigen::VectorXd::Zero(num_vars_all_);
-  jacobian_ = Eigen::MatrixXd::Zero(3, num_joints_);
-  jacobian_pseudo_inverse_ = Eigen::MatrixXd::Zero(num_joints_, 3);
-  jacobian_jacobian_tranpose_ = Eigen::MatrixXd::Zero(3, 3);
   random_state_ = Eigen::VectorXd::Zero(num_joints_);
   joint_state_velocities_ = Eigen::VectorXd::Zero(num_joints_);
 
@@ -178,13 +206,15 @@ void ChompOptimizer::initialize()
   // momentum_ = Eigen::MatrixXd::Zero(num_vars_free_, num_joints_);
   // random_momentum_ = Eigen::MatrixXd::Zero(num_vars_free_, num_joints_);
   // random_joint_momentum_ = Eigen::VectorXd::Zero(num_vars_free_);
-  multivariate_gaussian_.clear();
+  // The samplers need the dense inverse of the quadratic cost (and its dense Cholesky factorization), so they are
+  // only set up together with the HMC code that uses them.
+  // multivariate_gaussian_.clear();
   stochasticity_factor_ = 1.0;
-  for (int i = 0; i < num_joints_; i++)
-  {
-    multivariate_gaussian_.push_back(
-        MultivariateGaussian(Eigen::VectorXd::Zero(num_vars_free_), joint_costs_[i].getQuadraticCostInverse()));
-  }
+  // for (int i = 0; i < num_joints_; i++)
+  // {
+  //   multivariate_gaussian_.push_back(
+  //       MultivariateGaussian(Eigen::VectorXd::Zero(num_vars_free_), joint_costs_[i].getQuadraticCostInverse()));
+  // }
 
   std::map<std::string, std::string> fixed_link_resolution_map;
   for (int i = 0; i < num_joints_; i++)
@@ -592,15 +622,6 @@ void ChompOptimizer::calculateSmoothnessIncrements()
 
 void ChompOptimizer::calculateCollisionIncrements()
 {
-  double potential;
-  double vel_mag_sq;
-  double vel_mag;
-  Eigen::Vector3d potential_gradient;
-  Eigen::Vector3d normalized_velocity;
-  Eigen::Matrix3d orthogonal_projector;
-  Eigen::Vector3d curvature_vector;
-  Eigen::Vector3d cartesian_gradient;
-
   collision_increments_.setZero(num_vars_free_, num_joints_);
 
   int start_point = 0;
@@ -622,56 +643,64 @@ void ChompOptimizer::calculateCollisionIncrements()
     start_point = free_vars_start_;
   }
 
-  for (int i = start_point; i <= end_point; i++)
-  {
-    for (int j = 0; j < num_collision_points_; j++)
+  // each trajectory point only writes its own row of collision_increments_
+  forEachTrajectoryChunk(start_point, end_point, [this](int chunk_start, int chunk_end, ThreadData& thread_data) {
+    double potential;
+    double vel_mag_sq;
+    double vel_mag;
+    Eigen::Vector3d potential_gradient;
+    Eigen::Vector3d normalized_velocity;
+    Eigen::Matrix3d orthogonal_projector;
+    Eigen::Vector3d curvature_vector;
+    Eigen::Vector3d cartesian_gradient;
+
+    for (int i = chunk_start; i <= chunk_end; i++)
     {
-      potential = collision_point_potential_[i][j];
+      for (int j = 0; j < num_collision_points_; j++)
+      {
+        potential = collision_point_potential_[i][j];
 
-      if (potential < 0.0001)
-        continue;
+        if (potential < 0.0001)
+          continue;
 
-      potential_gradient = -collision_point_potential_gradient_[i][j];
+        potential_gradient = -collision_point_potential_gradient_[i][j];
 
-      vel_mag = collision_point_vel_mag_[i][j];
-      vel_mag_sq = vel_mag * vel_mag;
+        vel_mag = collision_point_vel_mag_[i][j];
+        vel_mag_sq = vel_mag * vel_mag;
 
-      // all math from the CHOMP paper:
+        // all math from the CHOMP paper:
 
-      normalized_velocity = collision_point_vel_eigen_[i][j] / vel_mag;
-      orthogonal_projector = Eigen::Matrix3d::Identity() - (normalized_velocity * normalized_velocity.transpose());
-      curvature_vector = (orthogonal_projector * collision_point_acc_eigen_[i][j]) / vel_mag_sq;
-      cartesian_gradient = vel_mag * (orthogonal_projector * potential_gradient - potential * curvature_vector);
+        normalized_velocity = collision_point_vel_eigen_[i][j] / vel_mag;
+        orthogonal_projector = Eigen::Matrix3d::Identity() - (normalized_velocity * normalized_velocity.transpose());
+        curvature_vector = (orthogonal_projector * collision_point_acc_eigen_[i][j]) / vel_mag_sq;
+        cartesian_gradient = vel_mag * (orthogonal_projector * potential_gradient - potential * curvature_vector);
 
-      // pass it through the jacobian transpose to get the increments
-      getJacobian(i, collision_point_pos_eigen_[i][j], collision_point_joint_names_[i][j], jacobian_);
+        // pass it through the jacobian transpose to get the increments
+        getJacobian(i, collision_point_pos_eigen_[i][j], collision_point_joint_names_[i][j], thread_data.jacobian_);
 
-      if (parameters_->use_pseudo_inverse_)
-      {
-        calculatePseudoInverse();
-        collision_increments_.row(i - free_vars_start_).transpose() -= jacobian_pseudo_inverse_ * cartesian_gradient;
-      }
-      else
-      {
-        collision_increments_.row(i - free_vars_start_).transpose() -= jacobian_.transpose() * cartesian_gradient;
-      }
-
-      /*
-        if(point_is_in_collision_[i][j])
+        if (parameters_->use_pseudo_inverse_)
         {
-        break;
+          calculatePseudoInverse(thread_data);
+          collision_increments_.row(i - free_vars_start_).transpose() -=
+              thread_data.jacobian_pseudo_inverse_ * cartesian_gradient;
+        }
+        else
+        {
+          collision_increments_.row(i - free_vars_start_).transpose() -=
+              thread_data.jacobian_.transpose() * cartesian_gradient;
         }
-      */
+      }
     }
-  }
-  // cout << collision_increments_ << endl;
+  });
 }
 
-void ChompOptimizer::calculatePseudoInverse()
+void ChompOptimizer::calculatePseudoInverse(ThreadData& thread_data)
 {
-  jacobian_jacobian_tranpose_ =
-      jacobian_ * jacobian_.transpose() + Eigen::MatrixXd::Identity(3, 3) * parameters_->pseudo_inverse_ridge_factor_;
-  jacobian_pseudo_inverse_ = jacobian_.transpose() * jacobian_jacobian_tranpose_.inverse();
+  thread_data.jacobian_jacobian_tranpose_ =
+      thread_data.jacobian_ * thread_data.jacobian_.transpose() +
+      Eigen::MatrixXd::Identity(3, 3) * parameters_->pseudo_inverse_ridge_factor_;
+  thread_data.jacobian_pseudo_inverse_ =
+      thread_data.jacobian_.transpose() * thread_data.jacobian_jacobian_tranpose_.inverse();
 }
 
 void ChompOptimizer::calculateTotalIncrements()
@@ -679,9 +708,9 @@ void ChompOptimizer::calculateTotalIncrements()
   for (int i = 0; i < num_joints_; i++)
   {
     final_increments_.col(i) =
-        parameters_->learning_rate_ * (joint_costs_[i].getQuadraticCostInverse() *
-                                       (parameters_->smoothness_cost_weight_ * smoothness_increments_.col(i) +
-                                        parameters_->obstacle_cost_weight_ * collision_increments_.col(i)));
+        parameters_->learning_rate_ * joint_costs_[i].multiplyByQuadraticCostInverse(
+                                          parameters_->smoothness_cost_weight_ * smoothness_increments_.col(i) +
+                                          parameters_->obstacle_cost_weight_ * collision_increments_.col(i));
   }
 }
 
@@ -759,11 +788,11 @@ double ChompOptimizer::getCollisionCost()
   return parameters_->obstacle_cost_weight_ * collision_cost;
 }
 
-void ChompOptimizer::computeJointProperties(int trajectory_point)
+void ChompOptimizer::computeJointProperties(int trajectory_point, const moveit::core::RobotState& state)
 {
   for (int j = 0; j < num_joints_; j++)
   {
-    const moveit::core::JointModel* joint_model = state_.getJointModel(joint_names_[j]);
+    const moveit::core::JointModel* joint_model = state.getJointModel(joint_names_[j]);
     const moveit::core::RevoluteJointModel* revolute_joint =
         dynamic_cast<const moveit::core::RevoluteJointModel*>(joint_model);
     const moveit::core::PrismaticJointModel* prismatic_joint =
@@ -771,9 +800,9 @@ void ChompOptimizer::computeJointProperties(int trajectory_point)
 
     std::string parent_link_name = joint_model->getParentLinkModel()->getName();
     std::string child_link_name = joint_model->getChildLinkModel()->getName();
-    Eigen::Isometry3d joint_transform = state_.getGlobalLinkTransform(parent_link_name) *
+    Eigen::Isometry3d joint_transform = state.getGlobalLinkTransform(parent_link_name) *
                                         (robot_model_->getLinkModel(child_link_name)->getJointOriginTransform() *
-                                         (state_.getJointTransform(joint_model)));
+                                         (state.getJointTransform(joint_model)));
 
     // joint_transform = inverseWorldTransform * jointTransform;
     Eigen::Vector3d axis;
@@ -893,10 +922,10 @@ void ChompOptimizer::handleJointLimits()
       if (violation)
       {
         int free_var_index = max_violation_index - free_vars_start_;
-        double multiplier =
-            max_violation / joint_costs_[joint_i].getQuadraticCostInverse()(free_var_index, free_var_index);
-        group_trajectory_.getFreeJointTrajectoryBlock(joint_i) +=
-            multiplier * joint_costs_[joint_i].getQuadraticCostInverse().col(free_var_index);
+        const Eigen::VectorXd quad_cost_inv_column =
+            joint_costs_[joint_i].getQuadraticCostInverseColumn(free_var_index);
+        double multiplier = max_violation / quad_cost_inv_column(free_var_index);
+        group_trajectory_.getFreeJointTrajectoryBlock(joint_i) += multiplier * quad_cost_inv_column;
       }
       if (++count > 10)
         break;
@@ -918,66 +947,60 @@ void ChompOptimizer::performForwardKinematics()
     end = num_vars_all_ - 1;
   }
 
-  is_collision_free_ = true;
+  // each trajectory point only writes its own entries of the collision point arrays
+  forEachTrajectoryChunk(start, end, [this](int chunk_start, int chunk_end, ThreadData& thread_data) {
+    // for each point in the trajectory
+    for (int i = chunk_start; i <= chunk_end; ++i)
+    {
+      // Set Robot state from trajectory point...
+      collision_detection::CollisionRequest req;
+      collision_detection::CollisionResult res;
+      req.group_name = planning_group_;
+      setRobotStateFromPoint(group_trajectory_, i, thread_data.state_);
 
-  ros::WallDuration total_dur(0.0);
+      hy_env_->getCollisionGradients(req, res, thread_data.state_, nullptr, thread_data.gsr_);
+      computeJointProperties(i, thread_data.state_);
+      state_is_in_collision_[i] = false;
 
-  // for each point in the trajectory
-  for (int i = start; i <= end; ++i)
-  {
-    // Set Robot state from trajectory point...
-    collision_detection::CollisionRequest req;
-    collision_detection::CollisionResult res;
-    req.group_name = planning_group_;
-    setRobotStateFromPoint(group_trajectory_, i);
-    ros::WallTime grad = ros::WallTime::now();
-
-    hy_env_->getCollisionGradients(req, res, state_, nullptr, gsr_);
-    total_dur += (ros::WallTime::now() - grad);
-    computeJointProperties(i);
-    state_is_in_collision_[i] = false;
-
-    // Keep vars in scope
-    {
-      size_t j = 0;
-      for (const collision_detection::GradientInfo& info : gsr_->gradients_)
+      // Keep vars in scope
       {
-        for (size_t k = 0; k < info.sphere_locations.size(); k++)
+        size_t j = 0;
+        for (const collision_detection::GradientInfo& info : thread_data.gsr_->gradients_)
         {
-          collision_point_pos_eigen_[i][j][0] = info.sphere_locations[k].x();
-          collision_point_pos_eigen_[i][j][1] = info.sphere_locations[k].y();
-          collision_point_pos_eigen_[i][j][2] = info.sphere_locations[k].z();
+          for (size_t k = 0; k < info.sphere_locations.size(); k++)
+          {
+            collision_point_pos_eigen_[i][j][0] = info.sphere_locations[k].x();
+            collision_point_pos_eigen_[i][j][1] = info.sphere_locations[k].y();
+            collision_point_pos_eigen_[i][j][2] = info.sphere_locations[k].z();
 
-          collision_point_potential_[i][j] =
-              getPotential(info.distances[k], info.sphere_radii[k], parameters_->min_clearance_);
-          collision_point_potential_gradient_[i][j][0] = info.gradients[k].x();
-          collision_point_potential_gradient_[i][j][1] = info.gradients[k].y();
-          collision_point_potential_gradient_[i][j][2] = info.gradients[k].z();
+            collision_point_potential_[i][j] =
+                getPotential(info.distances[k], info.sphere_radii[k], parameters_->min_clearance_);
+            collision_point_potential_gradient_[i][j][0] = info.gradients[k].x();
+            collision_point_potential_gradient_[i][j][1] = info.gradients[k].y();
+            collision_point_potential_gradient_[i][j][2] = info.gradients[k].z();
 
-          point_is_in_collision_[i][j] = (info.distances[k] - info.sphere_radii[k] < info.sphere_radii[k]);
+            point_is_in_collision_[i][j] = (info.distances[k] - info.sphere_radii[k] < info.sphere_radii[k]);
 
-          if (point_is_in_collision_[i][j])
-          {
-            state_is_in_collision_[i] = true;
-            // if(is_collision_free_ == true) {
-            //   ROS_INFO_STREAM("We know it's not collision free " << g);
-            //   ROS_INFO_STREAM("Sphere location " << info.sphere_locations[k].x() << " " <<
-            //   info.sphere_locations[k].y() << " " << info.sphere_locations[k].z());
-            //   ROS_INFO_STREAM("Gradient " << info.gradients[k].x() << " " << info.gradients[k].y() << " " <<
-            //   info.gradients[k].z() << " distance " << info.distances[k] << " radii " << info.sphere_radii[k]);
-            //   ROS_INFO_STREAM("Radius " << info.sphere_radii[k] << " potential " <<
-            //   collision_point_potential_[i][j]);
-            // }
-
-            is_collision_free_ = false;
+            if (point_is_in_collision_[i][j])
+            {
+              state_is_in_collision_[i] = true;
+            }
+            j++;
           }
-          j++;
         }
       }
     }
-  }
+  });
 
-  // ROS_INFO_STREAM("Total dur " << total_dur << " total checks " << end-start+1);
+  is_collision_free_ = true;
+  for (int i = start; i <= end; ++i)
+  {
+    if (state_is_in_collision_[i])
+    {
+      is_collision_free_ = false;
+      break;
+    }
+  }
 
   // now, get the vel and acc for each collision point (using finite differencing)
   for (int i = free_vars_start_; i <= free_vars_end_; i++)
@@ -1000,7 +1023,8 @@ void ChompOptimizer::performForwardKinematics()
   }
 }
 
-void ChompOptimizer::setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i)
+void ChompOptimizer::setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i,
+                                            moveit::core::RobotState& state)
 {
   const Eigen::MatrixXd::RowXpr& point = group_trajectory.getTrajectoryPoint(i);
 
@@ -1009,8 +1033,27 @@ void ChompOptimizer::setRobotStateFromPoint(ChompTrajectory& group_trajectory, i
   for (size_t j = 0; j < group_trajectory.getNumJoints(); j++)
     joint_states.emplace_back(point(0, j));
 
-  state_.setJointGroupPositions(planning_group_, joint_states);
-  state_.update();
+  state.setJointGroupPositions(planning_group_, joint_states);
+  state.update();
+}
+
+void ChompOptimizer::forEachTrajectoryChunk(int start, int end,
+                                            const std::function<void(int, int, ThreadData&)>& fn)
+{
+  const int num_points = end - start + 1;
+  const int num_chunks = std::min<int>(thread_data_.size(), num_points);
+  if (num_chunks <= 1)
+  {
+    fn(start, end, thread_data_[0]);
+    return;
+  }
+
+  workers_->run(num_chunks, [&](std::size_t index) {
+    const int chunk = static_cast<int>(index);
+    const int chunk_start = start + (num_points * chunk) / num_chunks;
+    const int chunk_end = start + (num_points * (chunk + 1)) / num_chunks - 1;
+    fn(chunk_start, chunk_end, thread_data_[chunk]);
+  });
 }
 
 void ChompOptimizer::perturbTrajectory()
@@ -1042,7 +1085,7 @@ void ChompOptimizer::perturbTrajectory()
   for (int i = 0; i < num_joints_; i++)
   {
     group_trajectory_.getFreeJointTrajectoryBlock(i) +=
-        joint_costs_[i].getQuadraticCostInverse().col(mp_free_vars_index) * random_state_(i);
+        joint_costs_[i].getQuadraticCostInverseColumn(mp_free_vars_index) * random_state_(i);
   }
 }
 
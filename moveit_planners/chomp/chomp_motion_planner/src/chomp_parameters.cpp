@@ -68,6 +68,7 @@ ChompParameters::ChompParameters()
   trajectory_initialization_method_ = std::string("quintic-spline");
   enable_failure_recovery_ = false;
   max_recovery_attempts_ = 5;
+  num_threads_ = 1;
 }
 
 ChompParameters::~ChompParameters() = default;
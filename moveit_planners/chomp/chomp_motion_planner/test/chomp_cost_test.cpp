@@ -0,0 +1,153 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <chomp_motion_planner/chomp_cost.h>
+#include <chomp_motion_planner/chomp_utils.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <eigen3/Eigen/LU>
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace
+{
+const double DISCRETIZATION = 0.05;
+
+// the dense quadratic cost of all variables, as ChompCost computed it before it switched to banded storage
+Eigen::MatrixXd getDenseQuadraticCost(int size, const std::vector<double>& derivative_costs, double ridge_factor)
+{
+  Eigen::MatrixXd quad_cost = Eigen::MatrixXd::Zero(size, size);
+  double multiplier = 1.0;
+  for (std::size_t i = 0; i < derivative_costs.size(); ++i)
+  {
+    multiplier *= DISCRETIZATION;
+    Eigen::MatrixXd diff_matrix = Eigen::MatrixXd::Zero(size, size);
+    for (int r = 0; r < size; ++r)
+      for (int j = -chomp::DIFF_RULE_LENGTH / 2; j <= chomp::DIFF_RULE_LENGTH / 2; ++j)
+        if (r + j >= 0 && r + j < size)
+          diff_matrix(r, r + j) = chomp::DIFF_RULES[i][j + chomp::DIFF_RULE_LENGTH / 2];
+    quad_cost += (derivative_costs[i] * multiplier) * (diff_matrix.transpose() * diff_matrix);
+  }
+  quad_cost += Eigen::MatrixXd::Identity(size, size) * ridge_factor;
+  return quad_cost;
+}
+
+void expectNear(const Eigen::VectorXd& actual, const Eigen::VectorXd& expected, double tolerance)
+{
+  ASSERT_EQ(actual.size(), expected.size());
+  EXPECT_LE((actual - expected).norm(), tolerance * expected.norm());
+}
+}  // namespace
+
+class ChompCostTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    moveit::core::RobotModelBuilder builder("one_joint", "base_link");
+    builder.addChain("base_link->link", "revolute");
+    builder.addGroupChain("base_link", "link", "arm");
+    ASSERT_TRUE(builder.isValid());
+    robot_model_ = builder.build();
+  }
+
+  // compare all queries of a ChompCost with the dense reference, for a few trajectory lengths
+  void compareWithDenseReference(const std::vector<double>& derivative_costs, double ridge_factor)
+  {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    for (std::size_t num_points : { 20, 57, 150 })
+    {
+      SCOPED_TRACE("trajectory of " + std::to_string(num_points) + " points");
+      const chomp::ChompTrajectory trajectory(robot_model_, num_points, DISCRETIZATION, "arm");
+      chomp::ChompCost cost(trajectory, 0, derivative_costs, ridge_factor);
+
+      const int num_vars_all = num_points;
+      const int num_vars_free = num_vars_all - 2 * (chomp::DIFF_RULE_LENGTH - 1);
+      Eigen::MatrixXd quad_cost_full = getDenseQuadraticCost(num_vars_all, derivative_costs, ridge_factor);
+
+      for (double scale : { 1.0, 2.5 })
+      {
+        SCOPED_TRACE("scale " + std::to_string(scale));
+        if (scale != 1.0)
+        {
+          cost.scale(scale);
+          quad_cost_full *= scale;
+        }
+        const Eigen::MatrixXd quad_cost_inv =
+            quad_cost_full.block(chomp::DIFF_RULE_LENGTH - 1, chomp::DIFF_RULE_LENGTH - 1, num_vars_free, num_vars_free)
+                .inverse();
+
+        Eigen::MatrixXd trajectory_values(num_vars_all, 1);
+        for (int i = 0; i < num_vars_all; ++i)
+          trajectory_values(i, 0) = uniform(rng);
+        const Eigen::VectorXd x = trajectory_values.col(0);
+
+        const double expected_cost = x.dot(quad_cost_full * x);
+        EXPECT_NEAR(cost.getCost(trajectory_values.col(0)), expected_cost, 1e-10 * std::abs(expected_cost));
+
+        Eigen::VectorXd derivative(num_vars_all);
+        cost.getDerivative(trajectory_values.col(0), derivative);
+        expectNear(derivative, 2.0 * quad_cost_full * x, 1e-10);
+
+        for (int i = 0; i < num_vars_free; ++i)
+          expectNear(cost.getQuadraticCostInverseColumn(i), quad_cost_inv.col(i), 1e-6);
+        EXPECT_NEAR(cost.getMaxQuadCostInvValue(), quad_cost_inv.maxCoeff(), 1e-6 * quad_cost_inv.maxCoeff());
+      }
+    }
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+};
+
+TEST_F(ChompCostTest, AccelerationCost)
+{
+  compareWithDenseReference({ 0.0, 1.0, 0.0 }, 0.0);
+}
+
+TEST_F(ChompCostTest, VelocityCost)
+{
+  compareWithDenseReference({ 1.0 }, 0.0);
+}
+
+TEST_F(ChompCostTest, MixedCostWithRidge)
+{
+  compareWithDenseReference({ 0.3, 1.0, 0.2 }, 1e-4);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
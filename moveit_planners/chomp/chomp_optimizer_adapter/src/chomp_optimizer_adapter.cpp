@@ -153,6 +153,11 @@ public:
       ROS_INFO_STREAM(
           "Param use_stochastic_descent was not set. Using default value: " << params_.use_stochastic_descent_);
     }
+    if (!nh.getParam("num_threads", params_.num_threads_))
+    {
+      params_.num_threads_ = 1;
+      ROS_INFO_STREAM("Param num_threads was not set. Using default value: " << params_.num_threads_);
+    }
     // default
     params_.trajectory_initialization_method_ = std::string("fillTrajectory");
     std::string trajectory_initialization_method;
@@ -47,6 +47,7 @@
 
 #include <moveit/kinematic_constraints/utils.h>
 #include <moveit/profiler/profiler.h>
+#include <moveit/profiler/tracer.h>
 #include <moveit/utils/lexical_casts.h>
 
 #include <ompl/config.h>
@@ -744,6 +745,7 @@ void ompl_interface::ModelBasedPlanningContext::postSolve()
 
 bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::MotionPlanResponse& res)
 {
+  MOVEIT_TRACE_SCOPE("ModelBasedPlanningContext::solve");
   if (solve(request_.allowed_planning_time, request_.num_planning_attempts))
   {
     double ptime = getLastPlanTime();
@@ -777,6 +779,7 @@ bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::Motion
 
 bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::MotionPlanDetailedResponse& res)
 {
+  MOVEIT_TRACE_SCOPE("ModelBasedPlanningContext::solve");
   if (solve(request_.allowed_planning_time, request_.num_planning_attempts))
   {
     res.trajectory_.reserve(3);
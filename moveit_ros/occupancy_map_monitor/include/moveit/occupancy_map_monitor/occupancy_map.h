@@ -40,12 +40,48 @@
 #include <boost/thread/locks.hpp>
 #include <boost/thread/shared_mutex.hpp>
 #include <boost/function.hpp>
+#include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 namespace occupancy_map_monitor
 {
 typedef octomap::OcTreeNode OccMapNode;
 
+/** @brief A log-odds change of a single cell, staged by an updater before it is applied to an OccMapTree */
+struct OccMapCellUpdate
+{
+  OccMapCellUpdate(const octomap::OcTreeKey& cell_key, float cell_log_odds)
+    : order(mortonCode(cell_key)), key(cell_key), log_odds(cell_log_odds)
+  {
+  }
+
+  /** @brief Interleave the bits of the three key coordinates, so that cells sorted by this code are visited in
+   *  octree order and consecutive updates descend through mostly the same inner nodes */
+  static uint64_t mortonCode(const octomap::OcTreeKey& key)
+  {
+    return spreadBits(key[0]) | (spreadBits(key[1]) << 1) | (spreadBits(key[2]) << 2);
+  }
+
+  uint64_t order;
+  octomap::OcTreeKey key;
+  float log_odds;
+
+private:
+  static uint64_t spreadBits(uint64_t v)
+  {
+    v &= 0xffff;
+    v = (v | (v << 16)) & 0x0000ff0000ffULL;
+    v = (v | (v << 8)) & 0x00f00f00f00fULL;
+    v = (v | (v << 4)) & 0x0c30c30c30c3ULL;
+    v = (v | (v << 2)) & 0x249249249249ULL;
+    return v;
+  }
+};
+
+using OccMapUpdateBatch = std::vector<OccMapCellUpdate>;
+
 class OccMapTree : public octomap::OcTree
 {
 public:
@@ -96,6 +132,26 @@ public:
     return WriteLock(tree_mutex_);
   }
 
+  /** @brief Apply a batch of staged cell updates. The batch is sorted in octree order without holding any lock
+   *  (updates of the same cell keep their relative order), then applied holding the write lock for at most
+   *  \e max_updates_per_lock updates at a time, so readers are only ever blocked for one short chunk. Readers may
+   *  observe a partially applied batch; every single cell update leaves the tree consistent. */
+  void applyUpdates(OccMapUpdateBatch& updates, std::size_t max_updates_per_lock = DEFAULT_MAX_UPDATES_PER_LOCK)
+  {
+    std::stable_sort(updates.begin(), updates.end(),
+                     [](const OccMapCellUpdate& a, const OccMapCellUpdate& b) { return a.order < b.order; });
+
+    max_updates_per_lock = std::max<std::size_t>(max_updates_per_lock, 1);
+    for (std::size_t begin = 0; begin < updates.size(); begin += max_updates_per_lock)
+    {
+      const std::size_t end = std::min(begin + max_updates_per_lock, updates.size());
+      WriteLock lock = writing();
+      applyUpdateChunk(updates.data() + begin, updates.data() + end);
+    }
+  }
+
+  static constexpr std::size_t DEFAULT_MAX_UPDATES_PER_LOCK = 2048;
+
   void triggerUpdateCallback()
   {
     if (update_callback_)
@@ -108,6 +164,14 @@ public:
     update_callback_ = update_callback;
   }
 
+protected:
+  /** @brief Apply the updates in [first, last) in order. Called by applyUpdates() with the write lock held */
+  virtual void applyUpdateChunk(const OccMapCellUpdate* first, const OccMapCellUpdate* last)
+  {
+    for (; first != last; ++first)
+      updateNode(first->key, first->log_odds);
+  }
+
 private:
   boost::shared_mutex tree_mutex_;
   boost::function<void()> update_callback_;
@@ -0,0 +1,158 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+#include <moveit/occupancy_map_monitor/occupancy_map.h>
+#include <random>
+#include <vector>
+
+using namespace occupancy_map_monitor;
+
+namespace
+{
+constexpr double RESOLUTION = 0.1;
+
+/** records the chunks in which applyUpdates() applies a batch */
+class TestOccMapTree : public OccMapTree
+{
+public:
+  using OccMapTree::OccMapTree;
+
+  std::vector<std::vector<OccMapCellUpdate>> chunks;
+
+protected:
+  void applyUpdateChunk(const OccMapCellUpdate* first, const OccMapCellUpdate* last) override
+  {
+    chunks.emplace_back(first, last);
+    OccMapTree::applyUpdateChunk(first, last);
+  }
+};
+
+/** a batch of hit, miss and model updates to a small block of cells, so most cells are updated several times */
+OccMapUpdateBatch createBatch(const OccMapTree& tree, std::size_t size)
+{
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<int> coordinate(-6, 6);
+  std::uniform_int_distribution<int> kind(0, 5);
+  const float model_log_odds = tree.getClampingThresMinLog() - tree.getClampingThresMaxLog();
+
+  OccMapUpdateBatch updates;
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    const octomap::OcTreeKey key(32768 + coordinate(gen), 32768 + coordinate(gen), 32768 + coordinate(gen));
+    const int k = kind(gen);
+    if (k < 3)
+      updates.emplace_back(key, tree.getProbHitLog());
+    else if (k < 5)
+      updates.emplace_back(key, tree.getProbMissLog());
+    else
+      updates.emplace_back(key, model_log_odds);
+  }
+  return updates;
+}
+}  // namespace
+
+TEST(OccMapTree, ApplyUpdatesMatchesSerialUpdates)
+{
+  TestOccMapTree tree(RESOLUTION);
+  OccMapUpdateBatch updates = createBatch(tree, 20000);
+
+  // the reference applies every update in the order in which it was staged
+  octomap::OcTree expected_tree(RESOLUTION);
+  for (const OccMapCellUpdate& update : updates)
+    expected_tree.updateNode(update.key, update.log_odds);
+
+  const OccMapUpdateBatch staged_updates = updates;
+  tree.applyUpdates(updates, 100);
+
+  for (const OccMapCellUpdate& update : staged_updates)
+  {
+    const octomap::OcTreeNode* node = tree.search(update.key);
+    const octomap::OcTreeNode* expected_node = expected_tree.search(update.key);
+    ASSERT_TRUE(node != nullptr);
+    ASSERT_TRUE(expected_node != nullptr);
+    EXPECT_EQ(node->getLogOdds(), expected_node->getLogOdds());
+  }
+  EXPECT_EQ(tree.getNumLeafNodes(), expected_tree.getNumLeafNodes());
+
+  // the updates are applied in octree order
+  for (std::size_t i = 1; i < updates.size(); ++i)
+    EXPECT_LE(updates[i - 1].order, updates[i].order);
+}
+
+TEST(OccMapTree, ApplyUpdatesChunks)
+{
+  for (std::size_t max_updates_per_lock : { std::size_t(0), std::size_t(1), std::size_t(64), std::size_t(1000),
+                                            OccMapTree::DEFAULT_MAX_UPDATES_PER_LOCK })
+  {
+    TestOccMapTree tree(RESOLUTION);
+    OccMapUpdateBatch updates = createBatch(tree, 5000);
+    if (max_updates_per_lock == OccMapTree::DEFAULT_MAX_UPDATES_PER_LOCK)
+      tree.applyUpdates(updates);
+    else
+      tree.applyUpdates(updates, max_updates_per_lock);
+
+    // every chunk but the last one holds the maximum number of updates, and together they hold the sorted batch
+    const std::size_t chunk_size = std::max<std::size_t>(max_updates_per_lock, 1);
+    ASSERT_EQ(tree.chunks.size(), (updates.size() + chunk_size - 1) / chunk_size);
+    std::size_t applied = 0;
+    for (std::size_t i = 0; i < tree.chunks.size(); ++i)
+    {
+      const std::vector<OccMapCellUpdate>& chunk = tree.chunks[i];
+      if (i + 1 < tree.chunks.size())
+        EXPECT_EQ(chunk.size(), chunk_size);
+      else
+        EXPECT_LE(chunk.size(), chunk_size);
+      for (const OccMapCellUpdate& update : chunk)
+      {
+        EXPECT_TRUE(update.key == updates[applied].key);
+        EXPECT_EQ(update.log_odds, updates[applied].log_odds);
+        ++applied;
+      }
+    }
+    EXPECT_EQ(applied, updates.size());
+  }
+
+  // an empty batch does not take the lock
+  TestOccMapTree tree(RESOLUTION);
+  OccMapUpdateBatch updates;
+  tree.applyUpdates(updates);
+  EXPECT_TRUE(tree.chunks.empty());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -39,8 +39,11 @@
 #include <rclcpp/rclcpp.hpp>
 #include <tf2_ros/buffer.h>
 #include <moveit/occupancy_map_monitor/occupancy_map_updater.h>
+#include <moveit/mesh_filter/cpu_mesh_filter.h>
+#ifdef MOVEIT_PERCEPTION_WITH_OPENGL
 #include <moveit/mesh_filter/mesh_filter.h>
 #include <moveit/mesh_filter/stereo_camera_model.h>
+#endif
 #include <moveit/lazy_free_space_updater/lazy_free_space_updater.h>
 #include <image_transport/image_transport.hpp>
 #include <memory>
@@ -64,6 +67,9 @@ private:
   void depthImageCallback(const sensor_msgs::msg::Image::ConstSharedPtr& depth_msg,
                           const sensor_msgs::msg::CameraInfo::ConstSharedPtr& info_msg);
   bool getShapeTransform(mesh_filter::MeshHandle h, Eigen::Isometry3d& transform) const;
+  void getFilteredLabels(mesh_filter::LabelType* labels) const;
+  void getFilteredDepth(float* depth) const;
+  void getModelDepth(float* depth) const;
   void stopHelper();
 
   rclcpp::Node::SharedPtr node_;
@@ -92,13 +98,17 @@ private:
   double max_update_rate_;
   unsigned int skip_vertical_pixels_;
   unsigned int skip_horizontal_pixels_;
+  bool use_cpu_mesh_filter_;
 
   unsigned int image_callback_count_;
   double average_callback_dt_;
   unsigned int good_tf_;
   unsigned int failed_tf_;
 
+#ifdef MOVEIT_PERCEPTION_WITH_OPENGL
   std::unique_ptr<mesh_filter::MeshFilter<mesh_filter::StereoCameraModel> > mesh_filter_;
+#endif
+  std::unique_ptr<mesh_filter::CPUMeshFilter> cpu_mesh_filter_;
   std::unique_ptr<LazyFreeSpaceUpdater> free_space_updater_;
 
   std::vector<float> x_cache_, y_cache_;
@@ -50,6 +50,15 @@ namespace occupancy_map_monitor
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.perception.depth_image_octomap_updater");
 
+#ifdef MOVEIT_PERCEPTION_WITH_OPENGL
+// the labels of both mesh filters are interpreted the same way below
+static_assert(static_cast<int>(mesh_filter::CPUMeshFilter::BACKGROUND) ==
+                      static_cast<int>(mesh_filter::MeshFilterBase::BACKGROUND) &&
+                  static_cast<int>(mesh_filter::CPUMeshFilter::FAR_CLIP) ==
+                      static_cast<int>(mesh_filter::MeshFilterBase::FAR_CLIP),
+              "CPUMeshFilter and MeshFilterBase labels differ");
+#endif
+
 DepthImageOctomapUpdater::DepthImageOctomapUpdater()
   : OccupancyMapUpdater("DepthImageUpdater")
   , image_topic_("depth")
@@ -62,6 +71,7 @@ DepthImageOctomapUpdater::DepthImageOctomapUpdater()
   , max_update_rate_(0)
   , skip_vertical_pixels_(4)
   , skip_horizontal_pixels_(6)
+  , use_cpu_mesh_filter_(false)
   , image_callback_count_(0)
   , average_callback_dt_(0.0)
   , good_tf_(5)
@@ -94,6 +104,7 @@ bool DepthImageOctomapUpdater::setParams(const std::string& name_space)
         node_->get_parameter(name_space + ".skip_vertical_pixels", skip_vertical_pixels_) &&
         node_->get_parameter(name_space + ".skip_horizontal_pixels", skip_horizontal_pixels_) &&
         node_->get_parameter(name_space + ".filtered_cloud_topic", filtered_cloud_topic_);
+    node_->get_parameter(name_space + ".use_cpu_mesh_filter", use_cpu_mesh_filter_);
     return true;
   }
   catch (const rclcpp::exceptions::InvalidParameterTypeException& e)
@@ -114,15 +125,39 @@ bool DepthImageOctomapUpdater::initialize(const rclcpp::Node::SharedPtr& node)
   tf_buffer_ = monitor_->getTFClient();
   free_space_updater_.reset(new LazyFreeSpaceUpdater(tree_));
 
-  // create our mesh filter
-  mesh_filter_.reset(new mesh_filter::MeshFilter<mesh_filter::StereoCameraModel>(
-      mesh_filter::MeshFilterBase::TransformCallback(), mesh_filter::StereoCameraModel::REGISTERED_PSDK_PARAMS));
-  mesh_filter_->parameters().setDepthRange(near_clipping_plane_distance_, far_clipping_plane_distance_);
-  mesh_filter_->setShadowThreshold(shadow_threshold_);
-  mesh_filter_->setPaddingOffset(padding_offset_);
-  mesh_filter_->setPaddingScale(padding_scale_);
-  mesh_filter_->setTransformCallback(boost::bind(&DepthImageOctomapUpdater::getShapeTransform, this,
-                                                 boost::placeholders::_1, boost::placeholders::_2));
+#ifndef MOVEIT_PERCEPTION_WITH_OPENGL
+  if (!use_cpu_mesh_filter_)
+  {
+    RCLCPP_WARN(LOGGER, "moveit_ros_perception was built without OpenGL, using the CPU mesh filter");
+    use_cpu_mesh_filter_ = true;
+  }
+#endif
+
+  // create our mesh filter; the CPU version does not need an OpenGL context, e.g. on headless machines
+  if (use_cpu_mesh_filter_)
+  {
+    cpu_mesh_filter_.reset(new mesh_filter::CPUMeshFilter(
+        mesh_filter::CPUMeshFilter::TransformCallback(), mesh_filter::CPUMeshFilter::Parameters::REGISTERED_PSDK_PARAMS));
+    cpu_mesh_filter_->parameters().setDepthRange(near_clipping_plane_distance_, far_clipping_plane_distance_);
+    cpu_mesh_filter_->setShadowThreshold(shadow_threshold_);
+    cpu_mesh_filter_->setPaddingOffset(padding_offset_);
+    cpu_mesh_filter_->setPaddingScale(padding_scale_);
+    cpu_mesh_filter_->setTransformCallback(boost::bind(&DepthImageOctomapUpdater::getShapeTransform, this,
+                                                       boost::placeholders::_1, boost::placeholders::_2));
+  }
+#ifdef MOVEIT_PERCEPTION_WITH_OPENGL
+  else
+  {
+    mesh_filter_.reset(new mesh_filter::MeshFilter<mesh_filter::StereoCameraModel>(
+        mesh_filter::MeshFilterBase::TransformCallback(), mesh_filter::StereoCameraModel::REGISTERED_PSDK_PARAMS));
+    mesh_filter_->parameters().setDepthRange(near_clipping_plane_distance_, far_clipping_plane_distance_);
+    mesh_filter_->setShadowThreshold(shadow_threshold_);
+    mesh_filter_->setPaddingOffset(padding_offset_);
+    mesh_filter_->setPaddingScale(padding_scale_);
+    mesh_filter_->setTransformCallback(boost::bind(&DepthImageOctomapUpdater::getShapeTransform, this,
+                                                   boost::placeholders::_1, boost::placeholders::_2));
+  }
+#endif
 
   // init rclcpp time default value
   last_update_time_ = node_->now();
@@ -162,16 +197,28 @@ void DepthImageOctomapUpdater::stopHelper()
 mesh_filter::MeshHandle DepthImageOctomapUpdater::excludeShape(const shapes::ShapeConstPtr& shape)
 {
   mesh_filter::MeshHandle h = 0;
-  if (mesh_filter_)
+#ifdef MOVEIT_PERCEPTION_WITH_OPENGL
+  const bool initialized = cpu_mesh_filter_ || mesh_filter_;
+#else
+  const bool initialized = static_cast<bool>(cpu_mesh_filter_);
+#endif
+  if (initialized)
   {
+    std::unique_ptr<shapes::Mesh> m;
+    const shapes::Mesh* mesh = nullptr;
     if (shape->type == shapes::MESH)
-      h = mesh_filter_->addMesh(static_cast<const shapes::Mesh&>(*shape));
+      mesh = static_cast<const shapes::Mesh*>(shape.get());
     else
     {
-      std::unique_ptr<shapes::Mesh> m(shapes::createMeshFromShape(shape.get()));
-      if (m)
-        h = mesh_filter_->addMesh(*m);
+      m.reset(shapes::createMeshFromShape(shape.get()));
+      mesh = m.get();
     }
+    if (mesh && cpu_mesh_filter_)
+      h = cpu_mesh_filter_->addMesh(*mesh);
+#ifdef MOVEIT_PERCEPTION_WITH_OPENGL
+    else if (mesh)
+      h = mesh_filter_->addMesh(*mesh);
+#endif
   }
   else
     RCLCPP_ERROR(LOGGER, "Mesh filter not yet initialized!");
@@ -180,8 +227,12 @@ mesh_filter::MeshHandle DepthImageOctomapUpdater::excludeShape(const shapes::Sha
 
 void DepthImageOctomapUpdater::forgetShape(mesh_filter::MeshHandle handle)
 {
-  if (mesh_filter_)
+  if (cpu_mesh_filter_)
+    cpu_mesh_filter_->removeMesh(handle);
+#ifdef MOVEIT_PERCEPTION_WITH_OPENGL
+  else if (mesh_filter_)
     mesh_filter_->removeMesh(handle);
+#endif
 }
 
 bool DepthImageOctomapUpdater::getShapeTransform(mesh_filter::MeshHandle h, Eigen::Isometry3d& transform) const
@@ -196,6 +247,36 @@ bool DepthImageOctomapUpdater::getShapeTransform(mesh_filter::MeshHandle h, Eige
   return true;
 }
 
+void DepthImageOctomapUpdater::getFilteredLabels(mesh_filter::LabelType* labels) const
+{
+  if (cpu_mesh_filter_)
+    cpu_mesh_filter_->getFilteredLabels(labels);
+#ifdef MOVEIT_PERCEPTION_WITH_OPENGL
+  else
+    mesh_filter_->getFilteredLabels(labels);
+#endif
+}
+
+void DepthImageOctomapUpdater::getFilteredDepth(float* depth) const
+{
+  if (cpu_mesh_filter_)
+    cpu_mesh_filter_->getFilteredDepth(depth);
+#ifdef MOVEIT_PERCEPTION_WITH_OPENGL
+  else
+    mesh_filter_->getFilteredDepth(depth);
+#endif
+}
+
+void DepthImageOctomapUpdater::getModelDepth(float* depth) const
+{
+  if (cpu_mesh_filter_)
+    cpu_mesh_filter_->getModelDepth(depth);
+#ifdef MOVEIT_PERCEPTION_WITH_OPENGL
+  else
+    mesh_filter_->getModelDepth(depth);
+#endif
+}
+
 namespace
 {
 bool host_is_big_endian()
@@ -323,25 +404,39 @@ void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::msg::Image:
   const int h = depth_msg->height;
 
   // call the mesh filter
-  mesh_filter::StereoCameraModel::Parameters& params = mesh_filter_->parameters();
-  params.setCameraParameters(info_msg->k[0], info_msg->k[4], info_msg->k[2], info_msg->k[5]);
-  params.setImageSize(w, h);
+  if (cpu_mesh_filter_)
+  {
+    cpu_mesh_filter_->parameters().setCameraParameters(info_msg->k[0], info_msg->k[4], info_msg->k[2], info_msg->k[5]);
+    cpu_mesh_filter_->parameters().setImageSize(w, h);
+  }
+#ifdef MOVEIT_PERCEPTION_WITH_OPENGL
+  else
+  {
+    mesh_filter_->parameters().setCameraParameters(info_msg->k[0], info_msg->k[4], info_msg->k[2], info_msg->k[5]);
+    mesh_filter_->parameters().setImageSize(w, h);
+  }
+#endif
 
   const bool is_u_short = depth_msg->encoding == sensor_msgs::image_encodings::TYPE_16UC1;
-  if (is_u_short)
-    mesh_filter_->filter(&depth_msg->data[0], GL_UNSIGNED_SHORT);
-  else
+  if (!is_u_short && depth_msg->encoding != sensor_msgs::image_encodings::TYPE_32FC1)
   {
-    if (depth_msg->encoding != sensor_msgs::image_encodings::TYPE_32FC1)
-    {
-      RCLCPP_ERROR_THROTTLE(LOGGER, *node_->get_clock(), 1000, "Unexpected encoding type: '%s'. Ignoring input.",
-                            depth_msg->encoding.c_str());
-      return;
-    }
-    mesh_filter_->filter(&depth_msg->data[0], GL_FLOAT);
+    RCLCPP_ERROR_THROTTLE(LOGGER, *node_->get_clock(), 1000, "Unexpected encoding type: '%s'. Ignoring input.",
+                          depth_msg->encoding.c_str());
+    return;
   }
+  if (cpu_mesh_filter_)
+  {
+    if (is_u_short)
+      cpu_mesh_filter_->filter(reinterpret_cast<const uint16_t*>(&depth_msg->data[0]));
+    else
+      cpu_mesh_filter_->filter(reinterpret_cast<const float*>(&depth_msg->data[0]));
+  }
+#ifdef MOVEIT_PERCEPTION_WITH_OPENGL
+  else
+    mesh_filter_->filter(&depth_msg->data[0], is_u_short ? GL_UNSIGNED_SHORT : GL_FLOAT);
+#endif
 
-  // the mesh filter runs in background; compute extra things in the meantime
+  // the GL mesh filter runs in background; compute extra things in the meantime
 
   // Use correct principal point from calibration
   const double px = info_msg->k[2];
@@ -391,7 +486,7 @@ void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::msg::Image:
 
   // get the labels of the filtered data
   const unsigned int* labels_row = &filtered_labels_[0];
-  mesh_filter_->getFilteredLabels(&filtered_labels_[0]);
+  getFilteredLabels(&filtered_labels_[0]);
 
   // publish debug information if needed
   if (debug_info_)
@@ -404,7 +499,7 @@ void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::msg::Image:
     debug_msg.encoding = sensor_msgs::image_encodings::TYPE_32FC1;
     debug_msg.step = w * sizeof(float);
     debug_msg.data.resize(img_size * sizeof(float));
-    mesh_filter_->getModelDepth(reinterpret_cast<float*>(&debug_msg.data[0]));
+    getModelDepth(reinterpret_cast<float*>(&debug_msg.data[0]));
     pub_model_depth_image_.publish(debug_msg, *info_msg);
 
     sensor_msgs::msg::Image filtered_depth_msg;
@@ -415,7 +510,7 @@ void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::msg::Image:
     filtered_depth_msg.encoding = sensor_msgs::image_encodings::TYPE_32FC1;
     filtered_depth_msg.step = w * sizeof(float);
     filtered_depth_msg.data.resize(img_size * sizeof(float));
-    mesh_filter_->getFilteredDepth(reinterpret_cast<float*>(&filtered_depth_msg.data[0]));
+    getFilteredDepth(reinterpret_cast<float*>(&filtered_depth_msg.data[0]));
     pub_filtered_depth_image_.publish(filtered_depth_msg, *info_msg);
 
     sensor_msgs::msg::Image label_msg;
@@ -426,7 +521,7 @@ void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::msg::Image:
     label_msg.encoding = sensor_msgs::image_encodings::RGBA8;
     label_msg.step = w * sizeof(unsigned int);
     label_msg.data.resize(img_size * sizeof(unsigned int));
-    mesh_filter_->getFilteredLabels(reinterpret_cast<unsigned int*>(&label_msg.data[0]));
+    getFilteredLabels(reinterpret_cast<unsigned int*>(&label_msg.data[0]));
 
     pub_filtered_label_image_.publish(label_msg, *info_msg);
   }
@@ -447,7 +542,7 @@ void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::msg::Image:
     if (filtered_data.size() < img_size)
       filtered_data.resize(img_size);
 
-    mesh_filter_->getFilteredDepth(reinterpret_cast<float*>(&filtered_data[0]));
+    getFilteredDepth(reinterpret_cast<float*>(&filtered_data[0]));
     unsigned short* msg_data = reinterpret_cast<unsigned short*>(&filtered_msg.data[0]);
     for (std::size_t i = 0; i < img_size; ++i)
     {
@@ -473,7 +568,7 @@ void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::msg::Image:
         for (int x = skip_horizontal_pixels_; x < w_bound; ++x)
         {
           // not filtered
-          if (labels_row[x] == mesh_filter::MeshFilterBase::BACKGROUND)
+          if (labels_row[x] == mesh_filter::CPUMeshFilter::BACKGROUND)
           {
             float zz = (float)input_row[x] * 1e-3;  // scale from mm to m
             float yy = y_cache_[y] * zz;
@@ -483,7 +578,7 @@ void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::msg::Image:
             occupied_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
           }
           // on far plane or a model point -> remove
-          else if (labels_row[x] >= mesh_filter::MeshFilterBase::FAR_CLIP)
+          else if (labels_row[x] >= mesh_filter::CPUMeshFilter::FAR_CLIP)
           {
             float zz = input_row[x] * 1e-3;
             float yy = y_cache_[y] * zz;
@@ -502,7 +597,7 @@ void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::msg::Image:
       for (int y = skip_vertical_pixels_; y < h_bound; ++y, labels_row += w, input_row += w)
         for (int x = skip_horizontal_pixels_; x < w_bound; ++x)
         {
-          if (labels_row[x] == mesh_filter::MeshFilterBase::BACKGROUND)
+          if (labels_row[x] == mesh_filter::CPUMeshFilter::BACKGROUND)
           {
             float zz = input_row[x];
             float yy = y_cache_[y] * zz;
@@ -511,7 +606,7 @@ void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::msg::Image:
             tf2::Vector3 point_tf = map_h_sensor * tf2::Vector3(xx, yy, zz);
             occupied_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
           }
-          else if (labels_row[x] >= mesh_filter::MeshFilterBase::FAR_CLIP)
+          else if (labels_row[x] >= mesh_filter::CPUMeshFilter::FAR_CLIP)
           {
             float zz = input_row[x];
             float yy = y_cache_[y] * zz;
@@ -537,18 +632,18 @@ void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::msg::Image:
     occupied_cells.erase(model_cell);
 
   // mark occupied cells
-  tree_->lockWrite();
+  OccMapUpdateBatch updates;
+  updates.reserve(occupied_cells.size());
+  for (const octomap::OcTreeKey& occupied_cell : occupied_cells)
+    updates.emplace_back(occupied_cell, tree_->getProbHitLog());
   try
   {
-    /* now mark all occupied cells */
-    for (const octomap::OcTreeKey& occupied_cell : occupied_cells)
-      tree_->updateNode(occupied_cell, true);
+    tree_->applyUpdates(updates);
   }
   catch (...)
   {
     RCLCPP_ERROR(LOGGER, "Internal error while updating octree");
   }
-  tree_->unlockWrite();
   tree_->triggerUpdateCallback();
 
   // at this point we still have not freed the space
@@ -168,25 +168,27 @@ void LazyFreeSpaceUpdater::processThread()
     }
     RCLCPP_DEBUG(LOGGER, "Marking %lu cells as free...", (long unsigned int)(free_cells1.size() + free_cells2.size()));
 
-    tree_->lockWrite();
+    OccMapUpdateBatch updates;
+    updates.reserve(process_model_cells_set_->size() + free_cells1.size() + free_cells2.size());
+
+    // set the logodds to the minimum for the cells that are part of the model
+    for (const octomap::OcTreeKey& it : *process_model_cells_set_)
+      updates.emplace_back(it, lg_0);
+
+    /* mark free cells only if not seen occupied in this cloud */
+    for (std::pair<const octomap::OcTreeKey, unsigned int>& it : free_cells1)
+      updates.emplace_back(it.first, it.second * lg_miss);
+    for (std::pair<const octomap::OcTreeKey, unsigned int>& it : free_cells2)
+      updates.emplace_back(it.first, it.second * lg_miss);
 
     try
     {
-      // set the logodds to the minimum for the cells that are part of the model
-      for (const octomap::OcTreeKey& it : *process_model_cells_set_)
-        tree_->updateNode(it, lg_0);
-
-      /* mark free cells only if not seen occupied in this cloud */
-      for (std::pair<const octomap::OcTreeKey, unsigned int>& it : free_cells1)
-        tree_->updateNode(it.first, it.second * lg_miss);
-      for (std::pair<const octomap::OcTreeKey, unsigned int>& it : free_cells2)
-        tree_->updateNode(it.first, it.second * lg_miss);
+      tree_->applyUpdates(updates);
     }
     catch (...)
     {
       RCLCPP_ERROR(LOGGER, "Internal error while updating octree");
     }
-    tree_->unlockWrite();
     tree_->triggerUpdateCallback();
 
     RCLCPP_DEBUG(LOGGER, "Marked free cells in %lf ms", (clock.now() - start).seconds() * 1000.0);
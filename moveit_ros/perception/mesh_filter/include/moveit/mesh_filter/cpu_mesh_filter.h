@@ -0,0 +1,328 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <Eigen/Geometry>  // for Isometry3d
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "moveit_cpu_mesh_filter_export.h"
+
+// forward declarations
+namespace shapes
+{
+class Mesh;
+}
+
+namespace mesh_filter
+{
+typedef unsigned int MeshHandle;
+typedef uint32_t LabelType;
+
+/**
+ * \brief CPUMeshFilter labels and removes the points of depth images that belong to given meshes, just like
+ * MeshFilter, but without OpenGL. The padded meshes are rasterized on the CPU into a model depth map, which is then
+ * compared against the sensor depth pixel by pixel. It therefore also runs on headless machines without GPU or X
+ * server, and it is the only mesh filter built when moveit_ros_perception is built without OpenGL.
+ */
+class MOVEIT_CPU_MESH_FILTER_EXPORT CPUMeshFilter
+{
+public:
+  typedef std::function<bool(MeshHandle, Eigen::Isometry3d&)> TransformCallback;
+
+  /**
+   * \brief Parameters of the stereo-like depth sensor; the same model as StereoCameraModel::Parameters, which cannot
+   * be used here because it is tied to the OpenGL renderer.
+   */
+  class MOVEIT_CPU_MESH_FILTER_EXPORT Parameters
+  {
+  public:
+    /**
+     * \brief Constructor
+     * \param[in] width width of generated depth maps from this device
+     * \param[in] height height of generated depth maps from this device
+     * \param[in] near_clipping_plane_distance distance of near clipping plane
+     * \param[in] far_clipping_plane_distance distance of far clipping plene
+     * \param[in] fx focal length in x-direction
+     * \param[in] fy focal length in y-direction
+     * \param[in] cx x component of principal point
+     * \param[in] cy y component of principal point
+     * \param[in] base_line the distance in meters used to determine disparity values
+     * \param[in] disparity_resolution resolution/quantization of disparity values in pixels
+     */
+    Parameters(unsigned width, unsigned height, float near_clipping_plane_distance, float far_clipping_plane_distance,
+               float fx, float fy, float cx, float cy, float base_line, float disparity_resolution);
+
+    /**
+     * \brief sets the image size
+     * \param[in] width with of depth map
+     * \param[in] height height of depth map
+     */
+    void setImageSize(unsigned width, unsigned height);
+
+    /**
+     * \brief sets the clipping range
+     * \param[in] near distance of near clipping plane
+     * \param[in] far distance of far clipping plane
+     */
+    void setDepthRange(float near, float far);
+
+    /**
+     * \brief sets the camera parameters of the pinhole camera where the disparities were obtained
+     * \param[in] fx focal length in x-direction
+     * \param[in] fy focal length in y-direction
+     * \param[in] cx x component of principal point
+     * \param[in] cy y component of principal point
+     */
+    void setCameraParameters(float fx, float fy, float cx, float cy);
+
+    unsigned getWidth() const;
+    unsigned getHeight() const;
+    float getNearClippingPlaneDistance() const;
+    float getFarClippingPlaneDistance() const;
+    float getFx() const;
+    float getFy() const;
+    float getCx() const;
+    float getCy() const;
+
+    /** \brief returns the coefficients that are required for obtaining the padding for meshes */
+    const Eigen::Vector3f& getPaddingCoefficients() const;
+
+    /** \brief predefined sensor model for OpenNI compatible devices, as StereoCameraModel::REGISTERED_PSDK_PARAMS */
+    static const Parameters REGISTERED_PSDK_PARAMS;  // NOLINT(readability-identifier-naming)
+
+  private:
+    unsigned width_;
+    unsigned height_;
+    float near_clipping_plane_distance_;
+    float far_clipping_plane_distance_;
+    float fx_;
+    float fy_;
+    float cx_;
+    float cy_;
+    Eigen::Vector3f padding_coefficients_;
+  };
+
+  /** \brief the labels assigned to the pixels; same values as in MeshFilterBase */
+  enum
+  {
+    BACKGROUND = 0,
+    SHADOW = 1,
+    NEAR_CLIP = 2,
+    FAR_CLIP = 3,
+    FIRST_LABEL = 16
+  };
+
+  /**
+   * \brief Constructor
+   * \param[in] transform_callback Callback function that is called for each mesh to obtain its current transformation
+   * in the sensor frame.
+   * \param[in] sensor_parameters the parameters of the depth sensor
+   */
+  CPUMeshFilter(const TransformCallback& transform_callback = TransformCallback(),
+                const Parameters& sensor_parameters = Parameters::REGISTERED_PSDK_PARAMS);
+
+  ~CPUMeshFilter();
+
+  /**
+   * \brief adds a mesh to the filter object.
+   * \param[in] mesh the mesh to be added. Vertex normals are computed if the mesh does not have them.
+   * \return handle to the mesh. This handle is passed to the transform callback and used as label of the mesh.
+   */
+  MeshHandle addMesh(const shapes::Mesh& mesh);
+
+  /**
+   * \brief removes a mesh given by its handle
+   * \param[in] mesh_handle the handle of the mesh to be removed.
+   */
+  void removeMesh(MeshHandle mesh_handle);
+
+  /**
+   * \brief label/remove pixels from input depth-image. In contrast to MeshFilter, filtering is done synchronously.
+   * \param[in] sensor_data depth image with metric depth values
+   */
+  void filter(const float* sensor_data);
+
+  /**
+   * \brief label/remove pixels from input depth-image. In contrast to MeshFilter, filtering is done synchronously.
+   * \param[in] sensor_data depth image with depth values in millimeters
+   */
+  void filter(const uint16_t* sensor_data);
+
+  /**
+   * \brief retrieves the labels of the input data
+   * \param[out] labels pointer to buffer to be filled with labels
+   */
+  void getFilteredLabels(LabelType* labels) const;
+
+  /**
+   * \brief retrieves the filtered depth values
+   * \param[out] depth pointer to buffer to be filled with metric depth values, 0 for removed pixels.
+   */
+  void getFilteredDepth(float* depth) const;
+
+  /**
+   * \brief retrieves the labels of the rendered model
+   * \param[out] labels pointer to buffer to be filled with labels
+   */
+  void getModelLabels(LabelType* labels) const;
+
+  /**
+   * \brief retrieves the depth values of the rendered model
+   * \param[out] depth pointer to buffer to be filled with metric depth values, 0 where no model was rendered.
+   */
+  void getModelDepth(float* depth) const;
+
+  /**
+   * \brief set the shadow threshold. points that are further away than the rendered model are filtered out.
+   *        Except they are further away than this threshold. Then these points are kept, but its label is set to
+   *        SHADOW
+   * \param[in] threshold shadow threshold in meters
+   */
+  void setShadowThreshold(float threshold);
+
+  /**
+   * \brief set the callback for retrieving transformations for each mesh.
+   * \param[in] transform_callback the callback
+   */
+  void setTransformCallback(const TransformCallback& transform_callback);
+
+  /**
+   * \brief set the scale component of padding used to multiply with sensor-specific padding coefficients to get final
+   * coefficients.
+   * \param[in] scale the scale value
+   */
+  void setPaddingScale(float scale);
+
+  /**
+   * \brief set the offset component of padding. This value is added to the scaled sensor-specific constant component.
+   * \param[in] offset the offset value
+   */
+  void setPaddingOffset(float offset);
+
+  /** \brief returns the Sensor Parameters */
+  Parameters& parameters();
+
+  /** \brief returns the Sensor Parameters */
+  const Parameters& parameters() const;
+
+private:
+  /** \brief a mesh with vertex normals and the bounding sphere used for culling */
+  struct Mesh
+  {
+    std::vector<Eigen::Vector3f> vertices;
+    std::vector<Eigen::Vector3f> normals;
+    std::vector<unsigned int> triangles;
+    Eigen::Vector3f center;
+    float radius;
+  };
+
+  /** \brief a triangle projected into the image, set up for rasterization */
+  struct ScreenTriangle
+  {
+    /** \brief coefficients (a, b, c) of the three edge functions a * x + b * y + c, all >= 0 inside the triangle */
+    float edges[3][3];
+
+    /** \brief coefficients of the inverse depth, which is affine in image coordinates */
+    float inv_depth[3];
+
+    /** \brief bounding box of the covered pixels, clipped to the image */
+    int x_min, x_max, y_min, y_max;
+
+    LabelType label;
+  };
+
+  /** \brief labels and filters the sensor data after scaling it to meters */
+  template <typename SensorType>
+  void doFilter(const SensorType* sensor_data, float to_metric);
+
+  /** \brief renders all meshes into model_depth_ (as inverse depth) and model_labels_ */
+  void renderModel();
+
+  /** \brief checks whether a sphere given in the sensor frame intersects the view frustum */
+  bool isSphereVisible(const Eigen::Vector3f& center, float radius) const;
+
+  /** \brief clips a triangle given in the sensor frame at the near plane, projects it and adds it to triangles_ */
+  void addTriangle(const Eigen::Vector3f& v0, const Eigen::Vector3f& v1, const Eigen::Vector3f& v2, LabelType label);
+
+  /** \brief adds a triangle given in image coordinates and inverse depth to triangles_ */
+  void addScreenTriangle(const Eigen::Vector3f& p0, const Eigen::Vector3f& p1, const Eigen::Vector3f& p2,
+                         LabelType label);
+
+  /** \brief rasterizes all triangles_ into the image rows [y_begin, y_end) */
+  void rasterize(int y_begin, int y_end);
+
+  /** \brief storage for meshes to be filtered */
+  std::map<MeshHandle, Mesh> meshes_;
+
+  /** \brief next handle to be used for next mesh that is added*/
+  MeshHandle next_handle_;
+
+  /** \brief Handle values below this are all taken */
+  MeshHandle min_handle_;
+
+  /** \brief the parameters of the used sensor model*/
+  Parameters sensor_parameters_;
+
+  /** \brief callback function for retrieving the mesh transformations*/
+  TransformCallback transform_callback_;
+
+  /** \brief protects the meshes, the transform callback and the buffers */
+  mutable std::mutex mutex_;
+
+  /** \brief padding scale*/
+  float padding_scale_;
+
+  /** \brief padding offset*/
+  float padding_offset_;
+
+  /** \brief threshold for shadowed pixels vs. filtered pixels*/
+  float shadow_threshold_;
+
+  /** \brief mesh vertices of the current frame, in the sensor frame and padded */
+  std::vector<Eigen::Vector3f> transformed_vertices_;
+
+  /** \brief triangles of the current frame to be rasterized */
+  std::vector<ScreenTriangle> triangles_;
+
+  std::vector<float> model_depth_;
+  std::vector<LabelType> model_labels_;
+  std::vector<float> filtered_depth_;
+  std::vector<LabelType> filtered_labels_;
+};
+}  // namespace mesh_filter
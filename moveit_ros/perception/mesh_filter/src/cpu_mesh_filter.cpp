@@ -0,0 +1,530 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/mesh_filter/cpu_mesh_filter.h>
+#include <geometric_shapes/shapes.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+namespace
+{
+// number of image rows rasterized as one unit of work; bands are processed in parallel
+constexpr int BAND_ROWS = 16;
+}  // namespace
+
+mesh_filter::CPUMeshFilter::Parameters::Parameters(unsigned width, unsigned height, float near_clipping_plane_distance,
+                                                   float far_clipping_plane_distance, float fx, float fy, float cx,
+                                                   float cy, float base_line, float disparity_resolution)
+  : width_(width)
+  , height_(height)
+  , near_clipping_plane_distance_(near_clipping_plane_distance)
+  , far_clipping_plane_distance_(far_clipping_plane_distance)
+  , fx_(fx)
+  , fy_(fy)
+  , cx_(cx)
+  , cy_(cy)
+  , padding_coefficients_(Eigen::Vector3f(disparity_resolution / (fx * base_line), 0, 0))
+{
+}
+
+void mesh_filter::CPUMeshFilter::Parameters::setImageSize(unsigned width, unsigned height)
+{
+  width_ = width;
+  height_ = height;
+}
+
+void mesh_filter::CPUMeshFilter::Parameters::setDepthRange(float near, float far)
+{
+  if (near <= 0)
+    throw std::runtime_error("Near clipping plane distance needs to be larger than zero!");
+
+  if (far <= near)
+    throw std::runtime_error("Far clipping plane distance must be larger than the near clipping plane distance!");
+
+  near_clipping_plane_distance_ = near;
+  far_clipping_plane_distance_ = far;
+}
+
+void mesh_filter::CPUMeshFilter::Parameters::setCameraParameters(float fx, float fy, float cx, float cy)
+{
+  fx_ = fx;
+  fy_ = fy;
+  cx_ = cx;
+  cy_ = cy;
+}
+
+unsigned mesh_filter::CPUMeshFilter::Parameters::getWidth() const
+{
+  return width_;
+}
+
+unsigned mesh_filter::CPUMeshFilter::Parameters::getHeight() const
+{
+  return height_;
+}
+
+float mesh_filter::CPUMeshFilter::Parameters::getNearClippingPlaneDistance() const
+{
+  return near_clipping_plane_distance_;
+}
+
+float mesh_filter::CPUMeshFilter::Parameters::getFarClippingPlaneDistance() const
+{
+  return far_clipping_plane_distance_;
+}
+
+float mesh_filter::CPUMeshFilter::Parameters::getFx() const
+{
+  return fx_;
+}
+
+float mesh_filter::CPUMeshFilter::Parameters::getFy() const
+{
+  return fy_;
+}
+
+float mesh_filter::CPUMeshFilter::Parameters::getCx() const
+{
+  return cx_;
+}
+
+float mesh_filter::CPUMeshFilter::Parameters::getCy() const
+{
+  return cy_;
+}
+
+const Eigen::Vector3f& mesh_filter::CPUMeshFilter::Parameters::getPaddingCoefficients() const
+{
+  return padding_coefficients_;
+}
+
+// NOLINTNEXTLINE(readability-identifier-naming)
+const mesh_filter::CPUMeshFilter::Parameters mesh_filter::CPUMeshFilter::Parameters::REGISTERED_PSDK_PARAMS(
+    640, 480, 0.4, 10.0, 525, 525, 319.5, 239.5, 0.075, 0.125);
+
+mesh_filter::CPUMeshFilter::CPUMeshFilter(const TransformCallback& transform_callback,
+                                          const Parameters& sensor_parameters)
+  : next_handle_(FIRST_LABEL)  // lower values are reserved!
+  , min_handle_(FIRST_LABEL)
+  , sensor_parameters_(sensor_parameters)
+  , transform_callback_(transform_callback)
+  , padding_scale_(1.0)
+  , padding_offset_(0.01)
+  , shadow_threshold_(0.5)
+{
+}
+
+mesh_filter::CPUMeshFilter::~CPUMeshFilter() = default;
+
+mesh_filter::MeshHandle mesh_filter::CPUMeshFilter::addMesh(const shapes::Mesh& mesh)
+{
+  std::unique_ptr<shapes::Mesh> mesh_with_normals;
+  const shapes::Mesh* source = &mesh;
+  if (!mesh.vertex_normals)
+  {
+    mesh_with_normals.reset(mesh.clone());
+    mesh_with_normals->computeVertexNormals();
+    source = mesh_with_normals.get();
+  }
+
+  Mesh cpu_mesh;
+  cpu_mesh.vertices.resize(source->vertex_count);
+  cpu_mesh.normals.resize(source->vertex_count);
+  for (unsigned int i = 0; i < source->vertex_count; ++i)
+  {
+    cpu_mesh.vertices[i] = Eigen::Vector3d(source->vertices + 3 * i).cast<float>();
+    cpu_mesh.normals[i] = Eigen::Vector3d(source->vertex_normals + 3 * i).cast<float>();
+  }
+  cpu_mesh.triangles.assign(source->triangles, source->triangles + 3 * source->triangle_count);
+
+  // bounding sphere around the center of the bounding box
+  Eigen::Vector3f min_corner = Eigen::Vector3f::Zero();
+  Eigen::Vector3f max_corner = Eigen::Vector3f::Zero();
+  if (!cpu_mesh.vertices.empty())
+  {
+    min_corner = max_corner = cpu_mesh.vertices[0];
+    for (const Eigen::Vector3f& vertex : cpu_mesh.vertices)
+    {
+      min_corner = min_corner.cwiseMin(vertex);
+      max_corner = max_corner.cwiseMax(vertex);
+    }
+  }
+  cpu_mesh.center = 0.5f * (min_corner + max_corner);
+  cpu_mesh.radius = 0.0f;
+  for (const Eigen::Vector3f& vertex : cpu_mesh.vertices)
+    cpu_mesh.radius = std::max(cpu_mesh.radius, (vertex - cpu_mesh.center).norm());
+
+  std::unique_lock<std::mutex> _(mutex_);
+  const MeshHandle ret = next_handle_;
+  meshes_[ret] = std::move(cpu_mesh);
+  const std::size_t sz = min_handle_ + meshes_.size() + 1;
+  for (std::size_t i = min_handle_; i < sz; ++i)
+    if (meshes_.find(i) == meshes_.end())
+    {
+      next_handle_ = i;
+      break;
+    }
+  min_handle_ = next_handle_;
+  return ret;
+}
+
+void mesh_filter::CPUMeshFilter::removeMesh(MeshHandle handle)
+{
+  std::unique_lock<std::mutex> _(mutex_);
+  if (meshes_.erase(handle) == 0)
+    throw std::runtime_error("Could not remove mesh. Mesh not found!");
+  min_handle_ = std::min(handle, min_handle_);
+}
+
+void mesh_filter::CPUMeshFilter::filter(const float* sensor_data)
+{
+  doFilter(sensor_data, 1.0f);
+}
+
+void mesh_filter::CPUMeshFilter::filter(const uint16_t* sensor_data)
+{
+  doFilter(sensor_data, 1e-3f);
+}
+
+template <typename SensorType>
+void mesh_filter::CPUMeshFilter::doFilter(const SensorType* sensor_data, float to_metric)
+{
+  std::unique_lock<std::mutex> _(mutex_);
+  const std::size_t size = sensor_parameters_.getWidth() * sensor_parameters_.getHeight();
+  model_depth_.assign(size, 0.0f);
+  model_labels_.assign(size, BACKGROUND);
+  filtered_depth_.resize(size);
+  filtered_labels_.resize(size);
+
+  renderModel();
+
+  const float near = sensor_parameters_.getNearClippingPlaneDistance();
+  const float far = sensor_parameters_.getFarClippingPlaneDistance();
+  const float threshold = shadow_threshold_;
+  float* model_depth = model_depth_.data();
+  const LabelType* model_labels = model_labels_.data();
+  float* filtered_depth = filtered_depth_.data();
+  LabelType* filtered_labels = filtered_labels_.data();
+
+  // same decisions as the filter shader of StereoCameraModel, in metric instead of normalized depth
+#pragma omp parallel for simd schedule(static)
+  for (std::size_t idx = 0; idx < size; ++idx)
+  {
+    const float sensor = static_cast<float>(sensor_data[idx]) * to_metric;
+    const float inv_model = model_depth[idx];
+    const float model = inv_model > 0.0f ? 1.0f / inv_model : far;
+    const float clamped = std::min(sensor, far);
+    const float diff = clamped - model;
+
+    LabelType label;
+    float depth = sensor;
+    if (!(sensor > near))  // includes invalid (0 or NaN) readings
+    {
+      label = NEAR_CLIP;
+      depth = 0.0f;
+    }
+    else if (diff < 0.0f && clamped < far)
+      label = BACKGROUND;
+    else if (diff > threshold)
+      label = SHADOW;
+    else if (clamped >= far)
+      label = FAR_CLIP;
+    else
+    {
+      label = model_labels[idx];
+      depth = 0.0f;
+    }
+    if (!(depth < far))
+      depth = 0.0f;
+
+    filtered_labels[idx] = label;
+    filtered_depth[idx] = depth;
+    model_depth[idx] = inv_model > 0.0f ? model : 0.0f;
+  }
+}
+
+void mesh_filter::CPUMeshFilter::renderModel()
+{
+  triangles_.clear();
+  if (!transform_callback_)
+    return;
+
+  const Eigen::Vector3f padding_coefficients =
+      sensor_parameters_.getPaddingCoefficients() * padding_scale_ + Eigen::Vector3f(0, 0, padding_offset_);
+
+  Eigen::Isometry3d transform;
+  for (const std::pair<const MeshHandle, Mesh>& mesh : meshes_)
+  {
+    if (!transform_callback_(mesh.first, transform))
+      continue;
+    const Eigen::Isometry3f pose = transform.cast<float>();
+
+    // cull meshes outside of the view frustum by their bounding sphere, enlarged by the largest possible padding
+    const Eigen::Vector3f center = pose * mesh.second.center;
+    const float max_z = std::abs(center.z()) + mesh.second.radius;
+    const float max_padding = std::abs(padding_coefficients[0]) * max_z * max_z +
+                              std::abs(padding_coefficients[1]) * max_z + std::abs(padding_coefficients[2]);
+    if (!isSphereVisible(center, mesh.second.radius + max_padding))
+      continue;
+
+    // move the vertices along their normals by the depth dependent padding, like the render shader does
+    const std::vector<Eigen::Vector3f>& vertices = mesh.second.vertices;
+    const std::vector<Eigen::Vector3f>& normals = mesh.second.normals;
+    transformed_vertices_.resize(vertices.size());
+    for (std::size_t i = 0; i < vertices.size(); ++i)
+    {
+      const Eigen::Vector3f vertex = pose * vertices[i];
+      const float z = vertex.z();
+      const float lambda = padding_coefficients[0] * z * z + padding_coefficients[1] * z + padding_coefficients[2];
+      transformed_vertices_[i] = vertex + lambda * (pose.linear() * normals[i]).normalized();
+    }
+
+    const std::vector<unsigned int>& triangles = mesh.second.triangles;
+    for (std::size_t i = 0; i + 2 < triangles.size(); i += 3)
+      addTriangle(transformed_vertices_[triangles[i]], transformed_vertices_[triangles[i + 1]],
+                  transformed_vertices_[triangles[i + 2]], mesh.first);
+  }
+
+  const int height = sensor_parameters_.getHeight();
+  const int bands = (height + BAND_ROWS - 1) / BAND_ROWS;
+#pragma omp parallel for schedule(dynamic)
+  for (int band = 0; band < bands; ++band)
+    rasterize(band * BAND_ROWS, std::min(height, (band + 1) * BAND_ROWS));
+}
+
+bool mesh_filter::CPUMeshFilter::isSphereVisible(const Eigen::Vector3f& center, float radius) const
+{
+  const float near = sensor_parameters_.getNearClippingPlaneDistance();
+  const float far = sensor_parameters_.getFarClippingPlaneDistance();
+  if (center.z() + radius < near || center.z() - radius > far)
+    return false;
+
+  // side planes of the frustum through the sensor origin and the outermost pixels, normals pointing inwards
+  const float fx = sensor_parameters_.getFx();
+  const float fy = sensor_parameters_.getFy();
+  const float cx = sensor_parameters_.getCx();
+  const float cy = sensor_parameters_.getCy();
+  const float max_x = sensor_parameters_.getWidth() - 1.0f;
+  const float max_y = sensor_parameters_.getHeight() - 1.0f;
+  const Eigen::Vector3f planes[4] = { Eigen::Vector3f(fx, 0, cx), Eigen::Vector3f(-fx, 0, max_x - cx),
+                                      Eigen::Vector3f(0, fy, cy), Eigen::Vector3f(0, -fy, max_y - cy) };
+  for (const Eigen::Vector3f& plane : planes)
+    if (plane.normalized().dot(center) < -radius)
+      return false;
+  return true;
+}
+
+void mesh_filter::CPUMeshFilter::addTriangle(const Eigen::Vector3f& v0, const Eigen::Vector3f& v1,
+                                             const Eigen::Vector3f& v2, LabelType label)
+{
+  // only faces whose outside is seen by the sensor are rendered, as the render pass culls back faces
+  if ((v1 - v0).cross(v2 - v0).dot(v0) >= 0.0f)
+    return;
+
+  // clip the triangle at the near plane (Sutherland-Hodgman with a single plane); yields at most 4 vertices
+  const float near = sensor_parameters_.getNearClippingPlaneDistance();
+  const Eigen::Vector3f* input[3] = { &v0, &v1, &v2 };
+  Eigen::Vector3f polygon[4];
+  int count = 0;
+  for (int i = 0; i < 3; ++i)
+  {
+    const Eigen::Vector3f& current = *input[i];
+    const Eigen::Vector3f& next = *input[(i + 1) % 3];
+    const bool current_inside = current.z() > near;
+    const bool next_inside = next.z() > near;
+    if (current_inside)
+      polygon[count++] = current;
+    if (current_inside != next_inside)
+      polygon[count++] = current + (next - current) * ((near - current.z()) / (next.z() - current.z()));
+  }
+  if (count < 3)
+    return;
+
+  // project into the image; (x, y, 1/z)
+  const float fx = sensor_parameters_.getFx();
+  const float fy = sensor_parameters_.getFy();
+  const float cx = sensor_parameters_.getCx();
+  const float cy = sensor_parameters_.getCy();
+  Eigen::Vector3f projected[4];
+  for (int i = 0; i < count; ++i)
+  {
+    const float inv_z = 1.0f / polygon[i].z();
+    projected[i] = Eigen::Vector3f(fx * polygon[i].x() * inv_z + cx, fy * polygon[i].y() * inv_z + cy, inv_z);
+  }
+
+  addScreenTriangle(projected[0], projected[1], projected[2], label);
+  if (count == 4)
+    addScreenTriangle(projected[0], projected[2], projected[3], label);
+}
+
+void mesh_filter::CPUMeshFilter::addScreenTriangle(const Eigen::Vector3f& p0, const Eigen::Vector3f& p1,
+                                                   const Eigen::Vector3f& p2, LabelType label)
+{
+  ScreenTriangle triangle;
+  triangle.x_min = std::max(0, static_cast<int>(std::ceil(std::min({ p0.x(), p1.x(), p2.x() }))));
+  triangle.x_max = std::min(static_cast<int>(sensor_parameters_.getWidth()) - 1,
+                            static_cast<int>(std::floor(std::max({ p0.x(), p1.x(), p2.x() }))));
+  triangle.y_min = std::max(0, static_cast<int>(std::ceil(std::min({ p0.y(), p1.y(), p2.y() }))));
+  triangle.y_max = std::min(static_cast<int>(sensor_parameters_.getHeight()) - 1,
+                            static_cast<int>(std::floor(std::max({ p0.y(), p1.y(), p2.y() }))));
+  if (triangle.x_min > triangle.x_max || triangle.y_min > triangle.y_max)
+    return;
+
+  float area = (p1.x() - p0.x()) * (p2.y() - p0.y()) - (p1.y() - p0.y()) * (p2.x() - p0.x());
+  if (std::abs(area) < std::numeric_limits<float>::epsilon())
+    return;
+
+  // edge i is opposite of vertex i, so that the normalized edge functions are the barycentric coordinates
+  const Eigen::Vector3f* points[3] = { &p0, &p1, &p2 };
+  const float sign = area > 0.0f ? 1.0f : -1.0f;
+  area *= sign;
+  for (int i = 0; i < 3; ++i)
+  {
+    // set up each edge from its lexicographically smaller end point, so that two triangles sharing an edge get exactly
+    // negated edge functions and no pixel on the edge is missed by both due to rounding
+    const Eigen::Vector3f* from = points[(i + 1) % 3];
+    const Eigen::Vector3f* to = points[(i + 2) % 3];
+    float edge_sign = sign;
+    if (std::make_pair(to->y(), to->x()) < std::make_pair(from->y(), from->x()))
+    {
+      std::swap(from, to);
+      edge_sign = -edge_sign;
+    }
+    const float a = from->y() - to->y();
+    const float b = to->x() - from->x();
+    const float c = -a * from->x() - b * from->y();
+    triangle.edges[i][0] = edge_sign * a;
+    triangle.edges[i][1] = edge_sign * b;
+    triangle.edges[i][2] = edge_sign * c;
+  }
+
+  for (int j = 0; j < 3; ++j)
+    triangle.inv_depth[j] = (triangle.edges[0][j] * p0.z() + triangle.edges[1][j] * p1.z() +
+                             triangle.edges[2][j] * p2.z()) /
+                            area;
+  triangle.label = label;
+  triangles_.push_back(triangle);
+}
+
+void mesh_filter::CPUMeshFilter::rasterize(int y_begin, int y_end)
+{
+  const int width = sensor_parameters_.getWidth();
+  const float inv_far = 1.0f / sensor_parameters_.getFarClippingPlaneDistance();
+
+  // triangles are drawn in order and only replace strictly closer pixels, like GL_LESS
+  for (const ScreenTriangle& triangle : triangles_)
+  {
+    const int row_begin = std::max(y_begin, triangle.y_min);
+    const int row_end = std::min(y_end, triangle.y_max + 1);
+    for (int y = row_begin; y < row_end; ++y)
+    {
+      const float(&e)[3][3] = triangle.edges;
+      const float e0 = e[0][1] * y + e[0][2];
+      const float e1 = e[1][1] * y + e[1][2];
+      const float e2 = e[2][1] * y + e[2][2];
+      const float d = triangle.inv_depth[1] * y + triangle.inv_depth[2];
+      float* depth_row = &model_depth_[static_cast<std::size_t>(y) * width];
+      LabelType* label_row = &model_labels_[static_cast<std::size_t>(y) * width];
+      const LabelType label = triangle.label;
+
+#pragma omp simd
+      for (int x = triangle.x_min; x <= triangle.x_max; ++x)
+      {
+        const float inv_depth = triangle.inv_depth[0] * x + d;
+        const bool covered = e[0][0] * x + e0 >= 0.0f && e[1][0] * x + e1 >= 0.0f && e[2][0] * x + e2 >= 0.0f &&
+                             inv_depth > inv_far && inv_depth > depth_row[x];
+        depth_row[x] = covered ? inv_depth : depth_row[x];
+        label_row[x] = covered ? label : label_row[x];
+      }
+    }
+  }
+}
+
+void mesh_filter::CPUMeshFilter::getFilteredLabels(LabelType* labels) const
+{
+  std::unique_lock<std::mutex> _(mutex_);
+  std::copy(filtered_labels_.begin(), filtered_labels_.end(), labels);
+}
+
+void mesh_filter::CPUMeshFilter::getFilteredDepth(float* depth) const
+{
+  std::unique_lock<std::mutex> _(mutex_);
+  std::copy(filtered_depth_.begin(), filtered_depth_.end(), depth);
+}
+
+void mesh_filter::CPUMeshFilter::getModelLabels(LabelType* labels) const
+{
+  std::unique_lock<std::mutex> _(mutex_);
+  std::copy(model_labels_.begin(), model_labels_.end(), labels);
+}
+
+void mesh_filter::CPUMeshFilter::getModelDepth(float* depth) const
+{
+  std::unique_lock<std::mutex> _(mutex_);
+  std::copy(model_depth_.begin(), model_depth_.end(), depth);
+}
+
+void mesh_filter::CPUMeshFilter::setShadowThreshold(float threshold)
+{
+  shadow_threshold_ = threshold;
+}
+
+void mesh_filter::CPUMeshFilter::setTransformCallback(const TransformCallback& transform_callback)
+{
+  std::unique_lock<std::mutex> _(mutex_);
+  transform_callback_ = transform_callback;
+}
+
+void mesh_filter::CPUMeshFilter::setPaddingScale(float scale)
+{
+  padding_scale_ = scale;
+}
+
+void mesh_filter::CPUMeshFilter::setPaddingOffset(float offset)
+{
+  padding_offset_ = offset;
+}
+
+mesh_filter::CPUMeshFilter::Parameters& mesh_filter::CPUMeshFilter::parameters()
+{
+  return sensor_parameters_;
+}
+
+const mesh_filter::CPUMeshFilter::Parameters& mesh_filter::CPUMeshFilter::parameters() const
+{
+  return sensor_parameters_;
+}
@@ -0,0 +1,223 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+#include <moveit/mesh_filter/cpu_mesh_filter.h>
+#include <geometric_shapes/shapes.h>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace mesh_filter;
+using namespace Eigen;
+
+namespace
+{
+constexpr unsigned WIDTH = 500;
+constexpr unsigned HEIGHT = 500;
+constexpr double NEAR = 0.5;
+constexpr double FAR = 5.0;
+constexpr double SHADOW = 0.1;
+constexpr double EPSILON = 1e-5;
+
+// a large plane at z = 0 that covers the whole visible area, with triangles of both orientations
+shapes::Mesh createPlane()
+{
+  shapes::Mesh mesh(4, 4);
+  const double vertices[12] = { -5, -5, 0, -5, 5, 0, 5, 5, 0, 5, -5, 0 };
+  const unsigned int triangles[12] = { 0, 3, 2, 0, 2, 1, 0, 2, 3, 0, 1, 2 };
+  std::copy(vertices, vertices + 12, mesh.vertices);
+  std::copy(triangles, triangles + 12, mesh.triangles);
+  mesh.computeVertexNormals();
+  return mesh;
+}
+
+template <typename Type>
+std::vector<Type> createSensorData(double to_metric)
+{
+  // make it random but reproducable
+  srand(0);
+  std::vector<Type> sensor_data(WIDTH * HEIGHT);
+  const Type t_near = NEAR / to_metric;
+  const Type t_far = FAR / to_metric;
+  for (Type& value : sensor_data)
+  {
+    do
+    {
+      value = Type(10.0 / to_metric * double(rand()) / double(RAND_MAX));
+    } while (value == t_near || value == t_far);
+  }
+  return sensor_data;
+}
+
+template <typename Type>
+void testPlane(double distance, double to_metric)
+{
+  const CPUMeshFilter::Parameters sensor_parameters(WIDTH, HEIGHT, NEAR, FAR, WIDTH >> 1, HEIGHT >> 1, WIDTH >> 1,
+                                                    HEIGHT >> 1, 0.1, 0.1);
+  CPUMeshFilter filter(
+      [distance](MeshHandle /*handle*/, Isometry3d& transform) {
+        transform = Isometry3d::Identity();
+        transform.translation() = Vector3d(0, 0, distance);
+        return true;
+      },
+      sensor_parameters);
+  filter.setShadowThreshold(SHADOW);
+  // no padding
+  filter.setPaddingOffset(0.0);
+  filter.setPaddingScale(0.0);
+  const MeshHandle handle = filter.addMesh(createPlane());
+  EXPECT_EQ(handle, static_cast<MeshHandle>(CPUMeshFilter::FIRST_LABEL));
+
+  const std::vector<Type> sensor_data = createSensorData<Type>(to_metric);
+  filter.filter(sensor_data.data());
+
+  std::vector<float> filtered_depth(WIDTH * HEIGHT);
+  std::vector<LabelType> filtered_labels(WIDTH * HEIGHT);
+  filter.getFilteredDepth(filtered_depth.data());
+  filter.getFilteredLabels(filtered_labels.data());
+
+  const bool visible = distance > NEAR && distance < FAR;
+  for (unsigned idx = 0; idx < WIDTH * HEIGHT; ++idx)
+  {
+    const double depth = sensor_data[idx] * to_metric;
+    // Only test if we are not very close to boundaries of object meshes and shadow-boundaries.
+    if (std::fabs(depth - distance - SHADOW) < EPSILON || std::fabs(depth - distance) < EPSILON)
+      continue;
+
+    LabelType label;
+    double expected_depth = depth;
+    if (depth < NEAR)
+    {
+      label = CPUMeshFilter::NEAR_CLIP;
+      expected_depth = 0;
+    }
+    else if (!visible)
+      label = depth >= FAR ? CPUMeshFilter::FAR_CLIP : CPUMeshFilter::BACKGROUND;
+    else if (depth < distance)
+      label = CPUMeshFilter::BACKGROUND;
+    else if (std::min(depth, FAR) - distance > SHADOW)
+      label = CPUMeshFilter::SHADOW;
+    else if (depth >= FAR)
+      label = CPUMeshFilter::FAR_CLIP;
+    else
+    {
+      label = handle;
+      expected_depth = 0;
+    }
+    if (expected_depth >= FAR)
+      expected_depth = 0;
+
+    ASSERT_EQ(filtered_labels[idx], label) << "distance " << distance << ", sensor depth " << depth;
+    ASSERT_NEAR(filtered_depth[idx], expected_depth, 1e-4);
+  }
+}
+}  // namespace
+
+TEST(CPUMeshFilter, FloatDepth)
+{
+  for (double distance = 0.0; distance < 6.0; distance += 0.5)
+    testPlane<float>(distance, 1.0);
+  testPlane<float>(2.37, 1.0);
+}
+
+TEST(CPUMeshFilter, UnsignedShortDepth)
+{
+  for (double distance = 0.0; distance < 6.0; distance += 0.5)
+    testPlane<unsigned short>(distance, 0.001);
+  testPlane<unsigned short>(2.37, 0.001);
+}
+
+TEST(CPUMeshFilter, ModelDepthAndCulling)
+{
+  // cube with edge length 0.2, triangles oriented outwards
+  shapes::Mesh cube(8, 12);
+  for (unsigned int i = 0; i < 8; ++i)
+  {
+    cube.vertices[3 * i] = (i & 1) ? 0.1 : -0.1;
+    cube.vertices[3 * i + 1] = (i & 2) ? 0.1 : -0.1;
+    cube.vertices[3 * i + 2] = (i & 4) ? 0.1 : -0.1;
+  }
+  const unsigned int triangles[36] = { 0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4,
+                                       2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5 };
+  std::copy(triangles, triangles + 36, cube.triangles);
+
+  CPUMeshFilter::Parameters sensor_parameters(640, 480, 0.3, 5.0, 525, 525, 319.5, 239.5, 0.075, 0.125);
+  std::vector<Isometry3d> poses(3, Isometry3d::Identity());
+  poses[0].translation() = Vector3d(0, 0, 1.5);   // in front of the sensor
+  poses[1].translation() = Vector3d(0, 0, -1.5);  // behind the sensor
+  poses[2].translation() = Vector3d(5, 0, 1.5);   // outside of the field of view
+  CPUMeshFilter filter(
+      [&poses](MeshHandle handle, Isometry3d& transform) {
+        transform = poses[handle - CPUMeshFilter::FIRST_LABEL];
+        return true;
+      },
+      sensor_parameters);
+  filter.setPaddingOffset(0.0);
+  filter.setPaddingScale(0.0);
+  for (std::size_t i = 0; i < poses.size(); ++i)
+    filter.addMesh(cube);
+
+  const std::vector<float> sensor_data(640 * 480, 1.45f);
+  filter.filter(sensor_data.data());
+  std::vector<float> model_depth(640 * 480);
+  std::vector<LabelType> model_labels(640 * 480);
+  std::vector<LabelType> filtered_labels(640 * 480);
+  filter.getModelDepth(model_depth.data());
+  filter.getModelLabels(model_labels.data());
+  filter.getFilteredLabels(filtered_labels.data());
+
+  // the front face of the first cube is seen in the center of the image
+  const std::size_t center = 240 * 640 + 320;
+  EXPECT_NEAR(model_depth[center], 1.4, 1e-4);
+  EXPECT_EQ(model_labels[center], static_cast<LabelType>(CPUMeshFilter::FIRST_LABEL));
+  EXPECT_EQ(filtered_labels[center], static_cast<LabelType>(CPUMeshFilter::FIRST_LABEL));
+
+  // nothing else is rendered
+  std::size_t rendered = 0;
+  for (std::size_t i = 0; i < model_depth.size(); ++i)
+    if (model_depth[i] > 0)
+    {
+      ++rendered;
+      EXPECT_EQ(model_labels[i], static_cast<LabelType>(CPUMeshFilter::FIRST_LABEL));
+    }
+  // the cube's front face spans 0.2 * 525 / 1.4 = 75 pixels
+  EXPECT_NEAR(static_cast<double>(rendered), 75.0 * 75.0, 2 * 75.0 + 1);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,186 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <sensor_msgs/msg/point_cloud2.hpp>
+#include <sensor_msgs/msg/point_field.hpp>
+#include <Eigen/Core>
+#include <cstdint>
+#include <string>
+
+namespace point_containment_filter
+{
+/** \brief The PointField datatype of the scalar type T */
+template <typename T>
+struct PointFieldDatatype;
+
+template <>
+struct PointFieldDatatype<float>
+{
+  static constexpr uint8_t value = sensor_msgs::msg::PointField::FLOAT32;
+};
+
+template <>
+struct PointFieldDatatype<double>
+{
+  static constexpr uint8_t value = sensor_msgs::msg::PointField::FLOAT64;
+};
+
+/** \brief A read-only view of the x, y and z fields of a PointCloud2, accessing the coordinates in the message buffer
+    in place instead of copying them. Points are indexed by row * width + col; rows of organized clouds start every
+    row_step bytes, an unorganized cloud is a single row. The view does not own the message, which has to outlive it.
+*/
+template <typename T>
+class PointCloudXYZView
+{
+public:
+  /** \brief Every subsample-th point of a row, one point per column */
+  using RowMap = Eigen::Map<const Eigen::Matrix<T, 3, Eigen::Dynamic>, 0, Eigen::OuterStride<> >;
+
+  explicit PointCloudXYZView(const sensor_msgs::msg::PointCloud2& cloud)
+    : data_(cloud.data.data())
+    , width_(cloud.width)
+    , height_(cloud.height)
+    , point_step_(cloud.point_step)
+    , row_step_(cloud.height > 1 ? std::size_t(cloud.row_step) : std::size_t(cloud.width) * cloud.point_step)
+  {
+    std::size_t* offsets[3] = { &x_offset_, &y_offset_, &z_offset_ };
+    const char* names[3] = { "x", "y", "z" };
+    for (std::size_t i = 0; i < 3 && error_.empty(); ++i)
+    {
+      const sensor_msgs::msg::PointField* field = nullptr;
+      for (const sensor_msgs::msg::PointField& f : cloud.fields)
+        if (f.name == names[i])
+          field = &f;
+      if (!field)
+        error_ = std::string("Field ") + names[i] + " does not exist";
+      else if (field->datatype != PointFieldDatatype<T>::value)
+        error_ = std::string("Field ") + names[i] + " has datatype " + std::to_string(field->datatype) +
+                 " instead of " + std::to_string(PointFieldDatatype<T>::value);
+      else if (field->offset % sizeof(T) != 0 || field->offset + sizeof(T) > point_step_)
+        error_ = std::string("Field ") + names[i] + " at offset " + std::to_string(field->offset) +
+                 " is not aligned within a point of " + std::to_string(point_step_) + " bytes";
+      else
+        *offsets[i] = field->offset;
+    }
+    if (!error_.empty())
+      return;
+
+    // the coordinates are read in place, so every one of them has to be aligned
+    if (point_step_ % sizeof(T) != 0 || row_step_ % sizeof(T) != 0 ||
+        reinterpret_cast<std::uintptr_t>(data_) % alignof(T) != 0)
+      error_ = "Point step " + std::to_string(point_step_) + " or row step " + std::to_string(row_step_) +
+               " is not a multiple of the size of the coordinates";
+    else if (size() > 0 && (row_step_ < std::size_t(width_) * point_step_ ||
+                            cloud.data.size() < (height_ - 1) * row_step_ + std::size_t(width_) * point_step_))
+      error_ = "Data of " + std::to_string(cloud.data.size()) + " bytes is too small for " + std::to_string(height_) +
+               " rows of " + std::to_string(width_) + " points";
+  }
+
+  /** \brief True if the cloud has x, y and z fields of type T that can be accessed in place */
+  bool isValid() const
+  {
+    return error_.empty();
+  }
+
+  /** \brief Why the view is not valid */
+  const std::string& getError() const
+  {
+    return error_;
+  }
+
+  /** \brief True if x, y and z are consecutive in every point, which is required by row() */
+  bool isPacked() const
+  {
+    return y_offset_ == x_offset_ + sizeof(T) && z_offset_ == y_offset_ + sizeof(T);
+  }
+
+  bool isOrganized() const
+  {
+    return height_ > 1;
+  }
+
+  unsigned int getWidth() const
+  {
+    return width_;
+  }
+
+  unsigned int getHeight() const
+  {
+    return height_;
+  }
+
+  std::size_t size() const
+  {
+    return std::size_t(width_) * height_;
+  }
+
+  const T& x(std::size_t row, std::size_t col) const
+  {
+    return coordinate(row, col, x_offset_);
+  }
+
+  const T& y(std::size_t row, std::size_t col) const
+  {
+    return coordinate(row, col, y_offset_);
+  }
+
+  const T& z(std::size_t row, std::size_t col) const
+  {
+    return coordinate(row, col, z_offset_);
+  }
+
+  /** \brief The columns 0, subsample, 2 * subsample, ... of a row as a 3xN matrix. The view has to be packed. */
+  RowMap row(std::size_t row, unsigned int subsample = 1) const
+  {
+    return RowMap(&x(row, 0), 3, (width_ + subsample - 1) / subsample,
+                  Eigen::OuterStride<>(subsample * point_step_ / sizeof(T)));
+  }
+
+private:
+  const T& coordinate(std::size_t row, std::size_t col, std::size_t offset) const
+  {
+    return *reinterpret_cast<const T*>(data_ + row * row_step_ + col * point_step_ + offset);
+  }
+
+  const uint8_t* data_;
+  unsigned int width_;
+  unsigned int height_;
+  std::size_t point_step_;
+  std::size_t row_step_;
+  std::size_t x_offset_ = 0, y_offset_ = 0, z_offset_ = 0;
+  std::string error_;
+};
+}  // namespace point_containment_filter
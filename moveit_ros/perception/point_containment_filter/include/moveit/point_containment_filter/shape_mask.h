@@ -36,9 +36,11 @@
 
 #pragma once
 
+#include <moveit/point_containment_filter/point_cloud_xyz_view.h>
 #include <sensor_msgs/msg/point_cloud2.hpp>
 #include <geometric_shapes/bodies.h>
 #include <boost/function.hpp>
+#include <Eigen/Geometry>
 #include <vector>
 #include <set>
 #include <map>
@@ -77,10 +79,17 @@ public:
   /** \brief Compute the containment mask (INSIDE or OUTSIDE) for a given pointcloud. If a mask element is INSIDE, the
      point
       is inside the robot. The point is outside if the mask element is OUTSIDE.
+      The points are processed in blocks in parallel. Each block is only tested against the bodies whose bounding
+      spheres overlap its bounding box, found through a hierarchy of bounding boxes that is rebuilt on every call.
   */
   void maskContainment(const sensor_msgs::msg::PointCloud2& data_in, const Eigen::Vector3d& sensor_pos,
                        const double min_sensor_dist, const double max_sensor_dist, std::vector<int>& mask);
 
+  /** \brief Compute the containment mask for the points of a view of a pointcloud, read in place. The mask has an
+      element for every point of the view, indexed by row * width + col. */
+  void maskContainment(const PointCloudXYZView<float>& data_in, const Eigen::Vector3d& sensor_pos,
+                       const double min_sensor_dist, const double max_sensor_dist, std::vector<int>& mask);
+
   /** \brief Get the containment mask (INSIDE or OUTSIDE) value for an individual point.
       It is assumed the point is in the frame corresponding to the TransformCallback */
   int getMaskContainment(double x, double y, double z) const;
@@ -114,6 +123,15 @@ protected:
     }
   };
 
+  /** \brief A node of the bounding volume hierarchy over the bounding spheres of the posed bodies. Leaves refer to
+      the range [begin, end) of bvh_bodies_, inner nodes to their two children. */
+  struct BVHNode
+  {
+    Eigen::AlignedBox3d box;
+    int begin, end;
+    int left, right;
+  };
+
   TransformCallback transform_callback_;
 
   /** \brief Protects, bodies_ and bspheres_. All public methods acquire this mutex for their whole duration. */
@@ -121,10 +139,22 @@ protected:
   std::set<SeeShape, SortBodies> bodies_;
   std::vector<bodies::BoundingSphere> bspheres_;
 
+  /** \brief The posed bodies (in the order of bodies_) and the hierarchy over their bounding spheres bspheres_ */
+  std::vector<const bodies::Body*> posed_bodies_;
+  std::vector<BVHNode> bvh_nodes_;
+  std::vector<int> bvh_bodies_;
+
 private:
   /** \brief Free memory. */
   void freeMemory();
 
+  /** \brief Build the subtree for bvh_bodies_[begin, end) and return the index of its root node */
+  int buildBVH(int begin, int end);
+
+  /** \brief Append the indices of all bodies whose bounding spheres overlap box to candidates, in the order of
+      bodies_ */
+  void findCandidates(const Eigen::AlignedBox3d& box, std::vector<int>& candidates) const;
+
   ShapeHandle next_handle_;
   ShapeHandle min_handle_;
   std::map<ShapeHandle, std::set<SeeShape, SortBodies>::iterator> used_handles_;
@@ -36,8 +36,9 @@
 
 #include <moveit/point_containment_filter/shape_mask.h>
 #include <geometric_shapes/body_operations.h>
-#include <sensor_msgs/point_cloud2_iterator.hpp>
 #include <rclcpp/rclcpp.hpp>
+#include <algorithm>
+#include <cmath>
 
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.perception.shape_mask");
 
@@ -114,13 +115,103 @@ void point_containment_filter::ShapeMask::removeShape(ShapeHandle handle)
     RCLCPP_ERROR(LOGGER, "Unable to remove shape handle %u", handle);
 }
 
+namespace
+{
+// number of consecutive points (row segments of organized clouds) that are culled and tested together
+constexpr int BLOCK_SIZE = 128;
+// maximal number of bodies in a leaf of the bounding volume hierarchy
+constexpr int BVH_LEAF_SIZE = 2;
+
+Eigen::AlignedBox3d sphereBox(const bodies::BoundingSphere& sphere)
+{
+  const Eigen::Vector3d extent = Eigen::Vector3d::Constant(sphere.radius);
+  return Eigen::AlignedBox3d(sphere.center - extent, sphere.center + extent);
+}
+}  // namespace
+
+int point_containment_filter::ShapeMask::buildBVH(int begin, int end)
+{
+  const int index = bvh_nodes_.size();
+  bvh_nodes_.emplace_back();
+  BVHNode node;
+  node.box.setEmpty();
+  for (int i = begin; i < end; ++i)
+    node.box.extend(sphereBox(bspheres_[bvh_bodies_[i]]));
+  node.begin = begin;
+  node.end = end;
+  node.left = node.right = -1;
+
+  if (end - begin > BVH_LEAF_SIZE)
+  {
+    // split at the median of the sphere centers along the longest axis of the box
+    Eigen::Index axis;
+    node.box.sizes().maxCoeff(&axis);
+    const int middle = begin + (end - begin) / 2;
+    std::nth_element(bvh_bodies_.begin() + begin, bvh_bodies_.begin() + middle, bvh_bodies_.begin() + end,
+                     [this, axis](int a, int b) { return bspheres_[a].center[axis] < bspheres_[b].center[axis]; });
+    node.left = buildBVH(begin, middle);
+    node.right = buildBVH(middle, end);
+  }
+  bvh_nodes_[index] = node;
+  return index;
+}
+
+void point_containment_filter::ShapeMask::findCandidates(const Eigen::AlignedBox3d& box,
+                                                         std::vector<int>& candidates) const
+{
+  candidates.clear();
+  if (bvh_nodes_.empty() || box.isEmpty())
+    return;
+
+  int stack[64];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0)
+  {
+    const BVHNode& node = bvh_nodes_[stack[--top]];
+    if (!node.box.intersects(box))
+      continue;
+    if (node.left < 0)
+    {
+      for (int i = node.begin; i < node.end; ++i)
+      {
+        const bodies::BoundingSphere& sphere = bspheres_[bvh_bodies_[i]];
+        if (box.squaredExteriorDistance(sphere.center) < sphere.radius * sphere.radius)
+          candidates.push_back(bvh_bodies_[i]);
+      }
+    }
+    else
+    {
+      stack[top++] = node.left;
+      stack[top++] = node.right;
+    }
+  }
+  // larger bodies first, as in getMaskContainment()
+  std::sort(candidates.begin(), candidates.end());
+}
+
 void point_containment_filter::ShapeMask::maskContainment(const sensor_msgs::msg::PointCloud2& data_in,
+                                                          const Eigen::Vector3d& sensor_origin,
+                                                          const double min_sensor_dist, const double max_sensor_dist,
+                                                          std::vector<int>& mask)
+{
+  const PointCloudXYZView<float> view(data_in);
+  if (!view.isValid())
+  {
+    RCLCPP_ERROR_STREAM(LOGGER, "Cannot compute the containment mask: " << view.getError());
+    mask.assign(std::size_t(data_in.width) * data_in.height, (int)CLIP);
+    return;
+  }
+  maskContainment(view, sensor_origin, min_sensor_dist, max_sensor_dist, mask);
+}
+
+void point_containment_filter::ShapeMask::maskContainment(const PointCloudXYZView<float>& data_in,
                                                           const Eigen::Vector3d& /*sensor_origin*/,
                                                           const double min_sensor_dist, const double max_sensor_dist,
                                                           std::vector<int>& mask)
 {
   boost::mutex::scoped_lock _(shapes_lock_);
-  const unsigned int np = data_in.data.size() / data_in.point_step;
+  const unsigned int np = data_in.size();
   mask.resize(np);
 
   if (bodies_.empty())
@@ -129,8 +220,9 @@ void point_containment_filter::ShapeMask::maskContainment(const sensor_msgs::msg
   {
     Eigen::Isometry3d tmp;
     bspheres_.resize(bodies_.size());
+    posed_bodies_.resize(bodies_.size());
     std::size_t j = 0;
-    for (std::set<SeeShape>::const_iterator it = bodies_.begin(); it != bodies_.end(); ++it)
+    for (std::set<SeeShape>::const_iterator it = bodies_.begin(); it != bodies_.end(); ++it, ++j)
     {
       if (!transform_callback_(it->handle, tmp))
       {
@@ -141,37 +233,89 @@ void point_containment_filter::ShapeMask::maskContainment(const sensor_msgs::msg
                               "Missing transform for shape " << it->body->getType() << " with handle " << it->handle);
       }
       else
-      {
         it->body->setPose(tmp);
-        it->body->computeBoundingSphere(bspheres_[j++]);
-      }
+      // bodies without a new transform are still tested at their last pose
+      it->body->computeBoundingSphere(bspheres_[j]);
+      posed_bodies_[j] = it->body;
     }
 
-    // compute a sphere that bounds the entire robot
-    bodies::BoundingSphere bound;
-    bodies::mergeBoundingSpheres(bspheres_, bound);
-    const double radius_squared = bound.radius * bound.radius;
+    // build the bounding volume hierarchy over the bounding spheres of the bodies
+    bvh_bodies_.resize(bodies_.size());
+    for (std::size_t i = 0; i < bvh_bodies_.size(); ++i)
+      bvh_bodies_[i] = i;
+    bvh_nodes_.clear();
+    buildBVH(0, bvh_bodies_.size());
 
     // we now decide which points we keep
-    sensor_msgs::PointCloud2ConstIterator<float> iter_x(data_in, "x");
-    sensor_msgs::PointCloud2ConstIterator<float> iter_y(data_in, "y");
-    sensor_msgs::PointCloud2ConstIterator<float> iter_z(data_in, "z");
-
-    // Cloud iterators are not incremented in the for loop, because of the pragma
-    // Comment out below parallelization as it can result in very high CPU consumption
-    //#pragma omp parallel for schedule(dynamic)
-    for (int i = 0; i < (int)np; ++i)
+    const unsigned int width = data_in.getWidth();
+    const int blocks = (np + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+#pragma omp parallel
     {
-      Eigen::Vector3d pt = Eigen::Vector3d(*(iter_x + i), *(iter_y + i), *(iter_z + i));
-      double d = pt.norm();
-      int out = OUTSIDE;
-      if (d < min_sensor_dist || d > max_sensor_dist)
-        out = CLIP;
-      else if ((bound.center - pt).squaredNorm() < radius_squared)
-        for (std::set<SeeShape>::const_iterator it = bodies_.begin(); it != bodies_.end() && out == OUTSIDE; ++it)
-          if (it->body->containsPoint(pt))
-            out = INSIDE;
-      mask[i] = out;
+      double x[BLOCK_SIZE], y[BLOCK_SIZE], z[BLOCK_SIZE];
+      int out[BLOCK_SIZE];
+      unsigned char in_sphere[BLOCK_SIZE];
+      std::vector<int> candidates;
+      candidates.reserve(bodies_.size());
+
+#pragma omp for schedule(dynamic)
+      for (int block = 0; block < blocks; ++block)
+      {
+        const int begin = block * BLOCK_SIZE;
+        const int count = std::min<int>(BLOCK_SIZE, np - begin);
+        // blocks may span several rows of organized clouds
+        std::size_t row = begin / width, col = begin % width;
+        for (int k = 0; k < count; ++k)
+        {
+          x[k] = data_in.x(row, col);
+          y[k] = data_in.y(row, col);
+          z[k] = data_in.z(row, col);
+          if (++col == width)
+          {
+            col = 0;
+            ++row;
+          }
+        }
+
+#pragma omp simd
+        for (int k = 0; k < count; ++k)
+        {
+          const double d = std::sqrt(x[k] * x[k] + y[k] * y[k] + z[k] * z[k]);
+          out[k] = (d < min_sensor_dist || d > max_sensor_dist) ? CLIP : OUTSIDE;
+        }
+
+        // only bodies overlapping the bounding box of the remaining points need to be tested
+        Eigen::AlignedBox3d box;
+        box.setEmpty();
+        for (int k = 0; k < count; ++k)
+          if (out[k] == OUTSIDE && std::isfinite(x[k] + y[k] + z[k]))
+            box.extend(Eigen::Vector3d(x[k], y[k], z[k]));
+        findCandidates(box, candidates);
+
+        for (int candidate : candidates)
+        {
+          const bodies::BoundingSphere& sphere = bspheres_[candidate];
+          const double cx = sphere.center.x();
+          const double cy = sphere.center.y();
+          const double cz = sphere.center.z();
+          const double radius_squared = sphere.radius * sphere.radius;
+#pragma omp simd
+          for (int k = 0; k < count; ++k)
+          {
+            const double dx = x[k] - cx;
+            const double dy = y[k] - cy;
+            const double dz = z[k] - cz;
+            in_sphere[k] = out[k] == OUTSIDE && dx * dx + dy * dy + dz * dz < radius_squared;
+          }
+
+          const bodies::Body* body = posed_bodies_[candidate];
+          for (int k = 0; k < count; ++k)
+            if (in_sphere[k] && body->containsPoint(Eigen::Vector3d(x[k], y[k], z[k])))
+              out[k] = INSIDE;
+        }
+
+        std::copy(out, out + count, mask.begin() + begin);
+      }
     }
   }
 }
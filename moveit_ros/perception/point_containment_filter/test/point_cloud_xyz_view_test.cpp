@@ -0,0 +1,268 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+#include <moveit/point_containment_filter/point_cloud_xyz_view.h>
+#include <moveit/point_containment_filter/shape_mask.h>
+#include <geometric_shapes/shapes.h>
+#include <cstring>
+#include <vector>
+
+using namespace point_containment_filter;
+
+namespace
+{
+/** a cloud with the x, y and z fields of type T at the given offsets. The coordinates of the point at (row, col) are
+    (row, col, 100 * row + col) */
+template <typename T>
+sensor_msgs::msg::PointCloud2 createCloud(uint32_t width, uint32_t height, uint32_t point_step, uint32_t row_step,
+                                          const uint32_t offsets[3])
+{
+  sensor_msgs::msg::PointCloud2 cloud;
+  cloud.width = width;
+  cloud.height = height;
+  cloud.point_step = point_step;
+  cloud.row_step = row_step;
+  const char* names[3] = { "x", "y", "z" };
+  for (uint32_t i = 0; i < 3; ++i)
+  {
+    sensor_msgs::msg::PointField field;
+    field.name = names[i];
+    field.offset = offsets[i];
+    field.datatype = PointFieldDatatype<T>::value;
+    field.count = 1;
+    cloud.fields.push_back(field);
+  }
+  // no padding after the last point
+  cloud.data.resize(height > 0 ? (height - 1) * row_step + width * point_step : 0);
+  for (uint32_t row = 0; row < height; ++row)
+  {
+    for (uint32_t col = 0; col < width; ++col)
+    {
+      const T xyz[3] = { T(row), T(col), T(100 * row + col) };
+      for (uint32_t i = 0; i < 3; ++i)
+        std::memcpy(&cloud.data[row * row_step + col * point_step + offsets[i]], &xyz[i], sizeof(T));
+    }
+  }
+  return cloud;
+}
+
+template <typename T>
+void expectCoordinates(const PointCloudXYZView<T>& view)
+{
+  ASSERT_TRUE(view.isValid()) << view.getError();
+  for (std::size_t row = 0; row < view.getHeight(); ++row)
+  {
+    for (std::size_t col = 0; col < view.getWidth(); ++col)
+    {
+      EXPECT_EQ(view.x(row, col), T(row));
+      EXPECT_EQ(view.y(row, col), T(col));
+      EXPECT_EQ(view.z(row, col), T(100 * row + col));
+    }
+  }
+}
+
+template <typename T>
+void expectRows(const PointCloudXYZView<T>& view)
+{
+  ASSERT_TRUE(view.isPacked());
+  for (unsigned int subsample = 1; subsample <= 4; ++subsample)
+  {
+    for (std::size_t row = 0; row < view.getHeight(); ++row)
+    {
+      const typename PointCloudXYZView<T>::RowMap points = view.row(row, subsample);
+      ASSERT_EQ(points.rows(), 3);
+      ASSERT_EQ(static_cast<unsigned int>(points.cols()), (view.getWidth() + subsample - 1) / subsample);
+      for (Eigen::Index i = 0; i < points.cols(); ++i)
+      {
+        const std::size_t col = i * subsample;
+        EXPECT_EQ(points(0, i), T(row));
+        EXPECT_EQ(points(1, i), T(col));
+        EXPECT_EQ(points(2, i), T(100 * row + col));
+      }
+    }
+  }
+}
+}  // namespace
+
+TEST(PointCloudXYZView, PaddedRows)
+{
+  // the coordinates follow a 4 byte field, and each row is padded by 12 bytes
+  const uint32_t offsets[3] = { 4, 8, 12 };
+  const sensor_msgs::msg::PointCloud2 cloud = createCloud<float>(7, 5, 20, 7 * 20 + 12, offsets);
+  const PointCloudXYZView<float> view(cloud);
+  ASSERT_TRUE(view.isValid()) << view.getError();
+  EXPECT_TRUE(view.isOrganized());
+  EXPECT_EQ(view.getWidth(), 7u);
+  EXPECT_EQ(view.getHeight(), 5u);
+  EXPECT_EQ(view.size(), 35u);
+  expectCoordinates(view);
+  expectRows(view);
+}
+
+TEST(PointCloudXYZView, Unorganized)
+{
+  // the row step of unorganized clouds is not used
+  const uint32_t offsets[3] = { 0, 4, 8 };
+  sensor_msgs::msg::PointCloud2 cloud = createCloud<float>(11, 1, 16, 11 * 16, offsets);
+  cloud.row_step = 0;
+  const PointCloudXYZView<float> view(cloud);
+  EXPECT_FALSE(view.isOrganized());
+  expectCoordinates(view);
+  expectRows(view);
+}
+
+TEST(PointCloudXYZView, Float64)
+{
+  const uint32_t offsets[3] = { 0, 8, 16 };
+  const sensor_msgs::msg::PointCloud2 cloud = createCloud<double>(6, 4, 32, 6 * 32 + 16, offsets);
+  const PointCloudXYZView<double> view(cloud);
+  expectCoordinates(view);
+  expectRows(view);
+
+  // the coordinates are not converted
+  const PointCloudXYZView<float> float_view(cloud);
+  EXPECT_FALSE(float_view.isValid());
+}
+
+TEST(PointCloudXYZView, NonPacked)
+{
+  // z is stored before y
+  const uint32_t offsets[3] = { 0, 12, 4 };
+  const sensor_msgs::msg::PointCloud2 cloud = createCloud<float>(5, 3, 16, 5 * 16, offsets);
+  const PointCloudXYZView<float> view(cloud);
+  EXPECT_FALSE(view.isPacked());
+  expectCoordinates(view);
+}
+
+TEST(PointCloudXYZView, InvalidFields)
+{
+  const uint32_t offsets[3] = { 0, 4, 8 };
+  const sensor_msgs::msg::PointCloud2 valid_cloud = createCloud<float>(5, 3, 16, 5 * 16, offsets);
+  ASSERT_TRUE(PointCloudXYZView<float>(valid_cloud).isValid());
+
+  // missing field
+  sensor_msgs::msg::PointCloud2 cloud = valid_cloud;
+  cloud.fields.pop_back();
+  EXPECT_FALSE(PointCloudXYZView<float>(cloud).isValid());
+
+  // misaligned offset
+  cloud = valid_cloud;
+  cloud.fields[1].offset = 6;
+  EXPECT_FALSE(PointCloudXYZView<float>(cloud).isValid());
+
+  // offset out of the point
+  cloud = valid_cloud;
+  cloud.fields[2].offset = 16;
+  EXPECT_FALSE(PointCloudXYZView<float>(cloud).isValid());
+  cloud.fields[2].offset = 14;
+  EXPECT_FALSE(PointCloudXYZView<float>(cloud).isValid());
+
+  // a point step that misaligns the following points
+  cloud = valid_cloud;
+  cloud.point_step = 18;
+  cloud.row_step = 5 * 18;
+  cloud.data.resize(3 * cloud.row_step);
+  EXPECT_FALSE(PointCloudXYZView<float>(cloud).isValid());
+
+  // a row step that misaligns the following rows
+  cloud = valid_cloud;
+  cloud.row_step = 5 * 16 + 2;
+  cloud.data.resize(3 * cloud.row_step);
+  EXPECT_FALSE(PointCloudXYZView<float>(cloud).isValid());
+
+  // a row step shorter than the points of a row
+  cloud = valid_cloud;
+  cloud.row_step = 4 * 16;
+  EXPECT_FALSE(PointCloudXYZView<float>(cloud).isValid());
+}
+
+TEST(PointCloudXYZView, ShortBuffer)
+{
+  // the last row does not need to be padded
+  const uint32_t offsets[3] = { 0, 4, 8 };
+  sensor_msgs::msg::PointCloud2 cloud = createCloud<float>(5, 3, 16, 5 * 16 + 8, offsets);
+  ASSERT_EQ(cloud.data.size(), 2u * (5 * 16 + 8) + 5 * 16);
+  expectCoordinates(PointCloudXYZView<float>(cloud));
+
+  cloud.data.pop_back();
+  const PointCloudXYZView<float> view(cloud);
+  EXPECT_FALSE(view.isValid());
+  EXPECT_FALSE(view.getError().empty());
+
+  // an empty cloud does not need any data
+  const sensor_msgs::msg::PointCloud2 empty_cloud = createCloud<float>(0, 0, 16, 0, offsets);
+  const PointCloudXYZView<float> empty_view(empty_cloud);
+  EXPECT_TRUE(empty_view.isValid()) << empty_view.getError();
+  EXPECT_EQ(empty_view.size(), 0u);
+}
+
+TEST(PointCloudXYZView, InvalidCloudIsClipped)
+{
+  // a sphere that contains all points of the cloud
+  ShapeMask shape_mask([](ShapeHandle /*handle*/, Eigen::Isometry3d& transform) {
+    transform = Eigen::Isometry3d::Identity();
+    return true;
+  });
+  shape_mask.addShape(std::make_shared<shapes::Sphere>(1000.0));
+
+  const uint32_t offsets[3] = { 0, 4, 8 };
+  const sensor_msgs::msg::PointCloud2 valid_cloud = createCloud<float>(5, 3, 16, 5 * 16, offsets);
+  std::vector<int> mask;
+  shape_mask.maskContainment(valid_cloud, Eigen::Vector3d::Zero(), 0.0, 1000.0, mask);
+  ASSERT_EQ(mask.size(), 15u);
+  for (int value : mask)
+    EXPECT_EQ(value, ShapeMask::INSIDE);
+
+  // clouds that cannot be read result in a mask of the size of the cloud in which every point is clipped
+  std::vector<sensor_msgs::msg::PointCloud2> invalid_clouds(3, valid_cloud);
+  invalid_clouds[0].fields.pop_back();
+  invalid_clouds[1].fields[0].datatype = sensor_msgs::msg::PointField::FLOAT64;
+  invalid_clouds[2].data.pop_back();
+  for (const sensor_msgs::msg::PointCloud2& cloud : invalid_clouds)
+  {
+    ASSERT_FALSE(PointCloudXYZView<float>(cloud).isValid());
+    mask.assign(3, ShapeMask::INSIDE);
+    shape_mask.maskContainment(cloud, Eigen::Vector3d::Zero(), 0.0, 1000.0, mask);
+    ASSERT_EQ(mask.size(), 15u);
+    for (int value : mask)
+      EXPECT_EQ(value, ShapeMask::CLIP);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
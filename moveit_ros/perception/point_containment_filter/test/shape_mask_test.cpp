@@ -0,0 +1,199 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+#include <moveit/point_containment_filter/shape_mask.h>
+#include <geometric_shapes/shapes.h>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace point_containment_filter;
+
+namespace
+{
+constexpr unsigned int WIDTH = 320;
+constexpr unsigned int HEIGHT = 240;
+constexpr double MIN_SENSOR_DIST = 0.3;
+constexpr double MAX_SENSOR_DIST = 2.4;
+
+/** an organized cloud of points in front of the sensor at origin, looking along z, with some NaN points */
+sensor_msgs::msg::PointCloud2 createCloud(std::mt19937& gen)
+{
+  sensor_msgs::msg::PointCloud2 cloud;
+  cloud.width = WIDTH;
+  cloud.height = HEIGHT;
+  cloud.point_step = 16;
+  cloud.row_step = WIDTH * cloud.point_step;
+  cloud.fields.resize(3);
+  const char* names[3] = { "x", "y", "z" };
+  for (uint32_t i = 0; i < 3; ++i)
+  {
+    cloud.fields[i].name = names[i];
+    cloud.fields[i].offset = 4 * i;
+    cloud.fields[i].datatype = sensor_msgs::msg::PointField::FLOAT32;
+    cloud.fields[i].count = 1;
+  }
+  cloud.data.resize(HEIGHT * cloud.row_step);
+
+  // the depths cover both clipping distances
+  std::uniform_real_distribution<float> depth(0.1f, 3.0f);
+  for (unsigned int row = 0; row < HEIGHT; ++row)
+  {
+    for (unsigned int col = 0; col < WIDTH; ++col)
+    {
+      const float z = (row * WIDTH + col) % 53 == 0 ? std::numeric_limits<float>::quiet_NaN() : depth(gen);
+      const float xyz[3] = { (col - 0.5f * WIDTH) / (0.5f * WIDTH) * z, (row - 0.5f * HEIGHT) / (0.5f * WIDTH) * z, z };
+      std::memcpy(&cloud.data[row * cloud.row_step + col * cloud.point_step], xyz, sizeof(xyz));
+    }
+  }
+  return cloud;
+}
+
+/** the value of the mask for a single point, computed without culling */
+int expectedMask(const ShapeMask& shape_mask, const Eigen::Vector3d& point)
+{
+  const double d = point.norm();
+  if (d < MIN_SENSOR_DIST || d > MAX_SENSOR_DIST)
+    return ShapeMask::CLIP;
+  return shape_mask.getMaskContainment(point);
+}
+}  // namespace
+
+TEST(ShapeMask, MaskMatchesPointContainment)
+{
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> unit(-1.0, 1.0);
+
+  std::vector<Eigen::Isometry3d> poses;
+  ShapeMask shape_mask([&poses](ShapeHandle handle, Eigen::Isometry3d& transform) {
+    transform = poses[handle - 1];
+    return true;
+  });
+
+  // boxes and spheres of different sizes in front of the sensor
+  for (int i = 0; i < 40; ++i)
+  {
+    shapes::ShapeConstPtr shape;
+    if (i % 2)
+      shape = std::make_shared<shapes::Sphere>(0.05 + 0.1 * std::abs(unit(gen)));
+    else
+      shape = std::make_shared<shapes::Box>(0.05 + 0.2 * std::abs(unit(gen)), 0.05 + 0.2 * std::abs(unit(gen)),
+                                            0.05 + 0.2 * std::abs(unit(gen)));
+    EXPECT_EQ(shape_mask.addShape(shape, 1.0, 0.02), static_cast<ShapeHandle>(i + 1));
+    poses.push_back(Eigen::Isometry3d::Identity());
+  }
+
+  const sensor_msgs::msg::PointCloud2 cloud = createCloud(gen);
+  const PointCloudXYZView<float> view(cloud);
+  ASSERT_TRUE(view.isValid());
+
+  // the mask is computed for several poses of the shapes, so the culling structures are rebuilt on each call
+  for (int trial = 0; trial < 3; ++trial)
+  {
+    for (Eigen::Isometry3d& pose : poses)
+    {
+      pose = Eigen::Translation3d(0.8 * unit(gen), 0.6 * unit(gen), 1.4 + unit(gen)) *
+             Eigen::AngleAxisd(M_PI * unit(gen), Eigen::Vector3d(unit(gen), unit(gen), unit(gen)).normalized());
+    }
+
+    std::vector<int> mask;
+    shape_mask.maskContainment(cloud, Eigen::Vector3d::Zero(), MIN_SENSOR_DIST, MAX_SENSOR_DIST, mask);
+    ASSERT_EQ(mask.size(), static_cast<std::size_t>(WIDTH * HEIGHT));
+
+    std::size_t counts[3] = { 0, 0, 0 };
+    for (unsigned int row = 0; row < HEIGHT; ++row)
+    {
+      for (unsigned int col = 0; col < WIDTH; ++col)
+      {
+        const Eigen::Vector3d point(view.x(row, col), view.y(row, col), view.z(row, col));
+        const int value = mask[row * WIDTH + col];
+        ASSERT_EQ(value, expectedMask(shape_mask, point)) << "point " << row << ", " << col << " in trial " << trial;
+        ++counts[value];
+      }
+    }
+    EXPECT_GT(counts[ShapeMask::INSIDE], 0u);
+    EXPECT_GT(counts[ShapeMask::OUTSIDE], 0u);
+    EXPECT_GT(counts[ShapeMask::CLIP], 0u);
+  }
+}
+
+TEST(ShapeMask, ClippedPointsInsideShapes)
+{
+  // a sphere around the sensor contains all points up to 1m
+  ShapeMask shape_mask([](ShapeHandle /*handle*/, Eigen::Isometry3d& transform) {
+    transform = Eigen::Isometry3d::Identity();
+    return true;
+  });
+  shape_mask.addShape(std::make_shared<shapes::Sphere>(1.0));
+
+  std::mt19937 gen(7);
+  const sensor_msgs::msg::PointCloud2 cloud = createCloud(gen);
+  const PointCloudXYZView<float> view(cloud);
+  std::vector<int> mask;
+  shape_mask.maskContainment(cloud, Eigen::Vector3d::Zero(), MIN_SENSOR_DIST, MAX_SENSOR_DIST, mask);
+  ASSERT_EQ(mask.size(), static_cast<std::size_t>(WIDTH * HEIGHT));
+
+  for (unsigned int row = 0; row < HEIGHT; ++row)
+  {
+    for (unsigned int col = 0; col < WIDTH; ++col)
+    {
+      const double d = Eigen::Vector3d(view.x(row, col), view.y(row, col), view.z(row, col)).norm();
+      const int value = mask[row * WIDTH + col];
+      // points closer than the minimal distance are clipped even though they are inside the sphere; invalid points
+      // are neither clipped nor inside
+      int expected = ShapeMask::OUTSIDE;
+      if (d < MIN_SENSOR_DIST || d > MAX_SENSOR_DIST)
+        expected = ShapeMask::CLIP;
+      else if (d < 1.0)
+        expected = ShapeMask::INSIDE;
+      EXPECT_EQ(value, expected) << "distance " << d;
+    }
+  }
+
+  // without shapes, no point is clipped either
+  ShapeMask empty_mask;
+  empty_mask.maskContainment(cloud, Eigen::Vector3d::Zero(), MIN_SENSOR_DIST, MAX_SENSOR_DIST, mask);
+  ASSERT_EQ(mask.size(), static_cast<std::size_t>(WIDTH * HEIGHT));
+  for (int value : mask)
+    EXPECT_EQ(value, ShapeMask::OUTSIDE);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -45,6 +45,7 @@
 #include <moveit/point_containment_filter/shape_mask.h>
 
 #include <memory>
+#include <vector>
 
 namespace occupancy_map_monitor
 {
@@ -66,11 +67,46 @@ protected:
   virtual void updateMask(const sensor_msgs::msg::PointCloud2& cloud, const Eigen::Vector3d& sensor_origin,
                           std::vector<int>& mask);
 
+  /** \brief Find the cells to update for the points of a cloud: the occupied, model and clipped cells at the ends of
+      the rays from the sensor origin, as classified by \e mask, and the free cells along these rays. Model cells are
+      not occupied and occupied cells are not free. The points are transformed into the map frame by map_r_sensor and
+      sensor_origin. They are processed on up to num_threads threads, with the same result for any number of threads.
+      If collect_filtered_points is set, the indices of the occupied points are kept in thread_buffers_.
+      \return false if the processing failed, e.g. because memory ran out */
+  bool computeCells(const octomap::OcTree& tree, const point_containment_filter::PointCloudXYZView<float>& cloud,
+                    const std::vector<int>& mask, const Eigen::Matrix3d& map_r_sensor,
+                    const Eigen::Vector3d& sensor_origin, unsigned int point_subsample, bool collect_filtered_points,
+                    int num_threads, octomap::KeySet& free_cells, octomap::KeySet& occupied_cells,
+                    octomap::KeySet& model_cells, octomap::KeySet& clip_cells);
+
+  /* buffers of a single thread of the cloud processing, kept across callbacks to reuse their memory */
+  struct ThreadBuffers
+  {
+    /* used to store all cells in the map which a given ray passes through during raycasting.
+       we cache this here because it dynamically pre-allocates a lot of memory in its contsructor */
+    octomap::KeyRay key_ray;
+
+    /* cells found by this thread, merged into the cells of the cloud after all threads are done */
+    octomap::KeySet free_cells, occupied_cells, model_cells, clip_cells;
+
+    /* indices of the points this thread found for the filtered cloud, in cloud order */
+    std::vector<unsigned int> filtered_points;
+
+    /* points of the current row, transformed into the map frame */
+    Eigen::Matrix3Xd points;
+  };
+  std::vector<ThreadBuffers> thread_buffers_;
+
 private:
   bool getShapeTransform(ShapeHandle h, Eigen::Isometry3d& transform) const;
   void cloudMsgCallback(const sensor_msgs::msg::PointCloud2::ConstSharedPtr& cloud_msg);
   void stopHelper();
 
+  /** \brief Write the points collected for the filtered cloud in thread_buffers_ into filtered_cloud, resized to
+      num_points xyz points */
+  void fillFilteredCloud(const point_containment_filter::PointCloudXYZView<float>& cloud, std::size_t num_points,
+                         sensor_msgs::msg::PointCloud2& filtered_cloud) const;
+
   // TODO: Enable private node for publishing filtered point cloud
   // ros::NodeHandle root_nh_;
   // ros::NodeHandle private_nh_;
@@ -89,15 +125,13 @@ private:
   unsigned int point_subsample_;
   double max_update_rate_;
   std::string filtered_cloud_topic_;
+  /* publish the filtered cloud in messages loaned from the middleware, if it supports them */
+  bool loan_filtered_cloud_;
   rclcpp::Publisher<sensor_msgs::msg::PointCloud2>::SharedPtr filtered_cloud_publisher_;
 
   message_filters::Subscriber<sensor_msgs::msg::PointCloud2>* point_cloud_subscriber_;
   tf2_ros::MessageFilter<sensor_msgs::msg::PointCloud2>* point_cloud_filter_;
 
-  /* used to store all cells in the map which a given ray passes through during raycasting.
-     we cache this here because it dynamically pre-allocates a lot of memory in its contsructor */
-  octomap::KeyRay key_ray_;
-
   std::unique_ptr<point_containment_filter::ShapeMask> shape_mask_;
   std::vector<int> mask_;
 };
@@ -34,7 +34,10 @@
 
 /* Author: Jon Binney, Ioan Sucan */
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstring>
 #include <moveit/pointcloud_octomap_updater/pointcloud_octomap_updater.h>
 #include <moveit/occupancy_map_monitor/occupancy_map_monitor.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
@@ -46,6 +49,7 @@
 
 #include <memory>
 #include <boost/bind.hpp>
+#include <omp.h>
 
 namespace occupancy_map_monitor
 {
@@ -57,6 +61,7 @@ PointCloudOctomapUpdater::PointCloudOctomapUpdater()
   , max_range_(std::numeric_limits<double>::infinity())
   , point_subsample_(1)
   , max_update_rate_(0)
+  , loan_filtered_cloud_(false)
   , point_cloud_subscriber_(nullptr)
   , point_cloud_filter_(nullptr)
 {
@@ -69,13 +74,16 @@ PointCloudOctomapUpdater::~PointCloudOctomapUpdater()
 
 bool PointCloudOctomapUpdater::setParams(const std::string& name_space)
 {
-  return node_->get_parameter(name_space + ".point_cloud_topic", point_cloud_topic_) &&
-         node_->get_parameter(name_space + ".max_range", max_range_) &&
-         node_->get_parameter(name_space + ".padding_offset", padding_) &&
-         node_->get_parameter(name_space + ".padding_scale", scale_) &&
-         node_->get_parameter(name_space + ".point_subsample", point_subsample_) &&
-         node_->get_parameter(name_space + ".max_update_rate", max_update_rate_) &&
-         node_->get_parameter(name_space + ".filtered_cloud_topic", filtered_cloud_topic_);
+  if (!(node_->get_parameter(name_space + ".point_cloud_topic", point_cloud_topic_) &&
+        node_->get_parameter(name_space + ".max_range", max_range_) &&
+        node_->get_parameter(name_space + ".padding_offset", padding_) &&
+        node_->get_parameter(name_space + ".padding_scale", scale_) &&
+        node_->get_parameter(name_space + ".point_subsample", point_subsample_) &&
+        node_->get_parameter(name_space + ".max_update_rate", max_update_rate_) &&
+        node_->get_parameter(name_space + ".filtered_cloud_topic", filtered_cloud_topic_)))
+    return false;
+  node_->get_parameter(name_space + ".loan_filtered_cloud", loan_filtered_cloud_);
+  return true;
 }
 
 bool PointCloudOctomapUpdater::initialize(const rclcpp::Node::SharedPtr& node)
@@ -163,6 +171,171 @@ void PointCloudOctomapUpdater::updateMask(const sensor_msgs::msg::PointCloud2& /
 {
 }
 
+void PointCloudOctomapUpdater::fillFilteredCloud(const point_containment_filter::PointCloudXYZView<float>& cloud,
+                                                 std::size_t num_points,
+                                                 sensor_msgs::msg::PointCloud2& filtered_cloud) const
+{
+  sensor_msgs::PointCloud2Modifier pcd_modifier(filtered_cloud);
+  pcd_modifier.setPointCloud2FieldsByString(1, "xyz");
+  pcd_modifier.resize(num_points);
+
+  /* x, y and z are the first fields of every point of the filtered cloud */
+  uint8_t* point = filtered_cloud.data.data();
+  const std::size_t width = cloud.getWidth();
+  for (const ThreadBuffers& buffers : thread_buffers_)
+  {
+    for (unsigned int index : buffers.filtered_points)
+    {
+      const std::size_t row = index / width, col = index % width;
+      const float xyz[3] = { cloud.x(row, col), cloud.y(row, col), cloud.z(row, col) };
+      std::memcpy(point, xyz, sizeof(xyz));
+      point += filtered_cloud.point_step;
+    }
+  }
+}
+
+bool PointCloudOctomapUpdater::computeCells(const octomap::OcTree& tree,
+                                            const point_containment_filter::PointCloudXYZView<float>& cloud,
+                                            const std::vector<int>& mask, const Eigen::Matrix3d& map_r_sensor,
+                                            const Eigen::Vector3d& sensor_origin, unsigned int point_subsample,
+                                            bool collect_filtered_points, int num_threads,
+                                            octomap::KeySet& free_cells, octomap::KeySet& occupied_cells,
+                                            octomap::KeySet& model_cells, octomap::KeySet& clip_cells)
+{
+  const unsigned int width = cloud.getWidth();
+  const unsigned int num_columns = (width + point_subsample - 1) / point_subsample;
+  const octomap::point3d sensor_origin_octomap(sensor_origin.x(), sensor_origin.y(), sensor_origin.z());
+
+  /* each thread collects cells and ray keys in its own buffers, which are merged after the parallel sections */
+  num_threads = std::max(num_threads, 1);
+  if (thread_buffers_.size() < static_cast<std::size_t>(num_threads))
+    thread_buffers_.resize(num_threads);
+  for (ThreadBuffers& buffers : thread_buffers_)
+  {
+    buffers.free_cells.clear();
+    buffers.occupied_cells.clear();
+    buffers.model_cells.clear();
+    buffers.clip_cells.clear();
+    buffers.filtered_points.clear();
+  }
+
+  /* exceptions must not leave an OpenMP region, so the threads catch them and flag the failure instead */
+  std::atomic<bool> failed(false);
+
+  /* find the cells at the end of each ray. Each thread deduplicates the cells of its points before they are
+   * merged, so every cell is ray cast only once. The static schedule gives each thread a contiguous block of
+   * rows, so the filtered points of the threads are in cloud order when concatenated in thread order. */
+#pragma omp parallel num_threads(num_threads)
+  {
+    ThreadBuffers& buffers = thread_buffers_[omp_get_thread_num()];
+
+#pragma omp for schedule(static)
+    for (unsigned int row = 0; row < cloud.getHeight(); row += point_subsample)
+    {
+      if (failed)
+        continue;
+      try
+      {
+        unsigned int row_c = row * width;
+
+        /* transform the whole row to the map frame */
+        const point_containment_filter::PointCloudXYZView<float>::RowMap sensor_points =
+            cloud.row(row, point_subsample);
+        buffers.points.resize(3, num_columns);
+        buffers.points.noalias() = map_r_sensor * sensor_points.cast<double>();
+        buffers.points.colwise() += sensor_origin;
+
+        for (unsigned int i = 0, col = 0; i < num_columns; ++i, col += point_subsample)
+        {
+          /* check for NaN */
+          if (std::isnan(sensor_points(0, i)) || std::isnan(sensor_points(1, i)) || std::isnan(sensor_points(2, i)))
+            continue;
+
+          const octomap::OcTreeKey key =
+              tree.coordToKey(buffers.points(0, i), buffers.points(1, i), buffers.points(2, i));
+
+          /* occupied cell at ray endpoint if ray is shorter than max range and this point
+             isn't on a part of the robot*/
+          if (mask[row_c + col] == point_containment_filter::ShapeMask::INSIDE)
+            buffers.model_cells.insert(key);
+          else if (mask[row_c + col] == point_containment_filter::ShapeMask::CLIP)
+            buffers.clip_cells.insert(key);
+          else
+          {
+            buffers.occupied_cells.insert(key);
+            // build list of valid points if we want to publish them
+            if (collect_filtered_points)
+              buffers.filtered_points.push_back(row_c + col);
+          }
+        }
+      }
+      catch (...)
+      {
+        failed = true;
+      }
+    }
+  }
+  if (failed)
+    return false;
+
+  try
+  {
+    for (const ThreadBuffers& buffers : thread_buffers_)
+    {
+      occupied_cells.insert(buffers.occupied_cells.begin(), buffers.occupied_cells.end());
+      model_cells.insert(buffers.model_cells.begin(), buffers.model_cells.end());
+      clip_cells.insert(buffers.clip_cells.begin(), buffers.clip_cells.end());
+    }
+
+    /* compute the free cells along each ray that ends at an occupied, model or clipped cell */
+    std::vector<octomap::OcTreeKey> ray_ends;
+    ray_ends.reserve(occupied_cells.size() + model_cells.size() + clip_cells.size());
+    ray_ends.insert(ray_ends.end(), occupied_cells.begin(), occupied_cells.end());
+    ray_ends.insert(ray_ends.end(), model_cells.begin(), model_cells.end());
+    ray_ends.insert(ray_ends.end(), clip_cells.begin(), clip_cells.end());
+
+#pragma omp parallel num_threads(num_threads)
+    {
+      ThreadBuffers& buffers = thread_buffers_[omp_get_thread_num()];
+
+#pragma omp for schedule(dynamic, 64)
+      for (std::size_t i = 0; i < ray_ends.size(); ++i)
+      {
+        if (failed)
+          continue;
+        try
+        {
+          if (tree.computeRayKeys(sensor_origin_octomap, tree.keyToCoord(ray_ends[i]), buffers.key_ray))
+            buffers.free_cells.insert(buffers.key_ray.begin(), buffers.key_ray.end());
+        }
+        catch (...)
+        {
+          failed = true;
+        }
+      }
+    }
+    if (failed)
+      return false;
+
+    for (const ThreadBuffers& buffers : thread_buffers_)
+      free_cells.insert(buffers.free_cells.begin(), buffers.free_cells.end());
+  }
+  catch (...)
+  {
+    return false;
+  }
+
+  /* cells that overlap with the model are not occupied */
+  for (const octomap::OcTreeKey& model_cell : model_cells)
+    occupied_cells.erase(model_cell);
+
+  /* occupied cells are not free */
+  for (const octomap::OcTreeKey& occupied_cell : occupied_cells)
+    free_cells.erase(occupied_cell);
+
+  return true;
+}
+
 void PointCloudOctomapUpdater::cloudMsgCallback(const sensor_msgs::msg::PointCloud2::ConstSharedPtr& cloud_msg)
 {
   RCLCPP_DEBUG(LOGGER, "Received a new point cloud message");
@@ -206,151 +379,95 @@ void PointCloudOctomapUpdater::cloudMsgCallback(const sensor_msgs::msg::PointClo
 
   /* compute sensor origin in map frame */
   const tf2::Vector3& sensor_origin_tf = map_h_sensor.getOrigin();
-  octomap::point3d sensor_origin(sensor_origin_tf.getX(), sensor_origin_tf.getY(), sensor_origin_tf.getZ());
   Eigen::Vector3d sensor_origin_eigen(sensor_origin_tf.getX(), sensor_origin_tf.getY(), sensor_origin_tf.getZ());
 
   if (!updateTransformCache(cloud_msg->header.frame_id, cloud_msg->header.stamp))
     return;
 
-  /* mask out points on the robot */
-  shape_mask_->maskContainment(*cloud_msg, sensor_origin_eigen, 0.0, max_range_, mask_);
-  updateMask(*cloud_msg, sensor_origin_eigen, mask_);
-
-  octomap::KeySet free_cells, occupied_cells, model_cells, clip_cells;
-  std::unique_ptr<sensor_msgs::msg::PointCloud2> filtered_cloud;
-
-  // We only use these iterators if we are creating a filtered_cloud for
-  // publishing. We cannot default construct these, so we use unique_ptr's
-  // to defer construction
-  std::unique_ptr<sensor_msgs::PointCloud2Iterator<float> > iter_filtered_x;
-  std::unique_ptr<sensor_msgs::PointCloud2Iterator<float> > iter_filtered_y;
-  std::unique_ptr<sensor_msgs::PointCloud2Iterator<float> > iter_filtered_z;
-
-  if (!filtered_cloud_topic_.empty())
+  /* the coordinates of the points are read in place from the message, each row is transformed as a matrix */
+  const point_containment_filter::PointCloudXYZView<float> cloud_view(*cloud_msg);
+  if (!cloud_view.isValid() || !cloud_view.isPacked())
   {
-    filtered_cloud.reset(new sensor_msgs::msg::PointCloud2());
-    filtered_cloud->header = cloud_msg->header;
-    sensor_msgs::PointCloud2Modifier pcd_modifier(*filtered_cloud);
-    pcd_modifier.setPointCloud2FieldsByString(1, "xyz");
-    pcd_modifier.resize(cloud_msg->width * cloud_msg->height);
-
-    // we have created a filtered_out, so we can create the iterators now
-    iter_filtered_x.reset(new sensor_msgs::PointCloud2Iterator<float>(*filtered_cloud, "x"));
-    iter_filtered_y.reset(new sensor_msgs::PointCloud2Iterator<float>(*filtered_cloud, "y"));
-    iter_filtered_z.reset(new sensor_msgs::PointCloud2Iterator<float>(*filtered_cloud, "z"));
+    RCLCPP_ERROR_STREAM(LOGGER, "Cannot read the points of the point cloud in place: "
+                                    << (cloud_view.isValid() ? "x, y and z are not consecutive" :
+                                                               cloud_view.getError()));
+    return;
   }
-  size_t filtered_cloud_size = 0;
-
-  tree_->lockRead();
-
-  try
-  {
-    /* do ray tracing to find which cells this point cloud indicates should be free, and which it indicates
-     * should be occupied */
-    for (unsigned int row = 0; row < cloud_msg->height; row += point_subsample_)
-    {
-      unsigned int row_c = row * cloud_msg->width;
-      sensor_msgs::PointCloud2ConstIterator<float> pt_iter(*cloud_msg, "x");
-      // set iterator to point at start of the current row
-      pt_iter += row_c;
-
-      for (unsigned int col = 0; col < cloud_msg->width; col += point_subsample_, pt_iter += point_subsample_)
-      {
-        // if (mask_[row_c + col] == point_containment_filter::ShapeMask::CLIP)
-        //  continue;
 
-        /* check for NaN */
-        if (!std::isnan(pt_iter[0]) && !std::isnan(pt_iter[1]) && !std::isnan(pt_iter[2]))
-        {
-          /* transform to map frame */
-          tf2::Vector3 point_tf = map_h_sensor * tf2::Vector3(pt_iter[0], pt_iter[1], pt_iter[2]);
-
-          /* occupied cell at ray endpoint if ray is shorter than max range and this point
-             isn't on a part of the robot*/
-          if (mask_[row_c + col] == point_containment_filter::ShapeMask::INSIDE)
-            model_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
-          else if (mask_[row_c + col] == point_containment_filter::ShapeMask::CLIP)
-            clip_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
-          else
-          {
-            occupied_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
-            // build list of valid points if we want to publish them
-            if (filtered_cloud)
-            {
-              **iter_filtered_x = pt_iter[0];
-              **iter_filtered_y = pt_iter[1];
-              **iter_filtered_z = pt_iter[2];
-              ++filtered_cloud_size;
-              ++*iter_filtered_x;
-              ++*iter_filtered_y;
-              ++*iter_filtered_z;
-            }
-          }
-        }
-      }
-    }
+  /* mask out points on the robot */
+  shape_mask_->maskContainment(cloud_view, sensor_origin_eigen, 0.0, max_range_, mask_);
+  updateMask(*cloud_msg, sensor_origin_eigen, mask_);
 
-    /* compute the free cells along each ray that ends at an occupied cell */
-    for (const octomap::OcTreeKey& occupied_cell : occupied_cells)
-      if (tree_->computeRayKeys(sensor_origin, tree_->keyToCoord(occupied_cell), key_ray_))
-        free_cells.insert(key_ray_.begin(), key_ray_.end());
+  /* the points are transformed row by row, using the rotation of the sensor in the map frame */
+  const tf2::Matrix3x3& map_r_sensor_tf = map_h_sensor.getBasis();
+  Eigen::Matrix3d map_r_sensor;
+  map_r_sensor << map_r_sensor_tf[0][0], map_r_sensor_tf[0][1], map_r_sensor_tf[0][2], map_r_sensor_tf[1][0],
+      map_r_sensor_tf[1][1], map_r_sensor_tf[1][2], map_r_sensor_tf[2][0], map_r_sensor_tf[2][1], map_r_sensor_tf[2][2];
 
-    /* compute the free cells along each ray that ends at a model cell */
-    for (const octomap::OcTreeKey& model_cell : model_cells)
-      if (tree_->computeRayKeys(sensor_origin, tree_->keyToCoord(model_cell), key_ray_))
-        free_cells.insert(key_ray_.begin(), key_ray_.end());
+  octomap::KeySet free_cells, occupied_cells, model_cells, clip_cells;
+  const bool publish_filtered_cloud = !filtered_cloud_topic_.empty();
 
-    /* compute the free cells along each ray that ends at a clipped cell */
-    for (const octomap::OcTreeKey& clip_cell : clip_cells)
-      if (tree_->computeRayKeys(sensor_origin, tree_->keyToCoord(clip_cell), key_ray_))
-        free_cells.insert(key_ray_.begin(), key_ray_.end());
-  }
-  catch (...)
+  tree_->lockRead();
+  const bool processed =
+      computeCells(*tree_, cloud_view, mask_, map_r_sensor, sensor_origin_eigen, point_subsample_,
+                   publish_filtered_cloud, omp_get_max_threads(), free_cells, occupied_cells, model_cells, clip_cells);
+  tree_->unlockRead();
+  if (!processed)
   {
-    tree_->unlockRead();
+    RCLCPP_ERROR(LOGGER, "Internal error while processing point cloud");
     return;
   }
 
-  tree_->unlockRead();
+  /* stage the update without holding the lock; the write lock is then only taken in short chunks */
+  const float lg = tree_->getClampingThresMinLog() - tree_->getClampingThresMaxLog();
+  OccMapUpdateBatch updates;
+  updates.reserve(free_cells.size() + occupied_cells.size() + model_cells.size());
 
-  /* cells that overlap with the model are not occupied */
-  for (const octomap::OcTreeKey& model_cell : model_cells)
-    occupied_cells.erase(model_cell);
+  /* mark free cells only if not seen occupied in this cloud */
+  for (const octomap::OcTreeKey& free_cell : free_cells)
+    updates.emplace_back(free_cell, tree_->getProbMissLog());
 
-  /* occupied cells are not free */
+  /* now mark all occupied cells */
   for (const octomap::OcTreeKey& occupied_cell : occupied_cells)
-    free_cells.erase(occupied_cell);
+    updates.emplace_back(occupied_cell, tree_->getProbHitLog());
 
-  tree_->lockWrite();
+  // set the logodds to the minimum for the cells that are part of the model
+  for (const octomap::OcTreeKey& model_cell : model_cells)
+    updates.emplace_back(model_cell, lg);
 
   try
   {
-    /* mark free cells only if not seen occupied in this cloud */
-    for (const octomap::OcTreeKey& free_cell : free_cells)
-      tree_->updateNode(free_cell, false);
-
-    /* now mark all occupied cells */
-    for (const octomap::OcTreeKey& occupied_cell : occupied_cells)
-      tree_->updateNode(occupied_cell, true);
-
-    // set the logodds to the minimum for the cells that are part of the model
-    const float lg = tree_->getClampingThresMinLog() - tree_->getClampingThresMaxLog();
-    for (const octomap::OcTreeKey& model_cell : model_cells)
-      tree_->updateNode(model_cell, lg);
+    tree_->applyUpdates(updates);
   }
   catch (...)
   {
     RCLCPP_ERROR(LOGGER, "Internal error while updating octree");
   }
-  tree_->unlockWrite();
   RCLCPP_DEBUG(LOGGER, "Processed point cloud in %lf ms", (node_->now() - start).seconds() * 1000.0);
   tree_->triggerUpdateCallback();
 
-  if (filtered_cloud)
+  if (publish_filtered_cloud)
   {
-    sensor_msgs::PointCloud2Modifier pcd_modifier(*filtered_cloud);
-    pcd_modifier.resize(filtered_cloud_size);
-    filtered_cloud_publisher_->publish(*filtered_cloud);
+    /* the filtered points are written once, directly into the message that is handed to the middleware */
+    std::size_t filtered_cloud_size = 0;
+    for (const ThreadBuffers& buffers : thread_buffers_)
+      filtered_cloud_size += buffers.filtered_points.size();
+
+    if (loan_filtered_cloud_ && filtered_cloud_publisher_->can_loan_messages())
+    {
+      auto filtered_cloud = filtered_cloud_publisher_->borrow_loaned_message();
+      filtered_cloud.get().header = cloud_msg->header;
+      fillFilteredCloud(cloud_view, filtered_cloud_size, filtered_cloud.get());
+      filtered_cloud_publisher_->publish(std::move(filtered_cloud));
+    }
+    else
+    {
+      /* publishing a unique_ptr lets intra process subscribers take the message without a copy */
+      auto filtered_cloud = std::make_unique<sensor_msgs::msg::PointCloud2>();
+      filtered_cloud->header = cloud_msg->header;
+      fillFilteredCloud(cloud_view, filtered_cloud_size, *filtered_cloud);
+      filtered_cloud_publisher_->publish(std::move(filtered_cloud));
+    }
   }
 }
 }  // namespace occupancy_map_monitor
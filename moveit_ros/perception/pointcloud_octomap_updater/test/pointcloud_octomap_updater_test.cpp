@@ -0,0 +1,188 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+#include <moveit/pointcloud_octomap_updater/pointcloud_octomap_updater.h>
+#include <sensor_msgs/msg/point_cloud2.hpp>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace occupancy_map_monitor;
+using point_containment_filter::ShapeMask;
+
+namespace
+{
+constexpr unsigned int WIDTH = 160;
+constexpr unsigned int HEIGHT = 120;
+constexpr unsigned int POINT_STEP = 16;
+constexpr unsigned int ROW_STEP = WIDTH * POINT_STEP + 32;  // rows are padded
+constexpr double RESOLUTION = 0.05;
+
+/** exposes the cloud processing of the updater */
+class TestPointCloudOctomapUpdater : public PointCloudOctomapUpdater
+{
+public:
+  using PointCloudOctomapUpdater::computeCells;
+
+  /** the points collected for the filtered cloud, in the order in which they would be published */
+  std::vector<unsigned int> getFilteredPoints() const
+  {
+    std::vector<unsigned int> points;
+    for (const ThreadBuffers& buffers : thread_buffers_)
+      points.insert(points.end(), buffers.filtered_points.begin(), buffers.filtered_points.end());
+    return points;
+  }
+};
+
+struct Cells
+{
+  octomap::KeySet free_cells, occupied_cells, model_cells, clip_cells;
+  std::vector<unsigned int> filtered_points;
+};
+
+sensor_msgs::msg::PointField createField(const std::string& name, uint32_t offset)
+{
+  sensor_msgs::msg::PointField field;
+  field.name = name;
+  field.offset = offset;
+  field.datatype = sensor_msgs::msg::PointField::FLOAT32;
+  field.count = 1;
+  return field;
+}
+
+/** an organized cloud of points in front of the sensor, with some invalid ones */
+sensor_msgs::msg::PointCloud2 createCloud()
+{
+  sensor_msgs::msg::PointCloud2 cloud;
+  cloud.width = WIDTH;
+  cloud.height = HEIGHT;
+  cloud.point_step = POINT_STEP;
+  cloud.row_step = ROW_STEP;
+  cloud.fields = { createField("x", 0), createField("y", 4), createField("z", 8) };
+  cloud.data.resize(HEIGHT * ROW_STEP);
+
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> depth(0.5f, 3.0f);
+  for (unsigned int row = 0; row < HEIGHT; ++row)
+  {
+    for (unsigned int col = 0; col < WIDTH; ++col)
+    {
+      const float z = depth(gen);
+      float xyz[3] = { (col - WIDTH / 2.0f) / WIDTH * z, (row - HEIGHT / 2.0f) / HEIGHT * z, z };
+      if ((row * WIDTH + col) % 37 == 0)
+        xyz[(row + col) % 3] = std::numeric_limits<float>::quiet_NaN();
+      std::memcpy(&cloud.data[row * ROW_STEP + col * POINT_STEP], xyz, sizeof(xyz));
+    }
+  }
+  return cloud;
+}
+
+Cells computeCells(const sensor_msgs::msg::PointCloud2& cloud, const std::vector<int>& mask,
+                   unsigned int point_subsample, int num_threads)
+{
+  const point_containment_filter::PointCloudXYZView<float> view(cloud);
+  EXPECT_TRUE(view.isValid() && view.isPacked());
+
+  const octomap::OcTree tree(RESOLUTION);
+  const Eigen::Matrix3d map_r_sensor = Eigen::AngleAxisd(0.4, Eigen::Vector3d(1.0, -2.0, 0.5).normalized()).matrix();
+  const Eigen::Vector3d sensor_origin(0.3, -0.2, 1.1);
+
+  TestPointCloudOctomapUpdater updater;
+  Cells cells;
+  EXPECT_TRUE(updater.computeCells(tree, view, mask, map_r_sensor, sensor_origin, point_subsample, true, num_threads,
+                                   cells.free_cells, cells.occupied_cells, cells.model_cells, cells.clip_cells));
+  cells.filtered_points = updater.getFilteredPoints();
+  return cells;
+}
+}  // namespace
+
+TEST(PointCloudOctomapUpdater, ParallelCellsMatchSerial)
+{
+  const sensor_msgs::msg::PointCloud2 cloud = createCloud();
+  std::vector<int> mask(WIDTH * HEIGHT, ShapeMask::OUTSIDE);
+  for (std::size_t i = 0; i < mask.size(); ++i)
+  {
+    if (i % 11 == 0)
+      mask[i] = ShapeMask::INSIDE;
+    else if (i % 7 == 0)
+      mask[i] = ShapeMask::CLIP;
+  }
+
+  for (unsigned int point_subsample : { 1u, 3u })
+  {
+    const Cells serial = computeCells(cloud, mask, point_subsample, 1);
+    ASSERT_FALSE(serial.free_cells.empty());
+    ASSERT_FALSE(serial.occupied_cells.empty());
+    ASSERT_FALSE(serial.model_cells.empty());
+    ASSERT_FALSE(serial.clip_cells.empty());
+
+    // the filtered points are the valid points outside of the robot, in cloud order
+    std::vector<unsigned int> expected_filtered_points;
+    const point_containment_filter::PointCloudXYZView<float> view(cloud);
+    for (unsigned int row = 0; row < HEIGHT; row += point_subsample)
+    {
+      for (unsigned int col = 0; col < WIDTH; col += point_subsample)
+      {
+        if (mask[row * WIDTH + col] == ShapeMask::OUTSIDE && !std::isnan(view.x(row, col)) &&
+            !std::isnan(view.y(row, col)) && !std::isnan(view.z(row, col)))
+          expected_filtered_points.push_back(row * WIDTH + col);
+      }
+    }
+    EXPECT_EQ(serial.filtered_points, expected_filtered_points);
+
+    for (const octomap::OcTreeKey& key : serial.occupied_cells)
+    {
+      EXPECT_EQ(serial.free_cells.count(key), 0u);
+      EXPECT_EQ(serial.model_cells.count(key), 0u);
+    }
+
+    for (int num_threads : { 2, 3, 4 })
+    {
+      const Cells parallel = computeCells(cloud, mask, point_subsample, num_threads);
+      EXPECT_TRUE(parallel.free_cells == serial.free_cells) << num_threads << " threads";
+      EXPECT_TRUE(parallel.occupied_cells == serial.occupied_cells) << num_threads << " threads";
+      EXPECT_TRUE(parallel.model_cells == serial.model_cells) << num_threads << " threads";
+      EXPECT_TRUE(parallel.clip_cells == serial.clip_cells) << num_threads << " threads";
+      EXPECT_EQ(parallel.filtered_points, serial.filtered_points) << num_threads << " threads";
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -36,8 +36,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <functional>
+#include <memory>
 #include <string>
 
 #include <boost/signals2.hpp>
@@ -278,19 +280,54 @@ private:
   bool haveCompleteStateHelper(const rclcpp::Time& oldest_allowed_update_time,
                                std::vector<std::string>* missing_joints) const;
 
+  /** @brief An immutable copy of the current state, shared with the readers */
+  struct StateSnapshot
+  {
+    StateSnapshot(const moveit::core::RobotState& state, const rclcpp::Time& stamp) : state(state), stamp(stamp)
+    {
+    }
+
+    moveit::core::RobotState state;
+    rclcpp::Time stamp;
+  };
+  using StateSnapshotConstPtr = std::shared_ptr<const StateSnapshot>;
+
+  /** @brief Get the latest published snapshot without blocking the writers */
+  StateSnapshotConstPtr getSnapshot() const;
+
+  /** @brief Publish robot_state_ stamped with \e stamp as the new snapshot. Snapshots that are no longer referenced by
+   *  any reader are recycled, so that this does not allocate in steady state. Must be called with
+   *  state_update_lock_ held. */
+  void publishSnapshot(const rclcpp::Time& stamp);
+
+  /** @brief Get the time joint \e jm was last updated, or false if it was never updated */
+  bool getJointTime(const moveit::core::JointModel* jm, rclcpp::Time& time) const;
+
+  /** @brief Set the time joint \e jm was last updated */
+  void setJointTime(const moveit::core::JointModel* jm, const rclcpp::Time& time);
+
+  /** @brief Mark all joints as never updated */
+  void resetJointTimes();
+
   void jointStateCallback(sensor_msgs::msg::JointState::ConstSharedPtr joint_state);
   void tfCallback();
 
   std::unique_ptr<MiddlewareHandle> middleware_handle_;
   std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
   moveit::core::RobotModelConstPtr robot_model_;
-  moveit::core::RobotState robot_state_;
-  std::map<const moveit::core::JointModel*, rclcpp::Time> joint_time_;
+  moveit::core::RobotState robot_state_;  // working copy of the writers, protected by state_update_lock_
   bool state_monitor_started_;
   bool copy_dynamics_;  // Copy velocity and effort from joint_state
   rclcpp::Time monitor_start_time_ = rclcpp::Time(0, 0, RCL_ROS_TIME);
   double error_;
-  rclcpp::Time current_state_time_ = rclcpp::Time(0, 0, RCL_ROS_TIME);
+
+  // Readers access the current state through snapshot_ using the atomic shared_ptr functions and never wait for the
+  // writers. The writers serialize on state_update_lock_, which waitForCurrentState() also uses to wait for updates.
+  StateSnapshotConstPtr snapshot_;
+  std::vector<std::shared_ptr<StateSnapshot>> snapshot_pool_;  // all snapshots published so far, for recycling
+
+  // time of the last update of each joint in nanoseconds, indexed by joint index
+  std::unique_ptr<std::atomic<int64_t>[]> joint_time_;
 
   mutable std::mutex state_update_lock_;
   mutable std::condition_variable state_update_condition_;
@@ -48,6 +48,9 @@ namespace planning_scene_monitor
 namespace
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.current_state_monitor");
+
+// value of joint_time_ for joints that were never updated
+static const int64_t NEVER_UPDATED = std::numeric_limits<int64_t>::min();
 }
 
 CurrentStateMonitor::CurrentStateMonitor(std::unique_ptr<CurrentStateMonitor::MiddlewareHandle> middleware_handle,
@@ -62,6 +65,11 @@ CurrentStateMonitor::CurrentStateMonitor(std::unique_ptr<CurrentStateMonitor::Mi
   , error_(std::numeric_limits<double>::epsilon())
 {
   robot_state_.setToDefaultValues();
+  joint_time_.reset(new std::atomic<int64_t>[robot_model_->getJointModelCount()]);
+  resetJointTimes();
+
+  std::unique_lock<std::mutex> slock(state_update_lock_);
+  publishSnapshot(rclcpp::Time(0, 0, RCL_ROS_TIME));
 }
 
 CurrentStateMonitor::CurrentStateMonitor(const rclcpp::Node::SharedPtr& node,
@@ -76,32 +84,75 @@ CurrentStateMonitor::~CurrentStateMonitor()
   stopStateMonitor();
 }
 
+CurrentStateMonitor::StateSnapshotConstPtr CurrentStateMonitor::getSnapshot() const
+{
+  return std::atomic_load(&snapshot_);
+}
+
+void CurrentStateMonitor::publishSnapshot(const rclcpp::Time& stamp)
+{
+  // a snapshot that is only referenced by the pool is neither current nor used by a reader, so it can be overwritten
+  for (const std::shared_ptr<StateSnapshot>& snapshot : snapshot_pool_)
+  {
+    if (snapshot.use_count() == 1)
+    {
+      // make sure the last reader is done with the snapshot before it is modified
+      std::atomic_thread_fence(std::memory_order_acquire);
+      snapshot->state.assignFrom(robot_state_);
+      snapshot->stamp = stamp;
+      std::atomic_store(&snapshot_, StateSnapshotConstPtr(snapshot));
+      return;
+    }
+  }
+  snapshot_pool_.push_back(std::make_shared<StateSnapshot>(robot_state_, stamp));
+  std::atomic_store(&snapshot_, StateSnapshotConstPtr(snapshot_pool_.back()));
+}
+
+bool CurrentStateMonitor::getJointTime(const moveit::core::JointModel* jm, rclcpp::Time& time) const
+{
+  const int64_t nanoseconds = joint_time_[jm->getJointIndex()].load(std::memory_order_acquire);
+  if (nanoseconds == NEVER_UPDATED)
+    return false;
+  time = rclcpp::Time(nanoseconds, RCL_ROS_TIME);
+  return true;
+}
+
+void CurrentStateMonitor::setJointTime(const moveit::core::JointModel* jm, const rclcpp::Time& time)
+{
+  joint_time_[jm->getJointIndex()].store(time.nanoseconds(), std::memory_order_release);
+}
+
+void CurrentStateMonitor::resetJointTimes()
+{
+  for (std::size_t i = 0; i < robot_model_->getJointModelCount(); ++i)
+    joint_time_[i].store(NEVER_UPDATED, std::memory_order_release);
+}
+
 moveit::core::RobotStatePtr CurrentStateMonitor::getCurrentState() const
 {
-  std::unique_lock<std::mutex> slock(state_update_lock_);
-  moveit::core::RobotState* result = new moveit::core::RobotState(robot_state_);
+  const StateSnapshotConstPtr snapshot = getSnapshot();
+  moveit::core::RobotState* result = new moveit::core::RobotState(snapshot->state);
   return moveit::core::RobotStatePtr(result);
 }
 
 rclcpp::Time CurrentStateMonitor::getCurrentStateTime() const
 {
-  std::unique_lock<std::mutex> slock(state_update_lock_);
-  return current_state_time_;
+  return getSnapshot()->stamp;
 }
 
 std::pair<moveit::core::RobotStatePtr, rclcpp::Time> CurrentStateMonitor::getCurrentStateAndTime() const
 {
-  std::unique_lock<std::mutex> slock(state_update_lock_);
-  moveit::core::RobotState* result = new moveit::core::RobotState(robot_state_);
-  return std::make_pair(moveit::core::RobotStatePtr(result), current_state_time_);
+  const StateSnapshotConstPtr snapshot = getSnapshot();
+  moveit::core::RobotState* result = new moveit::core::RobotState(snapshot->state);
+  return std::make_pair(moveit::core::RobotStatePtr(result), snapshot->stamp);
 }
 
 std::map<std::string, double> CurrentStateMonitor::getCurrentStateValues() const
 {
   std::map<std::string, double> m;
-  std::unique_lock<std::mutex> slock(state_update_lock_);
-  const double* pos = robot_state_.getVariablePositions();
-  const std::vector<std::string>& names = robot_state_.getVariableNames();
+  const StateSnapshotConstPtr snapshot = getSnapshot();
+  const double* pos = snapshot->state.getVariablePositions();
+  const std::vector<std::string>& names = snapshot->state.getVariableNames();
   for (std::size_t i = 0; i < names.size(); ++i)
     m[names[i]] = pos[i];
   return m;
@@ -109,24 +160,25 @@ std::map<std::string, double> CurrentStateMonitor::getCurrentStateValues() const
 
 void CurrentStateMonitor::setToCurrentState(moveit::core::RobotState& upd) const
 {
-  std::unique_lock<std::mutex> slock(state_update_lock_);
-  const double* pos = robot_state_.getVariablePositions();
+  const StateSnapshotConstPtr snapshot = getSnapshot();
+  const moveit::core::RobotState& current_state = snapshot->state;
+  const double* pos = current_state.getVariablePositions();
   upd.setVariablePositions(pos);
   if (copy_dynamics_)
   {
-    if (robot_state_.hasVelocities())
+    if (current_state.hasVelocities())
     {
-      const double* vel = robot_state_.getVariableVelocities();
+      const double* vel = current_state.getVariableVelocities();
       upd.setVariableVelocities(vel);
     }
-    if (robot_state_.hasAccelerations())
+    if (current_state.hasAccelerations())
     {
-      const double* acc = robot_state_.getVariableAccelerations();
+      const double* acc = current_state.getVariableAccelerations();
       upd.setVariableAccelerations(acc);
     }
-    if (robot_state_.hasEffort())
+    if (current_state.hasEffort())
     {
-      const double* eff = robot_state_.getVariableEffort();
+      const double* eff = current_state.getVariableEffort();
       upd.setVariableEffort(eff);
     }
   }
@@ -147,7 +199,7 @@ void CurrentStateMonitor::startStateMonitor(const std::string& joint_states_topi
 {
   if (!state_monitor_started_ && robot_model_)
   {
-    joint_time_.clear();
+    resetJointTimes();
     if (joint_states_topic.empty())
     {
       RCLCPP_ERROR(LOGGER, "The joint states topic cannot be an empty string");
@@ -201,18 +253,17 @@ bool CurrentStateMonitor::haveCompleteStateHelper(const rclcpp::Time& oldest_all
                                                   std::vector<std::string>* missing_joints) const
 {
   const std::vector<const moveit::core::JointModel*>& active_joints = robot_model_->getActiveJointModels();
-  std::unique_lock<std::mutex> slock(state_update_lock_);
   for (const moveit::core::JointModel* joint : active_joints)
   {
-    std::map<const moveit::core::JointModel*, rclcpp::Time>::const_iterator it = joint_time_.find(joint);
-    if (it == joint_time_.end())
+    rclcpp::Time joint_time;
+    if (!getJointTime(joint, joint_time))
     {
       RCLCPP_DEBUG(LOGGER, "Joint '%s' has never been updated", joint->getName().c_str());
     }
-    else if (it->second < oldest_allowed_update_time)
+    else if (joint_time < oldest_allowed_update_time)
     {
       RCLCPP_DEBUG(LOGGER, "Joint '%s' was last updated %0.3lf seconds before requested time", joint->getName().c_str(),
-                   (oldest_allowed_update_time - it->second).seconds());
+                   (oldest_allowed_update_time - joint_time).seconds());
     }
     else
       continue;
@@ -232,7 +283,7 @@ bool CurrentStateMonitor::waitForCurrentState(const rclcpp::Time& t, double wait
   rclcpp::Duration timeout = rclcpp::Duration::from_seconds(wait_time_s);
 
   std::unique_lock<std::mutex> lock(state_update_lock_);
-  while (current_state_time_ < t)
+  while (getSnapshot()->stamp < t)
   {
     state_update_condition_.wait_for(lock, (timeout - elapsed).to_chrono<std::chrono::duration<double>>());
     elapsed = middleware_handle_->now() - start;
@@ -305,7 +356,6 @@ void CurrentStateMonitor::jointStateCallback(sensor_msgs::msg::JointState::Const
     std::unique_lock<std::mutex> _(state_update_lock_);
     // read the received values, and update their time stamps
     std::size_t n = joint_state->name.size();
-    current_state_time_ = joint_state->header.stamp;
     for (std::size_t i = 0; i < n; ++i)
     {
       const moveit::core::JointModel* jm = robot_model_->getJointModel(joint_state->name[i]);
@@ -315,7 +365,7 @@ void CurrentStateMonitor::jointStateCallback(sensor_msgs::msg::JointState::Const
       if (jm->getVariableCount() != 1)
         continue;
 
-      joint_time_[jm] = joint_state->header.stamp;
+      setJointTime(jm, joint_state->header.stamp);
 
       if (robot_state_.getJointPositions(jm)[0] != joint_state->position[i])
       {
@@ -358,6 +408,9 @@ void CurrentStateMonitor::jointStateCallback(sensor_msgs::msg::JointState::Const
         }
       }
     }
+
+    // make the new values and time stamp visible to the readers
+    publishSnapshot(joint_state->header.stamp);
   }
 
   // callbacks, if needed
@@ -402,9 +455,11 @@ void CurrentStateMonitor::tfCallback()
       }
 
       // allow update if time is more recent or if it is a static transform (time = 0)
-      if (latest_common_time <= joint_time_[joint] && latest_common_time > rclcpp::Time(0))
+      rclcpp::Time last_update_time;
+      if (getJointTime(joint, last_update_time) && latest_common_time <= last_update_time &&
+          latest_common_time > rclcpp::Time(0))
         continue;
-      joint_time_[joint] = latest_common_time;
+      setJointTime(joint, latest_common_time);
 
       std::vector<double> new_values(joint->getStateSpaceDimension());
       const moveit::core::LinkModel* link = joint->getChildLinkModel();
@@ -422,6 +477,9 @@ void CurrentStateMonitor::tfCallback()
       robot_state_.setJointPositions(joint, new_values.data());
       update = true;
     }
+
+    if (update)
+      publishSnapshot(getSnapshot()->stamp);
   }
 
   // callbacks, if needed
@@ -34,9 +34,13 @@
 
 /* Author: Tyler Weaver */
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -195,6 +199,89 @@ TEST(CurrentStateMonitorTests, WaitForCompleteStateWaits)
   EXPECT_NEAR(nanoseconds_slept.count(), 1e+9, 1e3);
 }
 
+sensor_msgs::msg::JointState::ConstSharedPtr makePandaJointState(double position, int32_t seconds)
+{
+  auto joint_state = std::make_shared<sensor_msgs::msg::JointState>();
+  joint_state->header.stamp = rclcpp::Time(seconds, 0, RCL_ROS_TIME);
+  for (int i = 1; i <= 7; ++i)
+  {
+    joint_state->name.push_back("panda_joint" + std::to_string(i));
+    joint_state->position.push_back(position);
+  }
+  return joint_state;
+}
+
+TEST(CurrentStateMonitorTests, JointStateUpdatesCurrentState)
+{
+  auto mock_middleware_handle = std::make_unique<MockMiddlewareHandle>();
+  planning_scene_monitor::JointStateUpdateCallback joint_state_callback;
+  EXPECT_CALL(*mock_middleware_handle, createJointStateSubscription)
+      .WillOnce(testing::SaveArg<1>(&joint_state_callback));
+
+  // GIVEN a started CurrentStateMonitor
+  planning_scene_monitor::CurrentStateMonitor current_state_monitor{
+    std::move(mock_middleware_handle), moveit::core::loadTestingRobotModel("panda"),
+    std::make_shared<tf2_ros::Buffer>(std::make_shared<rclcpp::Clock>())
+  };
+  current_state_monitor.startStateMonitor();
+
+  // WHEN it receives a joint state
+  joint_state_callback(makePandaJointState(0.5, 10));
+
+  // THEN we expect the current state, its time and the joint times to reflect it
+  EXPECT_EQ(current_state_monitor.getCurrentState()->getVariablePosition("panda_joint1"), 0.5);
+  EXPECT_EQ(current_state_monitor.getCurrentStateTime(), rclcpp::Time(10, 0, RCL_ROS_TIME));
+  EXPECT_EQ(current_state_monitor.getCurrentStateValues()["panda_joint7"], 0.5);
+  std::vector<std::string> missing_joints;
+  current_state_monitor.haveCompleteState(rclcpp::Time(10, 0, RCL_ROS_TIME), missing_joints);
+  EXPECT_EQ(std::count(missing_joints.begin(), missing_joints.end(), "panda_joint1"), 0);
+  missing_joints.clear();
+  current_state_monitor.haveCompleteState(rclcpp::Time(11, 0, RCL_ROS_TIME), missing_joints);
+  EXPECT_EQ(std::count(missing_joints.begin(), missing_joints.end(), "panda_joint1"), 1);
+}
+
+TEST(CurrentStateMonitorTests, ConcurrentReadersSeeCompleteUpdates)
+{
+  auto mock_middleware_handle = std::make_unique<MockMiddlewareHandle>();
+  planning_scene_monitor::JointStateUpdateCallback joint_state_callback;
+  EXPECT_CALL(*mock_middleware_handle, createJointStateSubscription)
+      .WillOnce(testing::SaveArg<1>(&joint_state_callback));
+
+  // GIVEN a started CurrentStateMonitor that already received a joint state
+  planning_scene_monitor::CurrentStateMonitor current_state_monitor{
+    std::move(mock_middleware_handle), moveit::core::loadTestingRobotModel("panda"),
+    std::make_shared<tf2_ros::Buffer>(std::make_shared<rclcpp::Clock>())
+  };
+  current_state_monitor.startStateMonitor();
+  joint_state_callback(makePandaJointState(0.0, 1));
+
+  // WHEN readers query the state while joint states are received, with all joints set to the same value
+  std::atomic<bool> done(false);
+  std::atomic<int> torn_reads(0);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 4; ++r)
+    readers.emplace_back([&]() {
+      moveit::core::RobotState state(current_state_monitor.getRobotModel());
+      while (!done)
+      {
+        current_state_monitor.setToCurrentState(state);
+        for (int i = 2; i <= 7; ++i)
+          if (state.getVariablePosition("panda_joint" + std::to_string(i)) != state.getVariablePosition("panda_joint1"))
+            ++torn_reads;
+      }
+    });
+  for (int i = 2; i <= 2000; ++i)
+    joint_state_callback(makePandaJointState(i * 1e-3, i));
+  done = true;
+  for (std::thread& reader : readers)
+    reader.join();
+
+  // THEN we expect every read to be one of the received states, and the last one to be current
+  EXPECT_EQ(torn_reads, 0);
+  EXPECT_DOUBLE_EQ(current_state_monitor.getCurrentState()->getVariablePosition("panda_joint7"), 2.0);
+  EXPECT_EQ(current_state_monitor.getCurrentStateTime(), rclcpp::Time(2000, 0, RCL_ROS_TIME));
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
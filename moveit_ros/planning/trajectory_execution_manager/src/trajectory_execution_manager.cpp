@@ -36,6 +36,7 @@
 
 #include <moveit/trajectory_execution_manager/trajectory_execution_manager.h>
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/profiler/tracer.h>
 #include <geometric_shapes/check_isometry.h>
 #include <tf2_eigen/tf2_eigen.h>
 
@@ -1353,6 +1354,7 @@ void TrajectoryExecutionManager::executeThread(const ExecutionCompleteCallback&
 
 bool TrajectoryExecutionManager::executePart(std::size_t part_index)
 {
+  MOVEIT_TRACE_SCOPE("TrajectoryExecutionManager::executePart");
   TrajectoryExecutionContext& context = *trajectories_[part_index];
 
   // first make sure desired controllers are active